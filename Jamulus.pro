@@ -334,8 +334,11 @@ HEADERS += src/audiomixerboard.h \
     src/clientdlg.h \
     src/serverdlg.h \
     src/multicolorled.h \
+    src/mixkernels.h \
+    src/driftcomp.h \
     src/multicolorledbar.h \
     src/protocol.h \
+    src/rtallocguard.h \
     src/server.h \
     src/serverlist.h \
     src/serverlogging.h \
@@ -451,8 +454,11 @@ SOURCES += src/audiomixerboard.cpp \
     src/serverdlg.cpp \
     src/main.cpp \
     src/multicolorled.cpp \
+    src/mixkernels.cpp \
+    src/driftcomp.cpp \
     src/multicolorledbar.cpp \
     src/protocol.cpp \
+    src/rtallocguard.cpp \
     src/server.cpp \
     src/serverlist.cpp \
     src/serverlogging.cpp \
@@ -974,6 +980,13 @@ DISTFILES_OPUS += libs/opus/AUTHORS \
     libs/opus/celt/arm/armopts.s.in \
     libs/opus/celt/arm/celt_pitch_xcorr_arm.s \
 
+# optional real-time allocation guard which counts the memory allocations of
+# the real-time threads in their steady state (for debugging)
+contains(CONFIG, "rtallocguard") {
+    message(The real-time allocation guard is enabled.)
+    DEFINES += RT_ALLOC_GUARD
+}
+
 # use external OPUS library if requested
 contains(CONFIG, "opus_shared_lib") {
     message(OPUS codec is used from a shared library.)
@@ -120,8 +120,9 @@ CChannelFader::CChannelFader ( QWidget*     pNW,
     pMainGrid->addWidget ( pMuteSoloBox, 0, Qt::AlignHCenter );
     pMainGrid->addWidget ( pLabelInstBox );
 
-    // add fader frame to audio mixer board layout
-    pParentLayout->addWidget( pFrame );
+    // add fader frame to audio mixer board layout (in front of the spacer at
+    // the end of the layout)
+    pParentLayout->insertWidget ( pParentLayout->count() - 1, pFrame );
 
     // reset current fader
     Reset();
@@ -607,7 +608,10 @@ CAudioMixerBoard::CAudioMixerBoard ( QWidget* parent, Qt::WindowFlags ) :
     vecStoredFaderIsSolo ( MAX_NUM_STORED_FADER_SETTINGS, false ),
     vecStoredFaderIsMute ( MAX_NUM_STORED_FADER_SETTINGS, false ),
     iNewClientFaderLevel ( 100 ),
+    vecpChanFader        ( 0 ),
+    bDisplayPans         ( false ),
     bNoFaderVisible      ( true ),
+    eGUIDesign           ( GD_STANDARD ),
     strServerName        ( "" )
 {
     // add group box and hboxlayout
@@ -619,16 +623,8 @@ CAudioMixerBoard::CAudioMixerBoard ( QWidget* parent, Qt::WindowFlags ) :
     // set title text (default: no server given)
     SetServerName ( "" );
 
-    // create all mixer controls and make them invisible
-    vecpChanFader.Init ( MAX_NUM_CHANNELS );
-
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
-    {
-        vecpChanFader[i] = new CChannelFader ( this, pMainLayout );
-        vecpChanFader[i]->Hide();
-    }
-
-    // insert horizontal spacer
+    // insert horizontal spacer (the mixer controls are created when the
+    // channels appear in the connected clients list)
     pMainLayout->addItem ( new QSpacerItem ( 0, 0, QSizePolicy::Expanding ) );
 
     // set margins of the layout to zero to get maximum space for the controls
@@ -640,37 +636,36 @@ CAudioMixerBoard::CAudioMixerBoard ( QWidget* parent, Qt::WindowFlags ) :
     pScrollArea->setWidgetResizable ( true ); // make sure it fills the entire scroll area
     pScrollArea->setFrameShape ( QFrame::NoFrame );
     pGroupBoxLayout->addWidget ( pScrollArea );
-
-
-    // Connections -------------------------------------------------------------
-    connectFaderSignalsToMixerBoardSlots<MAX_NUM_CHANNELS>();
 }
 
-template<unsigned int slotId>
-inline void CAudioMixerBoard::connectFaderSignalsToMixerBoardSlots()
+void CAudioMixerBoard::CreateFaders ( const int iNewNumFaders )
 {
-    int iCurChanID = slotId - 1;
-
-    void ( CAudioMixerBoard::* pGainValueChanged )( double ) =
-        &CAudioMixerBoardSlots<slotId>::OnChGainValueChanged;
-
-    void ( CAudioMixerBoard::* pPanValueChanged )( double ) =
-        &CAudioMixerBoardSlots<slotId>::OnChPanValueChanged;
+    // create the missing mixer controls in the order of the channel IDs and
+    // make them invisible
+    for ( int i = vecpChanFader.Size(); i < iNewNumFaders; i++ )
+    {
+        CChannelFader* pChanFader = new CChannelFader ( this, pMainLayout );
 
-    QObject::connect ( vecpChanFader[iCurChanID], &CChannelFader::soloStateChanged,
-                       this, &CAudioMixerBoard::UpdateSoloStates );
+        pChanFader->SetGUIDesign ( eGUIDesign );
+        pChanFader->SetDisplayChannelLevel ( false );
+        pChanFader->SetDisplayPans ( bDisplayPans );
+        pChanFader->Hide();
 
-    QObject::connect ( vecpChanFader[iCurChanID], &CChannelFader::gainValueChanged,
-                       this, pGainValueChanged );
+        vecpChanFader.Add ( pChanFader );
 
-    QObject::connect ( vecpChanFader[iCurChanID], &CChannelFader::panValueChanged,
-                       this, pPanValueChanged );
+        QObject::connect ( pChanFader, &CChannelFader::soloStateChanged,
+                           this, &CAudioMixerBoard::UpdateSoloStates );
 
-    connectFaderSignalsToMixerBoardSlots<slotId - 1>();
-};
+        // the channel ID is bound to the gain/pan signals of the fader
+        QObject::connect ( pChanFader, &CChannelFader::gainValueChanged, this,
+                           [this, i] ( double dValue )
+                           { UpdateGainValue ( i, dValue ); } );
 
-template<>
-inline void CAudioMixerBoard::connectFaderSignalsToMixerBoardSlots<0>() {};
+        QObject::connect ( pChanFader, &CChannelFader::panValueChanged, this,
+                           [this, i] ( double dValue )
+                           { UpdatePanValue ( i, dValue ); } );
+    }
+}
 
 void CAudioMixerBoard::SetServerName ( const QString& strNewServerName )
 {
@@ -695,8 +690,10 @@ void CAudioMixerBoard::SetServerName ( const QString& strNewServerName )
 
 void CAudioMixerBoard::SetGUIDesign ( const EGUIDesign eNewDesign )
 {
+    eGUIDesign = eNewDesign;
+
     // apply GUI design to child GUI controls
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    for ( int i = 0; i < vecpChanFader.Size(); i++ )
     {
         vecpChanFader[i]->SetGUIDesign ( eNewDesign );
     }
@@ -711,7 +708,7 @@ void CAudioMixerBoard::SetDisplayChannelLevels ( const bool eNDCL )
     if ( !bDisplayChannelLevels )
     {
         // hide all level meters
-        for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+        for ( int i = 0; i < vecpChanFader.Size(); i++ )
         {
             vecpChanFader[i]->SetDisplayChannelLevel ( false );
         }
@@ -720,7 +717,9 @@ void CAudioMixerBoard::SetDisplayChannelLevels ( const bool eNDCL )
 
 void CAudioMixerBoard::SetPanIsSupported()
 {
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    bDisplayPans = true;
+
+    for ( int i = 0; i < vecpChanFader.Size(); i++ )
     {
         vecpChanFader[i]->SetDisplayPans ( true );
     }
@@ -728,8 +727,10 @@ void CAudioMixerBoard::SetPanIsSupported()
 
 void CAudioMixerBoard::HideAll()
 {
+    bDisplayPans = false;
+
     // make all controls invisible
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    for ( int i = 0; i < vecpChanFader.Size(); i++ )
     {
         // before hiding the fader, store its level (if some conditions are fullfilled)
         StoreFaderSettings ( vecpChanFader[i] );
@@ -759,9 +760,22 @@ void CAudioMixerBoard::ApplyNewConClientList ( CVector<CChannelInfo>& vecChanInf
     // get number of connected clients
     const int iNumConnectedClients = vecChanInfo.Size();
 
+    // make sure that there is a fader for each channel ID in the list
+    int iNumRequiredFaders = 0;
+
+    for ( int j = 0; j < iNumConnectedClients; j++ )
+    {
+        if ( vecChanInfo[j].iChanID < MAX_NUM_CHANNELS )
+        {
+            iNumRequiredFaders = std::max ( iNumRequiredFaders, vecChanInfo[j].iChanID + 1 );
+        }
+    }
+
+    CreateFaders ( iNumRequiredFaders );
+
     // search for channels with are already present and preserve their gain
     // setting, for all other channels reset gain
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    for ( int i = 0; i < vecpChanFader.Size(); i++ )
     {
         bool bFaderIsUsed = false;
 
@@ -850,7 +864,7 @@ void CAudioMixerBoard::SetFaderLevel ( const int iChannelIdx,
                                        const int iValue )
 {
     // only apply new fader level if channel index is valid and the fader is visible
-    if ( ( iChannelIdx >= 0 ) && ( iChannelIdx < MAX_NUM_CHANNELS ) )
+    if ( ( iChannelIdx >= 0 ) && ( iChannelIdx < vecpChanFader.Size() ) )
     {
         if ( vecpChanFader[iChannelIdx]->IsVisible() )
         {
@@ -863,7 +877,7 @@ void CAudioMixerBoard::SetRemoteFaderIsMute ( const int  iChannelIdx,
                                               const bool bIsMute )
 {
     // only apply remote mute state if channel index is valid and the fader is visible
-    if ( ( iChannelIdx >= 0 ) && ( iChannelIdx < MAX_NUM_CHANNELS ) )
+    if ( ( iChannelIdx >= 0 ) && ( iChannelIdx < vecpChanFader.Size() ) )
     {
         if ( vecpChanFader[iChannelIdx]->IsVisible() )
         {
@@ -877,7 +891,7 @@ void CAudioMixerBoard::UpdateSoloStates()
     // first check if any channel has a solo state active
     bool bAnyChannelIsSolo = false;
 
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    for ( int i = 0; i < vecpChanFader.Size(); i++ )
     {
         // check if fader is in use and has solo state active
         if ( vecpChanFader[i]->IsVisible() && vecpChanFader[i]->IsSolo() )
@@ -888,7 +902,7 @@ void CAudioMixerBoard::UpdateSoloStates()
     }
 
     // now update the solo state of all active faders
-    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    for ( int i = 0; i < vecpChanFader.Size(); i++ )
     {
         if ( vecpChanFader[i]->IsVisible() )
         {
@@ -992,7 +1006,7 @@ void CAudioMixerBoard::SetChannelLevels ( const CVector<uint16_t>& vecChannelLev
     const int iNumChannelLevels = vecChannelLevel.Size();
     int       i                 = 0;
 
-    for ( int iChId = 0; iChId < MAX_NUM_CHANNELS; iChId++ )
+    for ( int iChId = 0; iChId < vecpChanFader.Size(); iChId++ )
     {
         if ( vecpChanFader[iChId]->IsVisible() && i < iNumChannelLevels )
         {
@@ -112,27 +112,7 @@ signals:
     void soloStateChanged ( int value );
 };
 
-template<unsigned int slotId>
-class CAudioMixerBoardSlots : public CAudioMixerBoardSlots<slotId - 1>
-{
-public:
-    void OnChGainValueChanged ( double dValue ) { UpdateGainValue ( slotId - 1, dValue ); }
-    void OnChPanValueChanged ( double dValue ) { UpdatePanValue ( slotId - 1, dValue ); }
-
-protected:
-    virtual void UpdateGainValue ( const int    iChannelIdx,
-                                   const double dValue ) = 0;
-    virtual void UpdatePanValue ( const int    iChannelIdx,
-                                  const double dValue ) = 0;
-};
-
-template<>
-class CAudioMixerBoardSlots<0> {};
-
-
-class CAudioMixerBoard :
-    public QGroupBox,
-    public CAudioMixerBoardSlots<MAX_NUM_CHANNELS>
+class CAudioMixerBoard : public QGroupBox
 {
     Q_OBJECT
 
@@ -184,24 +164,26 @@ protected:
 
     void StoreFaderSettings ( CChannelFader* pChanFader );
     void UpdateSoloStates();
+    void CreateFaders ( const int iNewNumFaders );
 
     void OnGainValueChanged ( const int    iChannelIdx,
                               const double dValue );
 
+    // the faders are only created for the channel IDs the server actually
+    // uses (the index of a fader is the channel ID)
     CVector<CChannelFader*> vecpChanFader;
     CMixerBoardScrollArea*  pScrollArea;
     QHBoxLayout*            pMainLayout;
     bool                    bDisplayChannelLevels;
+    bool                    bDisplayPans;
     bool                    bNoFaderVisible;
+    EGUIDesign              eGUIDesign;
     QString                 strServerName;
 
-    virtual void UpdateGainValue ( const int    iChannelIdx,
-                                   const double dValue );
-    virtual void UpdatePanValue ( const int    iChannelIdx,
-                                  const double dValue );
-
-    template<unsigned int slotId>
-    inline void connectFaderSignalsToMixerBoardSlots();
+    void UpdateGainValue ( const int    iChannelIdx,
+                           const double dValue );
+    void UpdatePanValue ( const int    iChannelIdx,
+                          const double dValue );
 
 signals:
     void ChangeChanGain ( int iId, double dGain );
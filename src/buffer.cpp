@@ -5,7 +5,8 @@
  *  Volker Fischer
  *
  * Note: We are assuming here that put and get operations are secured by a mutex
- *       and accessing does not occur at the same time.
+ *       and accessing does not occur at the same time (except of the lock-free
+ *       network buffer).
  *
  ******************************************************************************
  *
@@ -117,10 +118,13 @@ CNetBufWithStats::CNetBufWithStats() :
     viBufSizesForSim[8] = 10;
     viBufSizesForSim[9] = 11;
 
-    // set all simulation buffers in simulation mode
+    // the simulation buffers are empty until the first initialization
+    iSimBlockSize = 0;
+
     for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
     {
-        SimulationBuffer[i].SetIsSimulation ( true );
+        viSimBufFillLevel[i] = 0;
+        viSimBufMemSize[i]   = 0;
     }
 }
 
@@ -173,10 +177,13 @@ void CNetBufWithStats::Init ( const int  iNewBlockSize,
             dUpMaxErrorBound          = UP_MAX_ERROR_BOUND;
         }
 
+        iSimBlockSize = iNewBlockSize;
+
         for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
         {
-            // init simulation buffers with the correct size
-            SimulationBuffer[i].Init ( iNewBlockSize, viBufSizesForSim[i] );
+            // init simulation buffers with the correct size (empty buffers)
+            viSimBufFillLevel[i] = 0;
+            viSimBufMemSize[i]   = iNewBlockSize * viBufSizesForSim[i];
 
             // init statistics
             ErrorRateStatistic[i].Init ( iMaxStatisticCount, true );
@@ -210,11 +217,7 @@ bool CNetBufWithStats::Put ( const CVector<uint8_t>& vecbyData,
     const bool bPutOK = CNetBuf::Put ( vecbyData, iInSize );
 
     // update statistics calculations
-    for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
-    {
-        ErrorRateStatistic[i].Update (
-            !SimulationBuffer[i].Put ( vecbyData, iInSize ) );
-    }
+    UpdateSimulationPut ( iInSize );
 
     return bPutOK;
 }
@@ -226,11 +229,7 @@ bool CNetBufWithStats::Get ( CVector<uint8_t>& vecbyData,
     const bool bGetOK = CNetBuf::Get ( vecbyData, iOutSize );
 
     // update statistics calculations
-    for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
-    {
-        ErrorRateStatistic[i].Update (
-            !SimulationBuffer[i].Get ( vecbyData, iOutSize ) );
-    }
+    UpdateSimulationGet ( iOutSize );
 
     // update auto setting
     UpdateAutoSetting();
@@ -238,6 +237,52 @@ bool CNetBufWithStats::Get ( CVector<uint8_t>& vecbyData,
     return bGetOK;
 }
 
+void CNetBufWithStats::UpdateSimulationPut ( const int iInSize )
+{
+    // a put fails if there is not enough space available in the simulated
+    // buffer (same as in CNetBuf::Put)
+    for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+    {
+        const bool bPutOK =
+            ( viSimBufMemSize[i] - viSimBufFillLevel[i] >= iInSize );
+
+        if ( bPutOK )
+        {
+            // note that the buffer implementation treats an empty put into an
+            // empty buffer as a full buffer (equal read and write positions)
+            if ( ( iInSize == 0 ) && ( viSimBufFillLevel[i] == 0 ) )
+            {
+                viSimBufFillLevel[i] = viSimBufMemSize[i];
+            }
+            else
+            {
+                viSimBufFillLevel[i] += iInSize;
+            }
+        }
+
+        ErrorRateStatistic[i].Update ( !bPutOK );
+    }
+}
+
+void CNetBufWithStats::UpdateSimulationGet ( const int iOutSize )
+{
+    // a get fails if the size is not exactly one block or if there is not
+    // enough data available in the simulated buffer (same as in CNetBuf::Get)
+    const bool bSizeOK = ( iOutSize != 0 ) && ( iOutSize == iSimBlockSize );
+
+    for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+    {
+        const bool bGetOK = bSizeOK && ( viSimBufFillLevel[i] >= iOutSize );
+
+        if ( bGetOK )
+        {
+            viSimBufFillLevel[i] -= iOutSize;
+        }
+
+        ErrorRateStatistic[i].Update ( !bGetOK );
+    }
+}
+
 void CNetBufWithStats::UpdateAutoSetting()
 {
     int  iCurDecision      = 0; // dummy initialization
@@ -384,3 +429,628 @@ else
         }
     }
 }
+
+
+/* Lock-free network buffer with statistic calculations implementation ********/
+CLockFreeNetBufWithStats::CLockFreeNetBufWithStats() :
+    iAccessState        ( 0 ),
+    iPutIdx             ( 0 ),
+    iGetIdx             ( 0 ),
+    iLastPutSize        ( 0 ),
+    iPendingPutWriteIdx ( 0 ),
+    iPendingPutReadIdx  ( 0 ),
+    iLastPutTimeUs      ( 0 ),
+    bUseBlockStates     ( false ),
+    bSeqNumIsSynced     ( false ),
+    iNextSeqNum         ( 0 ),
+    iSeqNumHistory      ( 0 ),
+    iSeqMappedSize      ( 0 ),
+    iPrevTimestamp      ( 0 ),
+    iPrevArrivalTimeUs  ( 0 ),
+    bHasPrevTimestamp   ( false ),
+    dJitterUs           ( 0.0 ),
+    iNumSeqReceived     ( 0 ),
+    iNumSeqLostBlocks   ( 0 ),
+    iNumSeqReordered    ( 0 ),
+    iNumSeqLate         ( 0 ),
+    iNumSeqDuplicate    ( 0 ),
+    iNumSeqRecovered    ( 0 ),
+    iSeqJitterUs        ( 0 ),
+    iSeqBlocksPerPacket ( 1 )
+{
+    ArrivalTimer.start();
+}
+
+bool CLockFreeNetBufWithStats::BeginAccess ( const int iAccessFlag )
+{
+    // announce the access and check that no re-initialization is in progress
+    // (since all flags are in one atomic variable, either the access or the
+    // re-initialization sees the flag of the other one)
+    if ( ( iAccessState.fetchAndAddOrdered ( iAccessFlag ) & AS_REINIT ) != 0 )
+    {
+        EndAccess ( iAccessFlag );
+        return false;
+    }
+
+    // the buffer must be initialized before the first access
+    if ( !bIsInitialized )
+    {
+        EndAccess ( iAccessFlag );
+        return false;
+    }
+
+    return true;
+}
+
+void CLockFreeNetBufWithStats::Init ( const int  iNewBlockSize,
+                                      const int  iNewNumBlocks,
+                                      const bool bPreserve )
+{
+    // block new accesses and wait for running accesses to be finished (this
+    // takes at most the time of one Put()/Get() call)
+    iAccessState.fetchAndAddOrdered ( AS_REINIT );
+
+    while ( ( iAccessState.loadAcquire() & ( AS_PUT_ACTIVE | AS_GET_ACTIVE ) ) != 0 )
+    {
+        QThread::yieldCurrentThread();
+    }
+
+    // block states of the stored blocks in the order of the data
+    int viOldBlockState[MAX_NUM_BLOCK_STATES];
+    int iNumOldBlockStates = 0;
+
+    if ( bIsInitialized )
+    {
+        // transfer the current positions to the base class so that the data
+        // can be preserved by the base class Init
+        const int iCurPutIdx = iPutIdx.loadAcquire();
+        const int iCurGetIdx = iGetIdx.loadAcquire();
+        const int iNumUsed   = GetNumUsed ( iCurPutIdx, iCurGetIdx );
+
+        if ( bUseBlockStates )
+        {
+            // the stored data may end within a block after a put with a wrong
+            // size, therefore the blocks are counted instead of comparing the
+            // position with the put position
+            const int iNumUsedBlocks = ( iNumUsed + iBlockSize - 1 ) / iBlockSize;
+
+            for ( int iIdx = iCurGetIdx; iNumOldBlockStates < iNumUsedBlocks; iIdx = AdvanceIdx ( iIdx, iBlockSize ) )
+            {
+                viOldBlockState[iNumOldBlockStates++] = viBlockState[GetBlockIdx ( iIdx )].loadAcquire();
+            }
+        }
+
+        iPutPos = GetMemPos ( iCurPutIdx );
+        iGetPos = GetMemPos ( iCurGetIdx );
+
+        if ( iNumUsed == 0 )
+        {
+            eBufState = CBufferBase<uint8_t>::BS_EMPTY;
+        }
+        else if ( iNumUsed == iMemSize )
+        {
+            eBufState = CBufferBase<uint8_t>::BS_FULL;
+        }
+        else
+        {
+            eBufState = CBufferBase<uint8_t>::BS_OK;
+        }
+    }
+
+    // call base class Init
+    CNetBufWithStats::Init ( iNewBlockSize, iNewNumBlocks, bPreserve );
+
+    // the auto jitter buffer size setting changes the size in the real-time
+    // thread with preserved data, the memory for the maximum size is therefore
+    // reserved here so that a size change does not allocate memory
+    if ( !bPreserve )
+    {
+        vecMemory.reserve ( iNewBlockSize * MAX_NET_BUF_SIZE_NUM_BL );
+        vecTempMemory.reserve ( iNewBlockSize * MAX_NET_BUF_SIZE_NUM_BL );
+    }
+
+    // take over the new positions from the base class
+    iGetIdx.storeRelease ( iGetPos );
+    iPutIdx.storeRelease ( iGetPos + CBufferBase<uint8_t>::GetAvailData() );
+
+    // the block states are only supported for a limited number of blocks
+    bUseBlockStates = ( iBlockSize > 0 ) && ( iMemSize / iBlockSize <= MAX_NUM_BLOCK_STATES );
+
+    if ( bUseBlockStates )
+    {
+        // the preserved data start at the get position zero (blocks which
+        // were not tracked are valid)
+        for ( int i = 0; i < iMemSize / iBlockSize; i++ )
+        {
+            viBlockState[i].storeRelease ( ( i < iNumOldBlockStates ) ? viOldBlockState[i] : BL_VALID );
+        }
+    }
+
+    // the next packet with sequence number defines the new sequence
+    bSeqNumIsSynced   = false;
+    bHasPrevTimestamp = false;
+
+    if ( !bPreserve )
+    {
+        // the statistic was reset, too
+        iPendingPutReadIdx.storeRelease ( iPendingPutWriteIdx.loadAcquire() );
+    }
+
+    // allow the accesses again
+    iAccessState.fetchAndAddOrdered ( -AS_REINIT );
+}
+
+bool CLockFreeNetBufWithStats::Put ( const CVector<uint8_t>& vecbyData,
+                                     const int               iInSize )
+{
+    // if the buffer is just re-initialized, the packet is dropped
+    if ( !BeginAccess ( AS_PUT_ACTIVE ) )
+    {
+        return false;
+    }
+
+    bool bPutOK = false;
+
+    // the put position is only modified by this thread
+    const int iCurPutIdx = iPutIdx.loadAcquire();
+    const int iCurGetIdx = iGetIdx.loadAcquire();
+
+    // check if there is enough space available
+    if ( iMemSize - GetNumUsed ( iCurPutIdx, iCurGetIdx ) >= iInSize )
+    {
+        // copy new data in internal buffer
+        CopyToMemory ( vecbyData, 0, iCurPutIdx, iInSize );
+        SetBlockStates ( iCurPutIdx, iInSize, BL_VALID );
+
+        // publish the data to the consumer
+        iPutIdx.storeRelease ( AdvanceIdx ( iCurPutIdx, iInSize ) );
+
+        bPutOK = true;
+    }
+
+    // a packet without sequence number interrupts the sequence
+    bSeqNumIsSynced   = false;
+    bHasPrevTimestamp = false;
+
+    // store the arrival time for the continuous fill level (the time stamp
+    // wraps around after about 71 minutes which is handled in GetFillLevel())
+    iLastPutTimeUs.storeRelease ( static_cast<int> ( ArrivalTimer.nsecsElapsed() / 1000 ) );
+
+    // the statistics calculations are done by the consumer
+    AddPendingPut ( iInSize );
+
+    EndAccess ( AS_PUT_ACTIVE );
+
+    return bPutOK;
+}
+
+bool CLockFreeNetBufWithStats::Get ( CVector<uint8_t>& vecbyData,
+                                     const int         iOutSize )
+{
+    // if the buffer is just re-initialized, we have a buffer underrun
+    if ( !BeginAccess ( AS_GET_ACTIVE ) )
+    {
+        return false;
+    }
+
+    bool bGetOK = false;
+
+    // update statistics calculations with the puts since the last get
+    ApplyPendingPuts();
+
+    // check size and if there is enough data available (the get position is
+    // only modified by this thread)
+    const int iCurPutIdx = iPutIdx.loadAcquire();
+    const int iCurGetIdx = iGetIdx.loadAcquire();
+
+    if ( ( iOutSize != 0 ) && ( iOutSize == iBlockSize ) &&
+         ( GetNumUsed ( iCurPutIdx, iCurGetIdx ) >= iOutSize ) )
+    {
+        // a missing block (or a block which is just written by a reordered
+        // packet) is lost now, the producer is informed by the lost state
+        int iState = BL_VALID;
+
+        if ( bUseBlockStates )
+        {
+            QAtomicInt& iBlockState = viBlockState[GetBlockIdx ( iCurGetIdx )];
+
+            iState = iBlockState.loadAcquire();
+
+            while ( ( iState != BL_VALID ) &&
+                    !iBlockState.testAndSetOrdered ( iState, BL_LOST ) )
+            {
+                iState = iBlockState.loadAcquire();
+            }
+        }
+
+        if ( iState == BL_VALID )
+        {
+            // copy data from internal buffer in output buffer (in two steps
+            // in case of a wrap around)
+            const int iPos          = GetMemPos ( iCurGetIdx );
+            const int iFirstPartLen = std::min ( iOutSize, iMemSize - iPos );
+
+            std::copy ( vecMemory.begin() + iPos,
+                        vecMemory.begin() + iPos + iFirstPartLen,
+                        vecbyData.begin() );
+
+            std::copy ( vecMemory.begin(),
+                        vecMemory.begin() + iOutSize - iFirstPartLen,
+                        vecbyData.begin() + iFirstPartLen );
+
+            bGetOK = true;
+        }
+        else
+        {
+            iNumSeqLostBlocks.fetchAndAddOrdered ( 1 );
+        }
+
+        // release the memory for the producer (a lost block is skipped)
+        iGetIdx.storeRelease ( AdvanceIdx ( iCurGetIdx, iOutSize ) );
+    }
+
+    // update statistics calculations
+    UpdateSimulationGet ( iOutSize );
+
+    // update auto setting
+    UpdateAutoSetting();
+
+    EndAccess ( AS_GET_ACTIVE );
+
+    return bGetOK;
+}
+
+bool CLockFreeNetBufWithStats::PutWithSeqNum ( const CVector<uint8_t>& vecbyData,
+                                               const int               iInSize,
+                                               const uint16_t          iSeqNum,
+                                               const uint16_t          iTimestamp )
+{
+    return PutWithSeqNumIntern ( vecbyData, 0, iInSize, iSeqNum, iTimestamp, false );
+}
+
+bool CLockFreeNetBufWithStats::PutRedundantCopy ( const CVector<uint8_t>& vecbyData,
+                                                  const int               iSrcOffset,
+                                                  const int               iInSize,
+                                                  const uint16_t          iSeqNum )
+{
+    // the timestamp is not used for a redundant copy
+    return PutWithSeqNumIntern ( vecbyData, iSrcOffset, iInSize, iSeqNum, 0, true );
+}
+
+bool CLockFreeNetBufWithStats::PutWithSeqNumIntern ( const CVector<uint8_t>& vecbyData,
+                                                     const int               iSrcOffset,
+                                                     const int               iInSize,
+                                                     const uint16_t          iSeqNum,
+                                                     const uint16_t          iTimestamp,
+                                                     const bool              bIsRedundant )
+{
+    // if the buffer is just re-initialized, the packet is dropped
+    if ( !BeginAccess ( AS_PUT_ACTIVE ) )
+    {
+        return false;
+    }
+
+    // without block states the packet is stored in the order of arrival (a
+    // redundant copy cannot be placed and is dropped)
+    if ( !bUseBlockStates || ( iInSize <= 0 ) || ( iInSize % iBlockSize != 0 ) )
+    {
+        EndAccess ( AS_PUT_ACTIVE );
+        return !bIsRedundant && Put ( vecbyData, iInSize );
+    }
+
+    bool bPutOK       = false;
+    bool bIsNewPacket = true;
+
+    // distance to the expected sequence number (the sequence number wraps
+    // around), a large distance means that the stream was restarted (a
+    // packet which is older than the history is treated as a restart, too)
+    int        iDist     = static_cast<int16_t> ( static_cast<uint16_t> ( iSeqNum - iNextSeqNum ) );
+    const bool bDoResync = !bSeqNumIsSynced ||
+                           ( iDist >= SEQ_NUM_RESYNC_THRESHOLD ) || ( iDist < -SEQ_NUM_HISTORY_LEN );
+
+    // a redundant copy must not define the sequence since the original packet
+    // may still be stored in the buffer (e.g., after a re-initialization)
+    if ( bIsRedundant && bDoResync )
+    {
+        EndAccess ( AS_PUT_ACTIVE );
+        return false;
+    }
+
+    iSeqBlocksPerPacket.storeRelease ( iInSize / iBlockSize );
+
+    if ( !bIsRedundant )
+    {
+        iNumSeqReceived.fetchAndAddOrdered ( 1 );
+    }
+
+    if ( bDoResync )
+    {
+        iNextSeqNum     = iSeqNum;
+        iSeqNumHistory  = 0;
+        iSeqMappedSize  = 0;
+        iDist           = 0;
+        bSeqNumIsSynced = true;
+    }
+
+    // the put position is only modified by this thread
+    const int iCurPutIdx = iPutIdx.loadAcquire();
+    const int iCurGetIdx = iGetIdx.loadAcquire();
+    const int iNumUsed   = GetNumUsed ( iCurPutIdx, iCurGetIdx );
+
+    if ( iDist >= 0 )
+    {
+        // the packet is in order, a gap is left for the missing packets
+        int iGapSize = iDist * iInSize;
+
+        if ( iMemSize - iNumUsed < iGapSize + iInSize )
+        {
+            // the gap does not fit in the buffer, the missing packets are
+            // lost and the gap is skipped
+            iNumSeqLostBlocks.fetchAndAddOrdered ( iGapSize / iBlockSize );
+            iGapSize       = 0;
+            iSeqMappedSize = 0;
+        }
+
+        // if there is not enough space available, the packet is dropped
+        if ( iMemSize - iNumUsed >= iGapSize + iInSize )
+        {
+            const int iPacketIdx = AdvanceIdx ( iCurPutIdx, iGapSize );
+
+            SetBlockStates ( iCurPutIdx, iGapSize, BL_MISSING );
+            CopyToMemory ( vecbyData, iSrcOffset, iPacketIdx, iInSize );
+            SetBlockStates ( iPacketIdx, iInSize, BL_VALID );
+
+            // publish the data to the consumer
+            iPutIdx.storeRelease ( AdvanceIdx ( iPacketIdx, iInSize ) );
+
+            iSeqMappedSize = std::min ( iSeqMappedSize + iGapSize + iInSize, iMemSize );
+            bPutOK         = true;
+
+            if ( bIsRedundant )
+            {
+                iNumSeqRecovered.fetchAndAddOrdered ( 1 );
+            }
+        }
+        else
+        {
+            // the positions of the older packets do not match the sequence
+            // numbers anymore
+            iSeqMappedSize = 0;
+        }
+
+        iSeqNumHistory = ( iDist + 1 >= SEQ_NUM_HISTORY_LEN ) ?
+            1 : ( ( iSeqNumHistory << ( iDist + 1 ) ) | 1 );
+
+        iNextSeqNum = static_cast<uint16_t> ( iSeqNum + 1 );
+
+        // the arrival time is only used for packets in order (the timing of
+        // a redundant copy is the timing of the following packet)
+        iLastPutTimeUs.storeRelease ( static_cast<int> ( ArrivalTimer.nsecsElapsed() / 1000 ) );
+
+        if ( !bIsRedundant )
+        {
+            UpdateJitter ( iTimestamp );
+        }
+    }
+    else
+    {
+        // the packet is older than the last packet (1: previous packet)
+        const int iAge = -iDist;
+
+        if ( ( iAge <= SEQ_NUM_HISTORY_LEN ) && ( ( ( iSeqNumHistory >> ( iAge - 1 ) ) & 1 ) != 0 ) )
+        {
+            // the redundant copy of a received packet is expected
+            if ( !bIsRedundant )
+            {
+                iNumSeqDuplicate.fetchAndAddOrdered ( 1 );
+            }
+
+            bIsNewPacket = false;
+        }
+        else
+        {
+            if ( iAge <= SEQ_NUM_HISTORY_LEN )
+            {
+                iSeqNumHistory |= static_cast<uint64_t> ( 1 ) << ( iAge - 1 );
+            }
+
+            // the packet can only be inserted if its gap was not read yet
+            // (and if the buffer positions still match the sequence numbers)
+            bool bIsInTime = ( iAge * iInSize <= std::min ( iNumUsed, iSeqMappedSize ) );
+
+            if ( bIsInTime )
+            {
+                const int iPacketIdx = AdvanceIdx ( iCurPutIdx, 2 * iMemSize - iAge * iInSize );
+
+                for ( int iOffs = 0; iOffs < iInSize; iOffs += iBlockSize )
+                {
+                    const int   iBlockIdx   = AdvanceIdx ( iPacketIdx, iOffs );
+                    QAtomicInt& iBlockState = viBlockState[GetBlockIdx ( iBlockIdx )];
+
+                    // the block must be claimed before it is written since the
+                    // consumer may read the gap at the same time
+                    if ( iBlockState.testAndSetOrdered ( BL_MISSING, BL_WRITING ) )
+                    {
+                        CopyToMemory ( vecbyData, iSrcOffset + iOffs, iBlockIdx, iBlockSize );
+
+                        bIsInTime = iBlockState.testAndSetOrdered ( BL_WRITING, BL_VALID ) && bIsInTime;
+                    }
+                    else
+                    {
+                        bIsInTime = false;
+                    }
+                }
+            }
+
+            // a redundant copy which is too late is not counted since the
+            // original packet is already counted as lost
+            if ( bIsInTime )
+            {
+                if ( bIsRedundant )
+                {
+                    iNumSeqRecovered.fetchAndAddOrdered ( 1 );
+                }
+                else
+                {
+                    iNumSeqReordered.fetchAndAddOrdered ( 1 );
+                }
+
+                bPutOK = true;
+            }
+            else if ( !bIsRedundant )
+            {
+                iNumSeqLate.fetchAndAddOrdered ( 1 );
+            }
+        }
+    }
+
+    // the statistics calculations are done by the consumer (a duplicate is
+    // no new arrival but a recovered packet is, i.e. the simulated buffers
+    // see the recovered packet at the arrival time of its redundant copy so
+    // that the auto setting can use a smaller buffer if the losses are
+    // recovered in time)
+    if ( bIsNewPacket )
+    {
+        AddPendingPut ( iInSize );
+    }
+
+    EndAccess ( AS_PUT_ACTIVE );
+
+    return bPutOK;
+}
+
+CNetBufSeqStatistic CLockFreeNetBufWithStats::GetAndResetSeqStatistic()
+{
+    CNetBufSeqStatistic SeqStatistic;
+
+    // the lost blocks are converted to packets
+    const int iBlocksPerPacket = std::max ( 1, iSeqBlocksPerPacket.loadAcquire() );
+
+    SeqStatistic.iNumReceived  = iNumSeqReceived.fetchAndStoreOrdered ( 0 );
+    SeqStatistic.iNumLost      = iNumSeqLostBlocks.fetchAndStoreOrdered ( 0 ) / iBlocksPerPacket;
+    SeqStatistic.iNumReordered = iNumSeqReordered.fetchAndStoreOrdered ( 0 );
+    SeqStatistic.iNumLate      = iNumSeqLate.fetchAndStoreOrdered ( 0 );
+    SeqStatistic.iNumDuplicate = iNumSeqDuplicate.fetchAndStoreOrdered ( 0 );
+    SeqStatistic.iNumRecovered = iNumSeqRecovered.fetchAndStoreOrdered ( 0 );
+    SeqStatistic.iJitterUs     = iSeqJitterUs.loadAcquire();
+
+    return SeqStatistic;
+}
+
+void CLockFreeNetBufWithStats::CopyToMemory ( const CVector<uint8_t>& vecbyData,
+                                              const int               iSrcOffset,
+                                              const int               iIdx,
+                                              const int               iSize )
+{
+    // copy the data in two steps in case of a wrap around
+    const int iPos          = GetMemPos ( iIdx );
+    const int iFirstPartLen = std::min ( iSize, iMemSize - iPos );
+
+    std::copy ( vecbyData.begin() + iSrcOffset,
+                vecbyData.begin() + iSrcOffset + iFirstPartLen,
+                vecMemory.begin() + iPos );
+
+    std::copy ( vecbyData.begin() + iSrcOffset + iFirstPartLen,
+                vecbyData.begin() + iSrcOffset + iSize,
+                vecMemory.begin() );
+}
+
+void CLockFreeNetBufWithStats::SetBlockStates ( const int iIdx,
+                                                const int iSize,
+                                                const int iState )
+{
+    if ( bUseBlockStates )
+    {
+        for ( int iOffs = 0; iOffs < iSize; iOffs += iBlockSize )
+        {
+            viBlockState[GetBlockIdx ( AdvanceIdx ( iIdx, iOffs ) )].storeRelease ( iState );
+        }
+    }
+}
+
+void CLockFreeNetBufWithStats::UpdateJitter ( const uint16_t iTimestamp )
+{
+    // inter-arrival jitter as defined in RFC 3550: the difference of the
+    // arrival time spacing and the timestamp spacing of two packets
+    const int iArrivalTimeUs = static_cast<int> ( ArrivalTimer.nsecsElapsed() / 1000 );
+
+    if ( bHasPrevTimestamp )
+    {
+        const double dArrivalDiffUs   = static_cast<uint32_t> ( iArrivalTimeUs ) -
+                                        static_cast<uint32_t> ( iPrevArrivalTimeUs );
+        const double dTimestampDiffUs = static_cast<uint16_t> ( iTimestamp - iPrevTimestamp ) *
+                                        1000000.0 / SYSTEM_SAMPLE_RATE_HZ;
+
+        dJitterUs += ( fabs ( dArrivalDiffUs - dTimestampDiffUs ) - dJitterUs ) / 16;
+
+        iSeqJitterUs.storeRelease ( static_cast<int> ( dJitterUs ) );
+    }
+
+    iPrevArrivalTimeUs = iArrivalTimeUs;
+    iPrevTimestamp     = iTimestamp;
+    bHasPrevTimestamp  = true;
+}
+
+void CLockFreeNetBufWithStats::AddPendingPut ( const int iInSize )
+{
+    iLastPutSize.storeRelease ( iInSize );
+
+    // the write index is only modified by the producer
+    const int iCurWriteIdx = iPendingPutWriteIdx.loadAcquire();
+    int       iNumPending  = iCurWriteIdx - iPendingPutReadIdx.loadAcquire();
+
+    if ( iNumPending < 0 )
+    {
+        iNumPending += 2 * MAX_NUM_PENDING_PUTS;
+    }
+
+    // if the queue is full, the put is not applied to the statistic
+    if ( iNumPending < MAX_NUM_PENDING_PUTS )
+    {
+        viPendingPutSize[iCurWriteIdx % MAX_NUM_PENDING_PUTS] = iInSize;
+
+        iPendingPutWriteIdx.storeRelease ( ( iCurWriteIdx + 1 ) % ( 2 * MAX_NUM_PENDING_PUTS ) );
+    }
+}
+
+void CLockFreeNetBufWithStats::ApplyPendingPuts()
+{
+    // the read index is only modified by the consumer
+    const int iCurWriteIdx = iPendingPutWriteIdx.loadAcquire();
+    int       iCurReadIdx  = iPendingPutReadIdx.loadAcquire();
+
+    while ( iCurReadIdx != iCurWriteIdx )
+    {
+        UpdateSimulationPut ( viPendingPutSize[iCurReadIdx % MAX_NUM_PENDING_PUTS] );
+
+        iCurReadIdx = ( iCurReadIdx + 1 ) % ( 2 * MAX_NUM_PENDING_PUTS );
+    }
+
+    // release the queue entries for the producer
+    iPendingPutReadIdx.storeRelease ( iCurReadIdx );
+}
+
+double CLockFreeNetBufWithStats::GetFillLevel ( const int iBlockDurationUs ) const
+{
+    if ( !bIsInitialized || ( iBlockSize == 0 ) || ( iBlockDurationUs <= 0 ) )
+    {
+        return 0.0;
+    }
+
+    const int iNumBlocks = GetNumUsed ( iPutIdx.loadAcquire(), iGetIdx.loadAcquire() ) / iBlockSize;
+
+    // the time difference is calculated with unsigned integers to handle the
+    // wrap around of the time stamp
+    const uint32_t iTimeSinceLastPutUs =
+        static_cast<uint32_t> ( ArrivalTimer.nsecsElapsed() / 1000 ) -
+        static_cast<uint32_t> ( iLastPutTimeUs.loadAcquire() );
+
+    // the fraction of the next packet which would have arrived in the
+    // meantime with a perfect network (a packet may contain several blocks)
+    const int iNumBlocksPerPut = std::max ( 1, iLastPutSize.loadAcquire() / iBlockSize );
+
+    const double dFraction = iNumBlocksPerPut * std::min ( 1.0,
+        static_cast<double> ( iTimeSinceLastPutUs ) / ( iBlockDurationUs * iNumBlocksPerPut ) );
+
+    return iNumBlocks + dFraction;
+}
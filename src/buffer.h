@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <QAtomicInt>
+#include <QThread>
+#include <QElapsedTimer>
 #include "util.h"
 #include "global.h"
 
@@ -92,8 +95,10 @@ public:
             // definition
             int iCurPos;
 
-            // copy current data in temporary vector
-            CVector<TData> vecTempMemory ( vecMemory );
+            // copy current data in temporary vector (the member vector is
+            // reused, i.e. no memory is allocated if its capacity is
+            // sufficient)
+            vecTempMemory = vecMemory;
 
             // resize actual buffer memory
             vecMemory.Init ( iNewMemSize );
@@ -390,6 +395,7 @@ protected:
     }
 
     CVector<TData> vecMemory;
+    CVector<TData> vecTempMemory;
     int            iMemSize;
     int            iGetPos;
     int            iPutPos;
@@ -443,13 +449,20 @@ public:
 protected:
     void UpdateAutoSetting();
     void ResetInitCounter();
+    void UpdateSimulationPut ( const int iInSize );
+    void UpdateSimulationGet ( const int iOutSize );
 
     // statistic (do not use the vector class since the classes do not have
     // appropriate copy constructor/operator)
     CErrorRate ErrorRateStatistic[NUM_STAT_SIMULATION_BUFFERS];
-    CNetBuf    SimulationBuffer[NUM_STAT_SIMULATION_BUFFERS];
     int        viBufSizesForSim[NUM_STAT_SIMULATION_BUFFERS];
 
+    // the simulation buffers do not store any data, only their fill levels
+    // are tracked (in bytes, same behaviour as a CNetBuf of the given size)
+    int        viSimBufFillLevel[NUM_STAT_SIMULATION_BUFFERS];
+    int        viSimBufMemSize[NUM_STAT_SIMULATION_BUFFERS];
+    int        iSimBlockSize;
+
     double     dCurIIRFilterResult;
     int        iCurDecidedResult;
     int        iInitCounter;
@@ -466,6 +479,201 @@ protected:
 };
 
 
+// Sequence number statistic of the jitter buffer -----------------------------
+class CNetBufSeqStatistic
+{
+public:
+    CNetBufSeqStatistic() :
+        iNumReceived  ( 0 ),
+        iNumLost      ( 0 ),
+        iNumReordered ( 0 ),
+        iNumLate      ( 0 ),
+        iNumDuplicate ( 0 ),
+        iNumRecovered ( 0 ),
+        iJitterUs     ( 0 ) {}
+
+    int iNumReceived;  // packets with sequence number
+    int iNumLost;      // packets which were missing at playout time
+    int iNumReordered; // packets which arrived out of order but in time
+    int iNumLate;      // packets which arrived after their playout time
+    int iNumDuplicate; // packets which were received more than once
+    int iNumRecovered; // missing packets restored from a redundant copy
+    int iJitterUs;     // inter-arrival jitter estimate (RFC 3550)
+};
+
+
+// Lock-free network buffer (jitter buffer) with statistic calculations --------
+// Single producer/single consumer variant of the network buffer with
+// statistic: Put() must only be called by one thread (e.g., the socket thread)
+// and Get() only by one other thread (e.g., the audio processing thread). Both
+// calls are wait-free, the read and write positions are exchanged with atomic
+// operations. The statistic is only updated by the consumer, the puts since
+// the last Get() are applied to the simulation fill levels in Get().
+// Init() waits until a running Put()/Get() call is finished (a Put()/Get()
+// call during the re-initialization fails immediately instead of blocking).
+// Note that concurrent Init() calls must be serialized by the caller.
+// Packets with a sequence number are inserted at the position given by the
+// sequence number: a gap is left for missing packets which can be filled by
+// reordered packets until the gap is read by Get() (a gap is reported as a
+// lost block). Each block has an atomic state so that the producer and the
+// consumer agree on whether a reordered packet was in time. A redundant copy
+// of a packet (which is sent together with the next packet) fills the gap of
+// the original packet in the same way.
+class CLockFreeNetBufWithStats : public CNetBufWithStats
+{
+public:
+    CLockFreeNetBufWithStats();
+
+    void Init ( const int  iNewBlockSize,
+                const int  iNewNumBlocks,
+                const bool bPreserve = false );
+
+    virtual bool Put ( const CVector<uint8_t>& vecbyData, const int iInSize );
+    virtual bool Get ( CVector<uint8_t>& vecbyData, const int iOutSize );
+
+    // put with the sequence number and the timestamp (in samples) of the
+    // packet, must be called by the same thread as Put()
+    bool PutWithSeqNum ( const CVector<uint8_t>& vecbyData,
+                         const int               iInSize,
+                         const uint16_t          iSeqNum,
+                         const uint16_t          iTimestamp );
+
+    // put of the redundant copy of a packet which starts at the given offset
+    // of the data vector, the copy is only stored if the original packet is
+    // missing and it is not counted as a received packet (must be called by
+    // the same thread as Put())
+    bool PutRedundantCopy ( const CVector<uint8_t>& vecbyData,
+                            const int               iSrcOffset,
+                            const int               iInSize,
+                            const uint16_t          iSeqNum );
+
+    // returns the sequence number statistic since the last call (the jitter
+    // is the current estimate)
+    CNetBufSeqStatistic GetAndResetSeqStatistic();
+
+    // continuous fill level in blocks for the clock drift compensation: the
+    // number of blocks in the buffer plus the fraction of the packet duration
+    // which has elapsed since the last packet arrival (has to be called by
+    // the consumer thread after Get())
+    double GetFillLevel ( const int iBlockDurationUs ) const;
+
+protected:
+    // access state flags
+    static const int AS_PUT_ACTIVE = 1;
+    static const int AS_GET_ACTIVE = 2;
+    static const int AS_REINIT     = 4;
+
+    // maximum number of puts which are queued for the statistic until the
+    // next Get() call (further puts are not applied to the statistic so that
+    // a flood of packets cannot overload the consumer thread)
+    static const int MAX_NUM_PENDING_PUTS = 4 * MAX_NET_BUF_SIZE_NUM_BL;
+
+    // block states (a missing block becomes lost if it is read by Get() or
+    // valid if the reordered packet is written in time)
+    static const int BL_VALID   = 0;
+    static const int BL_MISSING = 1;
+    static const int BL_WRITING = 2;
+    static const int BL_LOST    = 3;
+
+    // maximum number of blocks with a state, larger buffers (which are not
+    // used by the channels) do not support the sequence numbers
+    static const int MAX_NUM_BLOCK_STATES = 4 * MAX_NET_BUF_SIZE_NUM_BL;
+
+    // size of the history of received sequence numbers for the duplicate
+    // detection and gap size which is treated as a restart of the stream
+    static const int SEQ_NUM_HISTORY_LEN      = 64;
+    static const int SEQ_NUM_RESYNC_THRESHOLD = 256;
+
+    bool BeginAccess ( const int iAccessFlag );
+    void EndAccess ( const int iAccessFlag )
+        { iAccessState.fetchAndAddOrdered ( -iAccessFlag ); }
+
+    // the positions are in the range [0, 2 * iMemSize[ so that a full and
+    // an empty buffer can be distinguished
+    int GetNumUsed ( const int iCurPutIdx, const int iCurGetIdx ) const
+    {
+        const int iNumUsed = iCurPutIdx - iCurGetIdx;
+        return ( iNumUsed < 0 ) ? iNumUsed + 2 * iMemSize : iNumUsed;
+    }
+
+    int AdvanceIdx ( const int iIdx, const int iSize ) const
+    {
+        const int iNewIdx = iIdx + iSize;
+        return ( iNewIdx >= 2 * iMemSize ) ? iNewIdx - 2 * iMemSize : iNewIdx;
+    }
+
+    int GetMemPos ( const int iIdx ) const
+        { return ( iIdx >= iMemSize ) ? iIdx - iMemSize : iIdx; }
+
+    int GetBlockIdx ( const int iIdx ) const
+        { return GetMemPos ( iIdx ) / iBlockSize; }
+
+    bool PutWithSeqNumIntern ( const CVector<uint8_t>& vecbyData,
+                               const int               iSrcOffset,
+                               const int               iInSize,
+                               const uint16_t          iSeqNum,
+                               const uint16_t          iTimestamp,
+                               const bool              bIsRedundant );
+
+    void CopyToMemory ( const CVector<uint8_t>& vecbyData,
+                        const int               iSrcOffset,
+                        const int               iIdx,
+                        const int               iSize );
+
+    void SetBlockStates ( const int iIdx,
+                          const int iSize,
+                          const int iState );
+
+    void UpdateJitter ( const uint16_t iTimestamp );
+
+    // producer: queues the size of a put for the statistic of the consumer
+    void AddPendingPut ( const int iInSize );
+
+    // consumer: applies the queued puts to the statistic
+    void ApplyPendingPuts();
+
+    QAtomicInt iAccessState;
+    QAtomicInt iPutIdx;
+    QAtomicInt iGetIdx;
+    QAtomicInt iLastPutSize;
+
+    // single producer/single consumer queue of the sizes of the puts which
+    // are not yet applied to the statistic (the indices are in the range
+    // [0, 2 * MAX_NUM_PENDING_PUTS[ so that a full and an empty queue can
+    // be distinguished)
+    int        viPendingPutSize[MAX_NUM_PENDING_PUTS];
+    QAtomicInt iPendingPutWriteIdx;
+    QAtomicInt iPendingPutReadIdx;
+
+    QElapsedTimer ArrivalTimer;
+    QAtomicInt    iLastPutTimeUs;
+
+    // block states (only valid if the sequence numbers are supported by the
+    // current buffer size)
+    QAtomicInt    viBlockState[MAX_NUM_BLOCK_STATES];
+    bool          bUseBlockStates;
+
+    // sequence number state, only accessed by the producer
+    bool          bSeqNumIsSynced;
+    uint16_t      iNextSeqNum;
+    uint64_t      iSeqNumHistory; // bit i: next sequence number - 1 - i received
+    int           iSeqMappedSize; // data size at the end of the buffer which matches the sequence numbers
+    uint16_t      iPrevTimestamp;
+    int           iPrevArrivalTimeUs;
+    bool          bHasPrevTimestamp;
+    double        dJitterUs;
+
+    // sequence number statistic
+    QAtomicInt    iNumSeqReceived;
+    QAtomicInt    iNumSeqLostBlocks;
+    QAtomicInt    iNumSeqReordered;
+    QAtomicInt    iNumSeqLate;
+    QAtomicInt    iNumSeqDuplicate;
+    QAtomicInt    iNumSeqRecovered;
+    QAtomicInt    iSeqJitterUs;
+    QAtomicInt    iSeqBlocksPerPacket;
+};
+
 // Conversion buffer (very simple buffer) --------------------------------------
 // For this very simple buffer no wrap around mechanism is implemented. We
 // assume here, that the applied buffers are an integer fraction of the total
@@ -509,6 +717,15 @@ public:
                     vecMemory.begin() );
     }
 
+    void PutAll ( const TData* pData )
+    {
+        iGetPos = 0;
+
+        std::copy ( pData,
+                    pData + iBufferSize, // note that input array might be larger then memory size
+                    vecMemory.begin() );
+    }
+
     bool Put ( const CVector<TData>& vecsData,
                const int             iVecSize )
     {
@@ -530,7 +747,12 @@ public:
             return ( iEnd == iBufferSize );
         }
 
-        // buffer overrun or not initialized, return "not ready"
+        // buffer overrun or not initialized, return "not ready" (the partial
+        // data is dropped so that the buffer is aligned again if the size of
+        // the input blocks has changed before the buffer was initialized with
+        // the new size)
+        iPutPos = 0;
+
         return false;
     }
 
@@ -553,6 +775,12 @@ public:
 
     bool Get ( CVector<TData>& vecsData,
                const int       iVecSize )
+    {
+        return Get ( vecsData.data(), iVecSize );
+    }
+
+    bool Get ( TData*    pData,
+               const int iVecSize )
     {
         // calculate the input size and the end position after copying
         const int iEnd = iGetPos + iVecSize;
@@ -563,7 +791,7 @@ public:
             // copy new data from internal buffer
             std::copy ( vecMemory.begin() + iGetPos,
                         vecMemory.begin() + iGetPos + iVecSize,
-                        vecsData.begin() );
+                        pData );
 
             // set buffer pointer one block further
             iGetPos = iEnd;
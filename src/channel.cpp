@@ -30,6 +30,13 @@ CChannel::CChannel ( const bool bNIsServer ) :
     vecdGains              ( MAX_NUM_CHANNELS, 1.0 ),
     vecdPannings           ( MAX_NUM_CHANNELS, 0.5 ),
     bDoAutoSockBufSize     ( true ),
+    iSendSeqNum            ( 0 ),
+    iSendTimestamp         ( 0 ),
+    bUseRedundancy         ( false ),
+    bPrevAudioDataIsValid  ( false ),
+    iDownstreamSizeSwitchSeqNum ( 0 ),
+    bReportDownstreamStatistic ( false ),
+    pRequestNotifier       ( nullptr ),
     iFadeInCnt             ( 0 ),
     iFadeInCntMax          ( FADE_IN_NUM_FRAMES_DBLE_FRAMESIZE ),
     bIsEnabled             ( false ),
@@ -45,7 +52,7 @@ CChannel::CChannel ( const bool bNIsServer ) :
     iConTimeOutStartVal = CON_TIME_OUT_SEC_MAX * SYSTEM_SAMPLE_RATE_HZ;
 
     // init time-out for the buffer with zero -> no connection
-    iConTimeOut = 0;
+    iConTimeOut.storeRelease ( 0 );
 
     // init the socket buffer
     SetSockBufNumFrames ( DEF_NET_BUF_SIZE_NUM_BL );
@@ -53,6 +60,15 @@ CChannel::CChannel ( const bool bNIsServer ) :
     // initialize channel info
     ResetInfo();
 
+    // the client expands the received frames to the blocks of the jitter
+    // buffer, the memory for the largest packet is allocated here so that
+    // the socket thread does not allocate memory
+    if ( !bIsServer )
+    {
+        vecbyDownstreamBlocks.Init ( MAX_SIZE_BYTES_NETW_BUF +
+                                     2 * FRAME_SIZE_FACTOR_SAFE * NETW_FRAME_SIZE_FIELD_SIZE );
+    }
+
 
     // Connections -------------------------------------------------------------
 
@@ -120,6 +136,18 @@ qRegisterMetaType<CHostAddress> ( "CHostAddress" );
     QObject::connect ( &Protocol,
         SIGNAL ( ReqChannelLevelList ( bool ) ),
         this, SLOT ( OnReqChannelLevelList ( bool ) ) );
+
+    QObject::connect ( &Protocol,
+        SIGNAL ( MessageAcknowledged ( int ) ),
+        this, SLOT ( OnMessageAcknowledged ( int ) ) );
+
+    QObject::connect ( &Protocol,
+        SIGNAL ( DownstreamStatisticReceived ( int, int ) ),
+        this, SLOT ( OnDownstreamStatisticReceived ( int, int ) ) );
+
+    QObject::connect ( &TimerDownstreamStatistic,
+        SIGNAL ( timeout() ),
+        this, SLOT ( OnTimerDownstreamStatistic() ) );
 }
 
 bool CChannel::ProtocolIsEnabled()
@@ -148,9 +176,23 @@ void CChannel::SetEnable ( const bool bNEnStat )
     // if channel is not enabled, reset time out count and protocol
     if ( !bNEnStat )
     {
-        iConTimeOut = 0;
+        iConTimeOut.storeRelease ( 0 );
         Protocol.Reset();
     }
+
+    // the client reports the statistic of the received audio packets while
+    // it is connected
+    if ( !bIsServer )
+    {
+        if ( bNEnStat )
+        {
+            TimerDownstreamStatistic.start ( DOWNSTREAM_STATISTIC_INTERVAL_MS );
+        }
+        else
+        {
+            TimerDownstreamStatistic.stop();
+        }
+    }
 }
 
 void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
@@ -171,6 +213,12 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
         iNetwFrameSize        = iNewNetwFrameSize;
         iNetwFrameSizeFact    = iNewNetwFrameSizeFact;
 
+        // the server sends with the requested size until it announces a
+        // reduced size
+        iDownstreamNetwFrameSize.storeRelease ( iNetwFrameSize );
+        iDownstreamSizePending.storeRelease ( 0 );
+        iDownstreamSizePrev.storeRelease ( 0 );
+
         // update audio frame size
         if ( eAudioCompressionType == CT_OPUS )
         {
@@ -185,16 +233,12 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
         {
             // init socket buffer
             SockBuf.SetUseDoubleSystemFrameSize ( eAudioCompressionType == CT_OPUS ); // NOTE must be set BEFORE the init()
-            SockBuf.Init ( iNetwFrameSize, iCurSockBufNumFrames );
+            SockBuf.Init ( GetReceiveBlockSize(), iCurSockBufNumFrames );
         }
         MutexSocketBuf.unlock();
 
-        MutexConvBuf.lock();
-        {
-            // init conversion buffer
-            ConvBuf.Init ( iNetwFrameSize * iNetwFrameSizeFact );
-        }
-        MutexConvBuf.unlock();
+        // init conversion buffer (done by the sending thread)
+        iConvBufInitRequest.storeRelease ( iNetwFrameSize * iNetwFrameSizeFact );
 
         // fill network transport properties struct
         NetworkTransportProps = GetNetworkTransportPropsFromCurrentSettings();
@@ -225,7 +269,7 @@ bool CChannel::SetSockBufNumFrames ( const int  iNewNumFrames,
 
                 // the network block size is a multiple of the minimum network
                 // block size
-                SockBuf.Init ( iNetwFrameSize, iNewNumFrames, bPreserve );
+                SockBuf.Init ( GetReceiveBlockSize(), iNewNumFrames, bPreserve );
 
                 // store current auto socket buffer size setting in the mutex
                 // region since if we use the current parameter below in the
@@ -246,9 +290,14 @@ bool CChannel::SetSockBufNumFrames ( const int  iNewNumFrames,
     {
         // we cannot call the "CreateJitBufMes" function directly since
         // this would give us problems with different threads (e.g. the
-        // timer thread) and the protocol mechanism (problem with
-        // qRegisterMetaType(), etc.)
-        emit ServerAutoSockBufSizeChange ( iNewNumFrames );
+        // timer thread) and the protocol mechanism, the main thread is
+        // notified without allocating memory and picks up the latest setting
+        iSockBufSizeReport.storeRelease ( iNewNumFrames );
+
+        if ( pRequestNotifier != nullptr )
+        {
+            pRequestNotifier->Notify();
+        }
     }
 
     return ReturnValue; // set error flag
@@ -273,6 +322,17 @@ void CChannel::SetGain ( const int    iChanID,
         }
 
         vecdGains[iChanID] = dNewGain;
+
+        // the server keeps its own copy of the gains/pannings for the audio
+        // processing (the signal is emitted after unlocking the mutex since
+        // the connected slot locks the mutex of the gain/pan matrix)
+        if ( bIsServer )
+        {
+            const double dCurPan = vecdPannings[iChanID];
+
+            locker.unlock();
+            emit GainPanChanged ( iChanID, dNewGain, dCurPan );
+        }
     }
 }
 
@@ -300,6 +360,14 @@ void CChannel::SetPan ( const int    iChanID,
     if ( ( iChanID >= 0 ) && ( iChanID < MAX_NUM_CHANNELS ) )
     {
         vecdPannings[iChanID] = dNewPan;
+
+        if ( bIsServer )
+        {
+            const double dCurGain = vecdGains[iChanID];
+
+            locker.unlock();
+            emit GainPanChanged ( iChanID, dCurGain, dNewPan );
+        }
     }
 }
 
@@ -413,7 +481,8 @@ bool CChannel::GetAddress ( CHostAddress& RetAddr )
 
 void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTransportProps )
 {
-    // only the server shall act on network transport properties message
+    // only the server shall act on the audio settings of the network transport
+    // properties message
     if ( bIsServer )
     {
         // OPUS and OPUS64 codecs are the only supported codecs right now
@@ -432,6 +501,13 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
             iNetwFrameSizeFact    = NetworkTransportProps.iBlockSizeFact;
             iNetwFrameSize        = static_cast<int> ( NetworkTransportProps.iBaseNetworkPacketSize );
 
+            // we start sending with the requested size, a pending size change
+            // of the previous settings is dropped
+            iDownstreamNetwFrameSize.storeRelease ( iNetwFrameSize );
+            iDownstreamSizeAnnounced.storeRelease ( iNetwFrameSize );
+            iDownstreamSizeRequest.storeRelease ( 0 );
+            iDownstreamStatistic.storeRelease ( 0 );
+
             // update maximum number of frames for fade in counter (only needed for server)
             // and audio frame size
             if ( eAudioCompressionType == CT_OPUS )
@@ -458,14 +534,80 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
             }
             MutexSocketBuf.unlock();
 
-            MutexConvBuf.lock();
+            // init conversion buffer (done by the sending thread)
+            iConvBufInitRequest.storeRelease ( iNetwFrameSize * iNetwFrameSizeFact );
+        }
+        Mutex.unlock();
+
+        // the client list which was sent before the client has announced
+        // that it supports more channels was limited, therefore it is sent
+        // again in that case
+        const int iNewSupportsManyChannels =
+            ( ( NetworkTransportProps.iFlags & NF_WITH_MANY_CHANNELS ) != 0 ) ? 1 : 0;
+
+        if ( iSupportsManyChannels.fetchAndStoreOrdered ( iNewSupportsManyChannels ) != iNewSupportsManyChannels )
+        {
+            emit ReqConnClientsList();
+        }
+
+        // the client can receive audio packets with sequence numbers, we
+        // confirm that we support them, too, by sending our properties
+        // (older clients ignore this message), if the client requests the
+        // redundant audio data, we request it from the client, too
+        if ( ( NetworkTransportProps.iFlags & NF_WITH_SEQUENCE_NUMBER ) != 0 )
+        {
+            bUseRedundancy = ( ( NetworkTransportProps.iFlags & NF_WITH_REDUNDANCY ) != 0 );
+
+            iSendSeqNumTrailer.storeRelease ( 1 );
+            iSendRedundancy.storeRelease ( bUseRedundancy ? 1 : 0 );
+            iAcceptsAdaptiveSize.storeRelease (
+                ( ( NetworkTransportProps.iFlags & NF_WITH_ADAPTIVE_SIZE ) != 0 ) ? 1 : 0 );
+
+            Protocol.CreateNetwTranspPropsMes ( GetNetworkTransportPropsFromCurrentSettings() );
+        }
+        else
+        {
+            bUseRedundancy = false;
+
+            iSendSeqNumTrailer.storeRelease ( 0 );
+            iSendRedundancy.storeRelease ( 0 );
+            iAcceptsAdaptiveSize.storeRelease ( 0 );
+        }
+    }
+    else
+    {
+        // the client only evaluates the flags of the server properties (the
+        // other properties are defined by the client)
+        const bool bWithSeqNum = ( ( NetworkTransportProps.iFlags & NF_WITH_SEQUENCE_NUMBER ) != 0 );
+
+        iSendSeqNumTrailer.storeRelease ( bWithSeqNum ? 1 : 0 );
+        iSendRedundancy.storeRelease (
+            ( bWithSeqNum && ( ( NetworkTransportProps.iFlags & NF_WITH_REDUNDANCY ) != 0 ) ) ? 1 : 0 );
+
+        // a server which adapts the size of its audio packets tells us the
+        // size it will use after this message is acknowledged (it is never
+        // larger than the size we requested, a message which was sent before
+        // our last request may be outdated), the new size is applied by the
+        // socket thread with the first audio packet of the new size, the
+        // jitter buffer stores the size of each frame so that the buffered
+        // audio is kept
+        bReportDownstreamStatistic = bWithSeqNum && ( ( NetworkTransportProps.iFlags & NF_WITH_ADAPTIVE_SIZE ) != 0 );
+
+        if ( bReportDownstreamStatistic )
+        {
+            const int iNewSize = static_cast<int> ( NetworkTransportProps.iBaseNetworkPacketSize );
+
+            Mutex.lock();
             {
-                // init conversion buffer
-                ConvBuf.Init ( iNetwFrameSize * iNetwFrameSizeFact );
+                if ( ( iNewSize >= CELT_MINIMUM_NUM_BYTES ) &&
+                     ( iNewSize <= iNetwFrameSize ) )
+                {
+                    iDownstreamSizePending.storeRelease (
+                        ( iNewSize != iDownstreamNetwFrameSize.loadAcquire() ) ? iNewSize : 0 );
+                }
             }
-            MutexConvBuf.unlock();
+            Mutex.unlock();
         }
-        Mutex.unlock();
     }
 }
 
@@ -475,16 +617,191 @@ void CChannel::OnReqNetTranspProps()
     Protocol.CreateNetwTranspPropsMes ( GetNetworkTransportPropsFromCurrentSettings() );
 }
 
+void CChannel::SetDownstreamNetwFrameSize ( const int iNewNetwFrameSize )
+{
+/*
+    this function is intended for the server (not the client)
+*/
+    // only a client which accepts a reduced size gets it, the size is never
+    // larger than the size requested by the client
+    if ( iAcceptsAdaptiveSize.loadAcquire() == 0 )
+    {
+        return;
+    }
+
+    const int iNewSize = std::max ( CELT_MINIMUM_NUM_BYTES,
+                                    std::min ( iNewNetwFrameSize, iNetwFrameSize ) );
+
+    const int iCurRequest = iDownstreamSizeRequest.loadAcquire();
+
+    if ( ( iCurRequest == iNewSize ) ||
+         ( ( iCurRequest == 0 ) && ( iDownstreamSizeAnnounced.loadAcquire() == iNewSize ) ) )
+    {
+        return;
+    }
+
+    // the main thread is only notified if no request is pending, otherwise
+    // it picks up the latest requested size
+    if ( ( iDownstreamSizeRequest.fetchAndStoreOrdered ( iNewSize ) == 0 ) &&
+         ( pRequestNotifier != nullptr ) )
+    {
+        pRequestNotifier->Notify();
+    }
+}
+
+void CChannel::ProcessPendingRequests()
+{
+    // report the auto jitter buffer size to the client
+    const int iSockBufNumFrames = iSockBufSizeReport.fetchAndStoreOrdered ( 0 );
+
+    if ( iSockBufNumFrames != 0 )
+    {
+        emit ServerAutoSockBufSizeChange ( iSockBufNumFrames );
+    }
+
+    if ( iDownstreamSizeRequest.loadAcquire() != 0 )
+    {
+        ApplyDownstreamSizeRequest();
+    }
+}
+
+void CChannel::ApplyDownstreamSizeRequest()
+{
+    CNetworkTransportProps NetworkTransportProps;
+    bool                   bSizeChanged = false;
+
+    int iNewSize = iDownstreamSizeRequest.fetchAndStoreOrdered ( 0 );
+
+    Mutex.lock();
+    {
+        // the client cannot distinguish the packets of a size with a
+        // redundant copy from the packets of the double size, therefore the
+        // new size must not be the double or the half of the current size
+        const int iCurSize = iDownstreamNetwFrameSize.loadAcquire();
+
+        if ( 2 * iNewSize == iCurSize )
+        {
+            iNewSize++;
+        }
+        else if ( iNewSize == 2 * iCurSize )
+        {
+            iNewSize--;
+        }
+
+        // the settings of the client may have changed in the meantime
+        if ( ( iNewSize != 0 ) &&
+             ( iAcceptsAdaptiveSize.loadAcquire() != 0 ) &&
+             ( iNewSize <= iNetwFrameSize ) &&
+             ( iNewSize != iDownstreamSizeAnnounced.loadAcquire() ) )
+        {
+            iDownstreamSizeAnnounced.storeRelease ( iNewSize );
+
+            NetworkTransportProps = GetNetworkTransportPropsFromCurrentSettings();
+            bSizeChanged          = true;
+        }
+    }
+    Mutex.unlock();
+
+    // the audio packets with the new size are sent after the client has
+    // acknowledged the message, see OnMessageAcknowledged()
+    if ( bSizeChanged )
+    {
+        Protocol.CreateNetwTranspPropsMes ( NetworkTransportProps );
+    }
+}
+
+void CChannel::OnMessageAcknowledged ( int iID )
+{
+    // the server switches to the announced size if the client has received
+    // the last announcement (a later announcement which is still queued
+    // defines the next size)
+    if ( !bIsServer ||
+         ( iID != PROTMESSID_NETW_TRANSPORT_PROPS ) ||
+         Protocol.IsMessageQueued ( PROTMESSID_NETW_TRANSPORT_PROPS ) )
+    {
+        return;
+    }
+
+    Mutex.lock();
+    {
+        const int iNewSize = iDownstreamSizeAnnounced.loadAcquire();
+
+        if ( iNewSize != iDownstreamNetwFrameSize.loadAcquire() )
+        {
+            iDownstreamNetwFrameSize.storeRelease ( iNewSize );
+
+            // init conversion buffer (done by the sending thread)
+            iConvBufInitRequest.storeRelease ( iNewSize * iNetwFrameSizeFact );
+        }
+    }
+    Mutex.unlock();
+}
+
+bool CChannel::GetDownstreamStatistic ( int& iNumReceived,
+                                        int& iNumLost )
+{
+    if ( iDownstreamStatistic.loadAcquire() == 0 )
+    {
+        return false;
+    }
+
+    const int iStatistic = iDownstreamStatistic.fetchAndStoreOrdered ( 0 );
+
+    iNumReceived = ( iStatistic >> 16 ) & 0x7FFF;
+    iNumLost     = iStatistic & 0xFFFF;
+
+    return iStatistic != 0;
+}
+
+void CChannel::OnDownstreamStatisticReceived ( int iNumReceived,
+                                               int iNumLost )
+{
+    // the report is only used if we adapt the size of the audio packets
+    // (the packed value must not overflow, an empty report is ignored)
+    if ( bIsServer &&
+         ( iAcceptsAdaptiveSize.loadAcquire() != 0 ) &&
+         ( iNumReceived + iNumLost > 0 ) )
+    {
+        iDownstreamStatistic.storeRelease ( ( std::min ( iNumReceived, 0x7FFF ) << 16 ) |
+                                            std::min ( iNumLost, 0xFFFF ) );
+    }
+}
+
+void CChannel::OnTimerDownstreamStatistic()
+{
+    // the statistic is always read so that each report covers one interval
+    const CNetBufSeqStatistic SeqStatistic = SockBuf.GetAndResetSeqStatistic();
+
+    // the packets which arrived too late are not lost on the network path,
+    // the jitter buffer was too small for them (e.g., with a manual jitter
+    // buffer setting), the recovered packets were lost on the path
+    const int iNumNetwLost = std::max ( SeqStatistic.iNumLost - SeqStatistic.iNumLate, 0 ) +
+                             SeqStatistic.iNumRecovered;
+
+    if ( bReportDownstreamStatistic && IsConnected() )
+    {
+        Protocol.CreateDownstreamStatisticMes ( SeqStatistic.iNumReceived, iNumNetwLost );
+    }
+}
+
 CNetworkTransportProps CChannel::GetNetworkTransportPropsFromCurrentSettings()
 {
     // use current stored settings of the channel to fill the network transport
-    // properties structure
-    return CNetworkTransportProps ( static_cast<uint32_t> ( iNetwFrameSize ),
+    // properties structure (we can receive audio packets with sequence
+    // numbers and audio packets with a reduced size from the server, the
+    // base size of the server is the size of the audio it sends, and we
+    // support more than MAX_NUM_CHANNELS_LEGACY channels)
+    const uint32_t iFlags = NF_WITH_SEQUENCE_NUMBER | NF_WITH_ADAPTIVE_SIZE | NF_WITH_MANY_CHANNELS |
+                            ( bUseRedundancy ? NF_WITH_REDUNDANCY : NF_NONE );
+
+    const int iBaseNetwFrameSize = bIsServer ? iDownstreamSizeAnnounced.loadAcquire() : iNetwFrameSize;
+
+    return CNetworkTransportProps ( static_cast<uint32_t> ( iBaseNetwFrameSize ),
                                     static_cast<uint16_t> ( iNetwFrameSizeFact ),
                                     static_cast<uint32_t> ( iNumAudioChannels ),
                                     SYSTEM_SAMPLE_RATE_HZ,
                                     eAudioCompressionType,
-                                    0, // version of the codec
+                                    iFlags,
                                     0 );
 }
 
@@ -496,7 +813,7 @@ void CChannel::Disconnect()
         // set time out counter to a small value > 0 so that the next time a
         // received audio block is queried, the disconnection is performed
         // (assuming that no audio packet is received in the meantime)
-        iConTimeOut = 1; // a small number > 0
+        iConTimeOut.storeRelease ( 1 ); // a small number > 0
     }
 }
 
@@ -520,7 +837,7 @@ void CChannel::PutProtcolData ( const int               iRecCounter,
 
 EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
                                       const int               iNumBytes,
-                                      CHostAddress            RecHostAddr )
+                                      const CHostAddress&     RecHostAddr )
 {
     // init return state
     EPutDataStat eRet = PS_GEN_ERROR;
@@ -531,56 +848,100 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
     if ( ( bIsServer || ( GetAddress() == RecHostAddr ) ) &&
          IsEnabled() )
     {
-        MutexSocketBuf.lock();
+        // only process audio if packet has correct size (note that the jitter
+        // buffer is lock-free, this function must only be called by the
+        // socket thread), the packet may have a sequence number trailer and
+        // a redundant copy of the previous audio data
+        const int iFrameSize = bIsServer ?
+            ( IsAudioPacketSize ( iNumBytes, iNetwFrameSize, false ) ? iNetwFrameSize : 0 ) :
+            GetDownstreamFrameSize ( vecbyData, iNumBytes );
+
+        if ( iFrameSize > 0 )
         {
-            // only process audio if packet has correct size
-            if ( iNumBytes == ( iNetwFrameSize * iNetwFrameSizeFact ) )
+            const int  iAudioNumBytes     = iFrameSize * iNetwFrameSizeFact;
+            const bool bWithRedundantCopy = ( iNumBytes == 2 * iAudioNumBytes + NETW_SEQ_NUM_TRAILER_SIZE );
+
+            // the client stores the frames of the server together with their
+            // size since the server may change it
+            const CVector<uint8_t>& vecbyBlocks    = bIsServer ? vecbyData : vecbyDownstreamBlocks;
+            const int               iBlockNumBytes = bIsServer ? iAudioNumBytes : GetReceiveBlockSize() * iNetwFrameSizeFact;
+
+            if ( !bIsServer )
             {
-                // store new packet in jitter buffer
-                if ( SockBuf.Put ( vecbyData, iNumBytes ) )
-                {
-                    eRet = PS_AUDIO_OK;
-                }
-                else
-                {
-                    eRet = PS_AUDIO_ERR;
-                }
+                ExpandToDownstreamBlocks ( vecbyData,
+                                           iFrameSize,
+                                           bWithRedundantCopy ? 2 * iNetwFrameSizeFact : iNetwFrameSizeFact );
+            }
 
-                // manage audio fade-in counter
-                if ( iFadeInCnt < iFadeInCntMax )
+            bool bPutOK;
+
+            // store new packet in jitter buffer
+            if ( iNumBytes == iAudioNumBytes )
+            {
+                bPutOK = SockBuf.Put ( vecbyBlocks, iBlockNumBytes );
+            }
+            else
+            {
+                // the trailer is stored at the end of the packet (little endian)
+                const int      iTrailerPos = iNumBytes - NETW_SEQ_NUM_TRAILER_SIZE;
+                const uint16_t iSeqNum     = static_cast<uint16_t> ( vecbyData[iTrailerPos] |
+                                                                     ( vecbyData[iTrailerPos + 1] << 8 ) );
+                const uint16_t iTimestamp  = static_cast<uint16_t> ( vecbyData[iTrailerPos + 2] |
+                                                                     ( vecbyData[iTrailerPos + 3] << 8 ) );
+
+                // the redundant copy is stored first so that it is in order if
+                // only the previous packet was lost
+                if ( bWithRedundantCopy )
                 {
-                    iFadeInCnt++;
+                    SockBuf.PutRedundantCopy ( vecbyBlocks,
+                                               iBlockNumBytes,
+                                               iBlockNumBytes,
+                                               static_cast<uint16_t> ( iSeqNum - 1 ) );
                 }
+
+                bPutOK = SockBuf.PutWithSeqNum ( vecbyBlocks, iBlockNumBytes, iSeqNum, iTimestamp );
+            }
+
+            if ( bPutOK )
+            {
+                eRet = PS_AUDIO_OK;
             }
             else
             {
-                // the protocol parsing failed and this was no audio block,
-                // we treat this as protocol error (unkown packet)
-                eRet = PS_PROT_ERR;
+                eRet = PS_AUDIO_ERR;
             }
 
-            // All network packets except of valid protocol messages
-            // regardless if they are valid or invalid audio packets lead to
-            // a state change to a connected channel.
-            // This is because protocol messages can only be sent on a
-            // connected channel and the client has to inform the server
-            // about the audio packet properties via the protocol.
-
-            // check if channel was not connected, this is a new connection
-            if ( !IsConnected() )
+            // manage audio fade-in counter
+            if ( iFadeInCnt < iFadeInCntMax )
             {
-                // overwrite status
-                eRet = PS_NEW_CONNECTION;
-
-                // init audio fade-in counter
-                iFadeInCnt = 0;
+                iFadeInCnt++;
             }
+        }
+        else
+        {
+            // the protocol parsing failed and this was no audio block,
+            // we treat this as protocol error (unkown packet)
+            eRet = PS_PROT_ERR;
+        }
+
+        // All network packets except of valid protocol messages
+        // regardless if they are valid or invalid audio packets lead to
+        // a state change to a connected channel.
+        // This is because protocol messages can only be sent on a
+        // connected channel and the client has to inform the server
+        // about the audio packet properties via the protocol.
+
+        // reset time-out counter and check if channel was not connected,
+        // this is a new connection (this must be one atomic operation since
+        // the audio thread might disconnect the channel at the same time)
+        if ( iConTimeOut.fetchAndStoreOrdered ( iConTimeOutStartVal ) <= 0 )
+        {
+            // overwrite status
+            eRet = PS_NEW_CONNECTION;
 
-            // reset time-out counter (note that this must be done after the
-            // "IsConnected()" query above)
-            ResetTimeOutCounter();
+            // init audio fade-in counter
+            iFadeInCnt = 0;
         }
-        MutexSocketBuf.unlock();
     }
     else
     {
@@ -590,80 +951,337 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
     return eRet;
 }
 
+bool CChannel::IsAudioPacketSize ( const int  iNumBytes,
+                                   const int  iFrameSize,
+                                   const bool bWithSeqNumOnly ) const
+{
+    const int iAudioNumBytes = iFrameSize * iNetwFrameSizeFact;
+
+    return ( !bWithSeqNumOnly && ( iNumBytes == iAudioNumBytes ) ) ||
+           ( iNumBytes == iAudioNumBytes + NETW_SEQ_NUM_TRAILER_SIZE ) ||
+           ( iNumBytes == 2 * iAudioNumBytes + NETW_SEQ_NUM_TRAILER_SIZE );
+}
+
+int CChannel::GetDownstreamFrameSize ( const CVector<uint8_t>& vecbyData,
+                                       const int               iNumBytes )
+{
+/*
+    this function is intended for the client (not the server), it returns
+    the coded size of the frames of the audio packet (zero if this is no
+    audio packet)
+*/
+    const int iCurSize     = iDownstreamNetwFrameSize.loadAcquire();
+    const int iPendingSize = iDownstreamSizePending.loadAcquire();
+    const int iPrevSize    = iDownstreamSizePrev.loadAcquire();
+
+    // the expanded packet must fit in the memory allocated in the constructor
+    if ( 2 * iNetwFrameSizeFact * GetReceiveBlockSize() > vecbyDownstreamBlocks.Size() )
+    {
+        return 0;
+    }
+
+    // without a size change of the server only the current size is possible
+    if ( ( iPendingSize == 0 ) && ( iPrevSize == 0 ) )
+    {
+        return IsAudioPacketSize ( iNumBytes, iCurSize, false ) ? iCurSize : 0;
+    }
+
+    // a server which changes the size sends sequence numbers only (the
+    // server never announces a size which is the double or the half of the
+    // current size, therefore the sizes of the packets with and without a
+    // redundant copy are unique)
+    if ( iNumBytes < NETW_SEQ_NUM_TRAILER_SIZE )
+    {
+        return 0;
+    }
+
+    const int      iTrailerPos = iNumBytes - NETW_SEQ_NUM_TRAILER_SIZE;
+    const uint16_t iSeqNum     = static_cast<uint16_t> ( vecbyData[iTrailerPos] |
+                                                         ( vecbyData[iTrailerPos + 1] << 8 ) );
+
+    if ( IsAudioPacketSize ( iNumBytes, iCurSize, true ) )
+    {
+        // the previous size is not accepted anymore if all packets which were
+        // sent before the size change are too old
+        const int iDist = static_cast<int16_t> ( static_cast<uint16_t> ( iSeqNum - iDownstreamSizeSwitchSeqNum ) );
+
+        if ( ( iPrevSize != 0 ) && ( iDist >= DOWNSTREAM_PREV_SIZE_NUM_PACKETS ) )
+        {
+            iDownstreamSizePrev.testAndSetOrdered ( iPrevSize, 0 );
+        }
+
+        return iCurSize;
+    }
+
+    // the first packet with the announced size switches to the new size
+    if ( ( iPendingSize != 0 ) && IsAudioPacketSize ( iNumBytes, iPendingSize, true ) )
+    {
+        iDownstreamSizePrev.storeRelease ( iCurSize );
+        iDownstreamNetwFrameSize.storeRelease ( iPendingSize );
+        iDownstreamSizePending.testAndSetOrdered ( iPendingSize, 0 );
+
+        iDownstreamSizeSwitchSeqNum = iSeqNum;
+
+        return iPendingSize;
+    }
+
+    // a reordered packet which was sent before the size change
+    if ( ( iPrevSize != 0 ) && IsAudioPacketSize ( iNumBytes, iPrevSize, true ) )
+    {
+        const int iDist = static_cast<int16_t> ( static_cast<uint16_t> ( iSeqNum - iDownstreamSizeSwitchSeqNum ) );
+
+        if ( ( iDist < 0 ) && ( iDist >= -DOWNSTREAM_PREV_SIZE_NUM_PACKETS ) )
+        {
+            return iPrevSize;
+        }
+    }
+
+    return 0;
+}
+
+void CChannel::ExpandToDownstreamBlocks ( const CVector<uint8_t>& vecbyData,
+                                          const int               iFrameSize,
+                                          const int               iNumFrames )
+{
+    const int iBlockSize = GetReceiveBlockSize();
+
+    for ( int i = 0; i < iNumFrames; i++ )
+    {
+        const int iBlockPos = i * iBlockSize;
+
+        // coded size of the frame (little endian) in front of the frame
+        vecbyDownstreamBlocks[iBlockPos]     = static_cast<uint8_t> ( iFrameSize & 0xFF );
+        vecbyDownstreamBlocks[iBlockPos + 1] = static_cast<uint8_t> ( iFrameSize >> 8 );
+
+        std::copy ( vecbyData.begin() + i * iFrameSize,
+                    vecbyData.begin() + ( i + 1 ) * iFrameSize,
+                    vecbyDownstreamBlocks.begin() + iBlockPos + NETW_FRAME_SIZE_FIELD_SIZE );
+    }
+}
+
 EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
                                  const int         iNumBytes )
 {
     EGetDataStat eGetStatus;
 
-    MutexSocketBuf.lock();
+    // the jitter buffer is lock-free so that the audio thread is never blocked
+    // by the socket thread
+    const bool bSockBufState = SockBuf.Get ( vecbyData, iNumBytes );
+
+    // decrease time-out counter (the socket thread might reset the counter
+    // at the same time, therefore we have to use a compare-and-swap)
+    int iCurConTimeOut = iConTimeOut.loadAcquire();
+    int iNewConTimeOut = 0;
+
+    while ( iCurConTimeOut > 0 )
     {
-        // the socket access must be inside a mutex
-        const bool bSockBufState = SockBuf.Get ( vecbyData, iNumBytes );
+        // subtract the number of samples of the current block since the
+        // time out counter is based on samples not on blocks (definition:
+        // always one atomic block is get by using the GetData() function
+        // where the atomic block size is "iAudioFrameSizeSamples"), make
+        // sure we do not have negative values
+        iNewConTimeOut = std::max ( iCurConTimeOut - iAudioFrameSizeSamples, 0 );
+
+        if ( iConTimeOut.testAndSetOrdered ( iCurConTimeOut, iNewConTimeOut ) )
+        {
+            break;
+        }
+
+        iCurConTimeOut = iConTimeOut.loadAcquire();
+    }
 
-        // decrease time-out counter
-        if ( iConTimeOut > 0 )
+    if ( iCurConTimeOut > 0 )
+    {
+        if ( iNewConTimeOut == 0 )
         {
-            // subtract the number of samples of the current block since the
-            // time out counter is based on samples not on blocks (definition:
-            // always one atomic block is get by using the GetData() function
-            // where the atomic block size is "iAudioFrameSizeSamples")
-            iConTimeOut -= iAudioFrameSizeSamples;
+            // channel is just disconnected
+            eGetStatus = GS_CHAN_NOW_DISCONNECTED;
 
-            if ( iConTimeOut <= 0 )
+            // reset network transport properties (the main thread writes
+            // them under the mutex if a properties message is received)
+            Mutex.lock();
             {
-                // channel is just disconnected
-                eGetStatus  = GS_CHAN_NOW_DISCONNECTED;
-                iConTimeOut = 0; // make sure we do not have negative values
-
-                // reset network transport properties
                 ResetNetworkTransportProperties();
             }
-            else
-            {
-                if ( bSockBufState )
-                {
-                    // everything is ok
-                    eGetStatus = GS_BUFFER_OK;
-                }
-                else
-                {
-                    // channel is not yet disconnected but no data in buffer
-                    eGetStatus = GS_BUFFER_UNDERRUN;
-                }
-            }
+            Mutex.unlock();
         }
         else
         {
-            // channel is disconnected
-            eGetStatus = GS_CHAN_NOT_CONNECTED;
+            if ( bSockBufState )
+            {
+                // everything is ok
+                eGetStatus = GS_BUFFER_OK;
+            }
+            else
+            {
+                // channel is not yet disconnected but no data in buffer
+                eGetStatus = GS_BUFFER_UNDERRUN;
+            }
         }
     }
-    MutexSocketBuf.unlock();
+    else
+    {
+        // channel is disconnected
+        eGetStatus = GS_CHAN_NOT_CONNECTED;
+    }
 
     // in case we are just disconnected, we have to fire a message
     if ( eGetStatus == GS_CHAN_NOW_DISCONNECTED )
     {
-        // emit message
+        // emit message (this is no steady state, the signal may allocate
+        // memory)
+        CRtAllocGuardPause RtAllocGuardPause;
+
         emit Disconnected();
     }
 
     return eGetStatus;
 }
 
+EGetDataStat CChannel::GetDownstreamData ( CVector<uint8_t>& vecbyData,
+                                           int&              iNumBytes )
+{
+    // the jitter buffer block must fit in the vector
+    const int    iBlockSize = GetReceiveBlockSize();
+    EGetDataStat eGetStatus = GetData ( vecbyData, ( vecbyData.Size() >= iBlockSize ) ? iBlockSize : 0 );
+
+    if ( eGetStatus == GS_BUFFER_OK )
+    {
+        // the coded size is stored in front of the frame (little endian)
+        const int iFrameSize = vecbyData[0] | ( vecbyData[1] << 8 );
+
+        if ( ( iFrameSize > 0 ) && ( iFrameSize <= iBlockSize - NETW_FRAME_SIZE_FIELD_SIZE ) )
+        {
+            std::copy ( vecbyData.begin() + NETW_FRAME_SIZE_FIELD_SIZE,
+                        vecbyData.begin() + NETW_FRAME_SIZE_FIELD_SIZE + iFrameSize,
+                        vecbyData.begin() );
+
+            iNumBytes = iFrameSize;
+        }
+        else
+        {
+            eGetStatus = GS_BUFFER_UNDERRUN;
+        }
+    }
+
+    return eGetStatus;
+}
+
+bool CChannel::PrepPacket ( const CVector<uint8_t>& vecbyNPacket,
+                            const int               iNPacketLen )
+{
+    // The conversion buffer is only accessed by the sending thread, a new
+    // size is requested by the other threads and applied here (the request
+    // is zero if no initialization is pending).
+    if ( iConvBufInitRequest.loadAcquire() != 0 )
+    {
+        const int iNewPacketLen = iConvBufInitRequest.fetchAndStoreOrdered ( 0 );
+
+        // the size is only changed rarely, a change is no steady state
+        CRtAllocGuardPause RtAllocGuardPause;
+
+        ConvBuf.Init ( iNewPacketLen );
+        vecbySeqNumPacket.Init ( iNewPacketLen + NETW_SEQ_NUM_TRAILER_SIZE );
+        vecbyRedundantPacket.Init ( 2 * iNewPacketLen + NETW_SEQ_NUM_TRAILER_SIZE );
+        vecbyPrevAudioData.Init ( iNewPacketLen );
+
+        bPrevAudioDataIsValid = false;
+    }
+
+    // use conversion buffer to convert sound card block size in network
+    // block size
+    return ConvBuf.Put ( vecbyNPacket, iNPacketLen );
+}
+
 void CChannel::PrepAndSendPacket ( CHighPrioSocket*        pSocket,
                                    const CVector<uint8_t>& vecbyNPacket,
                                    const int               iNPacketLen )
 {
-    QMutexLocker locker ( &MutexConvBuf );
+    if ( PrepPacket ( vecbyNPacket, iNPacketLen ) )
+    {
+        pSocket->SendPacket ( GetPreparedPacket(), GetAddress() );
+    }
+}
 
-    // use conversion buffer to convert sound card block size in network
-    // block size
-    if ( ConvBuf.Put ( vecbyNPacket, iNPacketLen ) )
+void CChannel::PrepAndAddPacket ( CSocketSendBatch&       SendBatch,
+                                  const int               iSlot,
+                                  const CVector<uint8_t>& vecbyNPacket,
+                                  const int               iNPacketLen,
+                                  const bool              bCopy )
+{
+    if ( PrepPacket ( vecbyNPacket, iNPacketLen ) )
     {
-        pSocket->SendPacket ( ConvBuf.GetAll(), GetAddress() );
+        const CVector<uint8_t>& vecbyPacket = GetPreparedPacket();
+
+        // the packet must be copied if the conversion buffer is used again
+        // before the batch is sent
+        if ( bCopy )
+        {
+            SendBatch.SetCopy ( iSlot, vecbyPacket.data(), vecbyPacket.Size(), GetAddress() );
+        }
+        else
+        {
+            SendBatch.Set ( iSlot, vecbyPacket.data(), vecbyPacket.Size(), GetAddress() );
+        }
     }
 }
 
+const CVector<uint8_t>& CChannel::GetPreparedPacket()
+{
+    const CVector<uint8_t>& vecbyAudioPacket = ConvBuf.GetAll();
+
+    // the counters are always updated so that the sequence is continuous if
+    // the trailer is switched on
+    const uint16_t iCurSeqNum    = iSendSeqNum++;
+    const uint16_t iCurTimestamp = iSendTimestamp;
+
+    iSendTimestamp += static_cast<uint16_t> ( iNetwFrameSizeFact * iAudioFrameSizeSamples );
+
+    // the trailer is only added if the peer supports it
+    if ( iSendSeqNumTrailer.loadAcquire() == 0 )
+    {
+        bPrevAudioDataIsValid = false;
+        return vecbyAudioPacket;
+    }
+
+    // the redundant copy of the previous audio data is only added if the
+    // peer requests it and if the previous packet was sent directly before
+    const bool        bWithRedundancy = ( iSendRedundancy.loadAcquire() != 0 );
+    CVector<uint8_t>& vecbyPacket     = ( bWithRedundancy && bPrevAudioDataIsValid ) ?
+                                        vecbyRedundantPacket : vecbySeqNumPacket;
+    const int         iAudioNumBytes  = vecbyAudioPacket.Size();
+    const int         iTrailerPos     = vecbyPacket.Size() - NETW_SEQ_NUM_TRAILER_SIZE;
+
+    std::copy ( vecbyAudioPacket.begin(),
+                vecbyAudioPacket.end(),
+                vecbyPacket.begin() );
+
+    if ( iTrailerPos > iAudioNumBytes )
+    {
+        std::copy ( vecbyPrevAudioData.begin(),
+                    vecbyPrevAudioData.end(),
+                    vecbyPacket.begin() + iAudioNumBytes );
+    }
+
+    // sequence number and timestamp (little endian)
+    vecbyPacket[iTrailerPos]     = static_cast<uint8_t> ( iCurSeqNum & 0xFF );
+    vecbyPacket[iTrailerPos + 1] = static_cast<uint8_t> ( iCurSeqNum >> 8 );
+    vecbyPacket[iTrailerPos + 2] = static_cast<uint8_t> ( iCurTimestamp & 0xFF );
+    vecbyPacket[iTrailerPos + 3] = static_cast<uint8_t> ( iCurTimestamp >> 8 );
+
+    // keep the audio data for the next packet
+    if ( bWithRedundancy )
+    {
+        std::copy ( vecbyAudioPacket.begin(),
+                    vecbyAudioPacket.end(),
+                    vecbyPrevAudioData.begin() );
+    }
+
+    bPrevAudioDataIsValid = bWithRedundancy;
+
+    return vecbyPacket;
+}
+
 int CChannel::GetUploadRateKbps()
 {
     const int iAudioSizeOut = iNetwFrameSizeFact * iAudioFrameSizeSamples;
@@ -674,7 +1292,11 @@ int CChannel::GetUploadRateKbps()
     // 8 (UDP) + 20 (IP without optional fields) = 28 bytes
     // 2 (PPP) + 6 (PPPoE) + 18 (MAC)            = 26 bytes
     // 5 (RFC1483B) + 8 (AAL) + 10 (ATM)         = 23 bytes
-    return ( iNetwFrameSize * iNetwFrameSizeFact + 28 + 26 + 23 /* header */ ) *
+    // the redundant copy of the previous audio data doubles the audio data
+    const int iAudioNumBytes = iNetwFrameSize * iNetwFrameSizeFact *
+        ( ( iSendRedundancy.loadAcquire() != 0 ) ? 2 : 1 );
+
+    return ( iAudioNumBytes + 28 + 26 + 23 /* header */ ) *
         8 /* bits per byte */ *
         SYSTEM_SAMPLE_RATE_HZ / iAudioSizeOut / 1000;
 }
@@ -685,8 +1307,16 @@ void CChannel::UpdateSocketBufferSize()
     // do nothing
     if ( bDoAutoSockBufSize )
     {
-        // use auto setting result from channel, make sure we preserve the
-        // buffer memory since we just adjust the size here
-        SetSockBufNumFrames ( SockBuf.GetAutoSetting(), true );
+        const int iAutoSetting = SockBuf.GetAutoSetting();
+
+        // the size is only changed rarely, a change is no steady state
+        if ( iAutoSetting != iCurSockBufNumFrames )
+        {
+            CRtAllocGuardPause RtAllocGuardPause;
+
+            // use auto setting result from channel, make sure we preserve the
+            // buffer memory since we just adjust the size here
+            SetSockBufNumFrames ( iAutoSetting, true );
+        }
     }
 }
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <QThread>
+#include <QTimer>
 #include <QDateTime>
 #include <QFile>
 #include <QTextStream>
@@ -45,6 +46,18 @@
 #define FADE_IN_NUM_FRAMES                   2250
 #define FADE_IN_NUM_FRAMES_DBLE_FRAMESIZE    1125
 
+// interval of the statistic of the received audio packets which the client
+// reports to a server which adapts the size of its audio packets
+#define DOWNSTREAM_STATISTIC_INTERVAL_MS     1000
+
+// the client stores the coded size of each received frame in front of the
+// frame in the jitter buffer (the server may change the size)
+#define NETW_FRAME_SIZE_FIELD_SIZE           2
+
+// number of packets before the size change of the server in which the
+// client still accepts packets with the previous size (reordered packets)
+#define DOWNSTREAM_PREV_SIZE_NUM_PACKETS     64
+
 
 enum EPutDataStat
 {
@@ -76,17 +89,32 @@ public:
 
     EPutDataStat PutAudioData ( const CVector<uint8_t>& vecbyData,
                                 const int               iNumBytes,
-                                CHostAddress            RecHostAddr );
+                                const CHostAddress&     RecHostAddr );
 
     EGetDataStat GetData ( CVector<uint8_t>& vecbyData,
                            const int         iNumBytes );
 
+    // gets the next received frame of the server (client only), the coded
+    // size of the frame is returned since the server may change it (the
+    // vector must have at least the requested size plus the size field)
+    EGetDataStat GetDownstreamData ( CVector<uint8_t>& vecbyData,
+                                     int&              iNumBytes );
+
     void PrepAndSendPacket ( CHighPrioSocket*        pSocket,
                              const CVector<uint8_t>& vecbyNPacket,
                              const int               iNPacketLen );
 
-    void ResetTimeOutCounter() { iConTimeOut = iConTimeOutStartVal; }
-    bool IsConnected() const { return iConTimeOut > 0; }
+    // adds the network packet to the send batch instead of sending it (the
+    // packet data is not copied if bCopy is false, i.e. it is valid until
+    // the next call of this function)
+    void PrepAndAddPacket ( CSocketSendBatch&       SendBatch,
+                            const int               iSlot,
+                            const CVector<uint8_t>& vecbyNPacket,
+                            const int               iNPacketLen,
+                            const bool              bCopy );
+
+    void ResetTimeOutCounter() { iConTimeOut.storeRelease ( iConTimeOutStartVal ); }
+    bool IsConnected() const { return iConTimeOut.loadAcquire() > 0; }
     void Disconnect();
 
     void SetEnable ( const bool bNEnStat );
@@ -125,8 +153,18 @@ public:
                                const bool bPreserve = false );
     int GetSockBufNumFrames() const { return iCurSockBufNumFrames; }
 
+    double GetSockBufFillLevel() const
+        { return SockBuf.GetFillLevel ( iAudioFrameSizeSamples * 1000000 / SYSTEM_SAMPLE_RATE_HZ ); }
+
     void UpdateSocketBufferSize();
 
+    // the requests of the server timer thread are processed by the main thread
+    // which is woken up by the given notifier (server only)
+    void SetRequestNotifier ( CThreadNotifier* pNRequestNotifier )
+        { pRequestNotifier = pNRequestNotifier; }
+
+    void ProcessPendingRequests();
+
     int GetUploadRateKbps();
 
     // set/get network out buffer size and size factor
@@ -140,12 +178,32 @@ public:
 
     bool GetDoAutoSockBufSize() const { return bDoAutoSockBufSize; }
 
+    // request audio packets with a redundant copy of the previous packet from
+    // the peer (client only, the server follows the request of the client)
+    void SetUseRedundancy ( const bool bValue ) { bUseRedundancy = bValue; }
+    bool GetUseRedundancy() const { return bUseRedundancy; }
+
     int GetNetwFrameSizeFact() const { return iNetwFrameSizeFact; }
     int GetNetwFrameSize() const { return iNetwFrameSize; }
 
+    // coded size of the audio sent by the server, the server may reduce it
+    // below the size requested by the client to lower the bit rate if the
+    // client accepts it (the new size is set by the server timer thread and
+    // applied after the client has acknowledged it)
+    int GetDownstreamNetwFrameSize() const { return iDownstreamNetwFrameSize.loadAcquire(); }
+    void SetDownstreamNetwFrameSize ( const int iNewNetwFrameSize );
+
+    // statistic of the audio packets received by the client which was
+    // reported since the last call (server only, returns false if there is
+    // no new report)
+    bool GetDownstreamStatistic ( int& iNumReceived, int& iNumLost );
+
     void GetBufErrorRates ( CVector<double>& vecErrRates, double& dLimit, double& dMaxUpLimit )
         { SockBuf.GetErrorRates ( vecErrRates, dLimit, dMaxUpLimit ); }
 
+    CNetBufSeqStatistic GetAndResetSeqStatistic()
+        { return SockBuf.GetAndResetSeqStatistic(); }
+
     EAudComprType GetAudioCompressionType() { return eAudioCompressionType; }
     int GetNumAudioChannels() const { return iNumAudioChannels; }
 
@@ -171,12 +229,39 @@ public:
 
     bool ChannelLevelsRequired() const                { return bChannelLevelsRequired; }
 
+    // the channel list and the channel level list of a client which does not
+    // support more than MAX_NUM_CHANNELS_LEGACY channels are limited
+    bool SupportsManyChannels() const { return iSupportsManyChannels.loadAcquire() != 0; }
+
     double GetPrevLevel() const              { return dPrevLevel; }
     void   SetPrevLevel ( const double nPL ) { dPrevLevel = nPL; }
 
 protected:
     bool ProtocolIsEnabled();
 
+    void ApplyDownstreamSizeRequest();
+
+    // block size of the jitter buffer (the client stores the coded size in
+    // front of each frame, see NETW_FRAME_SIZE_FIELD_SIZE)
+    int GetReceiveBlockSize() const
+        { return bIsServer ? iNetwFrameSize : iNetwFrameSize + NETW_FRAME_SIZE_FIELD_SIZE; }
+
+    bool IsAudioPacketSize ( const int iNumBytes,
+                             const int iFrameSize,
+                             const bool bWithSeqNumOnly ) const;
+
+    int GetDownstreamFrameSize ( const CVector<uint8_t>& vecbyData,
+                                 const int               iNumBytes );
+
+    void ExpandToDownstreamBlocks ( const CVector<uint8_t>& vecbyData,
+                                   const int               iFrameSize,
+                                   const int               iNumFrames );
+
+    bool PrepPacket ( const CVector<uint8_t>& vecbyNPacket,
+                      const int               iNPacketLen );
+
+    const CVector<uint8_t>& GetPreparedPacket();
+
     void ResetNetworkTransportProperties()
     {
         // set it to a state were no decoding is ever possible (since we want
@@ -187,6 +272,19 @@ protected:
         iNetwFrameSize        = CELT_MINIMUM_NUM_BYTES;
         iNumAudioChannels     = 1; // mono
 
+        // the peer has to announce the sequence number support again
+        iSendSeqNumTrailer.storeRelease ( 0 );
+        iSendRedundancy.storeRelease ( 0 );
+
+        iDownstreamNetwFrameSize.storeRelease ( CELT_MINIMUM_NUM_BYTES );
+        iDownstreamSizeAnnounced.storeRelease ( CELT_MINIMUM_NUM_BYTES );
+        iDownstreamSizeRequest.storeRelease ( 0 );
+        iDownstreamSizePending.storeRelease ( 0 );
+        iDownstreamSizePrev.storeRelease ( 0 );
+        iDownstreamStatistic.storeRelease ( 0 );
+        iAcceptsAdaptiveSize.storeRelease ( 0 );
+        iSupportsManyChannels.storeRelease ( 0 );
+
         dPrevLevel            = 0.0;
     }
 
@@ -200,18 +298,65 @@ protected:
     CVector<double>   vecdGains;
     CVector<double>   vecdPannings;
 
-    // network jitter-buffer
-    CNetBufWithStats  SockBuf;
+    // network jitter-buffer (written by the socket thread and read by the
+    // audio thread without a lock)
+    CLockFreeNetBufWithStats SockBuf;
     int               iCurSockBufNumFrames;
     bool              bDoAutoSockBufSize;
 
     // network output conversion buffer
     CConvBuf<uint8_t> ConvBuf;
+    QAtomicInt        iConvBufInitRequest;
+
+    // sequence number trailer of the sent audio packets (the counters and the
+    // packet buffer are only accessed by the sending thread)
+    QAtomicInt        iSendSeqNumTrailer;
+    CVector<uint8_t>  vecbySeqNumPacket;
+    uint16_t          iSendSeqNum;
+    uint16_t          iSendTimestamp;
+
+    // redundant copy of the previous audio data in the sent audio packets
+    bool              bUseRedundancy;
+    QAtomicInt        iSendRedundancy;
+    CVector<uint8_t>  vecbyRedundantPacket;
+    CVector<uint8_t>  vecbyPrevAudioData;
+    bool              bPrevAudioDataIsValid;
+
+    // coded size of the audio sent by the server, the server announces a
+    // new size first and switches to it when the client has acknowledged it
+    // (the request is zero if no size change is pending)
+    QAtomicInt        iDownstreamNetwFrameSize;
+    QAtomicInt        iDownstreamSizeAnnounced;
+    QAtomicInt        iDownstreamSizeRequest;
+    QAtomicInt        iAcceptsAdaptiveSize;
+    QAtomicInt        iSupportsManyChannels;
+
+    // the client accepts the announced size (zero if no size change is
+    // pending) and the previous size (zero if not accepted anymore) besides
+    // the current size, the received frames are expanded to the blocks of
+    // the jitter buffer by the socket thread
+    QAtomicInt        iDownstreamSizePending;
+    QAtomicInt        iDownstreamSizePrev;
+    uint16_t          iDownstreamSizeSwitchSeqNum;
+    CVector<uint8_t>  vecbyDownstreamBlocks;
+
+    // statistic of the received audio packets, the client reports it
+    // periodically, the server stores the last report for the timer thread
+    // (received packets in the upper and lost packets in the lower 16 bits,
+    // zero if there is no new report)
+    QTimer            TimerDownstreamStatistic;
+    bool              bReportDownstreamStatistic;
+    QAtomicInt        iDownstreamStatistic;
+
+    // auto jitter buffer size which must be reported to the client (zero if
+    // no report is pending)
+    QAtomicInt        iSockBufSizeReport;
+    CThreadNotifier*  pRequestNotifier;
 
     // network protocol
     CProtocol         Protocol;
 
-    int               iConTimeOut;
+    QAtomicInt        iConTimeOut;
     int               iConTimeOutStartVal;
     int               iFadeInCnt;
     int               iFadeInCntMax;
@@ -227,8 +372,7 @@ protected:
     int               iNumAudioChannels;
 
     QMutex            Mutex;
-    QMutex            MutexSocketBuf;
-    QMutex            MutexConvBuf;
+    QMutex            MutexSocketBuf; // serializes the jitter buffer re-initializations
 
     bool              bChannelLevelsRequired;
     double            dPrevLevel;
@@ -241,6 +385,9 @@ public slots:
     void OnChangeChanInfo ( CChannelCoreInfo ChanInfo );
     void OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTransportProps );
     void OnReqNetTranspProps();
+    void OnMessageAcknowledged ( int iID );
+    void OnDownstreamStatisticReceived ( int iNumReceived, int iNumLost );
+    void OnTimerDownstreamStatistic();
 
     void OnParseMessageBody ( CVector<uint8_t> vecbyMesBodyData,
                               int              iRecCounter,
@@ -279,6 +426,7 @@ signals:
     void ConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo );
     void ChanInfoHasChanged();
     void MuteStateHasChanged ( int iChanID, bool bIsMuted );
+    void GainPanChanged ( int iChanID, double dNewGain, double dNewPan );
     void MuteStateHasChangedReceived ( int iChanID, bool bIsMuted );
     void ReqChanInfo();
     void ChatTextReceived ( QString strChatText );
@@ -30,7 +30,8 @@ CClient::CClient ( const quint16  iPortNumber,
                    const QString& strConnOnStartupAddress,
                    const int      iCtrlMIDIChannel,
                    const bool     bNoAutoJackConnect,
-                   const QString& strNClientName ) :
+                   const QString& strNClientName,
+                   const bool     bNUseRedundancy ) :
     vstrIPAddress                    ( MAX_NUM_SERVER_ADDR_ITEMS, "" ),
     ChannelInfo                      (),
     vecStoredFaderTags               ( MAX_NUM_STORED_FADER_SETTINGS, "" ),
@@ -122,6 +123,10 @@ CClient::CClient ( const quint16  iPortNumber,
     opus_custom_encoder_ctl ( OpusEncoderMono,   OPUS_SET_COMPLEXITY ( 1 ) );
     opus_custom_encoder_ctl ( OpusEncoderStereo, OPUS_SET_COMPLEXITY ( 1 ) );
 
+    // request the redundant audio data from the server (it is only used if
+    // the server supports it)
+    Channel.SetUseRedundancy ( bNUseRedundancy );
+
 
     // Connections -------------------------------------------------------------
     // connections for the protocol mechanism
@@ -878,8 +883,9 @@ void CClient::Init()
                                   CalcBitRateBitsPerSecFromCodedBytes (
                                       iCeltNumCodedBytes, iOPUSFrameSizeSamples ) ) );
 
-    // inits for network and channel
-    vecbyNetwData.Init ( iCeltNumCodedBytes );
+    // inits for network and channel (the channel stores the coded size in
+    // front of each received frame)
+    vecbyNetwData.Init ( iCeltNumCodedBytes + NETW_FRAME_SIZE_FIELD_SIZE );
 
     // set the channel network properties
     Channel.SetAudioStreamProperties ( eAudioCompressionType,
@@ -1140,11 +1146,15 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         vecsStereoSndCrdMuteStream = vecsStereoSndCrd;
     }
 
+    // the server may send the audio with a reduced size (the size is not
+    // used for lost packets)
+    int iCeltNumReceivedBytes = iCeltNumCodedBytes;
+
     for ( i = 0; i < iSndCrdFrameSizeFactor; i++ )
     {
         // receive a new block
         const bool bReceiveDataOk =
-            ( Channel.GetData ( vecbyNetwData, iCeltNumCodedBytes ) == GS_BUFFER_OK );
+            ( Channel.GetDownstreamData ( vecbyNetwData, iCeltNumReceivedBytes ) == GS_BUFFER_OK );
 
         // get pointer to coded data and manage the flags
         if ( bReceiveDataOk )
@@ -1168,7 +1178,7 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         {
             iUnused = opus_custom_decode ( CurOpusDecoder,
                                            pCurCodedData,
-                                           iCeltNumCodedBytes,
+                                           iCeltNumReceivedBytes,
                                            &vecsStereoSndCrd[i * iNumAudioChannels * iOPUSFrameSizeSamples],
                                            iOPUSFrameSizeSamples );
         }
@@ -109,7 +109,8 @@ public:
               const QString& strConnOnStartupAddress,
               const int      iCtrlMIDIChannel,
               const bool     bNoAutoJackConnect,
-              const QString& strNClientName );
+              const QString& strNClientName,
+              const bool     bNUseRedundancy = false );
 
     void   Start();
     void   Stop();
@@ -0,0 +1,314 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2020
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include <cmath>
+#include "driftcomp.h"
+
+
+/* Implementation *************************************************************/
+// Interpolation filter --------------------------------------------------------
+// The coefficient table is calculated once at program start. Row p contains
+// the Blackman windowed sinc for a fractional delay of p / NUM_PHASES samples
+// (there is one additional row for the interpolation between the phases).
+// Row 0 is a unit impulse so that the signal is not changed if the read
+// position is an integer.
+class CDriftCompFilterTable
+{
+public:
+    CDriftCompFilterTable()
+    {
+        const int    iHalfTaps = DRIFT_COMP_NUM_TAPS / 2;
+        const double dPi       = 3.14159265358979323846;
+
+        for ( int p = 0; p <= DRIFT_COMP_NUM_PHASES; p++ )
+        {
+            const double dFrac = static_cast<double> ( p ) / DRIFT_COMP_NUM_PHASES;
+            double       dSum  = 0;
+
+            for ( int k = 0; k < DRIFT_COMP_NUM_TAPS; k++ )
+            {
+                // distance of the tap from the interpolated position
+                const double dX = k - ( iHalfTaps - 1 ) - dFrac;
+
+                const double dSinc = ( dX == 0 ) ? 1.0 : sin ( dPi * dX ) / ( dPi * dX );
+
+                const double dWindow = 0.42 + 0.5 * cos ( dPi * dX / iHalfTaps ) +
+                                       0.08 * cos ( 2 * dPi * dX / iHalfTaps );
+
+                Coef[p][k] = static_cast<float> ( dSinc * dWindow );
+                dSum      += Coef[p][k];
+            }
+
+            // normalize the DC gain
+            for ( int k = 0; k < DRIFT_COMP_NUM_TAPS; k++ )
+            {
+                Coef[p][k] = static_cast<float> ( Coef[p][k] / dSum );
+            }
+        }
+    }
+
+    float Coef[DRIFT_COMP_NUM_PHASES + 1][DRIFT_COMP_NUM_TAPS];
+};
+
+static const CDriftCompFilterTable DriftCompFilterTable;
+
+
+// Drift compensator -----------------------------------------------------------
+CDriftCompensator::CDriftCompensator() :
+    iMaxNumChannels ( 0 ),
+    iMaxNumFrames   ( 0 ),
+    iNumChannels    ( 1 )
+{
+    Reset();
+}
+
+void CDriftCompensator::Init ( const int iNewMaxNumChannels,
+                               const int iNewMaxFrameSize )
+{
+    // the buffer must hold the filter history, one output frame and one input
+    // frame (plus one frame for the rounding of the read position)
+    iMaxNumChannels = iNewMaxNumChannels;
+    iMaxNumFrames   = 2 * iNewMaxFrameSize + DRIFT_COMP_NUM_TAPS + 2;
+
+    vecfBuffer.Init ( iMaxNumFrames * iMaxNumChannels, 0.0f );
+
+    Reset();
+}
+
+void CDriftCompensator::Reset()
+{
+    // the filter history is initialized with zeros and the read position is
+    // set to the last history sample, the look-ahead of the filter (plus one
+    // sample for the rounding of the read position) is primed with zeros, too,
+    // so that one input frame gives one output frame of the same size (the
+    // delay is DRIFT_COMP_NUM_TAPS / 2 + 1 samples)
+    iNumFrames = DRIFT_COMP_NUM_TAPS / 2 - 1 + DRIFT_COMP_NUM_TAPS / 2 + 1;
+    dReadPos   = DRIFT_COMP_NUM_TAPS / 2 - 1;
+
+    std::fill ( vecfBuffer.begin(), vecfBuffer.end(), 0.0f );
+
+    // reset the drift estimation
+    dRatio           = 1.0;
+    dFiltFillLevel   = 0.0;
+    dIntegrator      = 0.0;
+    bFillLevelIsInit = false;
+}
+
+void CDriftCompensator::SetNumChannels ( const int iNewNumChannels )
+{
+    if ( ( iNewNumChannels != iNumChannels ) && ( iNewNumChannels <= iMaxNumChannels ) )
+    {
+        iNumChannels = iNewNumChannels;
+        Reset();
+    }
+}
+
+int CDriftCompensator::GetNumRequiredFrames ( const int iOutFrameSize ) const
+{
+    // the last output sample needs half of the filter taps after its position,
+    // no further input is buffered
+    const int iLastPos = static_cast<int> ( dReadPos + ( iOutFrameSize - 1 ) * dRatio );
+
+    return iLastPos + DRIFT_COMP_NUM_TAPS / 2 + 1;
+}
+
+bool CDriftCompensator::IsInputRequired ( const int iOutFrameSize ) const
+{
+    return iNumFrames < GetNumRequiredFrames ( iOutFrameSize );
+}
+
+template<class TData> void CDriftCompensator::PutIntern ( const TData* pData,
+                                                          const int    iFrameSize )
+{
+    // check for buffer overrun (this cannot happen if the input is only put
+    // if it is required)
+    if ( iNumFrames + iFrameSize > iMaxNumFrames )
+    {
+        return;
+    }
+
+    const int iNumSamples = iFrameSize * iNumChannels;
+    float*    pfBuffer    = &vecfBuffer[iNumFrames * iNumChannels];
+
+    for ( int i = 0; i < iNumSamples; i++ )
+    {
+        pfBuffer[i] = static_cast<float> ( pData[i] );
+    }
+
+    iNumFrames += iFrameSize;
+}
+
+void CDriftCompensator::Put ( const int16_t* psData,
+                              const int      iFrameSize )
+{
+    PutIntern ( psData, iFrameSize );
+}
+
+void CDriftCompensator::Put ( const float* pfData,
+                              const int    iFrameSize )
+{
+    PutIntern ( pfData, iFrameSize );
+}
+
+template<class TData> void CDriftCompensator::GetIntern ( TData*    pData,
+                                                          const int iFrameSize )
+{
+    const int iHalfTaps = DRIFT_COMP_NUM_TAPS / 2;
+    float     fCoef[DRIFT_COMP_NUM_TAPS];
+
+    // in case of an input underrun (should not happen), silence is inserted
+    const int iNumReqFrames = std::min ( GetNumRequiredFrames ( iFrameSize ), iMaxNumFrames );
+
+    if ( iNumFrames < iNumReqFrames )
+    {
+        std::fill ( vecfBuffer.begin() + iNumFrames * iNumChannels,
+                    vecfBuffer.begin() + iNumReqFrames * iNumChannels,
+                    0.0f );
+
+        iNumFrames = iNumReqFrames;
+    }
+
+    for ( int i = 0; i < iFrameSize; i++ )
+    {
+        // integer and fractional part of the read position
+        const int    iPos   = static_cast<int> ( dReadPos );
+        const double dPhase = ( dReadPos - iPos ) * DRIFT_COMP_NUM_PHASES;
+        const int    iPhase = static_cast<int> ( dPhase );
+        const float  fAlpha = static_cast<float> ( dPhase - iPhase );
+
+        // linear interpolation between the two nearest filter phases
+        const float* pfCoef0 = DriftCompFilterTable.Coef[iPhase];
+        const float* pfCoef1 = DriftCompFilterTable.Coef[iPhase + 1];
+
+        for ( int k = 0; k < DRIFT_COMP_NUM_TAPS; k++ )
+        {
+            fCoef[k] = pfCoef0[k] + fAlpha * ( pfCoef1[k] - pfCoef0[k] );
+        }
+
+        const float* pfIn = &vecfBuffer[( iPos - iHalfTaps + 1 ) * iNumChannels];
+
+        for ( int c = 0; c < iNumChannels; c++ )
+        {
+            float fOut = 0.0f;
+
+            for ( int k = 0; k < DRIFT_COMP_NUM_TAPS; k++ )
+            {
+                fOut += fCoef[k] * pfIn[k * iNumChannels + c];
+            }
+
+            if ( sizeof ( TData ) == sizeof ( int16_t ) )
+            {
+                pData[i * iNumChannels + c] = static_cast<TData> ( Double2Short ( fOut ) );
+            }
+            else
+            {
+                pData[i * iNumChannels + c] = static_cast<TData> ( fOut );
+            }
+        }
+
+        dReadPos += dRatio;
+    }
+
+    // remove the samples which are no longer needed for the filter history
+    const int iNumDiscard = static_cast<int> ( dReadPos ) - iHalfTaps + 1;
+
+    if ( iNumDiscard > 0 )
+    {
+        std::copy ( vecfBuffer.begin() + iNumDiscard * iNumChannels,
+                    vecfBuffer.begin() + iNumFrames * iNumChannels,
+                    vecfBuffer.begin() );
+
+        iNumFrames -= iNumDiscard;
+        dReadPos   -= iNumDiscard;
+    }
+}
+
+void CDriftCompensator::Get ( int16_t*  psData,
+                              const int iFrameSize )
+{
+    GetIntern ( psData, iFrameSize );
+}
+
+void CDriftCompensator::Get ( float*    pfData,
+                              const int iFrameSize )
+{
+    GetIntern ( pfData, iFrameSize );
+}
+
+void CDriftCompensator::UpdateFillLevel ( const double dFillLevel,
+                                          const int    iBufferNumBlocks,
+                                          const int    iBlockSizeSamples )
+{
+    if ( iBufferNumBlocks < 2 )
+    {
+        return;
+    }
+
+    // time between two jitter buffer read accesses
+    const double dTimeStep = static_cast<double> ( iBlockSizeSamples ) / SYSTEM_SAMPLE_RATE_HZ;
+
+    // smooth the fill level to remove the network jitter
+    if ( bFillLevelIsInit )
+    {
+        const double dWeight = exp ( -dTimeStep / DRIFT_COMP_FILL_LEVEL_TIME_CONST );
+
+        dFiltFillLevel = dWeight * dFiltFillLevel + ( 1.0 - dWeight ) * dFillLevel;
+    }
+    else
+    {
+        dFiltFillLevel   = dFillLevel;
+        bFillLevelIsInit = true;
+    }
+
+    // the deviation of the fill level from the centre of the jitter buffer is
+    // the control error (a positive error means that the input clock is
+    // faster, i.e. we have to consume the audio faster)
+    double dError = ( dFiltFillLevel - iBufferNumBlocks / 2.0 ) * iBlockSizeSamples;
+
+    // apply the dead band
+    const double dDeadBand = DRIFT_COMP_DEADBAND_BLOCKS * iBlockSizeSamples;
+
+    if ( dError > dDeadBand )
+    {
+        dError -= dDeadBand;
+    }
+    else if ( dError < -dDeadBand )
+    {
+        dError += dDeadBand;
+    }
+    else
+    {
+        dError = 0.0;
+    }
+
+    // PI controller, the integrator estimates the clock drift
+    dIntegrator += DRIFT_COMP_INTEGRAL_GAIN * dError * dTimeStep;
+    dIntegrator  = std::max ( -DRIFT_COMP_MAX_RATIO_DEVIATION,
+                              std::min ( DRIFT_COMP_MAX_RATIO_DEVIATION, dIntegrator ) );
+
+    const double dCorrection = DRIFT_COMP_PROPORTIONAL_GAIN * dError + dIntegrator;
+
+    dRatio = 1.0 + std::max ( -DRIFT_COMP_MAX_RATIO_DEVIATION,
+                              std::min ( DRIFT_COMP_MAX_RATIO_DEVIATION, dCorrection ) );
+}
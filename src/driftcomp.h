@@ -0,0 +1,125 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2020
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include "global.h"
+#include "util.h"
+
+
+/* Definitions ****************************************************************/
+// number of taps of the interpolation filter of the resampler (must be even)
+// and number of filter phases which are stored in the coefficient table
+#define DRIFT_COMP_NUM_TAPS               16
+#define DRIFT_COMP_NUM_PHASES             128
+
+// maximum deviation of the resampling ratio from one (typical sound cards
+// have a clock deviation of less than 100 ppm)
+#define DRIFT_COMP_MAX_RATIO_DEVIATION    0.001
+
+// time constant of the jitter buffer fill level smoothing in seconds
+#define DRIFT_COMP_FILL_LEVEL_TIME_CONST  1.0
+
+// gains of the PI controller, the fill level error is measured in samples
+// (the integral gain is per second)
+#define DRIFT_COMP_PROPORTIONAL_GAIN      5.0e-6
+#define DRIFT_COMP_INTEGRAL_GAIN          2.0e-7
+
+// fill level errors smaller than this dead band (in blocks) are ignored by
+// the controller, otherwise the block-wise jitter buffer accesses lead to a
+// limit cycle of the resampling ratio
+#define DRIFT_COMP_DEADBAND_BLOCKS        0.25
+
+// maximum number of client frames which are decoded for one server frame
+#define DRIFT_COMP_MAX_NUM_DECODES        4
+
+
+/* Classes ********************************************************************/
+// Clock drift compensation ----------------------------------------------------
+// The sound card clock of a client and the clock of the server are never
+// exactly the same. Without a compensation, the jitter buffer slowly fills up
+// or runs empty which leads to dropouts, even if the network is perfect.
+// The drift compensator estimates the drift from the fill level trend of the
+// jitter buffer and corrects it with a fractional resampler (windowed sinc
+// interpolation) which consumes the decoded audio slightly faster or slower
+// so that the mean fill level is kept at the centre of the jitter buffer.
+// The resampler also converts between the input and the output frame sizes.
+// If the resampling ratio is exactly one, the audio is passed unchanged with a
+// delay of DRIFT_COMP_NUM_TAPS / 2 + 1 samples (otherwise up to one input
+// frame is buffered additionally).
+// The samples are interleaved, all functions are real-time safe (the memory
+// is allocated in Init()).
+class CDriftCompensator
+{
+public:
+    CDriftCompensator();
+
+    void Init ( const int iNewMaxNumChannels,
+                const int iNewMaxFrameSize );
+
+    void Reset();
+
+    // resets the compensator if the number of audio channels has changed
+    void SetNumChannels ( const int iNewNumChannels );
+
+    // returns true if more input data are required to get the next output
+    // frame of the given size (in samples per channel)
+    bool IsInputRequired ( const int iOutFrameSize ) const;
+
+    void Put ( const int16_t* psData, const int iFrameSize );
+    void Put ( const float* pfData, const int iFrameSize );
+    void Get ( int16_t* psData, const int iFrameSize );
+    void Get ( float* pfData, const int iFrameSize );
+
+    // has to be called after each jitter buffer read access with the fill
+    // level of the jitter buffer in blocks (see GetFillLevel() of the jitter
+    // buffer) and the jitter buffer size, a jitter buffer with less than two
+    // blocks has no room for a correction and therefore the ratio is held
+    void UpdateFillLevel ( const double dFillLevel,
+                           const int    iBufferNumBlocks,
+                           const int    iBlockSizeSamples );
+
+    double GetRatio() const { return dRatio; }
+
+protected:
+    template<class TData> void PutIntern ( const TData* pData,
+                                           const int    iFrameSize );
+
+    template<class TData> void GetIntern ( TData*    pData,
+                                           const int iFrameSize );
+
+    int GetNumRequiredFrames ( const int iOutFrameSize ) const;
+
+    CVector<float> vecfBuffer;
+    int            iMaxNumChannels;
+    int            iMaxNumFrames;
+    int            iNumChannels;
+    int            iNumFrames;
+    double         dReadPos;
+    double         dRatio;
+    double         dFiltFillLevel;
+    double         dIntegrator;
+    bool           bFillLevelIsInit;
+};
@@ -134,10 +134,19 @@ LED bar:      lbr
 #define CELT_MINIMUM_NUM_BYTES           10
 
 // Maximum block size for network input buffer. It is defined by the longest
-// protocol message which is PROTMESSID_CLM_SERVER_LIST: Worst case:
-// (2+2+1+2+2)+200*(4+2+2+1+1+2+20+2+32+2+20)=17609
-// We add some headroom to that value.
-#define MAX_SIZE_BYTES_NETW_BUF          20000
+// protocol message which is PROTMESSID_CONN_CLIENTS_LIST with MAX_NUM_CHANNELS
+// clients: Worst case (up to three bytes per character in UTF-8):
+// (7+2)+250*(1+2+4+1+4+2+3*16+2+3*20)=31009
+// We add some headroom to that value. The older versions have a buffer of
+// 20000 bytes, messages which may be received by them must not be longer
+// (the longest of these messages is PROTMESSID_CLM_SERVER_LIST: Worst case:
+// (2+2+1+2+2)+200*(4+2+2+1+1+2+20+2+32+2+20)=17609).
+#define MAX_SIZE_BYTES_NETW_BUF          32000
+#define MAX_SIZE_BYTES_NETW_BUF_LEGACY   20000
+
+// size of the optional sequence number trailer of the audio packets (2 bytes
+// sequence number and 2 bytes timestamp)
+#define NETW_SEQ_NUM_TRAILER_SIZE        4
 
 // minimum/maximum network buffer size (which can be chosen by slider)
 #define MIN_NET_BUF_SIZE_NUM_BL          1  // number of blocks
@@ -172,8 +181,22 @@ LED bar:      lbr
 #define LOW_BOUND_SIG_METER              ( -50.0 ) // dB
 #define UPPER_BOUND_SIG_METER            ( 0.0 )   // dB
 
-// Maximum number of connected clients at the server.
-#define MAX_NUM_CHANNELS                 50 // max number channels for server
+// Maximum number of connected clients at the server. The server allocates its
+// channels at runtime for the number of channels set at launch, this is only
+// the upper limit (the protocol transmits the channel ID in one byte).
+#define MAX_NUM_CHANNELS                 250 // max number channels for server
+
+// Maximum number of channels of the older clients. Their channel list and
+// channel level list must not have more entries and they have no faders for
+// higher channel IDs (a client announces the support of more channels in the
+// network transport properties).
+#define MAX_NUM_CHANNELS_LEGACY          50
+
+// maximum number of worker threads for the server audio processing
+#define MAX_NUM_SERVER_WORKER_THREADS    64
+
+// alignment of the server audio processing buffers (cache line size)
+#define AUDIO_BUFFER_ALIGNMENT_BYTES     64
 
 // actual number of used channels in the server
 // this parameter can safely be changed from 1 to MAX_NUM_CHANNELS
@@ -184,6 +207,9 @@ LED bar:      lbr
 // change this parameter, you most probably have to adjust MAX_SIZE_BYTES_NETW_BUF.
 #define MAX_NUM_SERVERS_IN_SERVER_LIST   150 // reduced to 150 because we now have genre-based server lists
 
+// time interval at which the server processing time statistics are reported
+#define PROCESSING_TIME_REPORT_INTERVAL_MS 10000 // ms
+
 // defines the time interval at which the ping time is updated in the GUI
 #define PING_UPDATE_TIME_MS              500 // ms
 
@@ -269,6 +295,8 @@ typedef unsigned char      uint8_t;
 /* Pseudo enum definitions -------------------------------------------------- */
 // definition for custom event
 #define MS_PACKET_RECEIVED               0
+#define MS_CHANNEL_DISCONNECTED          1
+#define MS_NO_CLIENTS_CONNECTED          2
 
 
 /* Classes ********************************************************************/
@@ -64,9 +64,22 @@ int main ( int argc, char** argv )
     bool         bShowAnalyzerConsole        = false;
     bool         bCentServPingServerInList   = false;
     bool         bNoAutoJackConnect          = false;
+    bool         bUseRedundancy              = false;
     bool         bUseTranslation             = true;
     bool         bCustomPortNumberGiven      = false;
+    bool         bUseParallelDecode          = false;
+    bool         bEnableProcTimeStats        = false;
+    bool         bUseFloatAudio              = false;
+    bool         bLockMemory                 = false;
+    bool         bUseDriftComp               = false;
+    bool         bUseAdaptiveBitRate         = false;
+    bool         bUseLoadGovernor            = false;
     int          iNumServerChannels          = DEFAULT_USED_NUM_CHANNELS;
+    int          iNumWorkerThreads           = 1;
+    int          iTimerRtPriority            = 0; // no real-time scheduling
+    int          iTimerCpuID                 = -1; // no CPU affinity
+    int          iTimerCatchUpPolicy         = TC_BURST;
+    int          iNumRecvThreads             = 1;
     int          iMaxDaysHistory             = DEFAULT_DAYS_HISTORY;
     int          iCtrlMIDIChannel            = INVALID_MIDI_CH;
     quint16      iPortNumber                 = DEFAULT_PORT_NUMBER;
@@ -82,6 +95,7 @@ int main ( int argc, char** argv )
     QString      strServerInfo               = "";
     QString      strWelcomeMessage           = "";
     QString      strClientName               = APP_NAME;
+    QString      strWorkerCpuAffinity        = "";
 
     // QT docu: argv()[0] is the program name, argv()[1] is the first
     // argument and argv()[argc()-1] is the last argument.
@@ -157,6 +171,215 @@ int main ( int argc, char** argv )
         }
 
 
+        // Number of server worker threads -------------------------------------
+        if ( GetNumericArgument ( tsConsole,
+                                  argc,
+                                  argv,
+                                  i,
+                                  "--workerthreads", // no short form
+                                  "--workerthreads",
+                                  1,
+                                  MAX_NUM_SERVER_WORKER_THREADS,
+                                  rDbleArgument ) )
+        {
+            iNumWorkerThreads = static_cast<int> ( rDbleArgument );
+
+            tsConsole << "- number of worker threads: "
+                << iNumWorkerThreads << endl;
+
+            continue;
+        }
+
+
+        // Parallel decoding in the server -------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--paralleldecode", // no short form
+                               "--paralleldecode" ) )
+        {
+            bUseParallelDecode = true;
+            tsConsole << "- parallel decoding enabled" << endl;
+            continue;
+        }
+
+
+        // Server processing time statistics -----------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--proctimestats", // no short form
+                               "--proctimestats" ) )
+        {
+            bEnableProcTimeStats = true;
+            tsConsole << "- processing time statistics enabled" << endl;
+            continue;
+        }
+
+
+        // Server float audio processing ---------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--floataudio", // no short form
+                               "--floataudio" ) )
+        {
+            bUseFloatAudio = true;
+            tsConsole << "- float audio processing enabled" << endl;
+            continue;
+        }
+
+
+        // Server clock drift compensation -------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--driftcomp", // no short form
+                               "--driftcomp" ) )
+        {
+            bUseDriftComp = true;
+            tsConsole << "- clock drift compensation enabled" << endl;
+            continue;
+        }
+
+
+        // Server adaptive bit rate --------------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--adaptivebitrate", // no short form
+                               "--adaptivebitrate" ) )
+        {
+            bUseAdaptiveBitRate = true;
+            tsConsole << "- adaptive bit rate enabled" << endl;
+            continue;
+        }
+
+
+        // Server load governor ------------------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--loadgovernor", // no short form
+                               "--loadgovernor" ) )
+        {
+            bUseLoadGovernor = true;
+            tsConsole << "- load governor enabled (reduces the encoder complexity above " <<
+                LOAD_GOV_HIGH_LOAD_PERCENT << " %, restores it below " <<
+                LOAD_GOV_LOW_LOAD_PERCENT << " % of the frame period)" << endl;
+            continue;
+        }
+
+
+        // Real-time priority of the server timer thread -----------------------
+        if ( GetNumericArgument ( tsConsole,
+                                  argc,
+                                  argv,
+                                  i,
+                                  "--rtpriority", // no short form
+                                  "--rtpriority",
+                                  1,
+                                  99,
+                                  rDbleArgument ) )
+        {
+            iTimerRtPriority = static_cast<int> ( rDbleArgument );
+
+            tsConsole << "- SCHED_FIFO priority of the timer thread: "
+                << iTimerRtPriority << endl;
+
+            continue;
+        }
+
+
+        // CPU affinity of the server timer thread -----------------------------
+        if ( GetNumericArgument ( tsConsole,
+                                  argc,
+                                  argv,
+                                  i,
+                                  "--timercpu", // no short form
+                                  "--timercpu",
+                                  0,
+                                  1023,
+                                  rDbleArgument ) )
+        {
+            iTimerCpuID = static_cast<int> ( rDbleArgument );
+
+            tsConsole << "- timer thread CPU: " << iTimerCpuID << endl;
+            continue;
+        }
+
+
+        // Lock the memory of the server ---------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--mlockall", // no short form
+                               "--mlockall" ) )
+        {
+            bLockMemory = true;
+            tsConsole << "- memory locking enabled" << endl;
+            continue;
+        }
+
+
+        // Catch-up policy of the server timer ---------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "--timercatchup", // no short form
+                                 "--timercatchup",
+                                 strArgument ) )
+        {
+            if ( !strArgument.compare ( "skip" ) )
+            {
+                iTimerCatchUpPolicy = TC_SKIP;
+            }
+            else if ( !strArgument.compare ( "burst" ) )
+            {
+                iTimerCatchUpPolicy = TC_BURST;
+            }
+            else
+            {
+                tsConsole << argv[0] << ": '--timercatchup' needs the argument "
+                    "'burst' or 'skip'" << endl;
+
+                exit ( 1 );
+            }
+
+            tsConsole << "- timer catch-up policy: " << strArgument << endl;
+            continue;
+        }
+
+
+        // Number of server receive threads ------------------------------------
+        if ( GetNumericArgument ( tsConsole,
+                                  argc,
+                                  argv,
+                                  i,
+                                  "--recvthreads", // no short form
+                                  "--recvthreads",
+                                  1,
+                                  MAX_NUM_SOCKET_RECV_THREADS,
+                                  rDbleArgument ) )
+        {
+            iNumRecvThreads = static_cast<int> ( rDbleArgument );
+
+            tsConsole << "- number of receive threads: "
+                << iNumRecvThreads << endl;
+
+            continue;
+        }
+
+
+        // CPU affinity of server worker threads -------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "--workercpus", // no short form
+                                 "--workercpus",
+                                 strArgument ) )
+        {
+            strWorkerCpuAffinity = strArgument;
+            tsConsole << "- worker thread CPUs: " << strWorkerCpuAffinity << endl;
+            continue;
+        }
+
+
         // Maximum days in history display -------------------------------------
         if ( GetNumericArgument ( tsConsole,
                                   argc,
@@ -225,6 +448,18 @@ int main ( int argc, char** argv )
         }
 
 
+        // Redundant audio data ------------------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--redundancy", // no short form
+                               "--redundancy" ) )
+        {
+            bUseRedundancy = true;
+            tsConsole << "- send and receive redundant audio data" << endl;
+            continue;
+        }
+
+
         // Disable translations ------------------------------------------------
         if ( GetFlagArgument ( argv,
                                i,
@@ -575,6 +810,27 @@ int main ( int argc, char** argv )
 // TEST -> activate the following line to activate the test bench,
 //CTestbench Testbench ( "127.0.0.1", DEFAULT_PORT_NUMBER );
 
+// TEST -> activate the following line to run the protocol CRC micro benchmark
+//CTestbench::RunCRCBenchmark();
+
+// TEST -> activate the following line to run the server send path micro benchmark
+//CTestbench::RunSendBatchBenchmark();
+
+// TEST -> activate the following line to run the jitter buffer statistic regression test
+//CTestbench::RunNetBufStatsRegressionTest();
+
+// TEST -> activate the following line to run the jitter buffer sequence number test
+//CTestbench::RunNetBufSeqNumTest();
+
+// TEST -> activate the following line to run the jitter buffer redundancy test
+//CTestbench::RunNetBufRedundancyTest();
+
+// TEST -> activate the following line to run the jitter buffer producer/consumer stress test
+//CTestbench::RunNetBufStressTest();
+
+// TEST -> activate the following line to run the clock drift compensator test
+//CTestbench::RunDriftCompTest();
+
 
     try
     {
@@ -586,7 +842,8 @@ int main ( int argc, char** argv )
                              strConnOnStartupAddress,
                              iCtrlMIDIChannel,
                              bNoAutoJackConnect,
-                             strClientName );
+                             strClientName,
+                             bUseRedundancy );
 
             // load settings from init-file
             CSettings Settings ( &Client, strIniFileName );
@@ -633,7 +890,20 @@ int main ( int argc, char** argv )
                              bCentServPingServerInList,
                              bDisconnectAllClientsOnQuit,
                              bUseDoubleSystemFrameSize,
-                             eLicenceType );
+                             eLicenceType,
+                             iNumWorkerThreads,
+                             strWorkerCpuAffinity,
+                             bUseParallelDecode,
+                             bEnableProcTimeStats,
+                             bUseFloatAudio,
+                             iTimerRtPriority,
+                             iTimerCpuID,
+                             bLockMemory,
+                             static_cast<ETimerCatchUpPolicy> ( iTimerCatchUpPolicy ),
+                             iNumRecvThreads,
+                             bUseDriftComp,
+                             bUseAdaptiveBitRate,
+                             bUseLoadGovernor );
             if ( bUseGUI )
             {
                 // load settings from init-file
@@ -732,11 +1002,30 @@ QString UsageArguments ( char **argv )
         "  -w, --welcomemessage  welcome message on connect\n"
         "  -y, --history         enable connection history and set file name\n"
         "  -z, --startminimized  start minimizied\n"
+        "  --workerthreads       number of threads for mixing and encoding\n"
+        "  --workercpus          comma separated list of CPU cores for the\n"
+        "                        worker threads\n"
+        "  --paralleldecode      decode the client streams in the worker threads\n"
+        "  --proctimestats       report the audio processing times in the log\n"
+        "  --floataudio          use float audio processing in the server\n"
+        "  --driftcomp           compensate the clock drift of the clients\n"
+        "  --adaptivebitrate     reduce the bit rate for congested clients\n"
+        "  --loadgovernor        reduce the encoder complexity if the server is\n"
+        "                        overloaded\n"
+        "  --rtpriority          SCHED_FIFO priority of the timer and worker\n"
+        "                        threads (Linux only)\n"
+        "  --timercpu            CPU core for the timer thread\n"
+        "  --mlockall            lock the server memory (Linux only)\n"
+        "  --timercatchup        'burst' (default) processes missed frames back\n"
+        "                        to back, 'skip' drops them\n"
+        "  --recvthreads         number of network receive threads (Linux only)\n"
         "\nClient only:\n"
         "  -c, --connect         connect to given server address on startup\n"
         "  -j, --nojackconnect   disable auto Jack connections\n"
         "  --ctrlmidich          MIDI controller channel to listen\n"
         "  --clientname          client name (window title and jack client name)\n"
+        "  --redundancy          send and receive a copy of the previous audio\n"
+        "                        packet to recover single packet losses\n"
         "\nExample: " + QString ( argv[0] ) + " -s -inifile myinifile.ini\n";
 }
 
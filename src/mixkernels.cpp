@@ -0,0 +1,495 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2020
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "mixkernels.h"
+#ifdef USE_X86_MIX_KERNELS
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+# endif
+#endif
+
+// The SIMD kernels are compiled with the required instruction set enabled for
+// the respective functions only, so that the rest of the application still
+// runs on CPUs which do not support these instruction sets (MSVC does not need
+// this since it always allows the usage of the intrinsics).
+#if defined ( USE_X86_MIX_KERNELS ) && ( defined ( __GNUC__ ) || defined ( __clang__ ) )
+# define MIX_TARGET_SSE2 __attribute__ ( ( target ( "sse2" ) ) )
+# define MIX_TARGET_AVX2 __attribute__ ( ( target ( "avx2" ) ) )
+#else
+# define MIX_TARGET_SSE2
+# define MIX_TARGET_AVX2
+#endif
+
+
+/* Implementation *************************************************************/
+// Generic kernels -------------------------------------------------------------
+struct CMixKernelsGeneric
+{
+    template<class TIn, int iInChan, int iOutChan, bool bUnityGain>
+    static void Mix ( float*      pfAccum,
+                      const TIn*  pIn,
+                      const int   iNumFrames,
+                      const float fGainL,
+                      const float fGainR )
+    {
+        for ( int i = 0; i < iNumFrames; i++ )
+        {
+            if ( iOutChan == 1 )
+            {
+                if ( iInChan == 1 )
+                {
+                    // mono
+                    pfAccum[i] += bUnityGain ? pIn[i] : pIn[i] * fGainL;
+                }
+                else
+                {
+                    // stereo: apply stereo-to-mono attenuation
+                    pfAccum[i] += ( static_cast<float> ( pIn[2 * i] ) + pIn[2 * i + 1] ) *
+                        ( bUnityGain ? 0.5f : 0.5f * fGainL );
+                }
+            }
+            else
+            {
+                // for a mono input copy same mono data in both out stereo audio channels
+                const float fInL = pIn[iInChan * i];
+                const float fInR = pIn[iInChan * i + iInChan - 1];
+
+                pfAccum[2 * i]     += bUnityGain ? fInL : fInL * fGainL;
+                pfAccum[2 * i + 1] += bUnityGain ? fInR : fInR * fGainR;
+            }
+        }
+    }
+
+    static void Saturate ( const float* pfAccum,
+                           int16_t*     psOut,
+                           const int    iNumSamples )
+    {
+        for ( int i = 0; i < iNumSamples; i++ )
+        {
+            psOut[i] = static_cast<int16_t> ( std::max ( static_cast<float> ( _MINSHORT ),
+                                              std::min ( static_cast<float> ( _MAXSHORT ), pfAccum[i] ) ) );
+        }
+    }
+
+    static void Clip ( const float* pfAccum,
+                       float*       pfOut,
+                       const int    iNumSamples )
+    {
+        for ( int i = 0; i < iNumSamples; i++ )
+        {
+            pfOut[i] = std::max ( -1.0f, std::min ( 1.0f, pfAccum[i] ) );
+        }
+    }
+};
+
+#ifdef USE_X86_MIX_KERNELS
+// SSE2 kernels ----------------------------------------------------------------
+struct CMixKernelsSSE2
+{
+    // loads four mono samples and converts them to float
+    MIX_TARGET_SSE2 static inline __m128 Load4 ( const int16_t* psIn )
+    {
+        // sign extend the shorts to 32 bit
+        const __m128i viIn = _mm_loadl_epi64 ( reinterpret_cast<const __m128i*> ( psIn ) );
+        return _mm_cvtepi32_ps ( _mm_srai_epi32 ( _mm_unpacklo_epi16 ( viIn, viIn ), 16 ) );
+    }
+
+    MIX_TARGET_SSE2 static inline __m128 Load4 ( const float* pfIn ) { return _mm_loadu_ps ( pfIn ); }
+
+    // loads four stereo frames and returns the sum of left and right channel
+    MIX_TARGET_SSE2 static inline __m128 LoadStereoSum4 ( const int16_t* psIn )
+    {
+        // the left and right samples are added in 32 bit integer
+        const __m128i viIn = _mm_loadu_si128 ( reinterpret_cast<const __m128i*> ( psIn ) );
+        return _mm_cvtepi32_ps ( _mm_madd_epi16 ( viIn, _mm_set1_epi16 ( 1 ) ) );
+    }
+
+    MIX_TARGET_SSE2 static inline __m128 LoadStereoSum4 ( const float* pfIn )
+    {
+        const __m128 vIn0 = _mm_loadu_ps ( pfIn );
+        const __m128 vIn1 = _mm_loadu_ps ( pfIn + 4 );
+
+        return _mm_add_ps ( _mm_shuffle_ps ( vIn0, vIn1, _MM_SHUFFLE ( 2, 0, 2, 0 ) ),
+                            _mm_shuffle_ps ( vIn0, vIn1, _MM_SHUFFLE ( 3, 1, 3, 1 ) ) );
+    }
+
+    MIX_TARGET_SSE2 static inline void Accumulate4 ( float* pfAccum, const __m128 vIn )
+    {
+        _mm_storeu_ps ( pfAccum, _mm_add_ps ( _mm_loadu_ps ( pfAccum ), vIn ) );
+    }
+
+    template<class TIn, int iInChan, int iOutChan, bool bUnityGain>
+    MIX_TARGET_SSE2 static void Mix ( float*      pfAccum,
+                                      const TIn*  pIn,
+                                      const int   iNumFrames,
+                                      const float fGainL,
+                                      const float fGainR )
+    {
+        int i = 0;
+
+        if ( ( iInChan == 1 ) && ( iOutChan == 1 ) )
+        {
+            const __m128 vGain = _mm_set1_ps ( fGainL );
+
+            for ( ; i + 4 <= iNumFrames; i += 4 )
+            {
+                const __m128 vIn = Load4 ( &pIn[i] );
+
+                Accumulate4 ( &pfAccum[i], bUnityGain ? vIn : _mm_mul_ps ( vIn, vGain ) );
+            }
+        }
+        else if ( iOutChan == 1 )
+        {
+            // stereo-to-mono attenuation
+            const __m128 vGain = _mm_set1_ps ( bUnityGain ? 0.5f : 0.5f * fGainL );
+
+            for ( ; i + 4 <= iNumFrames; i += 4 )
+            {
+                Accumulate4 ( &pfAccum[i], _mm_mul_ps ( LoadStereoSum4 ( &pIn[2 * i] ), vGain ) );
+            }
+        }
+        else if ( iInChan == 1 )
+        {
+            // mono-to-stereo: interleave the left and right output samples
+            const __m128 vGainL = _mm_set1_ps ( fGainL );
+            const __m128 vGainR = _mm_set1_ps ( fGainR );
+
+            for ( ; i + 4 <= iNumFrames; i += 4 )
+            {
+                const __m128 vIn = Load4 ( &pIn[i] );
+                const __m128 vL  = bUnityGain ? vIn : _mm_mul_ps ( vIn, vGainL );
+                const __m128 vR  = bUnityGain ? vIn : _mm_mul_ps ( vIn, vGainR );
+
+                Accumulate4 ( &pfAccum[2 * i],     _mm_unpacklo_ps ( vL, vR ) );
+                Accumulate4 ( &pfAccum[2 * i + 4], _mm_unpackhi_ps ( vL, vR ) );
+            }
+        }
+        else
+        {
+            // stereo: the gain vector alternates between left and right gain
+            const __m128 vGain = _mm_setr_ps ( fGainL, fGainR, fGainL, fGainR );
+
+            for ( ; i + 4 <= iNumFrames; i += 4 )
+            {
+                const __m128 vLo = Load4 ( &pIn[2 * i] );
+                const __m128 vHi = Load4 ( &pIn[2 * i + 4] );
+
+                Accumulate4 ( &pfAccum[2 * i],     bUnityGain ? vLo : _mm_mul_ps ( vLo, vGain ) );
+                Accumulate4 ( &pfAccum[2 * i + 4], bUnityGain ? vHi : _mm_mul_ps ( vHi, vGain ) );
+            }
+        }
+
+        // remaining frames which do not fill a complete vector
+        CMixKernelsGeneric::Mix<TIn, iInChan, iOutChan, bUnityGain> ( &pfAccum[iOutChan * i],
+                                                                      &pIn[iInChan * i],
+                                                                      iNumFrames - i,
+                                                                      fGainL,
+                                                                      fGainR );
+    }
+
+    MIX_TARGET_SSE2 static void Saturate ( const float* pfAccum,
+                                           int16_t*     psOut,
+                                           const int    iNumSamples )
+    {
+        const __m128 vMin = _mm_set1_ps ( static_cast<float> ( _MINSHORT ) );
+        const __m128 vMax = _mm_set1_ps ( static_cast<float> ( _MAXSHORT ) );
+        int          i    = 0;
+
+        for ( ; i + 8 <= iNumSamples; i += 8 )
+        {
+            // clip to the short range first since the float to integer
+            // conversion does not saturate
+            const __m128 vLo = _mm_max_ps ( vMin, _mm_min_ps ( vMax, _mm_loadu_ps ( &pfAccum[i] ) ) );
+            const __m128 vHi = _mm_max_ps ( vMin, _mm_min_ps ( vMax, _mm_loadu_ps ( &pfAccum[i + 4] ) ) );
+
+            _mm_storeu_si128 ( reinterpret_cast<__m128i*> ( &psOut[i] ),
+                               _mm_packs_epi32 ( _mm_cvttps_epi32 ( vLo ), _mm_cvttps_epi32 ( vHi ) ) );
+        }
+
+        CMixKernelsGeneric::Saturate ( &pfAccum[i], &psOut[i], iNumSamples - i );
+    }
+
+    MIX_TARGET_SSE2 static void Clip ( const float* pfAccum,
+                                       float*       pfOut,
+                                       const int    iNumSamples )
+    {
+        const __m128 vMin = _mm_set1_ps ( -1.0f );
+        const __m128 vMax = _mm_set1_ps ( 1.0f );
+        int          i    = 0;
+
+        for ( ; i + 4 <= iNumSamples; i += 4 )
+        {
+            _mm_storeu_ps ( &pfOut[i], _mm_max_ps ( vMin, _mm_min_ps ( vMax, _mm_loadu_ps ( &pfAccum[i] ) ) ) );
+        }
+
+        CMixKernelsGeneric::Clip ( &pfAccum[i], &pfOut[i], iNumSamples - i );
+    }
+};
+
+
+// AVX2 kernels ----------------------------------------------------------------
+struct CMixKernelsAVX2
+{
+    // loads eight mono samples and converts them to float
+    MIX_TARGET_AVX2 static inline __m256 Load8 ( const int16_t* psIn )
+    {
+        return _mm256_cvtepi32_ps ( _mm256_cvtepi16_epi32 (
+            _mm_loadu_si128 ( reinterpret_cast<const __m128i*> ( psIn ) ) ) );
+    }
+
+    MIX_TARGET_AVX2 static inline __m256 Load8 ( const float* pfIn ) { return _mm256_loadu_ps ( pfIn ); }
+
+    // loads eight stereo frames and returns the sum of left and right channel
+    MIX_TARGET_AVX2 static inline __m256 LoadStereoSum8 ( const int16_t* psIn )
+    {
+        // the left and right samples are added in 32 bit integer
+        const __m256i viIn = _mm256_loadu_si256 ( reinterpret_cast<const __m256i*> ( psIn ) );
+        return _mm256_cvtepi32_ps ( _mm256_madd_epi16 ( viIn, _mm256_set1_epi16 ( 1 ) ) );
+    }
+
+    MIX_TARGET_AVX2 static inline __m256 LoadStereoSum8 ( const float* pfIn )
+    {
+        const __m256 vIn0 = _mm256_loadu_ps ( pfIn );
+        const __m256 vIn1 = _mm256_loadu_ps ( pfIn + 8 );
+
+        // the shuffle instruction works on the 128 bit lanes, therefore the
+        // 64 bit blocks have to be reordered afterwards
+        const __m256 vSum = _mm256_add_ps ( _mm256_shuffle_ps ( vIn0, vIn1, _MM_SHUFFLE ( 2, 0, 2, 0 ) ),
+                                            _mm256_shuffle_ps ( vIn0, vIn1, _MM_SHUFFLE ( 3, 1, 3, 1 ) ) );
+
+        return _mm256_castpd_ps ( _mm256_permute4x64_pd ( _mm256_castps_pd ( vSum ), 0xD8 ) );
+    }
+
+    MIX_TARGET_AVX2 static inline void Accumulate8 ( float* pfAccum, const __m256 vIn )
+    {
+        _mm256_storeu_ps ( pfAccum, _mm256_add_ps ( _mm256_loadu_ps ( pfAccum ), vIn ) );
+    }
+
+    template<class TIn, int iInChan, int iOutChan, bool bUnityGain>
+    MIX_TARGET_AVX2 static void Mix ( float*      pfAccum,
+                                      const TIn*  pIn,
+                                      const int   iNumFrames,
+                                      const float fGainL,
+                                      const float fGainR )
+    {
+        int i = 0;
+
+        if ( ( iInChan == 1 ) && ( iOutChan == 1 ) )
+        {
+            const __m256 vGain = _mm256_set1_ps ( fGainL );
+
+            for ( ; i + 8 <= iNumFrames; i += 8 )
+            {
+                const __m256 vIn = Load8 ( &pIn[i] );
+
+                Accumulate8 ( &pfAccum[i], bUnityGain ? vIn : _mm256_mul_ps ( vIn, vGain ) );
+            }
+        }
+        else if ( iOutChan == 1 )
+        {
+            // stereo-to-mono attenuation
+            const __m256 vGain = _mm256_set1_ps ( bUnityGain ? 0.5f : 0.5f * fGainL );
+
+            for ( ; i + 8 <= iNumFrames; i += 8 )
+            {
+                Accumulate8 ( &pfAccum[i], _mm256_mul_ps ( LoadStereoSum8 ( &pIn[2 * i] ), vGain ) );
+            }
+        }
+        else if ( iInChan == 1 )
+        {
+            // mono-to-stereo: the unpack instructions work on the 128 bit
+            // lanes, therefore the lanes have to be reordered afterwards
+            const __m256 vGainL = _mm256_set1_ps ( fGainL );
+            const __m256 vGainR = _mm256_set1_ps ( fGainR );
+
+            for ( ; i + 8 <= iNumFrames; i += 8 )
+            {
+                const __m256 vIn = Load8 ( &pIn[i] );
+                const __m256 vL  = bUnityGain ? vIn : _mm256_mul_ps ( vIn, vGainL );
+                const __m256 vR  = bUnityGain ? vIn : _mm256_mul_ps ( vIn, vGainR );
+                const __m256 vLo = _mm256_unpacklo_ps ( vL, vR );
+                const __m256 vHi = _mm256_unpackhi_ps ( vL, vR );
+
+                Accumulate8 ( &pfAccum[2 * i],     _mm256_permute2f128_ps ( vLo, vHi, 0x20 ) );
+                Accumulate8 ( &pfAccum[2 * i + 8], _mm256_permute2f128_ps ( vLo, vHi, 0x31 ) );
+            }
+        }
+        else
+        {
+            // stereo: the gain vector alternates between left and right gain
+            const __m256 vGain = _mm256_setr_ps ( fGainL, fGainR, fGainL, fGainR, fGainL, fGainR, fGainL, fGainR );
+
+            for ( ; i + 8 <= iNumFrames; i += 8 )
+            {
+                const __m256 vLo = Load8 ( &pIn[2 * i] );
+                const __m256 vHi = Load8 ( &pIn[2 * i + 8] );
+
+                Accumulate8 ( &pfAccum[2 * i],     bUnityGain ? vLo : _mm256_mul_ps ( vLo, vGain ) );
+                Accumulate8 ( &pfAccum[2 * i + 8], bUnityGain ? vHi : _mm256_mul_ps ( vHi, vGain ) );
+            }
+        }
+
+        // remaining frames which do not fill a complete vector
+        CMixKernelsGeneric::Mix<TIn, iInChan, iOutChan, bUnityGain> ( &pfAccum[iOutChan * i],
+                                                                      &pIn[iInChan * i],
+                                                                      iNumFrames - i,
+                                                                      fGainL,
+                                                                      fGainR );
+    }
+
+    MIX_TARGET_AVX2 static void Saturate ( const float* pfAccum,
+                                           int16_t*     psOut,
+                                           const int    iNumSamples )
+    {
+        const __m256 vMin = _mm256_set1_ps ( static_cast<float> ( _MINSHORT ) );
+        const __m256 vMax = _mm256_set1_ps ( static_cast<float> ( _MAXSHORT ) );
+        int          i    = 0;
+
+        for ( ; i + 16 <= iNumSamples; i += 16 )
+        {
+            // clip to the short range first since the float to integer
+            // conversion does not saturate
+            const __m256 vLo = _mm256_max_ps ( vMin, _mm256_min_ps ( vMax, _mm256_loadu_ps ( &pfAccum[i] ) ) );
+            const __m256 vHi = _mm256_max_ps ( vMin, _mm256_min_ps ( vMax, _mm256_loadu_ps ( &pfAccum[i + 8] ) ) );
+
+            // the pack instruction works on the 128 bit lanes, reorder the
+            // 64 bit blocks to get the original sample order
+            const __m256i viPacked = _mm256_packs_epi32 ( _mm256_cvttps_epi32 ( vLo ), _mm256_cvttps_epi32 ( vHi ) );
+
+            _mm256_storeu_si256 ( reinterpret_cast<__m256i*> ( &psOut[i] ),
+                                  _mm256_permute4x64_epi64 ( viPacked, 0xD8 ) );
+        }
+
+        CMixKernelsGeneric::Saturate ( &pfAccum[i], &psOut[i], iNumSamples - i );
+    }
+
+    MIX_TARGET_AVX2 static void Clip ( const float* pfAccum,
+                                       float*       pfOut,
+                                       const int    iNumSamples )
+    {
+        const __m256 vMin = _mm256_set1_ps ( -1.0f );
+        const __m256 vMax = _mm256_set1_ps ( 1.0f );
+        int          i    = 0;
+
+        for ( ; i + 8 <= iNumSamples; i += 8 )
+        {
+            _mm256_storeu_ps ( &pfOut[i], _mm256_max_ps ( vMin, _mm256_min_ps ( vMax, _mm256_loadu_ps ( &pfAccum[i] ) ) ) );
+        }
+
+        CMixKernelsGeneric::Clip ( &pfAccum[i], &pfOut[i], iNumSamples - i );
+    }
+};
+
+
+// CPU feature detection -------------------------------------------------------
+static bool CpuSupportsSSE2()
+{
+# if defined ( _M_X64 ) || defined ( __x86_64__ )
+    // SSE2 is part of the x86-64 base instruction set
+    return true;
+# elif defined ( _MSC_VER )
+    int iCpuInfo[4];
+    __cpuid ( iCpuInfo, 1 );
+    return ( iCpuInfo[3] & ( 1 << 26 ) ) != 0;
+# else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports ( "sse2" );
+# endif
+}
+
+static bool CpuSupportsAVX2()
+{
+# ifdef _MSC_VER
+    int iCpuInfo[4];
+    __cpuid ( iCpuInfo, 0 );
+
+    if ( iCpuInfo[0] < 7 )
+    {
+        return false;
+    }
+
+    // the operating system must support saving the AVX registers
+    __cpuid ( iCpuInfo, 1 );
+
+    if ( ( ( iCpuInfo[2] & ( 1 << 27 ) ) == 0 ) || // OSXSAVE
+         ( ( iCpuInfo[2] & ( 1 << 28 ) ) == 0 ) || // AVX
+         ( ( _xgetbv ( 0 ) & 6 ) != 6 ) )
+    {
+        return false;
+    }
+
+    __cpuidex ( iCpuInfo, 7, 0 );
+    return ( iCpuInfo[1] & ( 1 << 5 ) ) != 0;
+# else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports ( "avx2" );
+# endif
+}
+#endif
+
+
+// CMixKernels -----------------------------------------------------------------
+template<class TKernels>
+void CMixKernels::InitFuncTable ( const EMixKernelType eNewType )
+{
+    pMixFunc[0][0][0]      = &TKernels::template Mix<int16_t, 1, 1, false>;
+    pMixFunc[0][0][1]      = &TKernels::template Mix<int16_t, 1, 1, true>;
+    pMixFunc[0][1][0]      = &TKernels::template Mix<int16_t, 1, 2, false>;
+    pMixFunc[0][1][1]      = &TKernels::template Mix<int16_t, 1, 2, true>;
+    pMixFunc[1][0][0]      = &TKernels::template Mix<int16_t, 2, 1, false>;
+    pMixFunc[1][0][1]      = &TKernels::template Mix<int16_t, 2, 1, true>;
+    pMixFunc[1][1][0]      = &TKernels::template Mix<int16_t, 2, 2, false>;
+    pMixFunc[1][1][1]      = &TKernels::template Mix<int16_t, 2, 2, true>;
+    pMixFloatFunc[0][0][0] = &TKernels::template Mix<float, 1, 1, false>;
+    pMixFloatFunc[0][0][1] = &TKernels::template Mix<float, 1, 1, true>;
+    pMixFloatFunc[0][1][0] = &TKernels::template Mix<float, 1, 2, false>;
+    pMixFloatFunc[0][1][1] = &TKernels::template Mix<float, 1, 2, true>;
+    pMixFloatFunc[1][0][0] = &TKernels::template Mix<float, 2, 1, false>;
+    pMixFloatFunc[1][0][1] = &TKernels::template Mix<float, 2, 1, true>;
+    pMixFloatFunc[1][1][0] = &TKernels::template Mix<float, 2, 2, false>;
+    pMixFloatFunc[1][1][1] = &TKernels::template Mix<float, 2, 2, true>;
+    pSaturateFunc          = &TKernels::Saturate;
+    pClipFunc              = &TKernels::Clip;
+    eType                  = eNewType;
+}
+
+CMixKernels::CMixKernels()
+{
+#ifdef USE_X86_MIX_KERNELS
+    if ( CpuSupportsAVX2() )
+    {
+        InitFuncTable<CMixKernelsAVX2> ( MK_AVX2 );
+        return;
+    }
+
+    if ( CpuSupportsSSE2() )
+    {
+        InitFuncTable<CMixKernelsSSE2> ( MK_SSE2 );
+        return;
+    }
+#endif
+
+    InitFuncTable<CMixKernelsGeneric> ( MK_GENERIC );
+}
@@ -0,0 +1,138 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2020
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include "global.h"
+
+// the SIMD kernels are only available on x86 CPUs, all other platforms use
+// the generic implementation
+#if defined ( __x86_64__ ) || defined ( __i386__ ) || defined ( _M_X64 ) || defined ( _M_IX86 )
+# define USE_X86_MIX_KERNELS
+#endif
+
+
+/* Definitions ****************************************************************/
+// type of the mixing kernel implementation
+enum EMixKernelType
+{
+    MK_GENERIC = 0, // portable C++ implementation
+    MK_SSE2    = 1, // x86 SSE2
+    MK_AVX2    = 2  // x86 AVX2
+};
+
+
+/* Classes ********************************************************************/
+// Mixing kernels for the server -----------------------------------------------
+// The audio data of the clients is accumulated in a float buffer (the gain is
+// applied during accumulation) and is converted to short with saturation (or
+// clipped in case of a float output) only once after all clients are mixed.
+// There is a separate kernel for each combination of input sample type,
+// number of input channels, number of output channels and unity/non-unity
+// gain (compile time specialization) and the best implementation for the
+// current CPU is selected at runtime.
+class CMixKernels
+{
+public:
+    // adds one client frame (iNumFrames samples per audio channel) to the
+    // accumulation buffer, for a mono output the left gain is used
+    typedef void ( *MixFunc ) ( float*         pfAccum,
+                                const int16_t* psIn,
+                                const int      iNumFrames,
+                                const float    fGainL,
+                                const float    fGainR );
+
+    typedef void ( *MixFloatFunc ) ( float*       pfAccum,
+                                     const float* pfIn,
+                                     const int    iNumFrames,
+                                     const float  fGainL,
+                                     const float  fGainR );
+
+    // converts the accumulation buffer to short with saturation
+    typedef void ( *SaturateFunc ) ( const float* pfAccum,
+                                     int16_t*     psOut,
+                                     const int    iNumSamples );
+
+    // clips the accumulation buffer to the float audio range [-1, 1]
+    typedef void ( *ClipFunc ) ( const float* pfAccum,
+                                 float*       pfOut,
+                                 const int    iNumSamples );
+
+    CMixKernels();
+
+    void Mix ( float*         pfAccum,
+               const int16_t* psIn,
+               const int      iNumInChan,
+               const int      iNumOutChan,
+               const int      iNumFrames,
+               const float    fGainL,
+               const float    fGainR ) const
+    {
+        pMixFunc[iNumInChan - 1][iNumOutChan - 1][IsUnityGain ( iNumOutChan, fGainL, fGainR )] (
+            pfAccum, psIn, iNumFrames, fGainL, fGainR );
+    }
+
+    void Mix ( float*       pfAccum,
+               const float* pfIn,
+               const int    iNumInChan,
+               const int    iNumOutChan,
+               const int    iNumFrames,
+               const float  fGainL,
+               const float  fGainR ) const
+    {
+        pMixFloatFunc[iNumInChan - 1][iNumOutChan - 1][IsUnityGain ( iNumOutChan, fGainL, fGainR )] (
+            pfAccum, pfIn, iNumFrames, fGainL, fGainR );
+    }
+
+    void Saturate ( const float* pfAccum,
+                    int16_t*     psOut,
+                    const int    iNumSamples ) const { pSaturateFunc ( pfAccum, psOut, iNumSamples ); }
+
+    // the input and output buffer may be the same
+    void Clip ( const float* pfAccum,
+                float*       pfOut,
+                const int    iNumSamples ) const { pClipFunc ( pfAccum, pfOut, iNumSamples ); }
+
+    EMixKernelType GetType() const { return eType; }
+
+protected:
+    static int IsUnityGain ( const int   iNumOutChan,
+                             const float fGainL,
+                             const float fGainR )
+    {
+        return ( ( fGainL == 1.0f ) && ( ( iNumOutChan == 1 ) || ( fGainR == 1.0f ) ) ) ? 1 : 0;
+    }
+
+    template<class TKernels>
+    void InitFuncTable ( const EMixKernelType eNewType );
+
+    // [number of input channels - 1][number of output channels - 1][unity gain]
+    MixFunc        pMixFunc[2][2][2];
+    MixFloatFunc   pMixFloatFunc[2][2][2];
+    SaturateFunc   pSaturateFunc;
+    ClipFunc       pClipFunc;
+    EMixKernelType eType;
+};
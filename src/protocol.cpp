@@ -137,9 +137,9 @@ MESSAGES (with connection)
         ... ------------------+-----------------------+ ...
         ...  4 bytes sam rate | 2 bytes audiocod type | ...
         ... ------------------+-----------------------+ ...
-        ... -----------------+----------------------+
-        ...  2 bytes version | 4 bytes audiocod arg | 
-        ... -----------------+----------------------+
+        ... ---------------+----------------------+
+        ...  2 bytes flags | 4 bytes audiocod arg |
+        ... ---------------+----------------------+
 
     - "base netw size":  length of the base network packet (frame) in bytes
     - "block size fact": block size factor
@@ -151,8 +151,31 @@ MESSAGES (with connection)
                           - 1: CELT
                           - 2: OPUS
                           - 3: OPUS64
-    - "version":         version of the audio coder, if not used this value
-                         shall be set to 0
+    - "flags":           network transport flags (this field was the unused
+                         "version" of the audio coder which was always 0):
+                          - bit 0: the sender supports audio packets with a
+                            sequence number trailer, see "AUDIO PACKETS"
+                            below
+                          - bit 1: the sender requests audio packets with a
+                            redundant copy of the previous packet, see
+                            "AUDIO PACKETS" below
+                          - bit 2: client: the sender accepts audio packets
+                            from the server with a reduced size, server: the
+                            "base netw size" is the size of the audio packets
+                            sent by the server (which may be smaller than the
+                            size requested by the client to reduce the bit
+                            rate), the server sends this message again if the
+                            size changes and uses the new size for its audio
+                            packets after the message was acknowledged (the
+                            client has to accept the previous size until the
+                            first audio packet with the new size is received)
+                          - bit 3: client: the sender supports more than 50
+                            channels, the server only sends the channels with
+                            an ID below 50 and their levels to a client
+                            without this flag, see
+                            PROTMESSID_CONN_CLIENTS_LIST and
+                            PROTMESSID_CLM_CHANNEL_LEVEL_LIST
+                         unknown flags shall be ignored
     - "audiocod arg":    argument for the audio coder, if not used this value
                          shall be set to 0
 
@@ -183,6 +206,24 @@ MESSAGES (with connection)
     +-------------------------+------------------+------------------------------+
 
 
+- PROTMESSID_DOWNSTREAM_STATISTIC: Statistic of the audio packets received by
+                                   the client
+
+    +------------------------------+--------------------------+
+    | 2 bytes num received packets | 2 bytes num lost packets |
+    +------------------------------+--------------------------+
+
+    - "num received packets": number of audio packets with a sequence number
+                               received since the last message
+    - "num lost packets":      number of audio packets which were lost on
+                               the network path since the last message
+                               (packets which arrived too late for the jitter
+                               buffer are not counted)
+
+    note: the client sends this message periodically to a server which adapts
+          the size of its audio packets, see PROTMESSID_NETW_TRANSPORT_PROPS
+
+
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
 - PROTMESSID_OPUS_SUPPORTED: Informs that OPUS codec is supported
 
@@ -305,6 +346,9 @@ CONNECTION LESS MESSAGES
     | PROTMESSID_CONN_CLIENTS_LIST | PROTMESSID_CONN_CLIENTS_LIST | ...
     +------------------------------+------------------------------+ ...
 
+    the list ends with the last client which fits in 20000 bytes (the receive
+    buffer of the older versions)
+
 
 - PROTMESSID_CLM_REQ_CONN_CLIENTS_LIST: Request the connected clients list
 
@@ -352,6 +396,41 @@ CONNECTION LESS MESSAGES
           (standard re-registration timeout).
 
 
+
+AUDIO PACKETS
+-------------
+
+- All packets which are not protocol messages are audio packets. An audio
+  packet contains the coded audio data only, its size is given by the
+  "base netw size" times the "block size fact" of the network transport
+  properties.
+
+- If the receiver has set the flag bit 0 in its network transport properties,
+  the sender may append a sequence number trailer to the audio data (the
+  packets with and without trailer are distinguished by their size):
+
+    +--------------------+-------------------------+------------------------+
+    | n bytes audio data | 2 bytes sequence number | 2 bytes timestamp      |
+    +--------------------+-------------------------+------------------------+
+
+    - "sequence number": incremented by one for each audio packet, wraps
+                         around at 65535
+    - "timestamp":       number of audio samples sent before this packet,
+                         wraps around at 65535
+
+- If the receiver has set the flag bits 0 and 1 in its network transport
+  properties, the sender may insert the audio data of the previous packet
+  in front of the trailer so that a single lost packet can be recovered:
+
+    +--------------------+-----------------------------+-----------------+
+    | n bytes audio data | n bytes previous audio data | 4 bytes trailer |
+    +--------------------+-----------------------------+-----------------+
+
+  A server which receives bit 1 from a client answers with its own network
+  transport properties with bit 1 set if it sends the redundant audio data,
+  the client then sends redundant audio data to the server, too.
+
+
  ******************************************************************************
  *
  * This program is free software; you can redistribute it and/or modify it under
@@ -500,6 +579,21 @@ void CProtocol::CreateAndImmSendAcknMess ( const int& iID,
     emit MessReadyForSending ( vecAcknMessage );
 }
 
+bool CProtocol::IsMessageQueued ( const int iID )
+{
+    QMutexLocker locker ( &Mutex );
+
+    for ( std::list<CSendMessage>::const_iterator it = SendMessQueue.begin(); it != SendMessQueue.end(); ++it )
+    {
+        if ( it->iID == iID )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void CProtocol::CreateAndImmSendConLessMessage ( const int               iID,
                                                  const CVector<uint8_t>& vecData,
                                                  const CHostAddress&     InetAddr )
@@ -523,6 +617,7 @@ bool CProtocol::ParseMessageBody ( const CVector<uint8_t>& vecbyMesBodyData,
 */
     bool bRet = false;
     bool bSendNextMess;
+    bool bMessAcknowledged;
 
 /*
 // TEST channel implementation: randomly delete protocol messages (50 % loss)
@@ -555,7 +650,8 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
             Mutex.lock();
             {
                 // check if this is the correct acknowledgment
-                bSendNextMess = false;
+                bSendNextMess     = false;
+                bMessAcknowledged = false;
                 if ( !SendMessQueue.empty() )
                 {
                     if ( ( SendMessQueue.front().iCnt == iRecCounter ) &&
@@ -564,6 +660,8 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
                         // message acknowledged, remove from queue
                         SendMessQueue.pop_front();
 
+                        bMessAcknowledged = true;
+
                         // send next message in queue
                         bSendNextMess = true;
                     }
@@ -575,6 +673,11 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
             {
                 SendMessage();
             }
+
+            if ( bMessAcknowledged )
+            {
+                emit MessageAcknowledged ( iData );
+            }
         }
         else
         {
@@ -640,6 +743,10 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
             case PROTMESSID_VERSION_AND_OS:
                 bRet = EvaluateVersionAndOSMes ( vecbyMesBodyData );
                 break;
+
+            case PROTMESSID_DOWNSTREAM_STATISTIC:
+                bRet = EvaluateDownstreamStatisticMes ( vecbyMesBodyData );
+                break;
             }
 
             // immediately send acknowledge message
@@ -1228,7 +1335,7 @@ void CProtocol::CreateNetwTranspPropsMes ( const CNetworkTransportProps& NetTrPr
         1 /* num chan */ +
         4 /* sam rate */ +
         2 /* audiocod type */ +
-        2 /* version */ +
+        2 /* flags */ +
         4 /* audiocod arg */;
 
     // build data vector
@@ -1254,9 +1361,9 @@ void CProtocol::CreateNetwTranspPropsMes ( const CNetworkTransportProps& NetTrPr
     PutValOnStream ( vecData, iPos,
         static_cast<uint32_t> ( NetTrProps.eAudioCodingType ), 2 );
 
-    // version (2 bytes)
+    // flags (2 bytes)
     PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iVersion ), 2 );
+        static_cast<uint32_t> ( NetTrProps.iFlags ), 2 );
 
     // argument for the audio coder (4 bytes)
     PutValOnStream ( vecData, iPos,
@@ -1277,7 +1384,7 @@ bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
         1 /* num chan */ +
         4 /* sam rate */ +
         2 /* audiocod type */ +
-        2 /* version */ +
+        2 /* flags */ +
         4 /* audiocod arg */;
 
     // check size
@@ -1339,8 +1446,8 @@ bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
     ReceivedNetwTranspProps.eAudioCodingType =
         static_cast<EAudComprType> ( iRecCodingType );
 
-    // version (2 bytes)
-    ReceivedNetwTranspProps.iVersion =
+    // flags (2 bytes)
+    ReceivedNetwTranspProps.iFlags =
         static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 2 ) );
 
     // argument for the audio coder (4 bytes)
@@ -1509,6 +1616,38 @@ bool CProtocol::EvaluateVersionAndOSMes ( const CVector<uint8_t>& vecData )
     return false; // no error
 }
 
+void CProtocol::CreateDownstreamStatisticMes ( const int iNumReceived,
+                                               const int iNumLost )
+{
+    CVector<uint8_t> vecData ( 4 ); // 4 bytes of data
+    int              iPos = 0;      // init position pointer
+
+    // build data vector (the numbers are limited to the range of the fields)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( std::min ( std::max ( iNumReceived, 0 ), 0xFFFF ) ), 2 );
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( std::min ( std::max ( iNumLost, 0 ), 0xFFFF ) ), 2 );
+
+    CreateAndSendMessage ( PROTMESSID_DOWNSTREAM_STATISTIC, vecData );
+}
+
+bool CProtocol::EvaluateDownstreamStatisticMes ( const CVector<uint8_t>& vecData )
+{
+    int iPos = 0; // init position pointer
+
+    // check size
+    if ( vecData.Size() != 4 )
+    {
+        return true; // return error code
+    }
+
+    const int iNumReceived = static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+    const int iNumLost     = static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+
+    // invoke message action
+    emit DownstreamStatisticReceived ( iNumReceived, iNumLost );
+
+    return false; // no error
+}
+
 
 // Connection less messages ----------------------------------------------------
 void CProtocol::CreateCLPingMes ( const CHostAddress& InetAddr, const int iMs )
@@ -2098,6 +2237,13 @@ void CProtocol::CreateCLConnClientsListMes ( const CHostAddress&          InetAd
             2 /* utf-8 str. size */ + strUTF8Name.size() +
             2 /* utf-8 str. size */ + strUTF8City.size();
 
+        // the requester may be an older version, the list is limited to the
+        // size of its receive buffer
+        if ( MESS_LEN_WITHOUT_DATA_BYTE + iPos + iCurListEntrLen > MAX_SIZE_BYTES_NETW_BUF_LEGACY )
+        {
+            break;
+        }
+
         // make space for new data
         vecData.Enlarge ( iCurListEntrLen );
 
@@ -2228,11 +2374,29 @@ bool CProtocol::EvaluateCLReqConnClientsListMes ( const CHostAddress& InetAddr )
 void CProtocol::CreateCLChannelLevelListMes  ( const CHostAddress&      InetAddr,
                                                const CVector<uint16_t>& vecLevelList,
                                                const int                iNumClients )
+{
+    CVector<uint8_t> vecNewMessage;
+    CVector<uint8_t> vecData;
+
+    GenCLChannelLevelListMes ( vecNewMessage,
+                               vecData,
+                               vecLevelList,
+                               iNumClients );
+
+    // immediately send message
+    emit CLMessReadyForSending ( InetAddr, vecNewMessage );
+}
+
+void CProtocol::GenCLChannelLevelListMes ( CVector<uint8_t>&        vecMessage,
+                                           CVector<uint8_t>&        vecData,
+                                           const CVector<uint16_t>& vecLevelList,
+                                           const int                iNumClients )
 {
     // This must be a multiple of bytes at four bits per client
-    const int        iNumBytes = ( iNumClients + 1 ) / 2;
-    CVector<uint8_t> vecData( iNumBytes );
-    int              iPos = 0; // init position pointer
+    const int iNumBytes = ( iNumClients + 1 ) / 2;
+    int       iPos      = 0; // init position pointer
+
+    vecData.Init ( iNumBytes );
 
     for ( int i = 0, j = 0; i < iNumClients; i += 2 /* pack two per byte */, j++ )
     {
@@ -2244,9 +2408,9 @@ void CProtocol::CreateCLChannelLevelListMes  ( const CHostAddress&      InetAddr
             static_cast<uint32_t> ( byte ), 1 );
     }
 
-    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_CHANNEL_LEVEL_LIST,
-                                     vecData,
-                                     InetAddr );
+    // build complete message (counter per definition=0 for connection less
+    // messages)
+    GenMessageFrame ( vecMessage, 0, PROTMESSID_CLM_CHANNEL_LEVEL_LIST, vecData );
 }
 
 bool CProtocol::EvaluateCLChannelLevelListMes  ( const CHostAddress&     InetAddr,
@@ -2332,21 +2496,20 @@ bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
                                     int&                    iCnt,
                                     int&                    iID )
 {
-    int i;
-    int iCurPos;
-
     // vector must be at least "MESS_LEN_WITHOUT_DATA_BYTE" bytes long
     if ( iNumBytesIn < MESS_LEN_WITHOUT_DATA_BYTE )
     {
         return true; // return error code
     }
 
+    // this function is called for each received packet, therefore the
+    // header is read directly from the buffer (all values are little endian)
+    const uint8_t* pbyData = vecbyData.data();
 
-    // Decode header -----------------------------------------------------------
-    iCurPos = 0; // start from beginning
 
+    // Decode header -----------------------------------------------------------
     // 2 bytes TAG
-    const int iTag = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 2 ) );
+    const int iTag = pbyData[0] | ( pbyData[1] << 8 );
 
     // check if tag is correct
     if ( iTag != 0 )
@@ -2355,13 +2518,13 @@ bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
     }
 
     // 2 bytes ID
-    iID = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 2 ) );
+    iID = pbyData[2] | ( pbyData[3] << 8 );
 
     // 1 byte cnt
-    iCnt = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 1 ) );
+    iCnt = pbyData[4];
 
     // 2 bytes length
-    const int iLenBy = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 2 ) );
+    const int iLenBy = pbyData[5] | ( pbyData[6] << 8 );
 
     // make sure the length is correct
     if ( iLenBy != iNumBytesIn - MESS_LEN_WITHOUT_DATA_BYTE )
@@ -2375,34 +2538,25 @@ bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
 
     const int iLenCRCCalc = MESS_HEADER_LENGTH_BYTE + iLenBy;
 
-    iCurPos = 0; // start from the beginning
+    CRCObj.AddBytes ( pbyData, iLenCRCCalc );
 
-    for ( i = 0; i < iLenCRCCalc; i++ )
-    {
-        CRCObj.AddByte ( static_cast<uint8_t> ( 
-            GetValFromStream ( vecbyData, iCurPos, 1 ) ) );
-    }
+    const uint32_t iRecCRC = static_cast<uint32_t> ( pbyData[iLenCRCCalc] |
+                                                     ( pbyData[iLenCRCCalc + 1] << 8 ) );
 
-    if ( CRCObj.GetCRC () != GetValFromStream ( vecbyData, iCurPos, 2 ) )
+    if ( CRCObj.GetCRC() != iRecCRC )
     {
         return true; // return error code
     }
 
 
     // Extract actual data -----------------------------------------------------
-
-// TODO this memory allocation is done in the real time thread but should be
-//      done in the low priority protocol management thread
-
+    // this function is called by the real-time socket thread, no memory is
+    // allocated here if the capacity of the body vector is large enough
     vecbyMesBodyData.Init ( iLenBy );
 
-    iCurPos = MESS_HEADER_LENGTH_BYTE; // start from beginning of data
-
-    for ( i = 0; i < iLenBy; i++ )
-    {
-        vecbyMesBodyData[i] = static_cast<uint8_t> (
-            GetValFromStream ( vecbyData, iCurPos, 1 ) );
-    }
+    std::copy ( pbyData + MESS_HEADER_LENGTH_BYTE,
+                pbyData + MESS_HEADER_LENGTH_BYTE + iLenBy,
+                vecbyMesBodyData.begin() );
 
     return false; // no error
 }
@@ -2481,8 +2635,6 @@ void CProtocol::GenMessageFrame ( CVector<uint8_t>&       vecOut,
                                   const int               iID,
                                   const CVector<uint8_t>& vecData )
 {
-    int i;
-
     // query length of data vector
     const int iDataLenByte = vecData.Size();
 
@@ -2513,25 +2665,15 @@ void CProtocol::GenMessageFrame ( CVector<uint8_t>&       vecOut,
         static_cast<uint32_t> ( iDataLenByte ), 2 );
 
     // encode data -----
-    for ( i = 0; i < iDataLenByte; i++ )
-    {
-        PutValOnStream ( vecOut, iCurPos,
-            static_cast<uint32_t> ( vecData[i] ), 1 );
-    }
+    std::copy ( vecData.begin(), vecData.end(), vecOut.begin() + iCurPos );
+
+    iCurPos += iDataLenByte;
 
 
     // Encode CRC --------------------------------------------------------------
     CCRC CRCObj;
 
-    iCurPos = 0; // start from beginning
-
-    const int iLenCRCCalc = MESS_HEADER_LENGTH_BYTE + iDataLenByte;
-
-    for ( i = 0; i < iLenCRCCalc; i++ )
-    {
-        CRCObj.AddByte ( static_cast<uint8_t> ( 
-            GetValFromStream ( vecOut, iCurPos, 1 ) ) );
-    }
+    CRCObj.AddBytes ( vecOut.data(), MESS_HEADER_LENGTH_BYTE + iDataLenByte );
 
     PutValOnStream ( vecOut, iCurPos,
         static_cast<uint32_t> ( CRCObj.GetCRC() ), 2 );
@@ -58,6 +58,7 @@
 #define PROTMESSID_VERSION_AND_OS             29 // version number and operating system
 #define PROTMESSID_CHANNEL_PAN                30 // set channel pan for mix
 #define PROTMESSID_MUTE_STATE_CHANGED         31 // mute state of your signal at another client has changed
+#define PROTMESSID_DOWNSTREAM_STATISTIC       32 // statistic of the audio packets received by the client
 
 // message IDs of connection less messages (CLM)
 // DEFINITION -> start at 1000, end at 1999, see IsConnectionLessMessageID
@@ -112,6 +113,7 @@ public:
     void CreateOpusSupportedMes();
     void CreateReqChannelLevelListMes ( const bool bRCL );
     void CreateVersionAndOSMes();
+    void CreateDownstreamStatisticMes ( const int iNumReceived, const int iNumLost );
 
     void CreateCLPingMes               ( const CHostAddress& InetAddr, const int iMs );
     void CreateCLPingWithNumClientsMes ( const CHostAddress& InetAddr,
@@ -140,6 +142,15 @@ public:
     void CreateCLRegisterServerResp    ( const CHostAddress& InetAddr,
                                          const ESvrRegResult eResult );
 
+    // generates the channel level list message without sending it, no memory
+    // is allocated if the capacity of the given vectors is large enough (this
+    // function does not access the protocol state and can be called by the
+    // server timer thread)
+    void GenCLChannelLevelListMes ( CVector<uint8_t>&        vecMessage,
+                                    CVector<uint8_t>&        vecData,
+                                    const CVector<uint16_t>& vecLevelList,
+                                    const int                iNumClients );
+
     static bool ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
                                     const int               iNumBytesIn,
                                     CVector<uint8_t>&       vecbyMesBodyData,
@@ -161,6 +172,9 @@ public:
     void CreateAndImmSendAcknMess ( const int& iID,
                                     const int& iCnt );
 
+    // checks if a message with the given ID waits for its acknowledgement
+    bool IsMessageQueued ( const int iID );
+
 protected:
     class CSendMessage
     {
@@ -236,6 +250,7 @@ protected:
     bool EvaluateLicenceRequiredMes     ( const CVector<uint8_t>& vecData );
     bool EvaluateReqChannelLevelListMes ( const CVector<uint8_t>& vecData );
     bool EvaluateVersionAndOSMes        ( const CVector<uint8_t>& vecData );
+    bool EvaluateDownstreamStatisticMes ( const CVector<uint8_t>& vecData );
 
     bool EvaluateCLPingMes               ( const CHostAddress&     InetAddr,
                                            const CVector<uint8_t>& vecData );
@@ -298,6 +313,8 @@ signals:
     void LicenceRequired ( ELicenceType eLicenceType );
     void ReqChannelLevelList ( bool bOptIn );
     void VersionAndOSReceived ( COSUtil::EOpSystemType eOSType, QString strVersion );
+    void DownstreamStatisticReceived ( int iNumReceived, int iNumLost );
+    void MessageAcknowledged ( int iID );
 
     void CLPingReceived               ( CHostAddress           InetAddr,
                                         int                    iMs );
@@ -0,0 +1,201 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2020
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "rtallocguard.h"
+
+#ifdef RT_ALLOC_GUARD
+#include <cstdlib>
+#include <new>
+#include <QDebug>
+
+
+/* Implementation *************************************************************/
+// state of the current thread (the thread is not supervised if no scope is
+// active, i.e. the thread ID is negative)
+static thread_local int iCurGuardThread    = -1;
+static thread_local int iGuardPauseDepth   = 0;
+static thread_local int iNumGuardedAllocs  = 0;
+static thread_local int iNumGuardedFrees   = 0;
+
+QAtomicInt CRtAllocGuard::vecNumAllocs[RG_NUM_THREADS];
+QAtomicInt CRtAllocGuard::vecNumFrees[RG_NUM_THREADS];
+
+void CRtAllocGuard::CountAlloc()
+{
+    // note that this function is called inside the allocation functions and
+    // therefore must not allocate memory itself
+    if ( ( iCurGuardThread >= 0 ) && ( iGuardPauseDepth == 0 ) )
+    {
+        iNumGuardedAllocs++;
+    }
+}
+
+void CRtAllocGuard::CountFree()
+{
+    if ( ( iCurGuardThread >= 0 ) && ( iGuardPauseDepth == 0 ) )
+    {
+        iNumGuardedFrees++;
+    }
+}
+
+void CRtAllocGuard::Report ( const ERtAllocGuardThread eThread,
+                             const int                 iNewAllocs,
+                             const int                 iNewFrees )
+{
+    const int iPrevTotal = vecNumAllocs[eThread].fetchAndAddOrdered ( iNewAllocs ) +
+                           vecNumFrees[eThread].fetchAndAddOrdered ( iNewFrees );
+
+    const int iNewTotal = iPrevTotal + iNewAllocs + iNewFrees;
+
+    // only report if the total count has reached the next power of two so that
+    // an allocation in every frame does not flood the console
+    int iNextReport = 1;
+
+    while ( ( iNextReport <= iPrevTotal ) && ( iNextReport > 0 ) )
+    {
+        iNextReport <<= 1;
+    }
+
+    if ( iNewTotal >= iNextReport )
+    {
+        qWarning() << "real-time allocation guard:" << GetNumAllocs ( eThread ) <<
+            "allocations and" << GetNumFrees ( eThread ) << "deallocations in the" <<
+            ( eThread == RG_SOCKET_THREAD ? "socket" : "timer" ) << "thread";
+    }
+}
+
+CRtAllocGuardScope::CRtAllocGuardScope ( const ERtAllocGuardThread eNThread ) :
+    eThread     ( eNThread ),
+    iPrevThread ( iCurGuardThread )
+{
+    iCurGuardThread = eThread;
+}
+
+CRtAllocGuardScope::~CRtAllocGuardScope()
+{
+    iCurGuardThread = iPrevThread;
+
+    // the counts are reported when the outermost scope is left (the report
+    // itself allocates memory and therefore is done in a pause)
+    if ( ( iPrevThread < 0 ) && ( ( iNumGuardedAllocs > 0 ) || ( iNumGuardedFrees > 0 ) ) )
+    {
+        const int iNewAllocs = iNumGuardedAllocs;
+        const int iNewFrees  = iNumGuardedFrees;
+
+        iNumGuardedAllocs = 0;
+        iNumGuardedFrees  = 0;
+
+        CRtAllocGuardPause RtAllocGuardPause;
+        CRtAllocGuard::Report ( eThread, iNewAllocs, iNewFrees );
+    }
+}
+
+CRtAllocGuardPause::CRtAllocGuardPause()
+{
+    iGuardPauseDepth++;
+}
+
+CRtAllocGuardPause::~CRtAllocGuardPause()
+{
+    iGuardPauseDepth--;
+}
+
+
+// Allocation hooks ------------------------------------------------------------
+#if defined ( __linux__ ) && defined ( __GLIBC__ )
+// With glibc, the C allocation functions are replaced so that the allocations
+// of the Qt and the C libraries are counted, too (the C++ operators new and
+// delete use these functions).
+extern "C"
+{
+void* __libc_malloc  ( size_t iSize );
+void* __libc_calloc  ( size_t iNum, size_t iSize );
+void* __libc_realloc ( void* pMem, size_t iSize );
+void  __libc_free    ( void* pMem );
+
+void* malloc ( size_t iSize ) noexcept
+{
+    CRtAllocGuard::CountAlloc();
+    return __libc_malloc ( iSize );
+}
+
+void* calloc ( size_t iNum, size_t iSize ) noexcept
+{
+    CRtAllocGuard::CountAlloc();
+    return __libc_calloc ( iNum, iSize );
+}
+
+void* realloc ( void* pMem, size_t iSize ) noexcept
+{
+    CRtAllocGuard::CountAlloc();
+    return __libc_realloc ( pMem, iSize );
+}
+
+void free ( void* pMem ) noexcept
+{
+    if ( pMem != nullptr )
+    {
+        CRtAllocGuard::CountFree();
+    }
+
+    __libc_free ( pMem );
+}
+}
+#else
+// on all other platforms only the C++ allocations are counted
+void* operator new ( std::size_t iSize )
+{
+    CRtAllocGuard::CountAlloc();
+
+    void* pMem = std::malloc ( iSize > 0 ? iSize : 1 );
+
+    if ( pMem == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+
+    return pMem;
+}
+
+void* operator new[] ( std::size_t iSize )
+{
+    return operator new ( iSize );
+}
+
+void operator delete ( void* pMem ) noexcept
+{
+    if ( pMem != nullptr )
+    {
+        CRtAllocGuard::CountFree();
+    }
+
+    std::free ( pMem );
+}
+
+void operator delete[] ( void* pMem ) noexcept
+{
+    operator delete ( pMem );
+}
+#endif
+#endif
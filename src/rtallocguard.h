@@ -0,0 +1,106 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2020
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#ifdef RT_ALLOC_GUARD
+# include <QAtomicInt>
+#endif
+
+
+/* Definitions ****************************************************************/
+// real-time threads which are supervised by the allocation guard
+enum ERtAllocGuardThread
+{
+    RG_SOCKET_THREAD = 0, // network receive thread(s)
+    RG_TIMER_THREAD  = 1, // server timer thread
+    RG_NUM_THREADS   = 2
+};
+
+
+/* Classes ********************************************************************/
+// Real-time allocation guard --------------------------------------------------
+// If the application is built with "CONFIG+=rtallocguard", the memory
+// allocation functions are hooked and every allocation and deallocation which
+// is done by a real-time thread in its steady state is counted and reported on
+// the console. A thread is in the steady state while a CRtAllocGuardScope
+// object exists in it which is not paused by a CRtAllocGuardPause object
+// (pauses are used for state changes like a new connection or for writing the
+// log file). Without the build option, the classes are empty.
+#ifdef RT_ALLOC_GUARD
+class CRtAllocGuard
+{
+public:
+    // called by the hooked allocation functions
+    static void CountAlloc();
+    static void CountFree();
+
+    static int GetNumAllocs ( const ERtAllocGuardThread eThread )
+        { return vecNumAllocs[eThread].loadAcquire(); }
+
+    static int GetNumFrees ( const ERtAllocGuardThread eThread )
+        { return vecNumFrees[eThread].loadAcquire(); }
+
+protected:
+    friend class CRtAllocGuardScope;
+    friend class CRtAllocGuardPause;
+
+    static void Report ( const ERtAllocGuardThread eThread,
+                         const int                 iNewAllocs,
+                         const int                 iNewFrees );
+
+    static QAtomicInt vecNumAllocs[RG_NUM_THREADS];
+    static QAtomicInt vecNumFrees[RG_NUM_THREADS];
+};
+
+class CRtAllocGuardScope
+{
+public:
+    CRtAllocGuardScope ( const ERtAllocGuardThread eThread );
+    ~CRtAllocGuardScope();
+
+protected:
+    ERtAllocGuardThread eThread;
+    int                 iPrevThread;
+};
+
+class CRtAllocGuardPause
+{
+public:
+    CRtAllocGuardPause();
+    ~CRtAllocGuardPause();
+};
+#else
+class CRtAllocGuardScope
+{
+public:
+    CRtAllocGuardScope ( const ERtAllocGuardThread ) {}
+};
+
+class CRtAllocGuardPause
+{
+public:
+    CRtAllocGuardPause() {}
+};
+#endif
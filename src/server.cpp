@@ -23,6 +23,11 @@
 \******************************************************************************/
 
 #include "server.h"
+#if defined ( __linux__ ) && !defined ( ANDROID )
+# include <pthread.h>
+# include <sched.h>
+# include <sys/mman.h>
+#endif
 
 
 // CHighPrecisionTimer implementation ******************************************
@@ -115,7 +120,10 @@ void CHighPrecisionTimer::OnTimer()
 }
 #else // Mac and Linux
 CHighPrecisionTimer::CHighPrecisionTimer ( const bool bUseDoubleSystemFrameSize ) :
-    bRun ( false )
+    bRun           ( false ),
+    iRtPriority    ( 0 ),
+    iCpuID         ( -1 ),
+    eCatchUpPolicy ( TC_BURST )
 {
     // calculate delay in ns
     uint64_t iNsDelay;
@@ -138,6 +146,9 @@ CHighPrecisionTimer::CHighPrecisionTimer ( const bool bUseDoubleSystemFrameSize
 
     Delay = ( iNsDelay * (uint64_t) timeBaseInfo.denom ) /
         (uint64_t) timeBaseInfo.numer;
+
+    LateWakeupThreshold = ( (uint64_t) TIMER_LATE_WAKEUP_THRESHOLD_NS * (uint64_t) timeBaseInfo.denom ) /
+        (uint64_t) timeBaseInfo.numer;
 #else
     // set delay
     Delay = iNsDelay;
@@ -180,18 +191,75 @@ void CHighPrecisionTimer::Stop()
     wait ( 5000 );
 }
 
+void CHighPrecisionTimer::SetRealTimeProperties ( const int                 iNewRtPriority,
+                                                 const int                 iNewCpuID,
+                                                 const ETimerCatchUpPolicy eNewCatchUpPolicy )
+{
+    iRtPriority    = iNewRtPriority;
+    iCpuID         = iNewCpuID;
+    eCatchUpPolicy = eNewCatchUpPolicy;
+}
+
 void CHighPrecisionTimer::run()
 {
+    // apply the real-time properties of the timer thread
+    CServerWorkerPool::SetCurrentThreadRealTimePriority ( iRtPriority );
+    CServerWorkerPool::SetCurrentThreadAffinity ( iCpuID );
+
     // loop until the thread shall be terminated
     while ( bRun )
     {
-        // call processing routine by fireing signal
+        // call processing routine by fireing signal (the server uses a direct
+        // connection so that the processing is done in this thread)
+        emit timeout();
 
-// TODO by emit a signal we leave the high priority thread -> maybe use some
-//      other connection type to have something like a true callback, e.g.
-//      "Qt::DirectConnection" -> Can this work?
+        // check if the processing has overrun the deadline of the next frame,
+        // if so, either process the missed frames back to back or drop them
+        // and continue with the next deadline in the future
+        bool bIsOverrun = false;
 
-        emit timeout();
+#if defined ( __APPLE__ ) || defined ( __MACOSX )
+        const uint64_t CurTime = mach_absolute_time();
+
+        if ( CurTime > NextEnd )
+        {
+            bIsOverrun = true;
+
+            if ( eCatchUpPolicy == TC_SKIP )
+            {
+                const uint64_t iNumMissed = ( CurTime - NextEnd ) / Delay + 1;
+
+                NextEnd += iNumMissed * Delay;
+                iNumSkippedFrames.fetchAndAddRelaxed ( static_cast<int> ( iNumMissed ) );
+            }
+        }
+#else
+        timespec CurTime;
+        clock_gettime ( CLOCK_MONOTONIC, &CurTime );
+
+        const long long iOverrunNs = ( static_cast<long long> ( CurTime.tv_sec ) - NextEnd.tv_sec ) * 1000000000LL +
+                                     ( CurTime.tv_nsec - NextEnd.tv_nsec );
+
+        if ( iOverrunNs > 0 )
+        {
+            bIsOverrun = true;
+
+            if ( eCatchUpPolicy == TC_SKIP )
+            {
+                const long long iNumMissed = iOverrunNs / Delay + 1;
+                const long long iSkipNs    = NextEnd.tv_nsec + iNumMissed * Delay;
+
+                NextEnd.tv_sec  += static_cast<time_t> ( iSkipNs / 1000000000LL );
+                NextEnd.tv_nsec  = static_cast<long> ( iSkipNs % 1000000000LL );
+                iNumSkippedFrames.fetchAndAddRelaxed ( static_cast<int> ( iNumMissed ) );
+            }
+        }
+#endif
+
+        if ( bIsOverrun )
+        {
+            iNumOverruns.fetchAndAddRelaxed ( 1 );
+        }
 
         // now wait until the next buffer shall be processed (we
         // use the "increment method" to make sure we do not introduce
@@ -199,6 +267,13 @@ void CHighPrecisionTimer::run()
 #if defined ( __APPLE__ ) || defined ( __MACOSX )
         mach_wait_until ( NextEnd );
 
+        // check the wake-up latency (for an overrun we do not sleep at all)
+        if ( ( ( eCatchUpPolicy == TC_SKIP ) || !bIsOverrun ) &&
+             ( mach_absolute_time() > NextEnd + LateWakeupThreshold ) )
+        {
+            iNumLateWakeups.fetchAndAddRelaxed ( 1 );
+        }
+
         NextEnd += Delay;
 #else
         clock_nanosleep ( CLOCK_MONOTONIC,
@@ -206,6 +281,21 @@ void CHighPrecisionTimer::run()
                           &NextEnd,
                           NULL );
 
+        // check the wake-up latency (for an overrun we do not sleep at all)
+        if ( ( eCatchUpPolicy == TC_SKIP ) || !bIsOverrun )
+        {
+            timespec WakeUpTime;
+            clock_gettime ( CLOCK_MONOTONIC, &WakeUpTime );
+
+            const long long iLatencyNs = ( static_cast<long long> ( WakeUpTime.tv_sec ) - NextEnd.tv_sec ) * 1000000000LL +
+                                         ( WakeUpTime.tv_nsec - NextEnd.tv_nsec );
+
+            if ( iLatencyNs > TIMER_LATE_WAKEUP_THRESHOLD_NS )
+            {
+                iNumLateWakeups.fetchAndAddRelaxed ( 1 );
+            }
+        }
+
         NextEnd.tv_nsec += Delay;
         if ( NextEnd.tv_nsec >= 1000000000L )
         {
@@ -218,1025 +308,3108 @@ void CHighPrecisionTimer::run()
 #endif
 
 
-// CServer implementation ******************************************************
-CServer::CServer ( const int          iNewMaxNumChan,
-                   const int          iMaxDaysHistory,
-                   const QString&     strLoggingFileName,
-                   const quint16      iPortNumber,
-                   const QString&     strHTMLStatusFileName,
-                   const QString&     strHistoryFileName,
-                   const QString&     strServerNameForHTMLStatusFile,
-                   const QString&     strCentralServer,
-                   const QString&     strServerInfo,
-                   const QString&     strNewWelcomeMessage,
-                   const QString&     strRecordingDirName,
-                   const bool         bNCentServPingServerInList,
-                   const bool         bNDisconnectAllClientsOnQuit,
-                   const bool         bNUseDoubleSystemFrameSize,
-                   const ELicenceType eNLicenceType ) :
-    bUseDoubleSystemFrameSize   ( bNUseDoubleSystemFrameSize ),
-    iMaxNumChannels             ( iNewMaxNumChan ),
-    Socket                      ( this, iPortNumber ),
-    Logging                     ( iMaxDaysHistory ),
-    JamRecorder                 ( strRecordingDirName ),
-    bEnableRecording            ( !strRecordingDirName.isEmpty() ),
-    bWriteStatusHTMLFile        ( false ),
-    HighPrecisionTimer          ( bNUseDoubleSystemFrameSize ),
-    ServerListManager           ( iPortNumber,
-                                  strCentralServer,
-                                  strServerInfo,
-                                  iNewMaxNumChan,
-                                  bNCentServPingServerInList,
-                                  &ConnLessProtocol ),
-    bAutoRunMinimized           ( false ),
-    strWelcomeMessage           ( strNewWelcomeMessage ),
-    eLicenceType                ( eNLicenceType ),
-    bDisconnectAllClientsOnQuit ( bNDisconnectAllClientsOnQuit ),
-    pSignalHandler              ( CSignalHandler::getSingletonP() )
+// CServerWorkerPool implementation ********************************************
+CServerWorkerPool::~CServerWorkerPool()
 {
-    int iOpusError;
-    int i;
+    // stop and delete all worker threads
+    for ( int i = 0; i < vecpWorkerThreads.Size(); i++ )
+    {
+        vecpWorkerThreads[i]->Stop();
+        delete vecpWorkerThreads[i];
+    }
+}
 
-    // create OPUS encoder/decoder for each channel (must be done before
-    // enabling the channels), create a mono and stereo encoder/decoder
-    // for each channel
-    for ( i = 0; i < iMaxNumChannels; i++ )
+void CServerWorkerPool::Init ( const int      iNewNumThreads,
+                               const QString& strCpuAffinity,
+                               const int      iNewRtPriority )
+{
+    // parse the comma separated list of CPU IDs for the worker threads (an
+    // empty list means that no CPU affinity is set)
+    CVector<int>      veciCpuIDs ( 0 );
+    const QStringList slCpuIDs = strCpuAffinity.split ( ",", QString::SkipEmptyParts );
+
+    for ( int i = 0; i < slCpuIDs.size(); i++ )
     {
-        // init OPUS -----------------------------------------------------------
-        OpusMode[i] = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
-                                                DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES,
-                                                &iOpusError );
-
-        Opus64Mode[i] = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
-                                                  SYSTEM_FRAME_SIZE_SAMPLES,
-                                                  &iOpusError );
-
-        // init audio encoders and decoders
-        OpusEncoderMono[i]     = opus_custom_encoder_create ( OpusMode[i],   1, &iOpusError ); // mono encoder legacy
-        OpusDecoderMono[i]     = opus_custom_decoder_create ( OpusMode[i],   1, &iOpusError ); // mono decoder legacy
-        OpusEncoderStereo[i]   = opus_custom_encoder_create ( OpusMode[i],   2, &iOpusError ); // stereo encoder legacy
-        OpusDecoderStereo[i]   = opus_custom_decoder_create ( OpusMode[i],   2, &iOpusError ); // stereo decoder legacy
-        Opus64EncoderMono[i]   = opus_custom_encoder_create ( Opus64Mode[i], 1, &iOpusError ); // mono encoder OPUS64
-        Opus64DecoderMono[i]   = opus_custom_decoder_create ( Opus64Mode[i], 1, &iOpusError ); // mono decoder OPUS64
-        Opus64EncoderStereo[i] = opus_custom_encoder_create ( Opus64Mode[i], 2, &iOpusError ); // stereo encoder OPUS64
-        Opus64DecoderStereo[i] = opus_custom_decoder_create ( Opus64Mode[i], 2, &iOpusError ); // stereo decoder OPUS64
-
-        // we require a constant bit rate
-        opus_custom_encoder_ctl ( OpusEncoderMono[i],     OPUS_SET_VBR ( 0 ) );
-        opus_custom_encoder_ctl ( OpusEncoderStereo[i],   OPUS_SET_VBR ( 0 ) );
-        opus_custom_encoder_ctl ( Opus64EncoderMono[i],   OPUS_SET_VBR ( 0 ) );
-        opus_custom_encoder_ctl ( Opus64EncoderStereo[i], OPUS_SET_VBR ( 0 ) );
+        bool      bOK;
+        const int iCpuID = slCpuIDs.at ( i ).trimmed().toInt ( &bOK );
 
-        // for 64 samples frame size we have to adjust the PLC behavior to avoid loud artifacts
-        opus_custom_encoder_ctl ( Opus64EncoderMono[i],   OPUS_SET_PACKET_LOSS_PERC ( 35 ) );
-        opus_custom_encoder_ctl ( Opus64EncoderStereo[i], OPUS_SET_PACKET_LOSS_PERC ( 35 ) );
+        if ( bOK && ( iCpuID >= 0 ) )
+        {
+            veciCpuIDs.Add ( iCpuID );
+        }
+    }
 
-        // we want as low delay as possible
-        opus_custom_encoder_ctl ( OpusEncoderMono[i],     OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
-        opus_custom_encoder_ctl ( OpusEncoderStereo[i],   OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
-        opus_custom_encoder_ctl ( Opus64EncoderMono[i],   OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
-        opus_custom_encoder_ctl ( Opus64EncoderStereo[i], OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+    iNumThreads = std::max ( 1, std::min ( iNewNumThreads, MAX_NUM_SERVER_WORKER_THREADS ) );
 
-        // set encoder low complexity for legacy 128 samples frame size
-        opus_custom_encoder_ctl ( OpusEncoderMono[i],   OPUS_SET_COMPLEXITY ( 1 ) );
-        opus_custom_encoder_ctl ( OpusEncoderStereo[i], OPUS_SET_COMPLEXITY ( 1 ) );
+    // the calling thread is the thread with ID 0, we only have to create the
+    // additional worker threads
+    for ( int i = 1; i < iNumThreads; i++ )
+    {
+        int iCpuID = -1; // no affinity
 
+        if ( veciCpuIDs.Size() > 0 )
+        {
+            iCpuID = veciCpuIDs[( i - 1 ) % veciCpuIDs.Size()];
+        }
 
-        // init double-to-normal frame size conversion buffers -----------------
-        // use worst case memory initialization to avoid allocating memory in
-        // the time-critical thread
-        DoubleFrameSizeConvBufIn[i].Init  ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
-        DoubleFrameSizeConvBufOut[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        vecpWorkerThreads.Add ( new CWorkerThread ( this, i, iCpuID, iNewRtPriority ) );
+        vecpWorkerThreads[i - 1]->start ( QThread::TimeCriticalPriority );
     }
+}
 
-    // define colors for chat window identifiers
-    vstrChatColors.Init ( 6 );
-    vstrChatColors[0] = "mediumblue";
-    vstrChatColors[1] = "red";
-    vstrChatColors[2] = "darkorchid";
-    vstrChatColors[3] = "green";
-    vstrChatColors[4] = "maroon";
-    vstrChatColors[5] = "coral";
+void CServerWorkerPool::Run ( CJob*     pJob,
+                              const int iNumItems )
+{
+    // store the job properties so that the worker threads can access it
+    pCurJob      = pJob;
+    iCurNumItems = iNumItems;
+    iNextItem.storeRelease ( 0 );
 
-    // set the server frame size
-    if ( bUseDoubleSystemFrameSize )
+    // we only wake up as many worker threads as we have work items
+    const int iNumActWorkers = std::min ( iNumThreads, iNumItems ) - 1;
+
+    for ( int i = 0; i < iNumActWorkers; i++ )
     {
-        iServerFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+        vecpWorkerThreads[i]->StartSemaphore.release();
     }
-    else
+
+    // the calling thread is a worker, too
+    ProcessItems ( 0 );
+
+    // wait until all worker threads are done (barrier)
+    if ( iNumActWorkers > 0 )
     {
-        iServerFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+        DoneSemaphore.acquire ( iNumActWorkers );
     }
 
+    pCurJob = nullptr;
+}
 
-    // To avoid audio clitches, in the entire realtime timer audio processing
-    // routine including the ProcessData no memory must be allocated. Since we
-    // do not know the required sizes for the vectors, we allocate memory for
-    // the worst case here:
+void CServerWorkerPool::ProcessItems ( const int iThreadID )
+{
+    // the work items are dynamically assigned to the threads so that a thread
+    // which has finished its item early immediately picks up the next one
+    int iCurItem = iNextItem.fetchAndAddOrdered ( 1 );
 
-    // we always use stereo audio buffers (which is the worst case)
-    vecsSendData.Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+    while ( iCurItem < iCurNumItems )
+    {
+        pCurJob->ProcessItem ( iCurItem, iThreadID );
 
-    // allocate worst case memory for the temporary vectors
-    vecChanIDsCurConChan.Init          ( iMaxNumChannels );
-    vecvecdGains.Init                  ( iMaxNumChannels );
-    vecvecdPannings.Init               ( iMaxNumChannels );
-    vecvecsData.Init                   ( iMaxNumChannels );
-    vecNumAudioChannels.Init           ( iMaxNumChannels );
-    vecNumFrameSizeConvBlocks.Init     ( iMaxNumChannels );
-    vecUseDoubleSysFraSizeConvBuf.Init ( iMaxNumChannels );
-    vecAudioComprType.Init             ( iMaxNumChannels );
+        iCurItem = iNextItem.fetchAndAddOrdered ( 1 );
+    }
+}
 
-    for ( i = 0; i < iMaxNumChannels; i++ )
+void CServerWorkerPool::SetCurrentThreadAffinity ( const int iCpuID )
+{
+    if ( iCpuID < 0 )
     {
-        // init vectors storing information of all channels
-        vecvecdGains[i].Init ( iMaxNumChannels );
-        vecvecdPannings[i].Init ( iMaxNumChannels );
-
-        // we always use stereo audio buffers (see "vecsSendData")
-        vecvecsData[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        return;
     }
 
-    // allocate worst case memory for the coded data
-    vecbyCodedData.Init ( MAX_SIZE_BYTES_NETW_BUF );
+#ifdef _WIN32
+    SetThreadAffinityMask ( GetCurrentThread(), static_cast<DWORD_PTR> ( 1 ) << iCpuID );
+#elif defined ( __linux__ ) && !defined ( ANDROID )
+    cpu_set_t CpuSet;
+    CPU_ZERO ( &CpuSet );
+    CPU_SET ( iCpuID, &CpuSet );
+    pthread_setaffinity_np ( pthread_self(), sizeof ( cpu_set_t ), &CpuSet );
+#else
+    // setting the CPU affinity is not supported on this platform
+#endif
+}
 
-    // allocate worst case memory for the channel levels
-    vecChannelLevels.Init     ( iMaxNumChannels );
+void CServerWorkerPool::SetCurrentThreadRealTimePriority ( const int iRtPriority )
+{
+    if ( iRtPriority <= 0 )
+    {
+        return;
+    }
 
-    // enable history graph (if requested)
-    if ( !strHistoryFileName.isEmpty() )
+#if defined ( __linux__ ) && !defined ( ANDROID )
+    sched_param Param;
+    Param.sched_priority = iRtPriority;
+
+    if ( pthread_setschedparam ( pthread_self(), SCHED_FIFO, &Param ) != 0 )
     {
-        Logging.EnableHistory ( strHistoryFileName );
+        qWarning() << "could not set the SCHED_FIFO priority" << iRtPriority <<
+            "(missing CAP_SYS_NICE or rtprio limit?)";
     }
+#else
+    // the real-time scheduling is only supported on Linux
+#endif
+}
 
-    // enable logging (if requested)
-    if ( !strLoggingFileName.isEmpty() )
+void CServerWorkerPool::CWorkerThread::Stop()
+{
+    // set flag so that thread can leave the main loop and wake it up
+    bRun = false;
+    StartSemaphore.release();
+
+    // give thread some time to terminate
+    wait ( 5000 );
+}
+
+void CServerWorkerPool::CWorkerThread::run()
+{
+    // the worker threads get the same priority as the timer thread so that
+    // the timer thread is not blocked by them at the end of the frame
+    SetCurrentThreadRealTimePriority ( iRtPriority );
+    SetCurrentThreadAffinity ( iCpuID );
+
+    while ( true )
     {
-        // in case the history is enabled and a logging file name is
-        // given, parse the logging file for old entries which are then
-        // added in the history on software startup
-        if ( !strHistoryFileName.isEmpty() )
+        // wait until the next frame shall be processed
+        StartSemaphore.acquire();
+
+        if ( !bRun )
         {
-            Logging.ParseLogFile ( strLoggingFileName );
+            break;
         }
 
-        Logging.Start ( strLoggingFileName );
+        pPool->ProcessItems ( iThreadID );
+
+        // signal that this thread is done with the current frame
+        pPool->DoneSemaphore.release();
     }
+}
 
-    // HTML status file writing
-    if ( !strHTMLStatusFileName.isEmpty() )
+
+// CGainPanMatrix implementation ***********************************************
+CGainPanMatrix::CGainPanMatrix() :
+    vecvecdGains        ( 4 ),
+    vecvecdPannings     ( 4 ),
+    vecvecRowChanged    ( 3 ),
+    vecvecColumnChanged ( 3 ),
+    iMaxNumChannels     ( 0 ),
+    iBackIdx            ( 0 ),
+    iFrontIdx           ( 1 ),
+    iMiddleIdx          ( 2 )
+{
+}
+
+void CGainPanMatrix::Init ( const int iNewMaxNumChannels )
+{
+    QMutexLocker locker ( &Mutex );
+
+    iMaxNumChannels = iNewMaxNumChannels;
+
+    // three buffers for the triple buffer and the master copy, all channels
+    // start with the default gain/pan
+    for ( int i = 0; i < 4; i++ )
     {
-        QString strCurServerNameForHTMLStatusFile = strServerNameForHTMLStatusFile;
+        vecvecdGains[i].Init    ( iMaxNumChannels * iMaxNumChannels, 1.0 );
+        vecvecdPannings[i].Init ( iMaxNumChannels * iMaxNumChannels, 0.5 );
+    }
 
-        // if server name is empty, substitude a default name
-        if ( strCurServerNameForHTMLStatusFile.isEmpty() )
+    // all buffers are equal to the master copy
+    for ( int i = 0; i < 3; i++ )
+    {
+        vecvecRowChanged[i].Init    ( iMaxNumChannels, 0 );
+        vecvecColumnChanged[i].Init ( iMaxNumChannels, 0 );
+    }
+}
+
+void CGainPanMatrix::SetGainPan ( const int    iChanID,
+                                  const int    iOtherChanID,
+                                  const double dNewGain,
+                                  const double dNewPan )
+{
+    if ( ( iChanID >= 0 ) && ( iChanID < iMaxNumChannels ) &&
+         ( iOtherChanID >= 0 ) && ( iOtherChanID < iMaxNumChannels ) )
+    {
+        QMutexLocker locker ( &Mutex );
+
+        vecvecdGains[3][iChanID * iMaxNumChannels + iOtherChanID]    = dNewGain;
+        vecvecdPannings[3][iChanID * iMaxNumChannels + iOtherChanID] = dNewPan;
+
+        MarkRowChanged ( iChanID );
+        Publish();
+    }
+}
+
+void CGainPanMatrix::ResetGains ( const int iChanID )
+{
+    if ( ( iChanID >= 0 ) && ( iChanID < iMaxNumChannels ) )
+    {
+        QMutexLocker locker ( &Mutex );
+
+        // reset the gains of the channel and the gains of the channel ID for
+        // all other channels (same as in CServer::PutAudioData)
+        for ( int i = 0; i < iMaxNumChannels; i++ )
         {
-            strCurServerNameForHTMLStatusFile = "[server address]";
+            vecvecdGains[3][iChanID * iMaxNumChannels + i] = 1.0;
+            vecvecdGains[3][i * iMaxNumChannels + iChanID] = 1.0;
         }
 
-        // (the static cast to integer of the port number is required so that it
-        // works correctly under Linux)
-        StartStatusHTMLFileWriting ( strHTMLStatusFileName,
-            strCurServerNameForHTMLStatusFile + ":" +
-            QString().number( static_cast<int> ( iPortNumber ) ) );
+        MarkRowChanged ( iChanID );
+        MarkColumnChanged ( iChanID );
+        Publish();
     }
+}
 
-    // Enable jam recording (if requested) - kicks off the thread
-    if ( bEnableRecording )
+void CGainPanMatrix::MarkRowChanged ( const int iChanID )
+{
+    for ( int i = 0; i < 3; i++ )
     {
-        JamRecorder.Init ( this, iServerFrameSizeSamples );
+        vecvecRowChanged[i][iChanID] = 1;
     }
+}
 
-    // enable all channels (for the server all channel must be enabled the
-    // entire life time of the software)
-    for ( i = 0; i < iMaxNumChannels; i++ )
+void CGainPanMatrix::MarkColumnChanged ( const int iChanID )
+{
+    for ( int i = 0; i < 3; i++ )
     {
-        vecChannels[i].SetEnable ( true );
+        vecvecColumnChanged[i][iChanID] = 1;
     }
+}
 
+void CGainPanMatrix::Publish()
+{
+    // copy the changed rows/columns of the master matrix in the back buffer
+    // and exchange it with the middle buffer (note that the mutex must be
+    // locked by the caller)
+    const CVector<double>& vecdMasterGains    = vecvecdGains[3];
+    const CVector<double>& vecdMasterPannings = vecvecdPannings[3];
+    CVector<double>&       vecdBackGains      = vecvecdGains[iBackIdx];
+    CVector<double>&       vecdBackPannings   = vecvecdPannings[iBackIdx];
+    CVector<int>&          vecRowChanged      = vecvecRowChanged[iBackIdx];
+    CVector<int>&          vecColumnChanged   = vecvecColumnChanged[iBackIdx];
 
-    // Connections -------------------------------------------------------------
-    // connect timer timeout signal
-    QObject::connect ( &HighPrecisionTimer, SIGNAL ( timeout() ),
-        this, SLOT ( OnTimer() ) );
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( vecRowChanged[i] != 0 )
+        {
+            const int iRowStart = i * iMaxNumChannels;
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLMessReadyForSending ( CHostAddress, CVector<uint8_t> ) ),
-        this, SLOT ( OnSendCLProtMessage ( CHostAddress, CVector<uint8_t> ) ) );
+            std::copy ( vecdMasterGains.begin() + iRowStart,
+                        vecdMasterGains.begin() + iRowStart + iMaxNumChannels,
+                        vecdBackGains.begin() + iRowStart );
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLPingReceived ( CHostAddress, int ) ),
-        this, SLOT ( OnCLPingReceived ( CHostAddress, int ) ) );
+            std::copy ( vecdMasterPannings.begin() + iRowStart,
+                        vecdMasterPannings.begin() + iRowStart + iMaxNumChannels,
+                        vecdBackPannings.begin() + iRowStart );
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLPingWithNumClientsReceived ( CHostAddress, int, int ) ),
-        this, SLOT ( OnCLPingWithNumClientsReceived ( CHostAddress, int, int ) ) );
+            vecRowChanged[i] = 0;
+        }
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLRegisterServerReceived ( CHostAddress, CHostAddress, CServerCoreInfo ) ),
-        this, SLOT ( OnCLRegisterServerReceived ( CHostAddress, CHostAddress, CServerCoreInfo ) ) );
+        if ( vecColumnChanged[i] != 0 )
+        {
+            for ( int j = i; j < iMaxNumChannels * iMaxNumChannels; j += iMaxNumChannels )
+            {
+                vecdBackGains[j]    = vecdMasterGains[j];
+                vecdBackPannings[j] = vecdMasterPannings[j];
+            }
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLUnregisterServerReceived ( CHostAddress ) ),
-        this, SLOT ( OnCLUnregisterServerReceived ( CHostAddress ) ) );
+            vecColumnChanged[i] = 0;
+        }
+    }
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLReqServerList ( CHostAddress ) ),
-        this, SLOT ( OnCLReqServerList ( CHostAddress ) ) );
+    iBackIdx = iMiddleIdx.fetchAndStoreAcquireRelease ( iBackIdx | NEW_DATA_FLAG ) & ~NEW_DATA_FLAG;
+}
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLRegisterServerResp ( CHostAddress, ESvrRegResult ) ),
-        this, SLOT ( OnCLRegisterServerResp ( CHostAddress, ESvrRegResult ) ) );
+bool CGainPanMatrix::Update()
+{
+    // only exchange the front buffer if a new matrix was published
+    if ( ( iMiddleIdx.loadAcquire() & NEW_DATA_FLAG ) == 0 )
+    {
+        return false;
+    }
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLSendEmptyMes ( CHostAddress ) ),
-        this, SLOT ( OnCLSendEmptyMes ( CHostAddress ) ) );
+    iFrontIdx = iMiddleIdx.fetchAndStoreAcquireRelease ( iFrontIdx ) & ~NEW_DATA_FLAG;
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLDisconnection ( CHostAddress ) ),
-        this, SLOT ( OnCLDisconnection ( CHostAddress ) ) );
+    return true;
+}
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLReqVersionAndOS ( CHostAddress ) ),
-        this, SLOT ( OnCLReqVersionAndOS ( CHostAddress ) ) );
 
-    QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLReqConnClientsList ( CHostAddress ) ),
-        this, SLOT ( OnCLReqConnClientsList ( CHostAddress ) ) );
+// CChannelAddressIndex implementation *****************************************
+CChannelAddressIndex::CChannelAddressIndex()
+{
+    Q_STATIC_ASSERT ( TABLE_SIZE >= 4 * MAX_NUM_CHANNELS );
 
-    QObject::connect ( &ServerListManager,
-       SIGNAL ( SvrRegStatusChanged() ),
-       this, SLOT ( OnSvrRegStatusChanged() ) );
+    Reset();
+}
 
-    QObject::connect ( QCoreApplication::instance(),
-        SIGNAL ( aboutToQuit() ),
-        this, SLOT ( OnAboutToQuit() ) );
+void CChannelAddressIndex::Reset()
+{
+    iSeqCnt.fetchAndAddOrdered ( 1 );
 
-    QObject::connect ( pSignalHandler,
-        SIGNAL ( HandledSignal ( int ) ),
-        this, SLOT ( OnHandledSignal ( int ) ) );
+    for ( int i = 0; i < TABLE_SIZE; i++ )
+    {
+        SetSlot ( i, 0, INVALID_CHANNEL_ID );
+    }
 
-    connectChannelSignalsToServerSlots<MAX_NUM_CHANNELS>();
+    iSeqCnt.fetchAndAddOrdered ( 1 );
 
-    // start the socket (it is important to start the socket after all
-    // initializations and connections)
-    Socket.Start();
+    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    {
+        veciChanKey[i]     = 0;
+        vecbChanIndexed[i] = false;
+    }
 }
 
-template<unsigned int slotId>
-inline void CServer::connectChannelSignalsToServerSlots()
+void CChannelAddressIndex::Insert ( const CHostAddress& Addr,
+                                    const int           iChanID )
 {
-    int iCurChanID = slotId - 1;
+    const quint64 iKey = GetKey ( Addr );
 
-    void ( CServer::* pOnSendProtMessCh )( CVector<uint8_t> ) =
-        &CServerSlots<slotId>::OnSendProtMessCh;
+    // remove the old entry of this channel and an old entry of a channel
+    // which had the same address before (e.g., a timed out client which
+    // reconnects and gets a new channel)
+    Remove ( iChanID );
 
-    void ( CServer::* pOnReqConnClientsListCh )() =
-        &CServerSlots<slotId>::OnReqConnClientsListCh;
+    const int iOldSlot = FindSlot ( iKey );
 
-    void ( CServer::* pOnChatTextReceivedCh )( QString ) =
-        &CServerSlots<slotId>::OnChatTextReceivedCh;
+    if ( iOldSlot != INVALID_INDEX )
+    {
+        vecbChanIndexed[Table[iOldSlot].iChanID.loadAcquire()] = false;
+        RemoveSlot ( iOldSlot );
+    }
 
-    void ( CServer::* pOnMuteStateHasChangedCh )( int, bool ) =
-        &CServerSlots<slotId>::OnMuteStateHasChangedCh;
+    // the table is never full since it is larger than the number of channels
+    int iSlot = GetHomeSlot ( iKey );
 
-    void ( CServer::* pOnServerAutoSockBufSizeChangeCh )( int ) =
-        &CServerSlots<slotId>::OnServerAutoSockBufSizeChangeCh;
+    while ( Table[iSlot].iChanID.loadAcquire() != INVALID_CHANNEL_ID )
+    {
+        iSlot = ( iSlot + 1 ) & TABLE_MASK;
+    }
 
-    // send message
-    QObject::connect ( &vecChannels[iCurChanID], &CChannel::MessReadyForSending,
-                       this, pOnSendProtMessCh );
+    iSeqCnt.fetchAndAddOrdered ( 1 );
+    SetSlot ( iSlot, iKey, iChanID );
+    iSeqCnt.fetchAndAddOrdered ( 1 );
 
-    // request connected clients list
-    QObject::connect ( &vecChannels[iCurChanID], &CChannel::ReqConnClientsList,
-                       this, pOnReqConnClientsListCh );
+    veciChanKey[iChanID]     = iKey;
+    vecbChanIndexed[iChanID] = true;
+}
 
-    // channel info has changed
-    QObject::connect ( &vecChannels[iCurChanID], &CChannel::ChanInfoHasChanged,
-                       this, &CServer::CreateAndSendChanListForAllConChannels );
+void CChannelAddressIndex::Remove ( const int iChanID )
+{
+    if ( vecbChanIndexed[iChanID] )
+    {
+        const int iSlot = FindSlot ( veciChanKey[iChanID] );
 
-    // chat text received
-    QObject::connect ( &vecChannels[iCurChanID], &CChannel::ChatTextReceived,
-                       this, pOnChatTextReceivedCh );
+        if ( iSlot != INVALID_INDEX )
+        {
+            RemoveSlot ( iSlot );
+        }
 
-    // other mute state has changed
-    QObject::connect ( &vecChannels[iCurChanID], &CChannel::MuteStateHasChanged,
-                       this, pOnMuteStateHasChangedCh );
+        vecbChanIndexed[iChanID] = false;
+    }
+}
 
-    // auto socket buffer size change
-    QObject::connect ( &vecChannels[iCurChanID], &CChannel::ServerAutoSockBufSizeChange,
-                       this, pOnServerAutoSockBufSizeChangeCh );
+int CChannelAddressIndex::Find ( const CHostAddress& Addr ) const
+{
+    const int iSlot = FindSlot ( GetKey ( Addr ) );
 
-    connectChannelSignalsToServerSlots<slotId - 1>();
-};
+    if ( iSlot == INVALID_INDEX )
+    {
+        return INVALID_CHANNEL_ID;
+    }
 
-template<>
-inline void CServer::connectChannelSignalsToServerSlots<0>() {};
+    return Table[iSlot].iChanID.loadAcquire();
+}
 
-void CServer::CreateAndSendJitBufMessage ( const int iCurChanID,
-                                           const int iNNumFra )
+bool CChannelAddressIndex::FindLockFree ( const CHostAddress& Addr,
+                                          int&                iChanID ) const
 {
-    vecChannels[iCurChanID].CreateJitBufMes ( iNNumFra );
+    const int iSeqStart = iSeqCnt.loadAcquire();
+
+    // the table is just modified (note that the probing always terminates
+    // since a modification does not fill all empty slots)
+    if ( ( iSeqStart & 1 ) != 0 )
+    {
+        return false;
+    }
+
+    iChanID = Find ( Addr );
+
+    // the slots are read with acquire semantics, i.e., the sequence counter
+    // is read after them
+    return iSeqCnt.loadAcquire() == iSeqStart;
 }
 
-void CServer::SendProtMessage ( int iChID, CVector<uint8_t> vecMessage )
+int CChannelAddressIndex::FindSlot ( const quint64 iKey ) const
 {
-    // the protocol queries me to call the function to send the message
-    // send it through the network
-    Socket.SendPacket ( vecMessage, vecChannels[iChID].GetAddress() );
+    // linear probing until the key or an empty slot is found
+    int iSlot = GetHomeSlot ( iKey );
+
+    while ( Table[iSlot].iChanID.loadAcquire() != INVALID_CHANNEL_ID )
+    {
+        if ( GetSlotKey ( iSlot ) == iKey )
+        {
+            return iSlot;
+        }
+
+        iSlot = ( iSlot + 1 ) & TABLE_MASK;
+    }
+
+    return INVALID_INDEX;
 }
 
-void CServer::OnNewConnection ( int          iChID,
-                                CHostAddress RecHostAddr )
+void CChannelAddressIndex::RemoveSlot ( int iSlot )
 {
-    // on a new connection we query the network transport properties for the
-    // audio packets (to use the correct network block size and audio
-    // compression properties, etc.)
-    vecChannels[iChID].CreateReqNetwTranspPropsMes();
+    // backward shift deletion: move the following entries of the probe
+    // sequence into the gap so that no tombstones are needed (a concurrent
+    // look up might miss a moved entry, therefore the whole shift is one
+    // modification of the sequence counter)
+    int iNextSlot = iSlot;
 
-    // this is a new connection, query the jitter buffer size we shall use
-    // for this client (note that at the same time on a new connection the
-    // client sends the jitter buffer size by default but maybe we have
-    // reached a state where this did not happen because of network trouble,
-    // client or server thinks that the connection was still active, etc.)
-    vecChannels[iChID].CreateReqJitBufMes();
+    iSeqCnt.fetchAndAddOrdered ( 1 );
 
-    // logging of new connected channel
-    Logging.AddNewConnection ( RecHostAddr.InetAddr );
+    for ( ;; )
+    {
+        Table[iSlot].iChanID.storeRelease ( INVALID_CHANNEL_ID );
 
-    // A new client connected to the server, the channel list
-    // at all clients have to be updated. This is done by sending
-    // a channel name request to the client which causes a channel
-    // name message to be transmitted to the server. If the server
-    // receives this message, the channel list will be automatically
-    // updated (implicitely).
-    // To make sure the protocol message is transmitted, the channel
-    // first has to be marked as connected.
-    //
-    // Usually it is not required to send the channel list to the
-    // client currently connecting since it automatically requests
-    // the channel list on a new connection (as a result, he will
-    // usually get the list twice which has no impact on functionality
-    // but will only increase the network load a tiny little bit). But
-    // in case the client thinks he is still connected but the server
-    // was restartet, it is important that we send the channel list
-    // at this place.
-    vecChannels[iChID].ResetTimeOutCounter();
-    vecChannels[iChID].CreateReqChanInfoMes();
+        for ( ;; )
+        {
+            iNextSlot = ( iNextSlot + 1 ) & TABLE_MASK;
 
-// COMPATIBILITY ISSUE
-// since old versions of the software did not implement the channel name
-// request message, we have to explicitely send the channel list here
-CreateAndSendChanListForAllConChannels();
+            if ( Table[iNextSlot].iChanID.loadAcquire() == INVALID_CHANNEL_ID )
+            {
+                iSeqCnt.fetchAndAddOrdered ( 1 );
+                return;
+            }
 
-    // send welcome message (if enabled)
-    if ( !strWelcomeMessage.isEmpty() )
-    {
-        // create formated server welcome message and send it just to
-        // the client which just connected to the server
-        const QString strWelcomeMessageFormated =
-            "<b>Server Welcome Message:</b> " + strWelcomeMessage;
+            // the entry may only be moved into the gap if its home slot does
+            // not lie cyclically in ( iSlot, iNextSlot ]
+            const int iHomeSlot = GetHomeSlot ( GetSlotKey ( iNextSlot ) );
 
-        vecChannels[iChID].CreateChatTextMes ( strWelcomeMessageFormated );
+            if ( ( ( iNextSlot - iHomeSlot ) & TABLE_MASK ) >=
+                 ( ( iNextSlot - iSlot ) & TABLE_MASK ) )
+            {
+                break;
+            }
+        }
+
+        SetSlot ( iSlot, GetSlotKey ( iNextSlot ), Table[iNextSlot].iChanID.loadAcquire() );
+        iSlot = iNextSlot;
     }
+}
 
-    // send licence request message (if enabled)
-    if ( eLicenceType != LT_NO_LICENCE )
+
+// CBitRateController implementation *******************************************
+void CBitRateController::Reset()
+{
+    dSizeFactor        = 1.0;
+    iNumCleanIntervals = 0;
+    bIsFirstInterval   = true;
+}
+
+void CBitRateController::Update ( const int iNumReceived,
+                                  const int iNumLost )
+{
+    const int iNumPackets = iNumReceived + iNumLost;
+
+    if ( iNumPackets <= 0 )
     {
-        vecChannels[iChID].CreateLicReqMes ( eLicenceType );
+        return;
     }
 
-    // send version info (for, e.g., feature activation in the client)
-    vecChannels[iChID].CreateVersionAndOSMes();
+    const double dErrRate = static_cast<double> ( iNumLost ) / iNumPackets;
 
-    // reset the conversion buffers
-    DoubleFrameSizeConvBufIn[iChID].Reset();
-    DoubleFrameSizeConvBufOut[iChID].Reset();
+    if ( bIsFirstInterval )
+    {
+        // the first interval after the connection is established may
+        // contain the start of the stream, it is no congestion indicator
+        bIsFirstInterval = false;
+    }
+    else if ( dErrRate > ADAPT_BITRATE_CONGESTION_ERR_RATE )
+    {
+        // congestion: reduce the bit rate immediately
+        dSizeFactor        = std::max ( dSizeFactor * ADAPT_BITRATE_DECREASE_FACTOR,
+                                        ADAPT_BITRATE_MIN_SIZE_FACTOR );
+        iNumCleanIntervals = 0;
+    }
+    else if ( dErrRate < ADAPT_BITRATE_CLEAN_ERR_RATE )
+    {
+        // the bit rate is only increased if the path is clean for a longer
+        // time since each size change interrupts the audio of the client
+        // shortly
+        if ( ++iNumCleanIntervals >= ADAPT_BITRATE_NUM_CLEAN_INTERVALS )
+        {
+            dSizeFactor        = std::min ( dSizeFactor + ADAPT_BITRATE_INCREASE_STEP, 1.0 );
+            iNumCleanIntervals = 0;
+        }
+    }
+    else
+    {
+        iNumCleanIntervals = 0;
+    }
 }
 
-void CServer::OnServerFull ( CHostAddress RecHostAddr )
+int CBitRateController::GetNetwFrameSize ( const int iMaxNetwFrameSize ) const
 {
-    // inform the calling client that no channel is free
-    ConnLessProtocol.CreateCLServerFullMes ( RecHostAddr );
+    const int iNetwFrameSize = static_cast<int> ( iMaxNetwFrameSize * dSizeFactor + 0.5 );
+
+    return std::min ( iMaxNetwFrameSize, std::max ( iNetwFrameSize, CELT_MINIMUM_NUM_BYTES ) );
 }
 
-void CServer::OnSendCLProtMessage ( CHostAddress     InetAddr,
-                                    CVector<uint8_t> vecMessage )
+
+// CLoadGovernor implementation ************************************************
+CLoadGovernor::CLoadGovernor() :
+    vecdSumNumEncoders ( LOAD_GOV_NUM_STEPS + 1, 0.0 )
 {
-    // the protocol queries me to call the function to send the message
-    // send it through the network
-    Socket.SendPacket ( vecMessage, InetAddr );
+    Init ( SYSTEM_FRAME_SIZE_SAMPLES * 1000000 / SYSTEM_SAMPLE_RATE_HZ * 1000 );
 }
 
-void CServer::OnProtcolCLMessageReceived ( int              iRecID,
-                                           CVector<uint8_t> vecbyMesBodyData,
-                                           CHostAddress     RecHostAddr )
+void CLoadGovernor::Init ( const int iNewFramePeriodNs )
 {
-    // connection less messages are always processed
-    ConnLessProtocol.ParseConnectionLessMessageBody ( vecbyMesBodyData,
-                                                      iRecID,
-                                                      RecHostAddr );
+    iFramePeriodNs     = iNewFramePeriodNs;
+    iIntervalLenFrames = std::max ( 1, static_cast<int> ( static_cast<qint64> ( LOAD_GOV_INTERVAL_MS ) *
+                                                          1000000 / iFramePeriodNs ) );
+
+    Reset();
 }
 
-void CServer::OnCLDisconnection ( CHostAddress InetAddr )
+void CLoadGovernor::Reset()
 {
-    // check if the given address is actually a client which is connected to
-    // this server, if yes, disconnect it
-    const int iCurChanID = FindChannel ( InetAddr );
+    dShedLevel         = 0.0;
+    iIntervalNumFrames = 0;
+    iIntervalSumTimeNs = 0;
+    iNumLowIntervals   = 0;
 
-    if ( iCurChanID != INVALID_CHANNEL_ID )
-    {
-        vecChannels[iCurChanID].Disconnect();
-    }
+    ResetStatistic();
 }
 
-void CServer::OnAboutToQuit()
+void CLoadGovernor::Update ( const qint64 iFrameTimeNs )
 {
-    // if enabled, disconnect all clients on quit
-    if ( bDisconnectAllClientsOnQuit )
+    iIntervalSumTimeNs += iFrameTimeNs;
+    iIntervalNumFrames++;
+
+    iStatSumTimeNs += iFrameTimeNs;
+    iStatMaxTimeNs  = std::max ( iStatMaxTimeNs, iFrameTimeNs );
+    iStatNumFrames++;
+
+    if ( iIntervalNumFrames < iIntervalLenFrames )
     {
-        Mutex.lock();
-        {
-            for ( int i = 0; i < iMaxNumChannels; i++ )
-            {
-                if ( vecChannels[i].IsConnected() )
-                {
-                    ConnLessProtocol.CreateCLDisconnection ( vecChannels[i].GetAddress() );
-                }
-            }
-        }
-        Mutex.unlock(); // release mutex
+        return;
     }
 
-    Stop();
+    // average load of the interval in percent of the frame period
+    const qint64 iLoadPercent = 100 * iIntervalSumTimeNs / ( iFramePeriodNs * iIntervalNumFrames );
 
-    // if server was registered at the central server, unregister on shutdown
-    if ( GetServerListEnabled() )
+    if ( iLoadPercent > LOAD_GOV_HIGH_LOAD_PERCENT )
     {
-        UnregisterSlaveServer();
+        // the server is near its limit: reduce the complexity of the next
+        // part of the mix groups immediately
+        if ( dShedLevel < LOAD_GOV_NUM_STEPS )
+        {
+            dShedLevel = std::min ( dShedLevel + LOAD_GOV_SHED_STEP,
+                                    static_cast<double> ( LOAD_GOV_NUM_STEPS ) );
+            iStatNumShedSteps++;
+        }
+
+        iNumLowIntervals = 0;
+    }
+    else if ( iLoadPercent < LOAD_GOV_LOW_LOAD_PERCENT )
+    {
+        // the complexity is only restored if there is enough headroom for a
+        // longer time, otherwise the governor would oscillate
+        if ( ( ++iNumLowIntervals >= LOAD_GOV_NUM_LOW_INTERVALS ) && ( dShedLevel > 0.0 ) )
+        {
+            dShedLevel       = std::max ( dShedLevel - LOAD_GOV_RESTORE_STEP, 0.0 );
+            iNumLowIntervals = 0;
+            iStatNumRestoreSteps++;
+        }
+    }
+    else
+    {
+        iNumLowIntervals = 0;
     }
+
+    // start the next interval
+    iIntervalNumFrames = 0;
+    iIntervalSumTimeNs = 0;
 }
 
-void CServer::OnHandledSignal ( int sigNum )
+int CLoadGovernor::GetTotalNumShedSteps ( const int iNumGroups ) const
 {
-#ifdef _WIN32
-    // Windows does not actually get OnHandledSignal triggered
-    QCoreApplication::instance()->exit();
-    Q_UNUSED ( sigNum )
-#else
-    switch ( sigNum )
-    {
+    // e.g., with four groups and a shed level of 1.25 five steps are handed
+    // out (one group gets two steps and the other groups get one step)
+    const double dNumSteps = ceil ( dShedLevel * iNumGroups );
 
-    case SIGUSR1:
-        RequestNewRecording();
-        break;
+    return std::max ( 0, std::min ( static_cast<int> ( dNumSteps ), LOAD_GOV_NUM_STEPS * iNumGroups ) );
+}
 
-    case SIGINT:
-    case SIGTERM:
-        // This should trigger OnAboutToQuit
-        QCoreApplication::instance()->exit();
-        break;
+int CLoadGovernor::GetComplexity ( const int iDefaultComplexity,
+                                   const int iNumShedSteps )
+{
+    // maximum complexity for each reduction step: without the pitch
+    // pre-filter, without the spreading and tf analysis, minimum complexity
+    int iMaxComplexity;
 
-    default:
-        break;
+    switch ( iNumShedSteps )
+    {
+    case 0:  iMaxComplexity = iDefaultComplexity; break;
+    case 1:  iMaxComplexity = 3;                  break;
+    case 2:  iMaxComplexity = 1;                  break;
+    default: iMaxComplexity = 0;                  break;
     }
-#endif
+
+    return std::min ( iDefaultComplexity, iMaxComplexity );
 }
 
-void CServer::RequestNewRecording()
+int CLoadGovernor::GetNextNumShedSteps ( const int iDefaultComplexity,
+                                         const int iNumShedSteps )
 {
-    if ( bEnableRecording )
+    const int iCurComplexity = GetComplexity ( iDefaultComplexity, iNumShedSteps );
+    int       iNextNumSteps  = iNumShedSteps + 1;
+
+    while ( ( iNextNumSteps <= LOAD_GOV_NUM_STEPS ) &&
+            ( GetComplexity ( iDefaultComplexity, iNextNumSteps ) >= iCurComplexity ) )
     {
-        emit RestartRecorder();
+        iNextNumSteps++;
     }
+
+    return iNextNumSteps;
 }
 
-void CServer::Start()
+bool CLoadGovernor::IsReportReady() const
 {
-    // only start if not already running
-    if ( !IsRunning() )
-    {
-        // start timer
-        HighPrecisionTimer.Start();
+    return ( iStatNumFrames > 0 ) &&
+           ( ReportTimer.elapsed() >= PROCESSING_TIME_REPORT_INTERVAL_MS );
+}
 
-        // emit start signal
-        emit Started();
-    }
+void CLoadGovernor::ResetStatistic()
+{
+    iStatNumFrames       = 0;
+    iStatSumTimeNs       = 0;
+    iStatMaxTimeNs       = 0;
+    iStatNumShedSteps    = 0;
+    iStatNumRestoreSteps = 0;
+    vecdSumNumEncoders.Reset ( 0.0 );
+    ReportTimer.start();
 }
 
-void CServer::Stop()
+double CLoadGovernor::GetAvLoadPercent() const
 {
-    // Under Mac we have the problem that the timer shutdown might
-    // take some time and therefore we get a lot of "server stopped"
-    // entries in the log. The following condition shall prevent this.
-    // For the other OSs this should not hurt either.
-    if ( IsRunning() )
+    return ( iStatNumFrames > 0 ) ?
+        100.0 * iStatSumTimeNs / ( static_cast<double> ( iFramePeriodNs ) * iStatNumFrames ) : 0.0;
+}
+
+double CLoadGovernor::GetMaxLoadPercent() const
+{
+    return 100.0 * iStatMaxTimeNs / iFramePeriodNs;
+}
+
+
+// COpusCodecPool implementation ***********************************************
+COpusCodecPool::COpusCodecPool() :
+    pRefillNotifier ( nullptr )
+{
+    int iOpusError;
+
+    // the modes are shared by all codecs of the server
+    OpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                         DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES,
+                                         &iOpusError );
+
+    Opus64Mode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                           SYSTEM_FRAME_SIZE_SAMPLES,
+                                           &iOpusError );
+
+    for ( int i = 0; i < NUM_VARIANTS; i++ )
     {
-        // stop timer
-        HighPrecisionTimer.Stop();
+        iSparePutPos[i].storeRelease ( 0 );
+        iSpareGetPos[i].storeRelease ( 0 );
+    }
 
-        // logging (add "server stopped" logging entry)
-        Logging.AddServerStopped();
+    Init ( MAX_NUM_CHANNELS );
+}
 
-        // emit stopped signal
-        emit Stopped();
+void COpusCodecPool::Init ( const int iNewMaxNumCodecsPerVariant )
+{
+    // each channel uses at most one encoder and one decoder and a codec is
+    // only taken from the spare codecs if the free list is empty, therefore
+    // the number of free codecs of a variant cannot exceed the number of
+    // channels
+    for ( int i = 0; i < NUM_VARIANTS; i++ )
+    {
+        vecFreeEncoders[i].Init ( iNewMaxNumCodecsPerVariant, nullptr );
+        vecFreeDecoders[i].Init ( iNewMaxNumCodecsPerVariant, nullptr );
+        iNumFree[i] = 0;
     }
 }
 
-void CServer::OnTimer()
+int COpusCodecPool::GetVariant ( const EAudComprType eAudComprType,
+                                 const int           iNumAudChan )
 {
-    int                i, j, iUnused;
-    int                iClientFrameSizeSamples = 0; // initialize to avoid a compiler warning
-    OpusCustomDecoder* CurOpusDecoder;
-    OpusCustomEncoder* CurOpusEncoder;
-    unsigned char*     pCurCodedData;
+    const int iStereoOffset = ( iNumAudChan == 1 ) ? 0 : 1;
 
-/*
-// TEST do a timer jitter measurement
+    if ( eAudComprType == CT_OPUS )
+    {
+        return iStereoOffset;
+    }
+    else if ( eAudComprType == CT_OPUS64 )
+    {
+        return 2 + iStereoOffset;
+    }
+
+    return INVALID_INDEX;
+}
+
+OpusCustomEncoder* COpusCodecPool::CreateEncoder ( const int iVariant )
+{
+    int                iOpusError;
+    const bool         bIsOpus64 = ( iVariant >= 2 );
+    OpusCustomEncoder* pEncoder  = opus_custom_encoder_create ( bIsOpus64 ? Opus64Mode : OpusMode,
+                                                                ( iVariant % 2 == 0 ) ? 1 : 2,
+                                                                &iOpusError );
+
+    // we require a constant bit rate
+    opus_custom_encoder_ctl ( pEncoder, OPUS_SET_VBR ( 0 ) );
+
+    // we want as low delay as possible
+    opus_custom_encoder_ctl ( pEncoder, OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+    if ( bIsOpus64 )
+    {
+        // for 64 samples frame size we have to adjust the PLC behavior to avoid loud artifacts
+        opus_custom_encoder_ctl ( pEncoder, OPUS_SET_PACKET_LOSS_PERC ( 35 ) );
+    }
+    else
+    {
+        // set encoder low complexity for legacy 128 samples frame size
+        opus_custom_encoder_ctl ( pEncoder, OPUS_SET_COMPLEXITY ( OPUS_ENCODER_COMPLEXITY ) );
+    }
+
+    return pEncoder;
+}
+
+OpusCustomDecoder* COpusCodecPool::CreateDecoder ( const int iVariant )
+{
+    int iOpusError;
+
+    return opus_custom_decoder_create ( ( iVariant >= 2 ) ? Opus64Mode : OpusMode,
+                                        ( iVariant % 2 == 0 ) ? 1 : 2,
+                                        &iOpusError );
+}
+
+int COpusCodecPool::GetNumSpare ( const int iVariant )
+{
+    const int iNumSpare = iSparePutPos[iVariant].loadAcquire() - iSpareGetPos[iVariant].loadAcquire();
+
+    return ( iNumSpare < 0 ) ? iNumSpare + 2 * OPUS_CODEC_POOL_NUM_SPARE : iNumSpare;
+}
+
+void COpusCodecPool::Refill()
+{
+    for ( int i = 0; i < NUM_VARIANTS; i++ )
+    {
+        while ( GetNumSpare ( i ) < OPUS_CODEC_POOL_NUM_SPARE )
+        {
+            const int iCurPutPos = iSparePutPos[i].loadAcquire();
+            const int iIdx       = ( iCurPutPos < OPUS_CODEC_POOL_NUM_SPARE ) ?
+                iCurPutPos : iCurPutPos - OPUS_CODEC_POOL_NUM_SPARE;
+
+            SpareEncoders[i][iIdx] = CreateEncoder ( i );
+            SpareDecoders[i][iIdx] = CreateDecoder ( i );
+
+            // publish the codecs to the timer thread
+            iSparePutPos[i].storeRelease ( iCurPutPos + 1 < 2 * OPUS_CODEC_POOL_NUM_SPARE ? iCurPutPos + 1 : 0 );
+        }
+    }
+}
+
+bool COpusCodecPool::GetCodecs ( const EAudComprType eAudComprType,
+                                 const int           iNumAudChan,
+                                 OpusCustomEncoder*& pEncoder,
+                                 OpusCustomDecoder*& pDecoder )
+{
+    const int iVariant = GetVariant ( eAudComprType, iNumAudChan );
+
+    if ( iVariant == INVALID_INDEX )
+    {
+        return false;
+    }
+
+    // reuse released codecs if possible (the reset clears the signal
+    // dependent state but keeps the settings of the encoder)
+    if ( iNumFree[iVariant] > 0 )
+    {
+        iNumFree[iVariant]--;
+
+        pEncoder = vecFreeEncoders[iVariant][iNumFree[iVariant]];
+        pDecoder = vecFreeDecoders[iVariant][iNumFree[iVariant]];
+
+        opus_custom_encoder_ctl ( pEncoder, OPUS_RESET_STATE );
+        opus_custom_decoder_ctl ( pDecoder, OPUS_RESET_STATE );
+
+        return true;
+    }
+
+    // take a spare codec pair of the main thread and let the main thread
+    // create a new one (if all spare codecs are taken, the channel has to
+    // wait for the main thread)
+    const bool bSpareAvailable = ( GetNumSpare ( iVariant ) > 0 );
+
+    if ( bSpareAvailable )
+    {
+        const int iCurGetPos = iSpareGetPos[iVariant].loadAcquire();
+        const int iIdx       = ( iCurGetPos < OPUS_CODEC_POOL_NUM_SPARE ) ?
+            iCurGetPos : iCurGetPos - OPUS_CODEC_POOL_NUM_SPARE;
+
+        pEncoder = SpareEncoders[iVariant][iIdx];
+        pDecoder = SpareDecoders[iVariant][iIdx];
+
+        iSpareGetPos[iVariant].storeRelease ( iCurGetPos + 1 < 2 * OPUS_CODEC_POOL_NUM_SPARE ? iCurGetPos + 1 : 0 );
+    }
+
+    if ( pRefillNotifier != nullptr )
+    {
+        pRefillNotifier->Notify();
+    }
+
+    return bSpareAvailable;
+}
+
+void COpusCodecPool::ReleaseCodecs ( OpusCustomEncoder*  pEncoder,
+                                     OpusCustomDecoder*  pDecoder,
+                                     const EAudComprType eAudComprType,
+                                     const int           iNumAudChan )
+{
+    const int iVariant = GetVariant ( eAudComprType, iNumAudChan );
+
+    if ( ( pEncoder != nullptr ) && ( pDecoder != nullptr ) && ( iVariant != INVALID_INDEX ) )
+    {
+        // a spare codec is only taken if all codecs of the variant are used
+        // by channels, therefore there are never more codecs of a variant
+        // than channels and the free list cannot overflow
+        Q_ASSERT ( iNumFree[iVariant] < vecFreeEncoders[iVariant].Size() );
+
+        vecFreeEncoders[iVariant][iNumFree[iVariant]] = pEncoder;
+        vecFreeDecoders[iVariant][iNumFree[iVariant]] = pDecoder;
+        iNumFree[iVariant]++;
+    }
+}
+
+
+// CRecordingQueue implementation **********************************************
+void CRecordingQueue::Init ( const int iNumEntries,
+                             const int iNumReserved,
+                             const int iFrameSize )
+{
+    vecEntries.Init ( iNumEntries );
+
+    for ( int i = 0; i < iNumEntries; i++ )
+    {
+        vecEntries[i].vecsData.Init ( iFrameSize );
+    }
+
+    iNumReservedEntries = iNumReserved;
+    iPutPos.storeRelease ( 0 );
+    iGetPos.storeRelease ( 0 );
+}
+
+int CRecordingQueue::GetNumUsed()
+{
+    // the positions run from zero to two times the number of entries so that
+    // a full and an empty queue can be distinguished
+    const int iNumUsed = iPutPos.loadAcquire() - iGetPos.loadAcquire();
+
+    return ( iNumUsed < 0 ) ? iNumUsed + 2 * vecEntries.Size() : iNumUsed;
+}
+
+CRecordingQueue::CEntry* CRecordingQueue::GetWriteEntry ( const bool bIsDisconnected )
+{
+    const int iNumEntries = vecEntries.Size();
+
+    // the audio frames must not use the reserved entries
+    const int iNumAvailable = bIsDisconnected ? iNumEntries : iNumEntries - iNumReservedEntries;
+
+    if ( GetNumUsed() >= iNumAvailable )
+    {
+        return nullptr;
+    }
+
+    const int iCurPutPos = iPutPos.loadAcquire();
+    CEntry&   Entry      = vecEntries[iCurPutPos < iNumEntries ? iCurPutPos : iCurPutPos - iNumEntries];
+
+    Entry.bIsDisconnected = bIsDisconnected;
+
+    return &Entry;
+}
+
+void CRecordingQueue::Publish()
+{
+    const int iCurPutPos = iPutPos.loadAcquire();
+
+    iPutPos.storeRelease ( iCurPutPos + 1 < 2 * vecEntries.Size() ? iCurPutPos + 1 : 0 );
+}
+
+CRecordingQueue::CEntry* CRecordingQueue::GetReadEntry()
+{
+    if ( GetNumUsed() == 0 )
+    {
+        return nullptr;
+    }
+
+    const int iCurGetPos = iGetPos.loadAcquire();
+
+    return &vecEntries[iCurGetPos < vecEntries.Size() ? iCurGetPos : iCurGetPos - vecEntries.Size()];
+}
+
+void CRecordingQueue::Release()
+{
+    const int iCurGetPos = iGetPos.loadAcquire();
+
+    iGetPos.storeRelease ( iCurGetPos + 1 < 2 * vecEntries.Size() ? iCurGetPos + 1 : 0 );
+}
+
+
+// CServer implementation ******************************************************
+CServer::CServer ( const int                 iNewMaxNumChan,
+                   const int                 iMaxDaysHistory,
+                   const QString&            strLoggingFileName,
+                   const quint16             iPortNumber,
+                   const QString&            strHTMLStatusFileName,
+                   const QString&            strHistoryFileName,
+                   const QString&            strServerNameForHTMLStatusFile,
+                   const QString&            strCentralServer,
+                   const QString&            strServerInfo,
+                   const QString&            strNewWelcomeMessage,
+                   const QString&            strRecordingDirName,
+                   const bool                bNCentServPingServerInList,
+                   const bool                bNDisconnectAllClientsOnQuit,
+                   const bool                bNUseDoubleSystemFrameSize,
+                   const ELicenceType        eNLicenceType,
+                   const int                 iNumWorkerThreads,
+                   const QString&            strWorkerCpuAffinity,
+                   const bool                bNUseParallelDecode,
+                   const bool                bNEnableProcTimeStats,
+                   const bool                bNUseFloatAudio,
+                   const int                 iTimerRtPriority,
+                   const int                 iTimerCpuID,
+                   const bool                bLockMemory,
+                   const ETimerCatchUpPolicy eTimerCatchUpPolicy,
+                   const int                 iNumRecvThreads,
+                   const bool                bNUseDriftComp,
+                   const bool                bNUseAdaptiveBitRate,
+                   const bool                bNUseLoadGovernor ) :
+    bUseDoubleSystemFrameSize   ( bNUseDoubleSystemFrameSize ),
+    iMaxNumChannels             ( iNewMaxNumChan ),
+    vecChannels                 ( new CChannel[iNewMaxNumChan] ),
+    bFadeInWasActive            ( false ),
+    iCurNumClients              ( 0 ),
+    iPrevNumClients             ( 0 ),
+    bUseParallelDecode          ( bNUseParallelDecode ),
+    bUseFloatAudio              ( bNUseFloatAudio ),
+    bUseDriftComp               ( bNUseDriftComp ),
+    bUseAdaptiveBitRate         ( bNUseAdaptiveBitRate ),
+    bUseLoadGovernor            ( bNUseLoadGovernor ),
+    iNumChannelMixes            ( 0 ),
+    iNumSkippedMixes            ( 0 ),
+    iSumChannelMixes            ( 0 ),
+    iSumSkippedMixes            ( 0 ),
+    iLastNumSkippedMixes        ( 0 ),
+    DecodeReceiveJob            ( this ),
+    MixEncodeTransmitJob        ( this ),
+    iSumSentPackets             ( 0 ),
+    iSumSendSysCalls            ( 0 ),
+    Socket                      ( this, iPortNumber, iNumRecvThreads ),
+    Logging                     ( iMaxDaysHistory ),
+    JamRecorder                 ( strRecordingDirName ),
+    bEnableRecording            ( !strRecordingDirName.isEmpty() ),
+    bWriteStatusHTMLFile        ( false ),
+    HighPrecisionTimer          ( bNUseDoubleSystemFrameSize ),
+    ServerListManager           ( iPortNumber,
+                                  strCentralServer,
+                                  strServerInfo,
+                                  iNewMaxNumChan,
+                                  bNCentServPingServerInList,
+                                  &ConnLessProtocol ),
+    bAutoRunMinimized           ( false ),
+    strWelcomeMessage           ( strNewWelcomeMessage ),
+    eLicenceType                ( eNLicenceType ),
+    bDisconnectAllClientsOnQuit ( bNDisconnectAllClientsOnQuit ),
+    pSignalHandler              ( CSignalHandler::getSingletonP() )
+{
+    int i;
+
+    // allocate the per channel data for the number of channels set at launch
+    pChanOpusEncoder.Init               ( iMaxNumChannels );
+    pChanOpusDecoder.Init               ( iMaxNumChannels );
+    eChanCodecComprType.Init            ( iMaxNumChannels );
+    iChanCodecNumAudChan.Init           ( iMaxNumChannels );
+    DoubleFrameSizeConvBufIn.Init       ( iMaxNumChannels );
+    DoubleFrameSizeConvBufOut.Init      ( iMaxNumChannels );
+    DoubleFrameSizeConvBufInFloat.Init  ( iMaxNumChannels );
+    DoubleFrameSizeConvBufOutFloat.Init ( iMaxNumChannels );
+    DriftComp.Init                      ( iMaxNumChannels );
+    BitRateCtrl.Init                    ( iMaxNumChannels );
+    pLastUsedEncoder.Init               ( iMaxNumChannels );
+    iLastEncoderBitRate.Init            ( iMaxNumChannels );
+    iLastEncoderComplexity.Init         ( iMaxNumChannels );
+    vecChanPutActive.Init               ( iMaxNumChannels );
+    vecChanResetPending.Init            ( iMaxNumChannels );
+    GainPanMatrix.Init                  ( iMaxNumChannels );
+
+    // the codecs are taken from the pool, a channel has no codec until it has
+    // negotiated a codec variant (the spare codecs for the first channels of
+    // each variant are created here, the following ones are created by the
+    // main thread when it is notified by the timer thread)
+    OpusCodecPool.Init ( iMaxNumChannels );
+    OpusCodecPool.Refill();
+    OpusCodecPool.SetRefillNotifier ( &CodecRefillNotifier );
+
+    for ( i = 0; i < iMaxNumChannels; i++ )
+    {
+        pChanOpusEncoder[i]     = nullptr;
+        pChanOpusDecoder[i]     = nullptr;
+        eChanCodecComprType[i]  = CT_NONE;
+        iChanCodecNumAudChan[i] = 0;
+
+        // the bit rate and the complexity are set on the first use of an
+        // encoder
+        pLastUsedEncoder[i]       = nullptr;
+        iLastEncoderBitRate[i]    = 0;
+        iLastEncoderComplexity[i] = 0;
+
+
+        // init double-to-normal frame size conversion buffers -----------------
+        // use worst case memory initialization to avoid allocating memory in
+        // the time-critical thread
+        DoubleFrameSizeConvBufIn[i].Init  ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        DoubleFrameSizeConvBufOut[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+
+        if ( bUseFloatAudio )
+        {
+            DoubleFrameSizeConvBufInFloat[i].Init  ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+            DoubleFrameSizeConvBufOutFloat[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        }
+
+        // init clock drift compensation ---------------------------------------
+        if ( bUseDriftComp )
+        {
+            DriftComp[i].Init ( 2 /* stereo */, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case frame size */ );
+        }
+    }
+
+    // define colors for chat window identifiers
+    vstrChatColors.Init ( 6 );
+    vstrChatColors[0] = "mediumblue";
+    vstrChatColors[1] = "red";
+    vstrChatColors[2] = "darkorchid";
+    vstrChatColors[3] = "green";
+    vstrChatColors[4] = "maroon";
+    vstrChatColors[5] = "coral";
+
+    // set the server frame size
+    if ( bUseDoubleSystemFrameSize )
+    {
+        iServerFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+    }
+    else
+    {
+        iServerFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+    }
+
+    // the load of the server is measured relative to the frame period
+    LoadGovernor.Init ( static_cast<int> ( static_cast<qint64> ( iServerFrameSizeSamples ) *
+                                           1000000000 / SYSTEM_SAMPLE_RATE_HZ ) );
+
+
+    // To avoid audio clitches, in the entire realtime timer audio processing
+    // routine including the ProcessData no memory must be allocated. Since we
+    // do not know the required sizes for the vectors, we allocate memory for
+    // the worst case here:
+
+    // start the worker threads for the audio processing (if only one thread
+    // is used, all processing is done in the timer thread)
+    WorkerPool.Init ( iNumWorkerThreads, strWorkerCpuAffinity, iTimerRtPriority );
+
+    // the audio processing is done directly in the timer thread
+    HighPrecisionTimer.SetRealTimeProperties ( iTimerRtPriority, iTimerCpuID, eTimerCatchUpPolicy );
+
+    // enable the processing time statistics (if requested)
+    DecodeTimeMeas.SetEnable ( bNEnableProcTimeStats );
+    SendTimeMeas.SetEnable   ( bNEnableProcTimeStats );
+
+    // each worker thread needs its own temporary buffers, we always use stereo
+    // audio buffers (which is the worst case)
+    vecvecsSendData.Init   ( WorkerPool.GetNumThreads() );
+    vecvecfMixAccum.Init   ( WorkerPool.GetNumThreads() );
+    vecvecbyCodedData.Init ( WorkerPool.GetNumThreads() );
+    vecNumChannelMixes.Init ( WorkerPool.GetNumThreads(), 1 );
+    vecNumSkippedMixes.Init ( WorkerPool.GetNumThreads(), 1 );
+
+    for ( i = 0; i < WorkerPool.GetNumThreads(); i++ )
+    {
+        vecvecsSendData[i].Init   ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        vecvecfMixAccum[i].Init   ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        vecvecbyCodedData[i].Init ( MAX_SIZE_BYTES_NETW_BUF );
+    }
+
+    // shared mixes for mono and stereo clients
+    vecvecfSharedMix.Init ( 2 );
+
+    for ( i = 0; i < 2; i++ )
+    {
+        vecvecfSharedMix[i].Init ( ( i + 1 ) * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+    }
+
+    // allocate worst case memory for the temporary vectors
+    vecChanIDsCurConChan.Init          ( iMaxNumChannels );
+    vecvecdGains.Init                  ( iMaxNumChannels, iMaxNumChannels );
+    vecvecdPannings.Init               ( iMaxNumChannels, iMaxNumChannels );
+    vecdFadeInGains.Init               ( iMaxNumChannels );
+    vecNumAudioChannels.Init           ( iMaxNumChannels );
+    vecNumFrameSizeConvBlocks.Init     ( iMaxNumChannels );
+    vecUseDoubleSysFraSizeConvBuf.Init ( iMaxNumChannels );
+    vecAudioComprType.Init             ( iMaxNumChannels );
+    vecChannelIsNowDisconnected.Init   ( iMaxNumChannels );
+    vecChannelIsActive.Init            ( iMaxNumChannels );
+    vecMixType.Init                    ( iMaxNumChannels );
+    SendBatch.Init                     ( iMaxNumChannels * MAX_NUM_PACKETS_PER_FRAME );
+    vecNetwFrameSizes.Init             ( iMaxNumChannels );
+    vecMixSettingsHash.Init            ( iMaxNumChannels );
+    vecMixGroupLeaders.Init            ( iMaxNumChannels );
+    vecMixGroupNext.Init               ( iMaxNumChannels );
+    vecMixSourceChanIDs.Init           ( iMaxNumChannels, INVALID_CHANNEL_ID );
+    vecMixGroupBitRates.Init           ( iMaxNumChannels );
+    vecMixGroupOrder.Init              ( iMaxNumChannels );
+    vecMixGroupNumShedSteps.Init       ( iMaxNumChannels, 0 );
+    vecFrameTransmitted.Init           ( iMaxNumChannels );
+
+    // we always use stereo audio buffers (see "vecvecsSendData")
+    vecvecsData.Init ( iMaxNumChannels, 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+
+    if ( bUseFloatAudio )
+    {
+        vecvecfData.Init ( iMaxNumChannels, 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+    }
+
+    // allocate worst case memory for the channel levels
+    vecChannelLevels.Init     ( iMaxNumChannels );
+
+    // reserve the memory of the channel level message for the maximum number
+    // of clients so that it is never allocated by the timer thread
+    vecbyChanLevelMes.reserve     ( MESS_LEN_WITHOUT_DATA_BYTE + ( iMaxNumChannels + 1 ) / 2 );
+    vecbyChanLevelMesData.reserve ( ( iMaxNumChannels + 1 ) / 2 );
+
+    vecbyChanLevelMesLegacy.reserve     ( MESS_LEN_WITHOUT_DATA_BYTE + ( MAX_NUM_CHANNELS_LEGACY + 1 ) / 2 );
+    vecbyChanLevelMesDataLegacy.reserve ( ( MAX_NUM_CHANNELS_LEGACY + 1 ) / 2 );
+
+    // lock all current and future memory pages to avoid page faults in the
+    // audio processing (if requested)
+    if ( bLockMemory )
+    {
+#if defined ( __linux__ ) && !defined ( ANDROID )
+        if ( mlockall ( MCL_CURRENT | MCL_FUTURE ) != 0 )
+        {
+            qWarning() << "could not lock the memory (missing CAP_IPC_LOCK or memlock limit?)";
+        }
+#else
+        qWarning() << "locking the memory is only supported on Linux";
+#endif
+    }
+
+    // enable history graph (if requested)
+    if ( !strHistoryFileName.isEmpty() )
+    {
+        Logging.EnableHistory ( strHistoryFileName );
+    }
+
+    // enable logging (if requested)
+    if ( !strLoggingFileName.isEmpty() )
+    {
+        // in case the history is enabled and a logging file name is
+        // given, parse the logging file for old entries which are then
+        // added in the history on software startup
+        if ( !strHistoryFileName.isEmpty() )
+        {
+            Logging.ParseLogFile ( strLoggingFileName );
+        }
+
+        Logging.Start ( strLoggingFileName );
+    }
+
+    // HTML status file writing
+    if ( !strHTMLStatusFileName.isEmpty() )
+    {
+        QString strCurServerNameForHTMLStatusFile = strServerNameForHTMLStatusFile;
+
+        // if server name is empty, substitude a default name
+        if ( strCurServerNameForHTMLStatusFile.isEmpty() )
+        {
+            strCurServerNameForHTMLStatusFile = "[server address]";
+        }
+
+        // (the static cast to integer of the port number is required so that it
+        // works correctly under Linux)
+        StartStatusHTMLFileWriting ( strHTMLStatusFileName,
+            strCurServerNameForHTMLStatusFile + ":" +
+            QString().number( static_cast<int> ( iPortNumber ) ) );
+    }
+
+    // Enable jam recording (if requested) - kicks off the thread
+    if ( bEnableRecording )
+    {
+        // one entry per channel is reserved for the disconnection
+        RecordingQueue.Init ( iMaxNumChannels * ( RECORDING_QUEUE_NUM_FRAMES + 1 ),
+                              iMaxNumChannels,
+                              2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+
+        JamRecorder.Init ( this, iServerFrameSizeSamples );
+    }
+
+    // enable all channels (for the server all channel must be enabled the
+    // entire life time of the software)
+    for ( i = 0; i < iMaxNumChannels; i++ )
+    {
+        vecChannels[i].SetEnable ( true );
+    }
+
+
+    // Connections -------------------------------------------------------------
+    // connect timer timeout signal (the direct connection makes sure that
+    // the audio processing is done in the high priority timer thread, all
+    // actions in OnTimer() which must be done in the main thread are posted
+    // as events)
+    QObject::connect ( &HighPrecisionTimer, SIGNAL ( timeout() ),
+        this, SLOT ( OnTimer() ), Qt::DirectConnection );
+
+    // the statistics reports of the timer thread are logged in the main thread
+    QObject::connect ( &StatReportTimer, SIGNAL ( timeout() ),
+        this, SLOT ( OnStatReportTimer() ) );
+
+    // the recording frames and the channel requests of the timer thread are
+    // processed in the main thread
+    QObject::connect ( &RecordingNotifier, SIGNAL ( Notified() ),
+        this, SLOT ( OnRecordingNotification() ) );
+
+    QObject::connect ( &ChanRequestNotifier, SIGNAL ( Notified() ),
+        this, SLOT ( OnChanRequestNotification() ) );
+
+    QObject::connect ( &CodecRefillNotifier, SIGNAL ( Notified() ),
+        this, SLOT ( OnCodecRefillNotification() ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLMessReadyForSending ( CHostAddress, CVector<uint8_t> ) ),
+        this, SLOT ( OnSendCLProtMessage ( CHostAddress, CVector<uint8_t> ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLPingReceived ( CHostAddress, int ) ),
+        this, SLOT ( OnCLPingReceived ( CHostAddress, int ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLPingWithNumClientsReceived ( CHostAddress, int, int ) ),
+        this, SLOT ( OnCLPingWithNumClientsReceived ( CHostAddress, int, int ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLRegisterServerReceived ( CHostAddress, CHostAddress, CServerCoreInfo ) ),
+        this, SLOT ( OnCLRegisterServerReceived ( CHostAddress, CHostAddress, CServerCoreInfo ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLUnregisterServerReceived ( CHostAddress ) ),
+        this, SLOT ( OnCLUnregisterServerReceived ( CHostAddress ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLReqServerList ( CHostAddress ) ),
+        this, SLOT ( OnCLReqServerList ( CHostAddress ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLRegisterServerResp ( CHostAddress, ESvrRegResult ) ),
+        this, SLOT ( OnCLRegisterServerResp ( CHostAddress, ESvrRegResult ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLSendEmptyMes ( CHostAddress ) ),
+        this, SLOT ( OnCLSendEmptyMes ( CHostAddress ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLDisconnection ( CHostAddress ) ),
+        this, SLOT ( OnCLDisconnection ( CHostAddress ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLReqVersionAndOS ( CHostAddress ) ),
+        this, SLOT ( OnCLReqVersionAndOS ( CHostAddress ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLReqConnClientsList ( CHostAddress ) ),
+        this, SLOT ( OnCLReqConnClientsList ( CHostAddress ) ) );
+
+    QObject::connect ( &ServerListManager,
+       SIGNAL ( SvrRegStatusChanged() ),
+       this, SLOT ( OnSvrRegStatusChanged() ) );
+
+    QObject::connect ( QCoreApplication::instance(),
+        SIGNAL ( aboutToQuit() ),
+        this, SLOT ( OnAboutToQuit() ) );
+
+    QObject::connect ( pSignalHandler,
+        SIGNAL ( HandledSignal ( int ) ),
+        this, SLOT ( OnHandledSignal ( int ) ) );
+
+    connectChannelSignalsToServerSlots();
+
+    // start the socket (it is important to start the socket after all
+    // initializations and connections)
+    Socket.Start();
+}
+
+void CServer::connectChannelSignalsToServerSlots()
+{
+    // the channel ID is bound to the slot of each channel (the slot is
+    // called in the thread of the server object like a member slot)
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        CChannel* pCurChannel = &vecChannels[i];
+
+        pCurChannel->SetRequestNotifier ( &ChanRequestNotifier );
+
+        // send message
+        QObject::connect ( pCurChannel, &CChannel::MessReadyForSending, this,
+                           [this, i] ( CVector<uint8_t> vecMessage )
+                           { SendProtMessage ( i, vecMessage ); } );
+
+        // request connected clients list
+        QObject::connect ( pCurChannel, &CChannel::ReqConnClientsList, this,
+                           [this, i]()
+                           { CreateAndSendChanListForThisChan ( i ); } );
+
+        // channel info has changed
+        QObject::connect ( pCurChannel, &CChannel::ChanInfoHasChanged,
+                           this, &CServer::CreateAndSendChanListForAllConChannels );
+
+        // chat text received
+        QObject::connect ( pCurChannel, &CChannel::ChatTextReceived, this,
+                           [this, i] ( QString strChatText )
+                           { CreateAndSendChatTextForAllConChannels ( i, strChatText ); } );
+
+        // other mute state has changed
+        QObject::connect ( pCurChannel, &CChannel::MuteStateHasChanged, this,
+                           [this, i] ( int iOtherChanID, bool bIsMuted )
+                           { CreateOtherMuteStateChanged ( i, iOtherChanID, bIsMuted ); } );
+
+        // auto socket buffer size change
+        QObject::connect ( pCurChannel, &CChannel::ServerAutoSockBufSizeChange, this,
+                           [this, i] ( int iNNumFra )
+                           { CreateAndSendJitBufMessage ( i, iNNumFra ); } );
+
+        // gain/pan has changed
+        QObject::connect ( pCurChannel, &CChannel::GainPanChanged, this,
+                           [this, i] ( int iOtherChanID, double dNewGain, double dNewPan )
+                           { UpdateGainPan ( i, iOtherChanID, dNewGain, dNewPan ); } );
+    }
+}
+
+void CServer::CreateAndSendJitBufMessage ( const int iCurChanID,
+                                           const int iNNumFra )
+{
+    vecChannels[iCurChanID].CreateJitBufMes ( iNNumFra );
+}
+
+void CServer::UpdateGainPan ( const int    iCurChanID,
+                              const int    iOtherChanID,
+                              const double dNewGain,
+                              const double dNewPan )
+{
+    // publish the new value for the audio processing
+    GainPanMatrix.SetGainPan ( iCurChanID, iOtherChanID, dNewGain, dNewPan );
+}
+
+void CServer::SendProtMessage ( int iChID, CVector<uint8_t> vecMessage )
+{
+    // the protocol queries me to call the function to send the message
+    // send it through the network
+    Socket.SendPacket ( vecMessage, vecChannels[iChID].GetAddress() );
+}
+
+void CServer::OnNewConnection ( int          iChID,
+                                CHostAddress RecHostAddr )
+{
+    // on a new connection we query the network transport properties for the
+    // audio packets (to use the correct network block size and audio
+    // compression properties, etc.)
+    vecChannels[iChID].CreateReqNetwTranspPropsMes();
+
+    // this is a new connection, query the jitter buffer size we shall use
+    // for this client (note that at the same time on a new connection the
+    // client sends the jitter buffer size by default but maybe we have
+    // reached a state where this did not happen because of network trouble,
+    // client or server thinks that the connection was still active, etc.)
+    vecChannels[iChID].CreateReqJitBufMes();
+
+    // logging of new connected channel
+    Logging.AddNewConnection ( RecHostAddr.InetAddr );
+
+    // A new client connected to the server, the channel list
+    // at all clients have to be updated. This is done by sending
+    // a channel name request to the client which causes a channel
+    // name message to be transmitted to the server. If the server
+    // receives this message, the channel list will be automatically
+    // updated (implicitely).
+    // To make sure the protocol message is transmitted, the channel
+    // first has to be marked as connected.
+    //
+    // Usually it is not required to send the channel list to the
+    // client currently connecting since it automatically requests
+    // the channel list on a new connection (as a result, he will
+    // usually get the list twice which has no impact on functionality
+    // but will only increase the network load a tiny little bit). But
+    // in case the client thinks he is still connected but the server
+    // was restartet, it is important that we send the channel list
+    // at this place.
+    vecChannels[iChID].ResetTimeOutCounter();
+    vecChannels[iChID].CreateReqChanInfoMes();
+
+// COMPATIBILITY ISSUE
+// since old versions of the software did not implement the channel name
+// request message, we have to explicitely send the channel list here
+CreateAndSendChanListForAllConChannels();
+
+    // send welcome message (if enabled)
+    if ( !strWelcomeMessage.isEmpty() )
+    {
+        // create formated server welcome message and send it just to
+        // the client which just connected to the server
+        const QString strWelcomeMessageFormated =
+            "<b>Server Welcome Message:</b> " + strWelcomeMessage;
+
+        vecChannels[iChID].CreateChatTextMes ( strWelcomeMessageFormated );
+    }
+
+    // send licence request message (if enabled)
+    if ( eLicenceType != LT_NO_LICENCE )
+    {
+        vecChannels[iChID].CreateLicReqMes ( eLicenceType );
+    }
+
+    // send version info (for, e.g., feature activation in the client)
+    vecChannels[iChID].CreateVersionAndOSMes();
+
+    // the conversion buffers, the clock drift compensation and the bit rate
+    // controller are used by the timer thread, therefore they are reset by
+    // the timer thread before the channel is processed next time
+    vecChanResetPending[iChID].storeRelease ( 1 );
+}
+
+void CServer::OnServerFull ( CHostAddress RecHostAddr )
+{
+    // inform the calling client that no channel is free
+    ConnLessProtocol.CreateCLServerFullMes ( RecHostAddr );
+}
+
+void CServer::OnSendCLProtMessage ( CHostAddress     InetAddr,
+                                    CVector<uint8_t> vecMessage )
+{
+    // the protocol queries me to call the function to send the message
+    // send it through the network
+    Socket.SendPacket ( vecMessage, InetAddr );
+}
+
+void CServer::OnProtcolCLMessageReceived ( int              iRecID,
+                                           CVector<uint8_t> vecbyMesBodyData,
+                                           CHostAddress     RecHostAddr )
+{
+    // connection less messages are always processed
+    ConnLessProtocol.ParseConnectionLessMessageBody ( vecbyMesBodyData,
+                                                      iRecID,
+                                                      RecHostAddr );
+}
+
+void CServer::OnCLDisconnection ( CHostAddress InetAddr )
+{
+    // check if the given address is actually a client which is connected to
+    // this server, if yes, disconnect it
+    QMutexLocker locker ( &Mutex );
+
+    const int iCurChanID = FindChannel ( InetAddr );
+
+    if ( iCurChanID != INVALID_CHANNEL_ID )
+    {
+        vecChannels[iCurChanID].Disconnect();
+    }
+}
+
+void CServer::OnAboutToQuit()
+{
+    // if enabled, disconnect all clients on quit
+    if ( bDisconnectAllClientsOnQuit )
+    {
+        Mutex.lock();
+        {
+            for ( int i = 0; i < iMaxNumChannels; i++ )
+            {
+                if ( vecChannels[i].IsConnected() )
+                {
+                    ConnLessProtocol.CreateCLDisconnection ( vecChannels[i].GetAddress() );
+                }
+            }
+        }
+        Mutex.unlock(); // release mutex
+    }
+
+    Stop();
+
+    // if server was registered at the central server, unregister on shutdown
+    if ( GetServerListEnabled() )
+    {
+        UnregisterSlaveServer();
+    }
+}
+
+void CServer::OnHandledSignal ( int sigNum )
+{
+#ifdef _WIN32
+    // Windows does not actually get OnHandledSignal triggered
+    QCoreApplication::instance()->exit();
+    Q_UNUSED ( sigNum )
+#else
+    switch ( sigNum )
+    {
+
+    case SIGUSR1:
+        RequestNewRecording();
+        break;
+
+    case SIGINT:
+    case SIGTERM:
+        // This should trigger OnAboutToQuit
+        QCoreApplication::instance()->exit();
+        break;
+
+    default:
+        break;
+    }
+#endif
+}
+
+void CServer::RequestNewRecording()
+{
+    if ( bEnableRecording )
+    {
+        emit RestartRecorder();
+    }
+}
+
+void CServer::Start()
+{
+    // only start if not already running
+    if ( !IsRunning() )
+    {
+        // the encoders start with their full complexity
+        LoadGovernor.Reset();
+
+        // start timer
+        HighPrecisionTimer.Start();
+        StatReportTimer.start ( STAT_REPORT_POLL_INTERVAL_MS );
+
+        // emit start signal
+        emit Started();
+    }
+}
+
+void CServer::Stop()
+{
+    // Under Mac we have the problem that the timer shutdown might
+    // take some time and therefore we get a lot of "server stopped"
+    // entries in the log. The following condition shall prevent this.
+    // For the other OSs this should not hurt either.
+    if ( IsRunning() )
+    {
+        // stop timer and log the last published statistics reports
+        HighPrecisionTimer.Stop();
+        StatReportTimer.stop();
+        OnStatReportTimer();
+
+        // hand over the last recorded frames
+        OnRecordingNotification();
+
+        // logging (add "server stopped" logging entry)
+        Logging.AddServerStopped();
+
+        // emit stopped signal
+        emit Stopped();
+    }
+}
+
+void CServer::OnStatReportTimer()
+{
+    if ( CDecodeStatReport* pReport = DecodeStatReport.GetReadReport() )
+    {
+        Logging.AddProcessingTime ( "decode", pReport->DecodeTimeMeas );
+        Logging.AddSkippedMixes ( pReport->iNumSkippedMixes, pReport->iNumChannelMixes );
+        Logging.AddTimerStatistics ( pReport->iNumOverruns,
+                                     pReport->iNumLateWakeups,
+                                     pReport->iNumSkippedFrames );
+        Logging.AddSeqNumStatistics ( pReport->SeqStatistic );
+        DecodeStatReport.Release();
+    }
+
+    if ( CSendStatReport* pReport = SendStatReport.GetReadReport() )
+    {
+        Logging.AddProcessingTime ( "send", pReport->SendTimeMeas );
+        Logging.AddSendStatistics ( pReport->iNumSentPackets,
+                                    pReport->iNumSysCalls,
+                                    pReport->SendTimeMeas.GetNumFrames() );
+        SendStatReport.Release();
+    }
+
+    if ( CLoadGovStatReport* pReport = LoadGovStatReport.GetReadReport() )
+    {
+        Logging.AddLoadGovernorStatistics ( pReport->dAvLoadPercent,
+                                            pReport->dMaxLoadPercent,
+                                            pReport->dShedLevel,
+                                            pReport->iNumShedSteps,
+                                            pReport->iNumRestoreSteps,
+                                            pReport->vecdSumNumEncoders,
+                                            pReport->iNumFrames );
+        LoadGovStatReport.Release();
+    }
+}
+
+void CServer::OnRecordingNotification()
+{
+    CRecordingQueue::CEntry* pEntry;
+
+    while ( ( pEntry = RecordingQueue.GetReadEntry() ) != nullptr )
+    {
+        if ( pEntry->bIsDisconnected )
+        {
+            emit ClientDisconnected ( pEntry->iChID );
+        }
+        else
+        {
+            emit AudioFrame ( pEntry->iChID,
+                              vecChannels[pEntry->iChID].GetName(),
+                              vecChannels[pEntry->iChID].GetAddress(),
+                              pEntry->iNumAudChan,
+                              pEntry->vecsData );
+        }
+
+        RecordingQueue.Release();
+    }
+}
+
+void CServer::OnChanRequestNotification()
+{
+    // the channels do not tell which of them has a pending request
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        vecChannels[i].ProcessPendingRequests();
+    }
+}
+
+void CServer::OnTimer()
+{
+    int i, j;
+
+/*
+// TEST do a timer jitter measurement
 static CTimingMeas JitterMeas ( 1000, "test2.dat" );
 JitterMeas.Measure();
 */
 
-    // Get data from all connected clients -------------------------------------
-    // some inits
-    int  iNumClients               = 0; // init connected client counter
-    bool bChannelIsNowDisconnected = false;
-    bool bSendChannelLevels        = false;
+    // Get data from all connected clients -------------------------------------
+    // some inits
+    int  iNumClients               = 0; // init connected client counter
+    bool bChannelIsNowDisconnected = false;
+    bool bConChanListChanged       = false;
+    bool bSendChannelLevels        = false;
+
+    // the processing of a frame must not allocate memory (except of the
+    // state changes which are excluded below)
+    CRtAllocGuardScope RtAllocGuardScope ( RG_TIMER_THREAD );
+
+    DecodeTimeMeas.Start();
+
+    // the processing time of the complete frame is the input of the load
+    // governor
+    if ( bUseLoadGovernor )
+    {
+        FrameTimer.start();
+    }
+
+    // Make put and get calls thread safe. Do not forget to unlock mutex
+    // afterwards!
+    Mutex.lock();
+    {
+        // first, get number and IDs of connected channels
+        for ( i = 0; i < iMaxNumChannels; i++ )
+        {
+            if ( vecChannels[i].IsConnected() )
+            {
+                // add ID and increment counter (note that the vector length is
+                // according to the worst case scenario, if the number of
+                // connected clients is less, only a subset of elements of this
+                // vector are actually used and the others are dummy elements)
+                if ( vecChanIDsCurConChan[iNumClients] != i )
+                {
+                    bConChanListChanged = true;
+                }
+
+                vecChanIDsCurConChan[iNumClients] = i;
+                iNumClients++;
+            }
+            else
+            {
+                // return the codecs of a disconnected channel to the pool
+                UpdateChannelCodecs ( i, CT_NONE, 0 );
+                vecMixSourceChanIDs[i] = INVALID_CHANNEL_ID;
+            }
+        }
+
+        if ( iNumClients != iPrevNumClients )
+        {
+            bConChanListChanged = true;
+        }
+
+        iPrevNumClients = iNumClients;
+
+        // get the fade-in gains of all connected channels
+        bool bFadeInActive = false;
+
+        for ( i = 0; i < iNumClients; i++ )
+        {
+            vecdFadeInGains[i] = vecChannels[vecChanIDsCurConChan[i]].GetFadeInGain();
+
+            if ( vecdFadeInGains[i] != static_cast<double> ( 1.0 ) )
+            {
+                bFadeInActive = true;
+            }
+        }
+
+        // The gains/pannings are only updated if a fader was changed, the
+        // connected channels have changed or a fade-in is in progress (the
+        // frame after the fade-in is finished needs an update, too). Note
+        // that the matrix update must be done in every frame to get the
+        // latest published matrix.
+        const bool bUpdateGains = GainPanMatrix.Update() || bConChanListChanged ||
+                                  bFadeInActive || bFadeInWasActive;
+
+        bFadeInWasActive = bFadeInActive;
+
+        // process connected channels
+        for ( i = 0; i < iNumClients; i++ )
+        {
+            // get actual ID of current channel
+            const int iCurChanID = vecChanIDsCurConChan[i];
+
+            // get and store number of audio channels and compression type
+            vecNumAudioChannels[i] = vecChannels[iCurChanID].GetNumAudioChannels();
+            vecAudioComprType[i]   = vecChannels[iCurChanID].GetAudioCompressionType();
+
+            // get the codecs of the negotiated variant (nothing will happen if
+            // the variant stays the same)
+            UpdateChannelCodecs ( iCurChanID, vecAudioComprType[i], vecNumAudioChannels[i] );
+
+            // reset the processing state of a new connection (requested by the
+            // main thread)
+            if ( vecChanResetPending[iCurChanID].fetchAndStoreOrdered ( 0 ) != 0 )
+            {
+                DoubleFrameSizeConvBufIn[iCurChanID].Reset();
+                DoubleFrameSizeConvBufOut[iCurChanID].Reset();
+                DoubleFrameSizeConvBufInFloat[iCurChanID].Reset();
+                DoubleFrameSizeConvBufOutFloat[iCurChanID].Reset();
+
+                if ( bUseDriftComp )
+                {
+                    DriftComp[iCurChanID].Reset();
+                }
+
+                // a new client starts with the bit rate it requested
+                BitRateCtrl[iCurChanID].Reset();
+            }
+
+            // get info about required frame size conversion properties
+            vecUseDoubleSysFraSizeConvBuf[i] = ( !bUseDoubleSystemFrameSize && ( vecAudioComprType[i] == CT_OPUS ) );
+
+            if ( bUseDoubleSystemFrameSize && ( vecAudioComprType[i] == CT_OPUS64 ) )
+            {
+                vecNumFrameSizeConvBlocks[i] = 2;
+            }
+            else
+            {
+                vecNumFrameSizeConvBlocks[i] = 1;
+            }
+
+            // update conversion buffer size (nothing will happen if the size stays the same)
+            if ( vecUseDoubleSysFraSizeConvBuf[i] )
+            {
+                if ( bUseFloatAudio )
+                {
+                    DoubleFrameSizeConvBufInFloat[iCurChanID].SetBufferSize  ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
+                    DoubleFrameSizeConvBufOutFloat[iCurChanID].SetBufferSize ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
+                }
+                else
+                {
+                    DoubleFrameSizeConvBufIn[iCurChanID].SetBufferSize  ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
+                    DoubleFrameSizeConvBufOut[iCurChanID].SetBufferSize ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
+                }
+            }
+
+            // get gains of all connected channels from the gain/pan matrix
+            if ( bUpdateGains )
+            {
+                const double* pdMatrixGains    = GainPanMatrix.GetGains ( iCurChanID );
+                const double* pdMatrixPannings = GainPanMatrix.GetPannings ( iCurChanID );
+                double*       pdGains          = vecvecdGains[i];
+                double*       pdPannings       = vecvecdPannings[i];
+
+                for ( j = 0; j < iNumClients; j++ )
+                {
+                    // The second index of "vecvecdGains" does not represent
+                    // the channel ID! Therefore we have to use
+                    // "vecChanIDsCurConChan" to query the IDs of the currently
+                    // connected channels
+                    const int iOtherChanID = vecChanIDsCurConChan[j];
+
+                    // consider audio fade-in
+                    pdGains[j] = pdMatrixGains[iOtherChanID] * vecdFadeInGains[j];
+
+                    // panning
+                    pdPannings[j] = pdMatrixPannings[iOtherChanID];
+                }
+            }
+        }
+    }
+    Mutex.unlock(); // release mutex
+
+    // The channel buffers and the decoders are only accessed by the server
+    // timer, therefore the decoding is done without having the global mutex
+    // locked (the jitter buffer of the channel is lock-free), optionally in
+    // parallel for all channels. The receive threads are not blocked by the
+    // decoding.
+    if ( bUseParallelDecode )
+    {
+        WorkerPool.Run ( &DecodeReceiveJob, iNumClients );
+    }
+    else
+    {
+        for ( i = 0; i < iNumClients; i++ )
+        {
+            DecodeReceiveData ( i, 0 );
+        }
+    }
+
+    // processing time statistics of the decoding (if enabled)
+    if ( DecodeTimeMeas.IsEnabled() )
+    {
+        DecodeTimeMeas.Stop ( iNumClients );
+
+        CDecodeStatReport* pReport;
+
+        if ( DecodeTimeMeas.IsReportReady() &&
+             ( ( pReport = DecodeStatReport.GetWriteReport() ) != nullptr ) )
+        {
+            pReport->DecodeTimeMeas = DecodeTimeMeas;
+            DecodeTimeMeas.Reset();
+
+            // the skipped mixes and the timer statistics are reported in the
+            // same interval
+            pReport->iNumSkippedMixes  = iSumSkippedMixes;
+            pReport->iNumChannelMixes  = iSumChannelMixes;
+            pReport->iNumOverruns      = HighPrecisionTimer.GetNumOverruns();
+            pReport->iNumLateWakeups   = HighPrecisionTimer.GetNumLateWakeups();
+            pReport->iNumSkippedFrames = HighPrecisionTimer.GetNumSkippedFrames();
+            iSumSkippedMixes = 0;
+            iSumChannelMixes = 0;
+
+            // sum of the sequence number statistics of the jitter buffers of
+            // all connected clients (maximum of the jitter)
+            CNetBufSeqStatistic& SeqStatistic = pReport->SeqStatistic;
+
+            SeqStatistic = CNetBufSeqStatistic();
+
+            for ( i = 0; i < iNumClients; i++ )
+            {
+                const CNetBufSeqStatistic ChanSeqStatistic =
+                    vecChannels[vecChanIDsCurConChan[i]].GetAndResetSeqStatistic();
+
+                SeqStatistic.iNumReceived  += ChanSeqStatistic.iNumReceived;
+                SeqStatistic.iNumLost      += ChanSeqStatistic.iNumLost;
+                SeqStatistic.iNumReordered += ChanSeqStatistic.iNumReordered;
+                SeqStatistic.iNumLate      += ChanSeqStatistic.iNumLate;
+                SeqStatistic.iNumDuplicate += ChanSeqStatistic.iNumDuplicate;
+                SeqStatistic.iNumRecovered += ChanSeqStatistic.iNumRecovered;
+                SeqStatistic.iJitterUs      = std::max ( SeqStatistic.iJitterUs, ChanSeqStatistic.iJitterUs );
+            }
+
+            DecodeStatReport.Publish();
+        }
+    }
+
+    // check if a channel was just disconnected
+    for ( i = 0; i < iNumClients; i++ )
+    {
+        if ( vecChannelIsNowDisconnected[i] != 0 )
+        {
+            CRecordingQueue::CEntry* pEntry;
+
+            if ( bEnableRecording &&
+                 ( ( pEntry = RecordingQueue.GetWriteEntry ( true ) ) != nullptr ) )
+            {
+                pEntry->iChID = vecChanIDsCurConChan[i];
+
+                RecordingQueue.Publish();
+                RecordingNotifier.Notify();
+            }
+
+            bChannelIsNowDisconnected = true;
+        }
+    }
+
+    // a channel is now disconnected, take action on it (the protocol must
+    // only be used in the main thread)
+    if ( bChannelIsNowDisconnected )
+    {
+        CRtAllocGuardPause RtAllocGuardPause;
+
+        QCoreApplication::postEvent ( this,
+            new CCustomEvent ( MS_CHANNEL_DISCONNECTED, 0, 0 ) );
+    }
+
+
+    // Process data ------------------------------------------------------------
+    // Check if at least one client is connected. If not, stop server until
+    // one client is connected.
+    if ( iNumClients > 0 )
+    {
+        // low frequency updates
+        if ( iFrameCount > CHANNEL_LEVEL_UPDATE_INTERVAL )
+        {
+            iFrameCount = 0;
+
+            // Calculate channel levels if any client has requested them
+            for ( int i = 0; i < iNumClients; i++ )
+            {
+                if ( vecChannels[vecChanIDsCurConChan[i]].ChannelLevelsRequired() )
+                {
+                    bSendChannelLevels = true;
+
+                    if ( bUseFloatAudio )
+                    {
+                        CreateLevelsForAllConChannels ( iNumClients,
+                                                        vecNumAudioChannels,
+                                                        vecvecfData,
+                                                        FLOAT_TO_SHORT_SCALE,
+                                                        vecChannelLevels );
+                    }
+                    else
+                    {
+                        CreateLevelsForAllConChannels ( iNumClients,
+                                                        vecNumAudioChannels,
+                                                        vecvecsData,
+                                                        1.0,
+                                                        vecChannelLevels );
+                    }
+                    break;
+                }
+            }
+        }
+        iFrameCount++;
+        if ( bUseDoubleSystemFrameSize )
+        {
+            // additional increment needed for double frame size to get to the same time interval
+            iFrameCount++;
+        }
+
+        // export the audio data for recording purpose (the frames are copied
+        // in the preallocated recording queue and emitted by the main thread)
+        if ( bEnableRecording )
+        {
+            for ( int i = 0; i < iNumClients; i++ )
+            {
+                CRecordingQueue::CEntry* pEntry = RecordingQueue.GetWriteEntry ( false );
+
+                if ( pEntry == nullptr )
+                {
+                    break;
+                }
+
+                // the recorder needs short samples
+                if ( bUseFloatAudio )
+                {
+                    for ( int k = 0; k < iServerFrameSizeSamples * vecNumAudioChannels[i]; k++ )
+                    {
+                        vecvecsData[i][k] = Double2Short ( vecvecfData[i][k] * FLOAT_TO_SHORT_SCALE );
+                    }
+                }
+
+                std::copy ( vecvecsData[i],
+                            vecvecsData[i] + vecvecsData.RowLength(),
+                            pEntry->vecsData.begin() );
+
+                pEntry->iChID       = vecChanIDsCurConChan[i];
+                pEntry->iNumAudChan = vecNumAudioChannels[i];
+
+                RecordingQueue.Publish();
+            }
+
+            RecordingNotifier.Notify();
+        }
+
+        // reset the statistics of the skipped mixes of the current frame
+        iNumChannelMixes = 0;
+        iNumSkippedMixes = 0;
+        vecNumChannelMixes.Reset ( 0 );
+        vecNumSkippedMixes.Reset ( 0 );
+
+        // clients which did not change the default gains/pannings get a mix
+        // which is derived from a shared mix of all clients
+        PrepareSharedMixes ( iNumClients );
+
+        // clients with identical mix settings get the same encoded audio
+        const int iNumMixGroups = GroupClientsByMixSettings ( iNumClients );
+
+        // reduce the encoder complexity if the server is near its limit
+        if ( bUseLoadGovernor )
+        {
+            ShedEncoderComplexity ( iNumMixGroups );
+        }
+
+        // generate a separate mix for each group of channels, encode and send
+        // it (the work is distributed on the worker threads, if enabled)
+        iCurNumClients = iNumClients;
+        WorkerPool.Run ( &MixEncodeTransmitJob, iNumMixGroups );
+
+        // send the packets of all clients with as few system calls as possible
+        SendTimeMeas.Start();
+        Socket.SendBatch ( SendBatch );
+
+        if ( SendTimeMeas.IsEnabled() )
+        {
+            SendTimeMeas.Stop ( iNumClients );
+
+            // the measurement restarts if the number of clients has changed
+            if ( SendTimeMeas.GetNumFrames() == 1 )
+            {
+                iSumSentPackets  = 0;
+                iSumSendSysCalls = 0;
+            }
+
+            iSumSentPackets  += SendBatch.GetNumSentPackets();
+            iSumSendSysCalls += SendBatch.GetNumSysCalls();
+
+            CSendStatReport* pReport;
+
+            if ( SendTimeMeas.IsReportReady() &&
+                 ( ( pReport = SendStatReport.GetWriteReport() ) != nullptr ) )
+            {
+                pReport->SendTimeMeas    = SendTimeMeas;
+                pReport->iNumSentPackets = iSumSentPackets;
+                pReport->iNumSysCalls    = iSumSendSysCalls;
+                SendStatReport.Publish();
+
+                SendTimeMeas.Reset();
+                iSumSentPackets  = 0;
+                iSumSendSysCalls = 0;
+            }
+        }
+
+        for ( int i = 0; i < WorkerPool.GetNumThreads(); i++ )
+        {
+            iNumChannelMixes += vecNumChannelMixes[i][0];
+            iNumSkippedMixes += vecNumSkippedMixes[i][0];
+        }
+
+        iLastNumSkippedMixes.storeRelease ( iNumSkippedMixes );
+
+        if ( DecodeTimeMeas.IsEnabled() )
+        {
+            iSumChannelMixes += iNumChannelMixes;
+            iSumSkippedMixes += iNumSkippedMixes;
+        }
+
+        // the channel level message is the same for all clients, it is
+        // generated once in preallocated buffers and sent directly (the
+        // connected channels are sorted by their IDs, therefore the older
+        // clients get the first levels, a separate message is only needed if
+        // there are channels they do not know)
+        int iNumLevelsLegacy = 0;
+
+        while ( ( iNumLevelsLegacy < iNumClients ) &&
+                ( vecChanIDsCurConChan[iNumLevelsLegacy] < MAX_NUM_CHANNELS_LEGACY ) )
+        {
+            iNumLevelsLegacy++;
+        }
+
+        if ( bSendChannelLevels )
+        {
+            ConnLessProtocol.GenCLChannelLevelListMes ( vecbyChanLevelMes,
+                                                        vecbyChanLevelMesData,
+                                                        vecChannelLevels,
+                                                        iNumClients );
+
+            if ( iNumLevelsLegacy < iNumClients )
+            {
+                ConnLessProtocol.GenCLChannelLevelListMes ( vecbyChanLevelMesLegacy,
+                                                            vecbyChanLevelMesDataLegacy,
+                                                            vecChannelLevels,
+                                                            iNumLevelsLegacy );
+            }
+        }
+
+        // the following functions emit signals or use the protocol and
+        // therefore must not be called in the worker threads
+        for ( int i = 0; i < iNumClients; i++ )
+        {
+            if ( vecFrameTransmitted[i] != 0 )
+            {
+                // get actual ID of current channel
+                const int iCurChanID = vecChanIDsCurConChan[i];
+
+                // update socket buffer size
+                vecChannels[iCurChanID].UpdateSocketBufferSize();
+
+                // adapt the size of the audio sent to the client to the
+                // congestion state of its network path which is reported by
+                // the client
+                if ( bUseAdaptiveBitRate )
+                {
+                    int iNumReceived, iNumLost;
+
+                    if ( vecChannels[iCurChanID].GetDownstreamStatistic ( iNumReceived, iNumLost ) )
+                    {
+                        BitRateCtrl[iCurChanID].Update ( iNumReceived, iNumLost );
+                    }
+
+                    vecChannels[iCurChanID].SetDownstreamNetwFrameSize (
+                        BitRateCtrl[iCurChanID].GetNetwFrameSize ( vecChannels[iCurChanID].GetNetwFrameSize() ) );
+                }
+
+                // send channel levels
+                if ( bSendChannelLevels && vecChannels[iCurChanID].ChannelLevelsRequired() )
+                {
+                    Socket.SendPacket ( ( vecChannels[iCurChanID].SupportsManyChannels() || ( iNumLevelsLegacy == iNumClients ) ) ?
+                                        vecbyChanLevelMes : vecbyChanLevelMesLegacy,
+                                        vecChannels[iCurChanID].GetAddress() );
+                }
+            }
+        }
+
+        if ( bUseLoadGovernor )
+        {
+            LoadGovernor.Update ( FrameTimer.nsecsElapsed() );
+
+            CLoadGovStatReport* pReport;
+
+            if ( LoadGovernor.IsReportReady() &&
+                 ( ( pReport = LoadGovStatReport.GetWriteReport() ) != nullptr ) )
+            {
+                pReport->dAvLoadPercent   = LoadGovernor.GetAvLoadPercent();
+                pReport->dMaxLoadPercent  = LoadGovernor.GetMaxLoadPercent();
+                pReport->dShedLevel       = LoadGovernor.GetShedLevel();
+                pReport->iNumShedSteps    = LoadGovernor.GetNumShedSteps();
+                pReport->iNumRestoreSteps = LoadGovernor.GetNumRestoreSteps();
+                pReport->iNumFrames       = LoadGovernor.GetNumFrames();
+
+                // the vectors have the same size, the copy does not allocate
+                std::copy ( LoadGovernor.GetSumNumEncoders().begin(),
+                            LoadGovernor.GetSumNumEncoders().end(),
+                            pReport->vecdSumNumEncoders.begin() );
+
+                LoadGovStatReport.Publish();
+                LoadGovernor.ResetStatistic();
+            }
+        }
+    }
+    else
+    {
+        // Disable server if no clients are connected. In this case the server
+        // does not consume any significant CPU when no client is connected.
+        // The timer thread cannot stop itself, therefore this is done in the
+        // main thread (only post one event until it is processed).
+        if ( iStopRequested.testAndSetOrdered ( 0, 1 ) )
+        {
+            CRtAllocGuardPause RtAllocGuardPause;
+
+            QCoreApplication::postEvent ( this,
+                new CCustomEvent ( MS_NO_CLIENTS_CONNECTED, 0, 0 ) );
+        }
+    }
+}
 
-    // Make put and get calls thread safe. Do not forget to unlock mutex
-    // afterwards!
-    Mutex.lock();
+void CServer::UpdateChannelCodecs ( const int           iChanID,
+                                   const EAudComprType eAudComprType,
+                                   const int           iNumAudChan )
+{
+    const bool bVariantChanged = ( eChanCodecComprType[iChanID] != eAudComprType ) ||
+                                 ( iChanCodecNumAudChan[iChanID] != iNumAudChan );
+
+    // a channel of a supported variant without codecs is still waiting for
+    // the main thread to create spare codecs
+    const bool bCodecsMissing = ( pChanOpusEncoder[iChanID] == nullptr ) &&
+                                COpusCodecPool::IsSupported ( eAudComprType );
+
+    if ( !bVariantChanged && !bCodecsMissing )
     {
-        // first, get number and IDs of connected channels
-        for ( i = 0; i < iMaxNumChannels; i++ )
+        return;
+    }
+
+    if ( bVariantChanged )
+    {
+        OpusCodecPool.ReleaseCodecs ( pChanOpusEncoder[iChanID],
+                                      pChanOpusDecoder[iChanID],
+                                      eChanCodecComprType[iChanID],
+                                      iChanCodecNumAudChan[iChanID] );
+
+        pChanOpusEncoder[iChanID]     = nullptr;
+        pChanOpusDecoder[iChanID]     = nullptr;
+        eChanCodecComprType[iChanID]  = eAudComprType;
+        iChanCodecNumAudChan[iChanID] = iNumAudChan;
+    }
+
+    // the pool never allocates memory in the timer thread, if it has no codec
+    // of the variant right now the channel stays without codecs (its audio is
+    // replaced by silence and is not mixed, no audio is sent to it) and it is
+    // tried again in the next frame
+    if ( COpusCodecPool::IsSupported ( eAudComprType ) &&
+         !OpusCodecPool.GetCodecs ( eAudComprType, iNumAudChan, pChanOpusEncoder[iChanID], pChanOpusDecoder[iChanID] ) )
+    {
+        pChanOpusEncoder[iChanID] = nullptr;
+        pChanOpusDecoder[iChanID] = nullptr;
+    }
+
+    // the encoder may have been used by another channel with other settings,
+    // therefore the bit rate and the complexity must be set again
+    pLastUsedEncoder[iChanID] = nullptr;
+}
+
+void CServer::DecodeReceiveData ( const int iClientIdx,
+                                  const int iThreadID )
+{
+    int                iClientFrameSizeSamples = 0; // initialize to avoid a compiler warning
+    OpusCustomDecoder* CurOpusDecoder;
+
+    // get actual ID of current channel
+    const int iCurChanID = vecChanIDsCurConChan[iClientIdx];
+
+    // get number of audio channels of current channel
+    const int iCurNumAudChan = vecNumAudioChannels[iClientIdx];
+
+    // init the flag which indicates that the channel was just disconnected
+    vecChannelIsNowDisconnected[iClientIdx] = 0;
+
+    // select the raw audio frame length, the decoder of the negotiated codec
+    // variant was assigned to the channel by the timer thread (it is a null
+    // pointer if no codec is negotiated or the pool has no codec available yet)
+    if ( vecAudioComprType[iClientIdx] == CT_OPUS )
+    {
+        iClientFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+    }
+    else if ( vecAudioComprType[iClientIdx] == CT_OPUS64 )
+    {
+        iClientFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+    }
+
+    CurOpusDecoder = pChanOpusDecoder[iCurChanID];
+
+    if ( bUseDriftComp )
+    {
+        // the drift compensator converts the client frame size to the server
+        // frame size, therefore the conversion buffers are not used here
+        CDriftCompensator& CurDriftComp = DriftComp[iCurChanID];
+
+        CurDriftComp.SetNumChannels ( iCurNumAudChan );
+
+        // decode new client frames until the resampler has enough input data
+        // (the number of decoded frames per server frame is limited so that
+        // the processing time is bounded)
+        const int iNumClientFrameSamples = iClientFrameSizeSamples * vecNumFrameSizeConvBlocks[iClientIdx];
+
+        for ( int iDec = 0; ( iDec < DRIFT_COMP_MAX_NUM_DECODES ) &&
+                            CurDriftComp.IsInputRequired ( iServerFrameSizeSamples ); iDec++ )
         {
-            if ( vecChannels[i].IsConnected() )
+            GetAndDecodeClientFrame ( iClientIdx, iThreadID, CurOpusDecoder, iClientFrameSizeSamples );
+
+            if ( bUseFloatAudio )
             {
-                // add ID and increment counter (note that the vector length is
-                // according to the worst case scenario, if the number of
-                // connected clients is less, only a subset of elements of this
-                // vector are actually used and the others are dummy elements)
-                vecChanIDsCurConChan[iNumClients] = i;
-                iNumClients++;
+                CurDriftComp.Put ( vecvecfData[iClientIdx], iNumClientFrameSamples );
+            }
+            else
+            {
+                CurDriftComp.Put ( vecvecsData[iClientIdx], iNumClientFrameSamples );
             }
         }
 
-        // process connected channels
-        for ( i = 0; i < iNumClients; i++ )
+        if ( bUseFloatAudio )
         {
-            // get actual ID of current channel
-            const int iCurChanID = vecChanIDsCurConChan[i];
+            CurDriftComp.Get ( vecvecfData[iClientIdx], iServerFrameSizeSamples );
+        }
+        else
+        {
+            CurDriftComp.Get ( vecvecsData[iClientIdx], iServerFrameSizeSamples );
+        }
+    }
+    else
+    {
+        // If the server frame size is smaller than the received OPUS frame size, we need a conversion
+        // buffer which stores the large buffer.
+        // Note that we have a shortcut here. If the conversion buffer is not needed, the boolean flag
+        // is false and the Get() function is not called at all. Therefore if the buffer is not needed
+        // we do not spend any time in the function but go directly inside the if condition.
+        if ( ( vecUseDoubleSysFraSizeConvBuf[iClientIdx] == 0 ) ||
+             ( bUseFloatAudio ?
+               !DoubleFrameSizeConvBufInFloat[iCurChanID].Get ( vecvecfData[iClientIdx], SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan ) :
+               !DoubleFrameSizeConvBufIn[iCurChanID].Get ( vecvecsData[iClientIdx], SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan ) ) )
+        {
+            GetAndDecodeClientFrame ( iClientIdx, iThreadID, CurOpusDecoder, iClientFrameSizeSamples );
 
-            // get and store number of audio channels and compression type
-            vecNumAudioChannels[i] = vecChannels[iCurChanID].GetNumAudioChannels();
-            vecAudioComprType[i]   = vecChannels[iCurChanID].GetAudioCompressionType();
+            // a new large frame is ready, if the conversion buffer is required, put it in the buffer
+            // and read out the small frame size immediately for further processing
+            if ( vecUseDoubleSysFraSizeConvBuf[iClientIdx] != 0 )
+            {
+                if ( bUseFloatAudio )
+                {
+                    DoubleFrameSizeConvBufInFloat[iCurChanID].PutAll ( vecvecfData[iClientIdx] );
+                    DoubleFrameSizeConvBufInFloat[iCurChanID].Get ( vecvecfData[iClientIdx], SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan );
+                }
+                else
+                {
+                    DoubleFrameSizeConvBufIn[iCurChanID].PutAll ( vecvecsData[iClientIdx] );
+                    DoubleFrameSizeConvBufIn[iCurChanID].Get ( vecvecsData[iClientIdx], SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan );
+                }
+            }
+        }
+    }
 
-            // get info about required frame size conversion properties
-            vecUseDoubleSysFraSizeConvBuf[i] = ( !bUseDoubleSystemFrameSize && ( vecAudioComprType[i] == CT_OPUS ) );
+    // a channel without a decoder (no codec negotiated or the pool had no
+    // codec available yet) is silent and is not mixed
+    if ( CurOpusDecoder == nullptr )
+    {
+        if ( bUseFloatAudio )
+        {
+            std::fill_n ( vecvecfData[iClientIdx], iServerFrameSizeSamples * iCurNumAudChan, 0.0f );
+        }
+        else
+        {
+            std::fill_n ( vecvecsData[iClientIdx], iServerFrameSizeSamples * iCurNumAudChan, static_cast<int16_t> ( 0 ) );
+        }
 
-            if ( bUseDoubleSystemFrameSize && ( vecAudioComprType[i] == CT_OPUS64 ) )
+        vecChannelIsActive[iClientIdx] = 0;
+        return;
+    }
+
+    // check if the channel is silent in the current frame (e.g. muted
+    // microphone or a listener only) so that it can be skipped in the mixes
+    if ( bUseFloatAudio )
+    {
+        vecChannelIsActive[iClientIdx] = HasSignalAboveThreshold ( vecvecfData[iClientIdx],
+                                                                   iServerFrameSizeSamples * iCurNumAudChan,
+                                                                   SILENCE_PEAK_THRESHOLD / FLOAT_TO_SHORT_SCALE ) ? 1 : 0;
+    }
+    else
+    {
+        vecChannelIsActive[iClientIdx] = HasSignalAboveThreshold ( vecvecsData[iClientIdx],
+                                                                   iServerFrameSizeSamples * iCurNumAudChan,
+                                                                   static_cast<int16_t> ( SILENCE_PEAK_THRESHOLD ) ) ? 1 : 0;
+    }
+}
+
+EMixType CServer::GetMixType ( const int iClientIdx,
+                              const int iNumClients ) const
+{
+    // the panning is only relevant for stereo clients
+    const bool bIsStereo = ( vecNumAudioChannels[iClientIdx] == 2 );
+
+    for ( int j = 0; j < iNumClients; j++ )
+    {
+        // the own channel is checked separately
+        if ( ( j != iClientIdx ) &&
+             ( ( vecvecdGains[iClientIdx][j] != static_cast<double> ( 1.0 ) ) ||
+               ( bIsStereo && ( vecvecdPannings[iClientIdx][j] != static_cast<double> ( 0.5 ) ) ) ) )
+        {
+            return MT_INDIVIDUAL;
+        }
+    }
+
+    // all other channels have default settings, check the own channel
+    if ( vecvecdGains[iClientIdx][iClientIdx] == static_cast<double> ( 0.0 ) )
+    {
+        return MT_ALL_BUT_OWN;
+    }
+
+    if ( ( vecvecdGains[iClientIdx][iClientIdx] == static_cast<double> ( 1.0 ) ) &&
+         ( !bIsStereo || ( vecvecdPannings[iClientIdx][iClientIdx] == static_cast<double> ( 0.5 ) ) ) )
+    {
+        return MT_ALL;
+    }
+
+    return MT_INDIVIDUAL;
+}
+
+
+void CServer::GetAndDecodeClientFrame ( const int          iClientIdx,
+                                        const int          iThreadID,
+                                        OpusCustomDecoder* CurOpusDecoder,
+                                        const int          iClientFrameSizeSamples )
+{
+    int            iUnused;
+    unsigned char* pCurCodedData;
+
+    // get the temporary buffer of the current thread
+    CVector<uint8_t>& vecbyCodedData = vecvecbyCodedData[iThreadID];
+
+    // get actual ID of current channel
+    const int iCurChanID = vecChanIDsCurConChan[iClientIdx];
+
+    // get number of audio channels of current channel
+    const int iCurNumAudChan = vecNumAudioChannels[iClientIdx];
+
+    // get current number of OPUS coded bytes
+    const int iCeltNumCodedBytes = vecChannels[iCurChanID].GetNetwFrameSize();
+
+    for ( int iB = 0; iB < vecNumFrameSizeConvBlocks[iClientIdx]; iB++ )
+    {
+        // get data
+        const EGetDataStat eGetStat = vecChannels[iCurChanID].GetData ( vecbyCodedData, iCeltNumCodedBytes );
+
+        // the jitter buffer fill level is the input of the clock drift
+        // estimation
+        if ( bUseDriftComp )
+        {
+            DriftComp[iCurChanID].UpdateFillLevel ( vecChannels[iCurChanID].GetSockBufFillLevel(),
+                                                    vecChannels[iCurChanID].GetSockBufNumFrames(),
+                                                    iClientFrameSizeSamples );
+        }
+
+        // if channel was just disconnected, set flag that connected
+        // client list is sent to all other clients
+        if ( eGetStat == GS_CHAN_NOW_DISCONNECTED )
+        {
+            vecChannelIsNowDisconnected[iClientIdx] = 1;
+        }
+
+        // get pointer to coded data
+        if ( eGetStat == GS_BUFFER_OK )
+        {
+            pCurCodedData = &vecbyCodedData[0];
+        }
+        else
+        {
+            // for lost packets use null pointer as coded input data
+            pCurCodedData = nullptr;
+        }
+
+        // OPUS decode received data stream
+        if ( CurOpusDecoder != nullptr )
+        {
+            if ( bUseFloatAudio )
             {
-                vecNumFrameSizeConvBlocks[i] = 2;
+                iUnused = opus_custom_decode_float ( CurOpusDecoder,
+                                                     pCurCodedData,
+                                                     iCeltNumCodedBytes,
+                                                     &vecvecfData[iClientIdx][iB * SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan],
+                                                     iClientFrameSizeSamples );
             }
             else
             {
-                vecNumFrameSizeConvBlocks[i] = 1;
+                iUnused = opus_custom_decode ( CurOpusDecoder,
+                                               pCurCodedData,
+                                               iCeltNumCodedBytes,
+                                               &vecvecsData[iClientIdx][iB * SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan],
+                                               iClientFrameSizeSamples );
             }
-
-            // update conversion buffer size (nothing will happen if the size stays the same)
-            if ( vecUseDoubleSysFraSizeConvBuf[i] )
+        }
+        else
+        {
+            // without a decoder the frame is silent (the row may still hold
+            // the audio of the client which had this index before)
+            if ( bUseFloatAudio )
             {
-                DoubleFrameSizeConvBufIn[iCurChanID].SetBufferSize  ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
-                DoubleFrameSizeConvBufOut[iCurChanID].SetBufferSize ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
+                std::fill_n ( &vecvecfData[iClientIdx][iB * SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan],
+                              iClientFrameSizeSamples * iCurNumAudChan, 0.0f );
             }
+            else
+            {
+                std::fill_n ( &vecvecsData[iClientIdx][iB * SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan],
+                              iClientFrameSizeSamples * iCurNumAudChan, static_cast<int16_t> ( 0 ) );
+            }
+        }
+    }
+
+    Q_UNUSED ( iUnused )
+}
+
+void CServer::PrepareSharedMixes ( const int iNumClients )
+{
+    bool bSharedMixRequired[2] = { false, false };
+
+    // find out which clients can use the shared mix
+    for ( int i = 0; i < iNumClients; i++ )
+    {
+        vecMixType[i] = GetMixType ( i, iNumClients );
+
+        if ( vecMixType[i] != MT_INDIVIDUAL )
+        {
+            bSharedMixRequired[vecNumAudioChannels[i] - 1] = true;
+        }
+    }
 
-            // select the opus decoder and raw audio frame length
-            if ( vecAudioComprType[i] == CT_OPUS )
+    // The shared mix is only calculated once per frame for each number of
+    // audio channels (mono/stereo) and is used by all clients with default
+    // settings. Since the sum of the short samples is exact in float, the
+    // result is the same as for an individual mix (in the float audio mode
+    // the result may differ by rounding errors only).
+    for ( int iCh = 0; iCh < 2; iCh++ )
+    {
+        if ( bSharedMixRequired[iCh] )
+        {
+            CVector<float>& vecfSharedMix = vecvecfSharedMix[iCh];
+
+            std::fill ( vecfSharedMix.begin(), vecfSharedMix.begin() + iServerFrameSizeSamples * ( iCh + 1 ), 0.0f );
+
+            for ( int j = 0; j < iNumClients; j++ )
             {
-                iClientFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+                iNumChannelMixes++;
 
-                if ( vecNumAudioChannels[i] == 1 )
+                // silent channels are not mixed
+                if ( vecChannelIsActive[j] == 0 )
                 {
-                    CurOpusDecoder = OpusDecoderMono[iCurChanID];
+                    iNumSkippedMixes++;
+                    continue;
+                }
+
+                if ( bUseFloatAudio )
+                {
+                    MixKernels.Mix ( &vecfSharedMix[0],
+                                     &vecvecfData[j][0],
+                                     vecNumAudioChannels[j],
+                                     iCh + 1,
+                                     iServerFrameSizeSamples,
+                                     1.0f,
+                                     1.0f );
                 }
                 else
                 {
-                    CurOpusDecoder = OpusDecoderStereo[iCurChanID];
+                    MixKernels.Mix ( &vecfSharedMix[0],
+                                     &vecvecsData[j][0],
+                                     vecNumAudioChannels[j],
+                                     iCh + 1,
+                                     iServerFrameSizeSamples,
+                                     1.0f,
+                                     1.0f );
                 }
             }
-            else if ( vecAudioComprType[i] == CT_OPUS64 )
+        }
+    }
+}
+
+bool CServer::HaveEqualMixSettings ( const int iClientIdx1,
+                                     const int iClientIdx2,
+                                     const int iNumClients ) const
+{
+    // the mix and the encoded data must be identical, note that clients which
+    // use the frame size conversion buffer are never grouped since the state
+    // of the conversion buffer is different for each client
+    if ( ( vecMixSettingsHash[iClientIdx1] != vecMixSettingsHash[iClientIdx2] ) ||
+         ( vecUseDoubleSysFraSizeConvBuf[iClientIdx1] != 0 ) ||
+         ( vecUseDoubleSysFraSizeConvBuf[iClientIdx2] != 0 ) ||
+         ( vecAudioComprType[iClientIdx1] != vecAudioComprType[iClientIdx2] ) ||
+         ( vecNumAudioChannels[iClientIdx1] != vecNumAudioChannels[iClientIdx2] ) ||
+         ( vecNetwFrameSizes[iClientIdx1] != vecNetwFrameSizes[iClientIdx2] ) ||
+         ( vecMixType[iClientIdx1] != vecMixType[iClientIdx2] ) )
+    {
+        return false;
+    }
+
+    // clients using the shared mix of all clients always get the same mix
+    if ( vecMixType[iClientIdx1] == MT_ALL )
+    {
+        return true;
+    }
+
+    // compare the gain/pan rows (the panning is only relevant for stereo)
+    const bool bIsStereo = ( vecNumAudioChannels[iClientIdx1] == 2 );
+
+    for ( int j = 0; j < iNumClients; j++ )
+    {
+        if ( ( vecvecdGains[iClientIdx1][j] != vecvecdGains[iClientIdx2][j] ) ||
+             ( bIsStereo && ( vecvecdPannings[iClientIdx1][j] != vecvecdPannings[iClientIdx2][j] ) ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int CServer::GroupClientsByMixSettings ( const int iNumClients )
+{
+    int i;
+    int iNumMixGroups = 0;
+
+    for ( i = 0; i < iNumClients; i++ )
+    {
+        // store the current network frame size so that it is the same for
+        // the grouping and the encoding
+        vecNetwFrameSizes[i] = vecChannels[vecChanIDsCurConChan[i]].GetDownstreamNetwFrameSize();
+
+        // calculate a hash of the mix and codec settings to speed up the search
+        // for clients with identical settings
+        uint uHash = qHash ( static_cast<int> ( vecAudioComprType[i] ) ) ^
+                     qHash ( vecNumAudioChannels[i] * 1000003 + vecNetwFrameSizes[i] );
+
+        if ( vecMixType[i] == MT_INDIVIDUAL )
+        {
+            uHash ^= qHashBits ( &vecvecdGains[i][0], iNumClients * sizeof ( double ), 1 );
+
+            if ( vecNumAudioChannels[i] == 2 )
+            {
+                uHash ^= qHashBits ( &vecvecdPannings[i][0], iNumClients * sizeof ( double ), 2 );
+            }
+        }
+        else
+        {
+            uHash ^= qHash ( static_cast<int> ( vecMixType[i] ) );
+        }
+
+        vecMixSettingsHash[i] = uHash;
+        vecMixGroupNext[i]    = INVALID_INDEX;
+    }
+
+    // The encoders are stateful, a client must keep receiving the stream of
+    // the same encoder as long as possible. Therefore the clients which were
+    // group leaders in the last frame are grouped first so that they stay the
+    // leaders of their groups (a group only gets a new leader if it was
+    // dissolved or merged with another group).
+    for ( int iPass = 0; iPass < 2; iPass++ )
+    {
+        for ( i = 0; i < iNumClients; i++ )
+        {
+            const int  iCurChanID = vecChanIDsCurConChan[i];
+            const bool bWasLeader = ( vecMixSourceChanIDs[iCurChanID] == iCurChanID );
+
+            if ( bWasLeader != ( iPass == 0 ) )
             {
-                iClientFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+                continue;
+            }
 
-                if ( vecNumAudioChannels[i] == 1 )
-                {
-                    CurOpusDecoder = Opus64DecoderMono[iCurChanID];
-                }
-                else
+            // search for an existing group with identical settings (the
+            // MT_ALL_BUT_OWN mix is different for each client)
+            int iGroupIdx = INVALID_INDEX;
+
+            if ( vecMixType[i] != MT_ALL_BUT_OWN )
+            {
+                for ( int iG = 0; iG < iNumMixGroups; iG++ )
                 {
-                    CurOpusDecoder = Opus64DecoderStereo[iCurChanID];
+                    if ( HaveEqualMixSettings ( vecMixGroupLeaders[iG], i, iNumClients ) )
+                    {
+                        iGroupIdx = iG;
+                        break;
+                    }
                 }
             }
+
+            if ( iGroupIdx == INVALID_INDEX )
+            {
+                // this client is the leader of a new group
+                vecMixGroupLeaders[iNumMixGroups] = i;
+                iNumMixGroups++;
+            }
             else
             {
-                CurOpusDecoder = nullptr;
+                // insert the client in the linked list of the group after the leader
+                const int iLeaderIdx = vecMixGroupLeaders[iGroupIdx];
+
+                vecMixGroupNext[i]          = vecMixGroupNext[iLeaderIdx];
+                vecMixGroupNext[iLeaderIdx] = i;
+            }
+        }
+    }
+
+    // A client which switches to its own encoder (it has left a group or its
+    // group got a new leader) continues with a reset encoder instead of the
+    // stale state of the last frame in which the encoder was used. The reset
+    // keeps the encoder settings and does not allocate memory.
+    for ( int iG = 0; iG < iNumMixGroups; iG++ )
+    {
+        const int iLeaderIdx    = vecMixGroupLeaders[iG];
+        const int iLeaderChanID = vecChanIDsCurConChan[iLeaderIdx];
+
+        for ( i = iLeaderIdx; i != INVALID_INDEX; i = vecMixGroupNext[i] )
+        {
+            const int iCurChanID = vecChanIDsCurConChan[i];
+
+            if ( vecMixSourceChanIDs[iCurChanID] != iLeaderChanID )
+            {
+                if ( ( i == iLeaderIdx ) && ( pChanOpusEncoder[iCurChanID] != nullptr ) )
+                {
+                    opus_custom_encoder_ctl ( pChanOpusEncoder[iCurChanID], OPUS_RESET_STATE );
+                }
+
+                vecMixSourceChanIDs[iCurChanID] = iLeaderChanID;
             }
+        }
+    }
+
+    return iNumMixGroups;
+}
+
+void CServer::ShedEncoderComplexity ( const int iNumMixGroups )
+{
+    int iG;
+
+    if ( !LoadGovernor.IsShedding() )
+    {
+        // all encoders have their full complexity
+        for ( iG = 0; iG < iNumMixGroups; iG++ )
+        {
+            vecMixGroupNumShedSteps[iG] = 0;
+            LoadGovernor.AddEncoderToStatistic ( 0 );
+        }
+
+        return;
+    }
+
+    // the sensitivity of a group is defined by the bit rate of its audio
+    for ( iG = 0; iG < iNumMixGroups; iG++ )
+    {
+        const int iLeaderIdx = vecMixGroupLeaders[iG];
+
+        vecMixGroupBitRates[iG] = CalcBitRateBitsPerSecFromCodedBytes (
+            vecNetwFrameSizes[iLeaderIdx],
+            ( vecAudioComprType[iLeaderIdx] == CT_OPUS ) ? DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES : SYSTEM_FRAME_SIZE_SAMPLES );
+
+        vecMixGroupOrder[iG] = iG;
+    }
+
+    // the groups with the lowest bit rate come first (the group index makes
+    // the order unique so that it does not change from frame to frame)
+    std::sort ( vecMixGroupOrder.begin(),
+                vecMixGroupOrder.begin() + iNumMixGroups,
+                [this] ( const int iG1, const int iG2 )
+                {
+                    return ( vecMixGroupBitRates[iG1] < vecMixGroupBitRates[iG2] ) ||
+                           ( ( vecMixGroupBitRates[iG1] == vecMixGroupBitRates[iG2] ) && ( iG1 < iG2 ) );
+                } );
+
+    // the steps are handed out in rounds in the order of the groups, a group
+    // gets the next step which lowers the complexity of its encoder and it
+    // is skipped if its encoder has the minimum complexity already
+    int  iNumSteps      = LoadGovernor.GetTotalNumShedSteps ( iNumMixGroups );
+    bool bStepHandedOut = true;
+
+    for ( iG = 0; iG < iNumMixGroups; iG++ )
+    {
+        vecMixGroupNumShedSteps[iG] = 0;
+    }
 
-            // get gains of all connected channels
-            for ( j = 0; j < iNumClients; j++ )
-            {
-                // The second index of "vecvecdGains" does not represent
-                // the channel ID! Therefore we have to use
-                // "vecChanIDsCurConChan" to query the IDs of the currently
-                // connected channels
-                vecvecdGains[i][j] = vecChannels[iCurChanID].GetGain ( vecChanIDsCurConChan[j] );
+    while ( ( iNumSteps > 0 ) && bStepHandedOut )
+    {
+        bStepHandedOut = false;
 
-                // consider audio fade-in
-                vecvecdGains[i][j] *= vecChannels[vecChanIDsCurConChan[j]].GetFadeInGain();
+        for ( int iRank = 0; ( iRank < iNumMixGroups ) && ( iNumSteps > 0 ); iRank++ )
+        {
+            iG = vecMixGroupOrder[iRank];
 
-                // panning
-                vecvecdPannings[i][j] = vecChannels[iCurChanID].GetPan ( vecChanIDsCurConChan[j] );
-            }
+            // a group without a negotiated codec has no encoder
+            const EAudComprType eAudComprType = vecAudioComprType[vecMixGroupLeaders[iG]];
+            const int           iDefaultComplexity =
+                ( eAudComprType == CT_OPUS ) ? OPUS_ENCODER_COMPLEXITY :
+                ( ( eAudComprType == CT_OPUS64 ) ? OPUS64_ENCODER_COMPLEXITY : 0 );
 
-            // If the server frame size is smaller than the received OPUS frame size, we need a conversion
-            // buffer which stores the large buffer.
-            // Note that we have a shortcut here. If the conversion buffer is not needed, the boolean flag
-            // is false and the Get() function is not called at all. Therefore if the buffer is not needed
-            // we do not spend any time in the function but go directly inside the if condition.
-            if ( ( vecUseDoubleSysFraSizeConvBuf[i] == 0 ) ||
-                 !DoubleFrameSizeConvBufIn[iCurChanID].Get ( vecvecsData[i], SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] ) )
+            const int iNextNumSteps = CLoadGovernor::GetNextNumShedSteps ( iDefaultComplexity,
+                                                                           vecMixGroupNumShedSteps[iG] );
+
+            if ( iNextNumSteps <= LOAD_GOV_NUM_STEPS )
             {
-                // get current number of OPUS coded bytes
-                const int iCeltNumCodedBytes = vecChannels[iCurChanID].GetNetwFrameSize();
+                vecMixGroupNumShedSteps[iG] = iNextNumSteps;
+                iNumSteps--;
+                bStepHandedOut = true;
+            }
+        }
+    }
 
-                for ( int iB = 0; iB < vecNumFrameSizeConvBlocks[i]; iB++ )
-                {
-                    // get data
-                    const EGetDataStat eGetStat = vecChannels[iCurChanID].GetData ( vecbyCodedData, iCeltNumCodedBytes );
+    for ( iG = 0; iG < iNumMixGroups; iG++ )
+    {
+        LoadGovernor.AddEncoderToStatistic ( vecMixGroupNumShedSteps[iG] );
+    }
+}
 
-                    // if channel was just disconnected, set flag that connected
-                    // client list is sent to all other clients
-                    // and emit the client disconnected signal
-                    if ( eGetStat == GS_CHAN_NOW_DISCONNECTED )
-                    {
-                        if ( bEnableRecording )
-                        {
-                            emit ClientDisconnected ( iCurChanID ); // TODO do this outside the mutex lock?
-                        }
+void CServer::MixEncodeTransmitData ( const int iGroupIdx,
+                                      const int iThreadID )
+{
+    int                iUnused;
+    int                iClientFrameSizeSamples = 0; // initialize to avoid a compiler warning
+    int                iDefaultComplexity      = 0;
+    int                iCurIdx;
+    bool               bFrameTransmitted = false;
+    OpusCustomEncoder* CurOpusEncoder;
 
-                        bChannelIsNowDisconnected = true;
-                    }
+    // the mix and the encoder of the group leader is used for all clients of
+    // the group
+    const int iClientIdx = vecMixGroupLeaders[iGroupIdx];
 
-                    // get pointer to coded data
-                    if ( eGetStat == GS_BUFFER_OK )
-                    {
-                        pCurCodedData = &vecbyCodedData[0];
-                    }
-                    else
-                    {
-                        // for lost packets use null pointer as coded input data
-                        pCurCodedData = nullptr;
-                    }
+    // get the temporary buffers of the current thread
+    CVector<int16_t>& vecsSendData   = vecvecsSendData[iThreadID];
+    CVector<uint8_t>& vecbyCodedData = vecvecbyCodedData[iThreadID];
 
-                    // OPUS decode received data stream
-                    if ( CurOpusDecoder != nullptr )
-                    {
-                        iUnused = opus_custom_decode ( CurOpusDecoder,
-                                                       pCurCodedData,
-                                                       iCeltNumCodedBytes,
-                                                       &vecvecsData[i][iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i]],
-                                                       iClientFrameSizeSamples );
-                    }
-                }
+    // get actual ID of current channel
+    const int iCurChanID = vecChanIDsCurConChan[iClientIdx];
 
-                // a new large frame is ready, if the conversion buffer is required, put it in the buffer
-                // and read out the small frame size immediately for further processing
-                if ( vecUseDoubleSysFraSizeConvBuf[i] != 0 )
-                {
-                    DoubleFrameSizeConvBufIn[iCurChanID].PutAll ( vecvecsData[i] );
-                    DoubleFrameSizeConvBufIn[iCurChanID].Get ( vecvecsData[i], SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] );
-                }
-            }
-        }
+    // get number of audio channels of current channel
+    const int iCurNumAudChan = vecNumAudioChannels[iClientIdx];
+
+    // generate a sparate mix for each channel (the final mix is accumulated in
+    // float and pfMix points to it)
+    CVector<float>& vecfMixAccum   = vecvecfMixAccum[iThreadID];
+    const int       iNumOutSamples = iServerFrameSizeSamples * iCurNumAudChan;
+    const float*    pfMix          = &vecfMixAccum[0];
+
+    if ( vecMixType[iClientIdx] == MT_INDIVIDUAL )
+    {
+        // actual processing of audio data -> mix
+        vecNumChannelMixes[iThreadID][0] += iCurNumClients;
 
-        // a channel is now disconnected, take action on it
-        if ( bChannelIsNowDisconnected )
+        if ( bUseFloatAudio )
         {
-            // update channel list for all currently connected clients
-            CreateAndSendChanListForAllConChannels();
+            vecNumSkippedMixes[iThreadID][0] += ProcessData ( vecvecfData,
+                                                              vecvecdGains[iClientIdx],
+                                                              vecvecdPannings[iClientIdx],
+                                                              vecNumAudioChannels,
+                                                              vecfMixAccum,
+                                                              iCurNumAudChan,
+                                                              iCurNumClients );
+        }
+        else
+        {
+            vecNumSkippedMixes[iThreadID][0] += ProcessData ( vecvecsData,
+                                                              vecvecdGains[iClientIdx],
+                                                              vecvecdPannings[iClientIdx],
+                                                              vecNumAudioChannels,
+                                                              vecfMixAccum,
+                                                              iCurNumAudChan,
+                                                              iCurNumClients );
         }
     }
-    Mutex.unlock(); // release mutex
-
-
-    // Process data ------------------------------------------------------------
-    // Check if at least one client is connected. If not, stop server until
-    // one client is connected.
-    if ( iNumClients > 0 )
+    else if ( vecMixType[iClientIdx] == MT_ALL )
     {
-        // low frequency updates
-        if ( iFrameCount > CHANNEL_LEVEL_UPDATE_INTERVAL )
-        {
-            iFrameCount = 0;
+        // the shared mix can be used directly
+        pfMix = &vecvecfSharedMix[iCurNumAudChan - 1][0];
+    }
+    else if ( vecChannelIsActive[iClientIdx] == 0 )
+    {
+        // a silent channel is not contained in the shared mix, therefore the
+        // shared mix can be used directly
+        pfMix = &vecvecfSharedMix[iCurNumAudChan - 1][0];
+    }
+    else
+    {
+        // subtract the own signal from the shared mix
+        const CVector<float>& vecfSharedMix = vecvecfSharedMix[iCurNumAudChan - 1];
 
-            // Calculate channel levels if any client has requested them
-            for ( int i = 0; i < iNumClients; i++ )
-            {
-                if ( vecChannels[vecChanIDsCurConChan[i]].ChannelLevelsRequired() )
-                {
-                    bSendChannelLevels = true;
+        std::copy ( vecfSharedMix.begin(), vecfSharedMix.begin() + iNumOutSamples, vecfMixAccum.begin() );
 
-                    CreateLevelsForAllConChannels ( iNumClients,
-                                                    vecNumAudioChannels,
-                                                    vecvecsData,
-                                                    vecChannelLevels );
-                    break;
-                }
-            }
+        if ( bUseFloatAudio )
+        {
+            MixKernels.Mix ( &vecfMixAccum[0],
+                             &vecvecfData[iClientIdx][0],
+                             iCurNumAudChan,
+                             iCurNumAudChan,
+                             iServerFrameSizeSamples,
+                             -1.0f,
+                             -1.0f );
         }
-        iFrameCount++;
-        if ( bUseDoubleSystemFrameSize )
+        else
         {
-            // additional increment needed for double frame size to get to the same time interval
-            iFrameCount++;
+            MixKernels.Mix ( &vecfMixAccum[0],
+                             &vecvecsData[iClientIdx][0],
+                             iCurNumAudChan,
+                             iCurNumAudChan,
+                             iServerFrameSizeSamples,
+                             -1.0f,
+                             -1.0f );
         }
+    }
 
-        for ( int i = 0; i < iNumClients; i++ )
-        {
-            // get actual ID of current channel
-            const int iCurChanID = vecChanIDsCurConChan[i];
+    // the saturation/clipping is only applied once on the final mix, in the
+    // float audio mode the accumulation buffer is directly used for encoding
+    if ( bUseFloatAudio )
+    {
+        MixKernels.Clip ( pfMix, &vecfMixAccum[0], iNumOutSamples );
+    }
+    else
+    {
+        MixKernels.Saturate ( pfMix, &vecsSendData[0], iNumOutSamples );
+    }
 
-            // get number of audio channels of current channel
-            const int iCurNumAudChan = vecNumAudioChannels[i];
+    // get current number of CELT coded bytes
+    const int iCeltNumCodedBytes = vecNetwFrameSizes[iClientIdx];
+
+    // select the complexity and raw audio frame length, the encoder of the
+    // negotiated codec variant was assigned to the channel by the timer
+    // thread (it is a null pointer if no codec is negotiated or the pool has
+    // no codec available yet)
+    if ( vecAudioComprType[iClientIdx] == CT_OPUS )
+    {
+        iClientFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+        iDefaultComplexity      = OPUS_ENCODER_COMPLEXITY;
+    }
+    else if ( vecAudioComprType[iClientIdx] == CT_OPUS64 )
+    {
+        iClientFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+        iDefaultComplexity      = OPUS64_ENCODER_COMPLEXITY;
+    }
 
-            // export the audio data for recording purpose
-            if ( bEnableRecording )
+    CurOpusEncoder = pChanOpusEncoder[iCurChanID];
+
+    // If the server frame size is smaller than the received OPUS frame size, we need a conversion
+    // buffer which stores the large buffer.
+    // Note that we have a shortcut here. If the conversion buffer is not needed, the boolean flag
+    // is false and the Get() function is not called at all. Therefore if the buffer is not needed
+    // we do not spend any time in the function but go directly inside the if condition.
+    if ( ( vecUseDoubleSysFraSizeConvBuf[iClientIdx] == 0 ) ||
+         ( bUseFloatAudio ?
+           DoubleFrameSizeConvBufOutFloat[iCurChanID].Put ( vecfMixAccum, SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan ) :
+           DoubleFrameSizeConvBufOut[iCurChanID].Put ( vecsSendData, SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan ) ) )
+    {
+        if ( vecUseDoubleSysFraSizeConvBuf[iClientIdx] != 0 )
+        {
+            // get the large frame from the conversion buffer
+            if ( bUseFloatAudio )
+            {
+                DoubleFrameSizeConvBufOutFloat[iCurChanID].GetAll ( vecfMixAccum, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan );
+            }
+            else
             {
-                emit AudioFrame ( iCurChanID,
-                                  vecChannels[iCurChanID].GetName(),
-                                  vecChannels[iCurChanID].GetAddress(),
-                                  iCurNumAudChan,
-                                  vecvecsData[i] );
+                DoubleFrameSizeConvBufOut[iCurChanID].GetAll ( vecsSendData, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan );
             }
+        }
 
-            // generate a sparate mix for each channel
-            // actual processing of audio data -> mix
-            ProcessData ( vecvecsData,
-                          vecvecdGains[i],
-                          vecvecdPannings[i],
-                          vecNumAudioChannels,
-                          vecsSendData,
-                          iCurNumAudChan,
-                          iNumClients );
-
-            // get current number of CELT coded bytes
-            const int iCeltNumCodedBytes = vecChannels[iCurChanID].GetNetwFrameSize();
-
-            // select the opus encoder and raw audio frame length
-            if ( vecAudioComprType[i] == CT_OPUS )
+        // without an encoder (no codec negotiated or the pool had no codec
+        // available yet) nothing is sent since the coded data buffer of the
+        // thread still holds the packet of another client
+        for ( int iB = 0; ( CurOpusEncoder != nullptr ) && ( iB < vecNumFrameSizeConvBlocks[iClientIdx] ); iB++ )
+        {
+            // OPUS encoding, the bit rate and the complexity are only set
+            // if the encoder or the setting has changed (the encoders of a
+            // channel are only used by the thread which processes its
+            // group)
+            const int iBitRate    = CalcBitRateBitsPerSecFromCodedBytes ( iCeltNumCodedBytes, iClientFrameSizeSamples );
+            const int iComplexity = CLoadGovernor::GetComplexity ( iDefaultComplexity, vecMixGroupNumShedSteps[iGroupIdx] );
+
+            if ( pLastUsedEncoder[iCurChanID] != CurOpusEncoder )
             {
-                iClientFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+                pLastUsedEncoder[iCurChanID]       = CurOpusEncoder;
+                iLastEncoderBitRate[iCurChanID]    = 0;
+                iLastEncoderComplexity[iCurChanID] = -1;
+            }
 
-                if ( vecNumAudioChannels[i] == 1 )
-                {
-                    CurOpusEncoder = OpusEncoderMono[iCurChanID];
-                }
-                else
-                {
-                    CurOpusEncoder = OpusEncoderStereo[iCurChanID];
-                }
+            if ( iLastEncoderBitRate[iCurChanID] != iBitRate )
+            {
+                opus_custom_encoder_ctl ( CurOpusEncoder, OPUS_SET_BITRATE ( iBitRate ) );
+                iLastEncoderBitRate[iCurChanID] = iBitRate;
             }
-            else if ( vecAudioComprType[i] == CT_OPUS64 )
+
+            if ( iLastEncoderComplexity[iCurChanID] != iComplexity )
             {
-                iClientFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+                opus_custom_encoder_ctl ( CurOpusEncoder, OPUS_SET_COMPLEXITY ( iComplexity ) );
+                iLastEncoderComplexity[iCurChanID] = iComplexity;
+            }
 
-                if ( vecNumAudioChannels[i] == 1 )
-                {
-                    CurOpusEncoder = Opus64EncoderMono[iCurChanID];
-                }
-                else
-                {
-                    CurOpusEncoder = Opus64EncoderStereo[iCurChanID];
-                }
+            if ( bUseFloatAudio )
+            {
+                iUnused = opus_custom_encode_float ( CurOpusEncoder,
+                                                     &vecfMixAccum[iB * SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan],
+                                                     iClientFrameSizeSamples,
+                                                     &vecbyCodedData[0],
+                                                     iCeltNumCodedBytes );
             }
             else
             {
-                CurOpusEncoder = nullptr;
+                iUnused = opus_custom_encode ( CurOpusEncoder,
+                                               &vecsSendData[iB * SYSTEM_FRAME_SIZE_SAMPLES * iCurNumAudChan],
+                                               iClientFrameSizeSamples,
+                                               &vecbyCodedData[0],
+                                               iCeltNumCodedBytes );
             }
 
-            // If the server frame size is smaller than the received OPUS frame size, we need a conversion
-            // buffer which stores the large buffer.
-            // Note that we have a shortcut here. If the conversion buffer is not needed, the boolean flag
-            // is false and the Get() function is not called at all. Therefore if the buffer is not needed
-            // we do not spend any time in the function but go directly inside the if condition.
-            if ( ( vecUseDoubleSysFraSizeConvBuf[i] == 0 ) ||
-                 DoubleFrameSizeConvBufOut[iCurChanID].Put ( vecsSendData, SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] ) )
-            {
-                if ( vecUseDoubleSysFraSizeConvBuf[i] != 0 )
-                {
-                    // get the large frame from the conversion buffer
-                    DoubleFrameSizeConvBufOut[iCurChanID].GetAll ( vecsSendData, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] );
-                }
-
-                for ( int iB = 0; iB < vecNumFrameSizeConvBlocks[i]; iB++ )
-                {
-                    // OPUS encoding
-                    if ( CurOpusEncoder != nullptr )
-                    {
-// TODO find a better place than this: the setting does not change all the time
-//      so for speed optimization it would be better to set it only if the network
-//      frame size is changed
-opus_custom_encoder_ctl ( CurOpusEncoder,
-                          OPUS_SET_BITRATE ( CalcBitRateBitsPerSecFromCodedBytes ( iCeltNumCodedBytes, iClientFrameSizeSamples ) ) );
-
-                        iUnused = opus_custom_encode ( CurOpusEncoder,
-                                                       &vecsSendData[iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i]],
-                                                       iClientFrameSizeSamples,
-                                                       &vecbyCodedData[0],
-                                                       iCeltNumCodedBytes );
-                    }
-
-                    // send separate mix to current clients
-                    vecChannels[iCurChanID].PrepAndSendPacket ( &Socket,
-                                                                vecbyCodedData,
-                                                                iCeltNumCodedBytes );
-                }
-
-                // update socket buffer size
-                vecChannels[iCurChanID].UpdateSocketBufferSize();
+            // add the separate mix of all clients of the group to the send
+            // batch (the packet of a client must be copied if its conversion
+            // buffer is used again for the next block of this frame)
+            const bool bCopyPacket = ( iB < vecNumFrameSizeConvBlocks[iClientIdx] - 1 );
 
-                // send channel levels
-                if ( bSendChannelLevels && vecChannels[iCurChanID].ChannelLevelsRequired() )
-                {
-                    ConnLessProtocol.CreateCLChannelLevelListMes ( vecChannels[iCurChanID].GetAddress(), vecChannelLevels, iNumClients );
-                }
+            for ( iCurIdx = iClientIdx; iCurIdx != INVALID_INDEX; iCurIdx = vecMixGroupNext[iCurIdx] )
+            {
+                vecChannels[vecChanIDsCurConChan[iCurIdx]].PrepAndAddPacket ( SendBatch,
+                                                                              iCurIdx * MAX_NUM_PACKETS_PER_FRAME + iB,
+                                                                              vecbyCodedData,
+                                                                              iCeltNumCodedBytes,
+                                                                              bCopyPacket );
             }
         }
+
+        bFrameTransmitted = ( CurOpusEncoder != nullptr );
     }
-    else
+
+    // set the flag which indicates that a frame was actually sent
+    for ( iCurIdx = iClientIdx; iCurIdx != INVALID_INDEX; iCurIdx = vecMixGroupNext[iCurIdx] )
     {
-        // Disable server if no clients are connected. In this case the server
-        // does not consume any significant CPU when no client is connected.
-        Stop();
+        vecFrameTransmitted[iCurIdx] = bFrameTransmitted ? 1 : 0;
     }
 
     Q_UNUSED ( iUnused )
 }
 
 /// @brief Mix all audio data from all clients together.
-void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
-                            const CVector<double>&            vecdGains,
-                            const CVector<double>&            vecdPannings,
-                            const CVector<int>&               vecNumAudioChannels,
-                            CVector<int16_t>&                 vecsOutData,
-                            const int                         iCurNumAudChan,
-                            const int                         iNumClients )
+template<class TData>
+int CServer::ProcessData ( const CAlignedMatrix<TData>& vecvecData,
+                           const double*                pdGains,
+                           const double*                pdPannings,
+                           const CVector<int>&          vecNumAudioChannels,
+                           CVector<float>&              vecfMixAccum,
+                           const int                    iCurNumAudChan,
+                           const int                    iNumClients )
 {
-    int i, j, k;
+    int iNumSkipped = 0;
 
-    // init return vector with zeros since we mix all channels on that vector
-    vecsOutData.Reset ( 0 );
+    // init accumulation buffer with zeros since we mix all channels on that
+    // buffer (the saturation is applied by the caller on the final mix)
+    std::fill ( vecfMixAccum.begin(), vecfMixAccum.begin() + iServerFrameSizeSamples * iCurNumAudChan, 0.0f );
 
-    // distinguish between stereo and mono mode
-    if ( iCurNumAudChan == 1 )
+    for ( int j = 0; j < iNumClients; j++ )
     {
-        // Mono target channel -------------------------------------------------
-        for ( j = 0; j < iNumClients; j++ )
+        const double dGain = pdGains[j];
+        double       dGainL, dGainR;
+
+        // silent or muted channels do not contribute to the mix
+        if ( ( vecChannelIsActive[j] == 0 ) || ( dGain == static_cast<double> ( 0.0 ) ) )
         {
-            // get a reference to the audio data and gain of the current client
-            const CVector<int16_t>& vecsData = vecvecsData[j];
-            const double            dGain    = vecdGains[j];
+            iNumSkipped++;
+            continue;
+        }
 
-            // if channel gain is 1, avoid multiplication for speed optimization
-            if ( dGain == static_cast<double> ( 1.0 ) )
-            {
-                if ( vecNumAudioChannels[j] == 1 )
-                {
-                    // mono
-                    for ( i = 0; i < iServerFrameSizeSamples; i++ )
-                    {
-                        vecsOutData[i] = Double2Short (
-                            static_cast<double> ( vecsOutData[i] ) + vecsData[i] );
-                    }
-                }
-                else
-                {
-                    // stereo: apply stereo-to-mono attenuation
-                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
-                    {
-                        vecsOutData[i] =
-                            Double2Short ( vecsOutData[i] +
-                            ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2 );
-                    }
-                }
-            }
-            else
-            {
-                if ( vecNumAudioChannels[j] == 1 )
-                {
-                    // mono
-                    for ( i = 0; i < iServerFrameSizeSamples; i++ )
-                    {
-                        vecsOutData[i] = Double2Short (
-                            vecsOutData[i] + vecsData[i] * dGain );
-                    }
-                }
-                else
-                {
-                    // stereo: apply stereo-to-mono attenuation
-                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
-                    {
-                        vecsOutData[i] =
-                            Double2Short ( vecsOutData[i] + dGain *
-                            ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2 );
-                    }
-                }
-            }
+        // distinguish between stereo and mono mode
+        if ( iCurNumAudChan == 1 )
+        {
+            // mono target channel: for stereo input the mixing kernel applies
+            // the stereo-to-mono attenuation
+            dGainL = dGain;
+            dGainR = dGain;
         }
-    }
-    else
-    {
-        // Stereo target channel -----------------------------------------------
-        for ( j = 0; j < iNumClients; j++ )
+        else
         {
-            // get a reference to the audio data and gain/pan of the current client
-            const CVector<int16_t>& vecsData = vecvecsData[j];
-            const double            dGain    = vecdGains[j];
-            const double            dPan     = vecdPannings[j];
-
-            // calculate combined gain/pan for each stereo channel where we define
-            // the panning that center equals full gain for both channels
-            const double dGainL = std::min ( 0.5, 1 - dPan ) * 2 * dGain;
-            const double dGainR = std::min ( 0.5, dPan ) * 2 * dGain;
-
-            // if channel gain is 1, avoid multiplication for speed optimization
-            if ( ( dGainL == static_cast<double> ( 1.0 ) ) && ( dGainR == static_cast<double> ( 1.0 ) ) )
-            {
-                if ( vecNumAudioChannels[j] == 1 )
-                {
-                    // mono: copy same mono data in both out stereo audio channels
-                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
-                    {
-                        // left channel
-                        vecsOutData[k] = Double2Short (
-                            static_cast<double> ( vecsOutData[k] ) + vecsData[i] );
-
-                        // right channel
-                        vecsOutData[k + 1] = Double2Short (
-                            static_cast<double> ( vecsOutData[k + 1] ) + vecsData[i] );
-                    }
-                }
-                else
-                {
-                    // stereo
-                    for ( i = 0; i < ( 2 * iServerFrameSizeSamples ); i++ )
-                    {
-                        vecsOutData[i] = Double2Short (
-                            static_cast<double> ( vecsOutData[i] ) + vecsData[i] );
-                    }
-                }
-            }
-            else
-            {
-                if ( vecNumAudioChannels[j] == 1 )
-                {
-                    // mono: copy same mono data in both out stereo audio channels
-                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
-                    {
-                        // left channel
-                        vecsOutData[k] = Double2Short (
-                            vecsOutData[k] + vecsData[i] * dGain * dGainL );
-
-                        // right channel
-                        vecsOutData[k + 1] = Double2Short (
-                            vecsOutData[k + 1] + vecsData[i] * dGain * dGainR );
-                    }
-                }
-                else
-                {
-                    // stereo
-                    for ( i = 0; i < ( 2 * iServerFrameSizeSamples ); i += 2 )
-                    {
-                        // left channel
-                        vecsOutData[i] = Double2Short (
-                            vecsOutData[i] + vecsData[i] * dGain * dGainL );
+            // stereo target channel: calculate combined gain/pan for each
+            // stereo channel where we define the panning that center equals
+            // full gain for both channels
+            const double dPan = pdPannings[j];
 
-                        // right channel
-                        vecsOutData[i + 1] = Double2Short (
-                            vecsOutData[i + 1] + vecsData[i + 1] * dGain * dGainR );
-                    }
-                }
-            }
+            dGainL = std::min ( 0.5, 1 - dPan ) * 2 * dGain * dGain;
+            dGainR = std::min ( 0.5, dPan ) * 2 * dGain * dGain;
         }
+
+        // the kernel avoids the multiplication if the channel gain is 1
+        MixKernels.Mix ( &vecfMixAccum[0],
+                         &vecvecData[j][0],
+                         vecNumAudioChannels[j],
+                         iCurNumAudChan,
+                         iServerFrameSizeSamples,
+                         static_cast<float> ( dGainL ),
+                         static_cast<float> ( dGainR ) );
     }
+
+    return iNumSkipped;
 }
 
-CVector<CChannelInfo> CServer::CreateChannelList()
+CVector<CChannelInfo> CServer::CreateChannelList ( const int iNumChanIDs )
 {
     CVector<CChannelInfo> vecChanInfo ( 0 );
 
-    // look for free channels
-    for ( int i = 0; i < iMaxNumChannels; i++ )
+    // look for free channels (only the channel IDs below the given number are
+    // included)
+    for ( int i = 0; i < std::min ( iMaxNumChannels, iNumChanIDs ); i++ )
     {
         if ( vecChannels[i].IsConnected() )
         {
@@ -1253,8 +3426,10 @@ CVector<CChannelInfo> CServer::CreateChannelList()
 
 void CServer::CreateAndSendChanListForAllConChannels()
 {
-    // create channel list
-    CVector<CChannelInfo> vecChanInfo ( CreateChannelList() );
+    // create channel list (the older clients only get the channels they have
+    // faders for)
+    CVector<CChannelInfo> vecChanInfo       ( CreateChannelList ( iMaxNumChannels ) );
+    CVector<CChannelInfo> vecChanInfoLegacy ( CreateChannelList ( MAX_NUM_CHANNELS_LEGACY ) );
 
     // now send connected channels list to all connected clients
     for ( int i = 0; i < iMaxNumChannels; i++ )
@@ -1262,7 +3437,8 @@ void CServer::CreateAndSendChanListForAllConChannels()
         if ( vecChannels[i].IsConnected() )
         {
             // send message
-            vecChannels[i].CreateConClientListMes ( vecChanInfo );
+            vecChannels[i].CreateConClientListMes (
+                vecChannels[i].SupportsManyChannels() ? vecChanInfo : vecChanInfoLegacy );
         }
     }
 
@@ -1276,7 +3452,8 @@ void CServer::CreateAndSendChanListForAllConChannels()
 void CServer::CreateAndSendChanListForThisChan ( const int iCurChanID )
 {
     // create channel list
-    CVector<CChannelInfo> vecChanInfo ( CreateChannelList() );
+    CVector<CChannelInfo> vecChanInfo ( CreateChannelList (
+        vecChannels[iCurChanID].SupportsManyChannels() ? iMaxNumChannels : MAX_NUM_CHANNELS_LEGACY ) );
 
     // now send connected channels list to the channel with the ID "iCurChanID"
     vecChannels[iCurChanID].CreateConClientListMes ( vecChanInfo );
@@ -1333,7 +3510,11 @@ int CServer::GetFreeChan()
     // look for a free channel
     for ( int i = 0; i < iMaxNumChannels; i++ )
     {
-        if ( !vecChannels[i].IsConnected() )
+        // a channel which is just used by another receive thread must not
+        // be assigned to a new client, the channel is marked as used in the
+        // same atomic operation (see PutAudioData())
+        if ( !vecChannels[i].IsConnected() &&
+             vecChanPutActive[i].testAndSetOrdered ( 0, 1 ) )
         {
             return i;
         }
@@ -1362,21 +3543,20 @@ int CServer::GetNumberOfConnectedClients()
 
 int CServer::FindChannel ( const CHostAddress& CheckAddr )
 {
-    CHostAddress InetAddr;
+    // look up the address in the index (note that the mutex must be locked
+    // by the caller)
+    const int iChanID = ChannelAddressIndex.Find ( CheckAddr );
 
-    // check for all possible channels if IP is already in use
-    for ( int i = 0; i < iMaxNumChannels; i++ )
+    if ( iChanID != INVALID_CHANNEL_ID )
     {
-        // the "GetAddress" gives a valid address and returns true if the
-        // channel is connected
-        if ( vecChannels[i].GetAddress ( InetAddr ) )
+        // the channel might have been disconnected by the timer thread in
+        // the meantime, in that case the entry is stale and is removed
+        if ( vecChannels[iChanID].IsConnected() )
         {
-            // IP found, return channel number
-            if ( InetAddr == CheckAddr )
-            {
-                return i;
-            }
+            return iChanID;
         }
+
+        ChannelAddressIndex.Remove ( iChanID );
     }
 
     // IP not found, return invalid ID
@@ -1413,15 +3593,95 @@ bool CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
     bool bNewConnection = false; // init return value
     bool bChanOK        = true; // init with ok, might be overwritten
 
+    // Get channel ID without the mutex ----------------------------------------
+    // The packets of a connected client are assigned to its channel without
+    // locking the mutex. The channel is marked as used before it is checked
+    // so that it cannot be assigned to another client in the meantime (the
+    // marks are counters, GetFreeChan() only takes a channel without marks).
+    // If the channel was disconnected or its address entry was replaced
+    // after the look up, the mark is removed and the mutex is used.
+    if ( !ChannelAddressIndex.FindLockFree ( HostAdr, iCurChanID ) )
+    {
+        iCurChanID = INVALID_CHANNEL_ID;
+    }
+
+    if ( iCurChanID != INVALID_CHANNEL_ID )
+    {
+        int iCheckChanID;
+
+        vecChanPutActive[iCurChanID].fetchAndAddOrdered ( 1 );
+
+        if ( !vecChannels[iCurChanID].IsConnected() ||
+             !ChannelAddressIndex.FindLockFree ( HostAdr, iCheckChanID ) ||
+             ( iCheckChanID != iCurChanID ) )
+        {
+            vecChanPutActive[iCurChanID].fetchAndAddOrdered ( -1 );
+            iCurChanID = INVALID_CHANNEL_ID;
+        }
+    }
+
+    if ( iCurChanID == INVALID_CHANNEL_ID )
+    {
+        PutAudioDataLocked ( HostAdr, iCurChanID, bChanOK );
+    }
+
+
+    // Put received audio data in jitter buffer --------------------------------
+    // The jitter buffer is lock-free so that the mutex is not needed here
+    // (the packets of a client are always received by the same thread).
+    if ( bChanOK )
+    {
+        // put packet in socket buffer
+        const EPutDataStat ePutStat =
+            vecChannels[iCurChanID].PutAudioData ( vecbyRecBuf,
+                                                   iNumBytesRead,
+                                                   HostAdr );
+
+        vecChanPutActive[iCurChanID].fetchAndAddOrdered ( -1 );
+
+        if ( ePutStat == PS_NEW_CONNECTION )
+        {
+            // in case we have a new connection return this information
+            bNewConnection = true;
+
+            // the channel might have been disconnected and removed from the
+            // address index after the look up, make sure it is in the index
+            Mutex.lock();
+            {
+                ChannelAddressIndex.Insert ( HostAdr, iCurChanID );
+            }
+            Mutex.unlock();
+        }
+    }
+
+    // return the state if a new connection was happening
+    return bNewConnection;
+}
+
+void CServer::PutAudioDataLocked ( const CHostAddress& HostAdr,
+                                   int&                iCurChanID,
+                                   bool&               bChanOK )
+{
     Mutex.lock();
     {
         // Get channel ID ------------------------------------------------------
         // check address
         iCurChanID = FindChannel ( HostAdr );
 
-        if ( iCurChanID == INVALID_CHANNEL_ID )
+        if ( iCurChanID != INVALID_CHANNEL_ID )
+        {
+            // mark the channel as used so that it cannot be assigned to
+            // another client by another receive thread until the packet is
+            // put in the jitter buffer
+            vecChanPutActive[iCurChanID].fetchAndAddOrdered ( 1 );
+        }
+        else
         {
-            // a new client is calling, look for free channel
+            // a new client is calling, look for free channel (this is no
+            // steady state, the channel initialization may allocate memory),
+            // the free channel is already marked as used
+            CRtAllocGuardPause RtAllocGuardPause;
+
             iCurChanID = GetFreeChan();
 
             if ( iCurChanID != INVALID_CHANNEL_ID )
@@ -1430,6 +3690,9 @@ bool CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
                 // address
                 vecChannels[iCurChanID].SetAddress ( HostAdr );
 
+                // add the new client to the address index
+                ChannelAddressIndex.Insert ( HostAdr, iCurChanID );
+
                 // reset channel info
                 vecChannels[iCurChanID].ResetInfo();
 
@@ -1443,6 +3706,11 @@ bool CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
                     // i == iCurChanID for simplicity)
                     vecChannels[i].SetGain ( iCurChanID, 1.0 );
                 }
+
+                // the gains for the audio processing must be reset
+                // immediately (the change signals of the channels might be
+                // queued)
+                GainPanMatrix.ResetGains ( iCurChanID );
             }
             else
             {
@@ -1450,25 +3718,8 @@ bool CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
                 bChanOK = false;
             }
         }
-
-
-        // Put received audio data in jitter buffer ----------------------------
-        if ( bChanOK )
-        {
-            // put packet in socket buffer
-            if ( vecChannels[iCurChanID].PutAudioData ( vecbyRecBuf,
-                                                        iNumBytesRead,
-                                                        HostAdr ) == PS_NEW_CONNECTION )
-            {
-                // in case we have a new connection return this information
-                bNewConnection = true;
-            }
-        }
     }
     Mutex.unlock();
-
-    // return the state if a new connection was happening
-    return bNewConnection;
 }
 
 void CServer::GetConCliParam ( CVector<CHostAddress>& vecHostAddresses,
@@ -1572,14 +3823,44 @@ void CServer::customEvent ( QEvent* pEvent )
             // no effect
             Start();
             break;
+
+        case MS_CHANNEL_DISCONNECTED:
+            Mutex.lock();
+            {
+                // remove the disconnected channels from the address index
+                for ( int i = 0; i < iMaxNumChannels; i++ )
+                {
+                    if ( !vecChannels[i].IsConnected() )
+                    {
+                        ChannelAddressIndex.Remove ( i );
+                    }
+                }
+
+                // update channel list for all currently connected clients
+                CreateAndSendChanListForAllConChannels();
+            }
+            Mutex.unlock(); // release mutex
+            break;
+
+        case MS_NO_CLIENTS_CONNECTED:
+            // a client might have connected in the meantime
+            if ( GetNumberOfConnectedClients() == 0 )
+            {
+                Stop();
+            }
+
+            iStopRequested.storeRelease ( 0 );
+            break;
         }
     }
 }
 
 /// @brief Compute frame peak level for each client
+template<class TData>
 void CServer::CreateLevelsForAllConChannels ( const int                        iNumClients,
                                               const CVector<int>&              vecNumAudioChannels,
-                                              const CVector<CVector<int16_t> > vecvecsData,
+                                              const CAlignedMatrix<TData>&     vecvecData,
+                                              const double                     dSampleScale,
                                               CVector<uint16_t>&               vecLevelsOut )
 {
     int i, j, k;
@@ -1589,8 +3870,8 @@ void CServer::CreateLevelsForAllConChannels ( const int                        i
 
     for ( j = 0; j < iNumClients; j++ )
     {
-        // get a reference to the audio data
-        const CVector<int16_t>& vecsData = vecvecsData[j];
+        // get a pointer to the audio data
+        const TData* pData = vecvecData[j];
 
         double dCurLevel = 0.0;
 
@@ -1599,7 +3880,7 @@ void CServer::CreateLevelsForAllConChannels ( const int                        i
             // mono
             for ( i = 0; i < iServerFrameSizeSamples; i += 3 )
             {
-                dCurLevel = std::max ( dCurLevel, fabs ( static_cast<double> ( vecsData[i] ) ) );
+                dCurLevel = std::max ( dCurLevel, fabs ( static_cast<double> ( pData[i] ) ) );
             }
         }
         else
@@ -1607,11 +3888,14 @@ void CServer::CreateLevelsForAllConChannels ( const int                        i
             // stereo: apply stereo-to-mono attenuation
             for ( i = 0, k = 0; i < iServerFrameSizeSamples; i += 3, k += 6 )
             {
-                double sMix = ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2;
+                double sMix = ( static_cast<double> ( pData[k] ) + pData[k + 1] ) / 2;
                 dCurLevel = std::max ( dCurLevel, fabs ( sMix ) );
             }
         }
 
+        // the level meter expects the short sample range
+        dCurLevel *= dSampleScale;
+
         // smoothing
         const int iChId = vecChanIDsCurConChan[j];
         dCurLevel       = std::max ( dCurLevel, vecChannels[iChId].GetPrevLevel() * 0.5 );
@@ -28,6 +28,12 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QHostAddress>
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QHash>
+#include <QScopedPointer>
+#include <QDebug>
 #include <algorithm>
 #ifdef USE_OPUS_SHARED_LIB
 # include "opus/opus_custom.h"
@@ -41,6 +47,9 @@
 #include "channel.h"
 #include "util.h"
 #include "serverlogging.h"
+#include "mixkernels.h"
+#include "driftcomp.h"
+#include "rtallocguard.h"
 #include "serverlist.h"
 #include "multicolorledbar.h"
 #include "recorder/jamrecorder.h"
@@ -50,6 +59,84 @@
 // no valid channel number
 #define INVALID_CHANNEL_ID                  ( MAX_NUM_CHANNELS + 1 )
 
+// scale factor between the float audio samples (range -1 to 1) and the short
+// audio samples
+#define FLOAT_TO_SHORT_SCALE                32768.0f
+
+// end of list marker for the index lists
+#define INVALID_INDEX                       ( -1 )
+
+// peak level of a decoded frame below which the channel is treated as silent
+// and is not mixed (short sample magnitude, about -78 dBFS)
+#define SILENCE_PEAK_THRESHOLD              4
+
+// maximum number of network packets of a client in one frame (a client with
+// 64 samples frame size on a server with 128 samples frame size gets two)
+#define MAX_NUM_PACKETS_PER_FRAME           2
+
+// wake-up latency of the timer thread above which a wake-up is counted as late
+#define TIMER_LATE_WAKEUP_THRESHOLD_NS      250000 // ns
+
+// policy if the frame processing overruns the deadline of the next frame
+enum ETimerCatchUpPolicy
+{
+    TC_BURST = 0, // process the missed frames back to back
+    TC_SKIP  = 1  // drop the missed frames and continue with the next deadline
+};
+
+// adaptive bit rate of the audio sent to the clients: the error rate of the
+// packets received by the client is reported in intervals (see
+// DOWNSTREAM_STATISTIC_INTERVAL_MS), the coded size is reduced by a factor if
+// the error rate is above the congestion limit and increased in steps after
+// a number of clean intervals (the sizes are relative to the size requested
+// by the client)
+#define ADAPT_BITRATE_CONGESTION_ERR_RATE   0.02
+#define ADAPT_BITRATE_CLEAN_ERR_RATE        0.005
+#define ADAPT_BITRATE_NUM_CLEAN_INTERVALS   10
+#define ADAPT_BITRATE_DECREASE_FACTOR       0.75
+#define ADAPT_BITRATE_INCREASE_STEP         0.1
+#define ADAPT_BITRATE_MIN_SIZE_FACTOR       0.5
+
+// complexity of the encoders (the OPUS64 encoders use the default complexity
+// of the OPUS library)
+#define OPUS_ENCODER_COMPLEXITY             1
+#define OPUS64_ENCODER_COMPLEXITY           5
+
+// load governor: the average processing time of the frames is evaluated in
+// intervals (in percent of the frame period), above the high load the shed
+// level is increased, after a number of intervals below the low load it is
+// decreased again (the shed level is the number of complexity reduction steps
+// of all mix groups, a fraction means that only a part of the groups get the
+// next step)
+#define LOAD_GOV_INTERVAL_MS                100
+#define LOAD_GOV_HIGH_LOAD_PERCENT          80
+#define LOAD_GOV_LOW_LOAD_PERCENT           60
+#define LOAD_GOV_NUM_LOW_INTERVALS          10
+#define LOAD_GOV_SHED_STEP                  0.25
+#define LOAD_GOV_RESTORE_STEP               0.125
+#define LOAD_GOV_NUM_STEPS                  3
+
+// interval in which the main thread checks for statistics reports of the
+// server timer thread
+#define STAT_REPORT_POLL_INTERVAL_MS        1000 // ms
+
+// number of frames per channel which the recording queue can hold until the
+// main thread hands them over to the jam recorder
+#define RECORDING_QUEUE_NUM_FRAMES          64
+
+// number of spare codecs per codec variant which the main thread keeps ready
+// for the server timer thread (a channel takes one of them if there is no
+// released codec of its variant)
+#define OPUS_CODEC_POOL_NUM_SPARE           4
+
+// type of the mix which is sent to a client
+enum EMixType
+{
+    MT_INDIVIDUAL  = 0, // individual mix with custom gains/pannings
+    MT_ALL         = 1, // shared mix of all clients (all gains are unity)
+    MT_ALL_BUT_OWN = 2  // shared mix minus own signal (only own channel muted)
+};
+
 
 /* Classes ********************************************************************/
 #if ( defined ( WIN32 ) || defined ( _WIN32 ) )
@@ -65,6 +152,13 @@ public:
     void Stop();
     bool isActive() const { return Timer.isActive(); }
 
+    // the real-time properties and the timing statistics are not supported
+    // by the QTimer implementation
+    void SetRealTimeProperties ( const int, const int, const ETimerCatchUpPolicy ) {}
+    int GetNumOverruns() const { return 0; }
+    int GetNumLateWakeups() const { return 0; }
+    int GetNumSkippedFrames() const { return 0; }
+
 protected:
     QTimer       Timer;
     CVector<int> veciTimeOutIntervals;
@@ -99,14 +193,32 @@ public:
     void Stop();
     bool isActive() { return bRun; }
 
+    // the SCHED_FIFO priority (0 means no real-time scheduling) and the CPU
+    // affinity (-1 means no affinity) are applied if the thread is started
+    void SetRealTimeProperties ( const int                 iNewRtPriority,
+                                 const int                 iNewCpuID,
+                                 const ETimerCatchUpPolicy eNewCatchUpPolicy );
+
+    // timing statistics since the start of the server
+    int GetNumOverruns() const { return iNumOverruns.loadAcquire(); }
+    int GetNumLateWakeups() const { return iNumLateWakeups.loadAcquire(); }
+    int GetNumSkippedFrames() const { return iNumSkippedFrames.loadAcquire(); }
+
 protected:
     virtual void run();
 
-    bool bRun;
+    bool                bRun;
+    int                 iRtPriority;
+    int                 iCpuID;
+    ETimerCatchUpPolicy eCatchUpPolicy;
+    QAtomicInt          iNumOverruns;      // processing finished after the next deadline
+    QAtomicInt          iNumLateWakeups;   // woken up too late by the OS
+    QAtomicInt          iNumSkippedFrames; // dropped frames (TC_SKIP policy)
 
 # if defined ( __APPLE__ ) || defined ( __MACOSX )
     uint64_t Delay;
     uint64_t NextEnd;
+    uint64_t LateWakeupThreshold;
 # else
     long     Delay;
     timespec NextEnd;
@@ -118,75 +230,553 @@ signals:
 #endif
 
 
-template<unsigned int slotId>
-class CServerSlots : public CServerSlots<slotId - 1>
+// Worker thread pool for the server audio processing --------------------------
+// The work of one server frame (e.g. the mix, encode and send for each of the
+// connected clients) is split in independent work items which are distributed
+// on a fixed set of worker threads. The calling thread takes part in the
+// processing and Run() only returns if all work items of the current frame are
+// finished (barrier at the end of each frame).
+class CServerWorkerPool
 {
 public:
-    void OnSendProtMessCh ( CVector<uint8_t> mess ) { SendProtMessage ( slotId - 1,  mess ); }
-    void OnReqConnClientsListCh()  { CreateAndSendChanListForThisChan ( slotId - 1 ); }
+    // interface for the actual processing of one work item
+    class CJob
+    {
+    public:
+        virtual ~CJob() {}
+        virtual void ProcessItem ( const int iItem, const int iThreadID ) = 0;
+    };
+
+    CServerWorkerPool() : iNumThreads ( 1 ), pCurJob ( nullptr ), iCurNumItems ( 0 ) {}
+    virtual ~CServerWorkerPool();
+
+    void Init ( const int      iNewNumThreads,
+                const QString& strCpuAffinity,
+                const int      iNewRtPriority );
+
+    // number of threads including the calling thread
+    int GetNumThreads() const { return iNumThreads; }
+
+    void Run ( CJob*     pJob,
+               const int iNumItems );
 
-    void OnChatTextReceivedCh ( QString strChatText )
+    // settings for the calling thread (also used for the server timer thread)
+    static void SetCurrentThreadAffinity ( const int iCpuID );
+    static void SetCurrentThreadRealTimePriority ( const int iRtPriority );
+
+protected:
+    class CWorkerThread : public QThread
     {
-        CreateAndSendChatTextForAllConChannels ( slotId - 1, strChatText );
-    }
+    public:
+        CWorkerThread ( CServerWorkerPool* pNewPool,
+                        const int          iNewThreadID,
+                        const int          iNewCpuID,
+                        const int          iNewRtPriority ) :
+            pPool ( pNewPool ), iThreadID ( iNewThreadID ), iCpuID ( iNewCpuID ),
+            iRtPriority ( iNewRtPriority ), bRun ( true ) {}
+
+        void Stop();
+
+        QSemaphore StartSemaphore;
+
+    protected:
+        virtual void run();
+
+        CServerWorkerPool* pPool;
+        int                iThreadID;
+        int                iCpuID;
+        int                iRtPriority;
+        bool               bRun;
+    };
+
+    void ProcessItems ( const int iThreadID );
+
+    int                     iNumThreads;
+    CVector<CWorkerThread*> vecpWorkerThreads;
+    QSemaphore              DoneSemaphore;
+
+    // properties of the current job (only valid during Run())
+    CJob*                   pCurJob;
+    int                     iCurNumItems;
+    QAtomicInt              iNextItem;
+};
+
+
+// Gain/pan matrix shared between the protocol and the audio processing -------
+// The gain and pan of each channel for each other channel (indexed by the
+// channel IDs). Changes are applied on a master copy under a mutex and a
+// complete copy of the matrix is then published via a triple buffer. The
+// server timer thread (only one reader is supported) gets the latest
+// published matrix with a single atomic operation and is never blocked.
+class CGainPanMatrix
+{
+public:
+    CGainPanMatrix();
+
+    void Init ( const int iNewMaxNumChannels );
+
+    void SetGainPan ( const int    iChanID,
+                      const int    iOtherChanID,
+                      const double dNewGain,
+                      const double dNewPan );
 
-    void OnMuteStateHasChangedCh ( int iChanID, bool bIsMuted )
+    // sets the default gain for a new client on the given channel
+    void ResetGains ( const int iChanID );
+
+    // reader: switches to the latest published matrix, returns true if the
+    // matrix has changed since the last call
+    bool Update();
+
+    const double* GetGains ( const int iChanID ) const
+        { return &vecvecdGains[iFrontIdx][iChanID * iMaxNumChannels]; }
+
+    const double* GetPannings ( const int iChanID ) const
+        { return &vecvecdPannings[iFrontIdx][iChanID * iMaxNumChannels]; }
+
+protected:
+    // flag in the middle buffer index which indicates a new matrix
+    static const int NEW_DATA_FLAG = 4;
+
+    void MarkRowChanged ( const int iChanID );
+    void MarkColumnChanged ( const int iChanID );
+    void Publish();
+
+    // index 0 to 2: triple buffer, index 3: master copy of the writers
+    CVector<CVector<double> > vecvecdGains;
+    CVector<CVector<double> > vecvecdPannings;
+
+    // rows/columns of the master copy which have changed since the triple
+    // buffer with the same index was written the last time (only these are
+    // copied on a publish)
+    CVector<CVector<int> >    vecvecRowChanged;
+    CVector<CVector<int> >    vecvecColumnChanged;
+    int                       iMaxNumChannels;
+    QMutex                    Mutex;
+    int                       iBackIdx;  // only used by the writers
+    int                       iFrontIdx; // only used by the reader
+    QAtomicInt                iMiddleIdx;
+};
+
+
+// Channel address index ------------------------------------------------------
+// Maps the host address of a connected client to its channel ID so that an
+// incoming packet can be assigned to its channel in constant time. The key
+// is the IPv4 address and the port (the socket only supports IPv4) packed
+// in one integer, the table uses open addressing with linear probing and
+// backward shift deletion. All modifications must be protected by the server
+// mutex. The receive threads can look up an address without the mutex: the
+// slots are atomic and each modification increments a sequence counter twice
+// (odd while the table is modified), a look up which overlaps with a
+// modification fails and must be repeated with the mutex locked.
+class CChannelAddressIndex
+{
+public:
+    CChannelAddressIndex();
+
+    void Reset();
+
+    // adds the channel with the given address, an old entry of the channel
+    // and an old entry with the same address are replaced
+    void Insert ( const CHostAddress& Addr, const int iChanID );
+
+    // removes the entry of the channel, nothing happens if the channel is
+    // not in the index
+    void Remove ( const int iChanID );
+
+    // returns the channel ID of the address or INVALID_CHANNEL_ID
+    int Find ( const CHostAddress& Addr ) const;
+
+    // same as Find() but may be called without the mutex, returns false if
+    // the table was modified during the look up
+    bool FindLockFree ( const CHostAddress& Addr, int& iChanID ) const;
+
+protected:
+    // power of two and at least four times the maximum number of channels so
+    // that the probe sequences stay short
+    static const int TABLE_BITS = 10;
+    static const int TABLE_SIZE = 1 << TABLE_BITS;
+    static const int TABLE_MASK = TABLE_SIZE - 1;
+
+    // the key is stored in two halves since the slots are read without the
+    // mutex (a torn slot is detected by the sequence counter)
+    struct SEntry
     {
-        CreateOtherMuteStateChanged ( slotId - 1, iChanID, bIsMuted );
+        QAtomicInt iKeyHigh;
+        QAtomicInt iKeyLow;
+        QAtomicInt iChanID; // INVALID_CHANNEL_ID for an empty slot
+    };
+
+    static quint64 GetKey ( const CHostAddress& Addr )
+        { return ( static_cast<quint64> ( Addr.InetAddr.toIPv4Address() ) << 16 ) | Addr.iPort; }
+
+    static int GetHomeSlot ( const quint64 iKey )
+        { return static_cast<int> ( ( iKey * Q_UINT64_C ( 0x9E3779B97F4A7C15 ) ) >> ( 64 - TABLE_BITS ) ) & TABLE_MASK; }
+
+    quint64 GetSlotKey ( const int iSlot ) const
+    {
+        return ( static_cast<quint64> ( static_cast<quint32> ( Table[iSlot].iKeyHigh.loadAcquire() ) ) << 32 ) |
+               static_cast<quint32> ( Table[iSlot].iKeyLow.loadAcquire() );
     }
 
-    void OnServerAutoSockBufSizeChangeCh ( int iNNumFra )
+    void SetSlot ( const int iSlot, const quint64 iKey, const int iChanID )
     {
-        CreateAndSendJitBufMessage ( slotId - 1, iNNumFra );
+        Table[iSlot].iKeyHigh.storeRelease ( static_cast<int> ( iKey >> 32 ) );
+        Table[iSlot].iKeyLow.storeRelease ( static_cast<int> ( iKey & 0xFFFFFFFF ) );
+        Table[iSlot].iChanID.storeRelease ( iChanID );
     }
 
+    int  FindSlot ( const quint64 iKey ) const;
+    void RemoveSlot ( int iSlot );
+
+    SEntry     Table[TABLE_SIZE];
+    QAtomicInt iSeqCnt;
+    quint64    veciChanKey[MAX_NUM_CHANNELS];
+    bool       vecbChanIndexed[MAX_NUM_CHANNELS];
+};
+
+
+// Bit rate controller ---------------------------------------------------------
+// Adapts the coded size of the audio sent to a client to the congestion state
+// of the network path from the server to the client (additive increase,
+// multiplicative decrease). The client reports the packets which were lost on
+// this path, the packets which arrived too late for its jitter buffer are no
+// congestion indicator. The controller is updated by the server timer thread.
+class CBitRateController
+{
+public:
+    CBitRateController() { Reset(); }
+
+    void Reset();
+
+    // updates the controller with the statistic of one report interval
+    void Update ( const int iNumReceived,
+                  const int iNumLost );
+
+    // coded size for the given size requested by the client
+    int GetNetwFrameSize ( const int iMaxNetwFrameSize ) const;
+
 protected:
-    virtual void SendProtMessage ( int              iChID,
-                                   CVector<uint8_t> vecMessage ) = 0;
+    double dSizeFactor;
+    int    iNumCleanIntervals;
+    bool   bIsFirstInterval;
+};
 
-    virtual void CreateAndSendChanListForThisChan ( const int iCurChanID ) = 0;
 
-    virtual void CreateAndSendChatTextForAllConChannels ( const int      iCurChanID,
-                                                          const QString& strChatText ) = 0;
+// Load governor ---------------------------------------------------------------
+// Protects the server from overload by reducing the complexity of the encoders
+// if the processing time of the frames gets near the frame period, the
+// complexity is restored if there is enough headroom again. The reduction is
+// spread over the mix groups in the order of their sensitivity, the groups
+// with the lowest bit rate (low audio quality or a reduced bit rate due to a
+// congested network) get the first reduction steps. A group only gets a step
+// which actually lowers the complexity of its encoder (e.g., the OPUS
+// encoders have a low complexity already). The governor is only used by the
+// server timer thread.
+class CLoadGovernor
+{
+public:
+    CLoadGovernor();
 
-    virtual void CreateOtherMuteStateChanged ( const int  iCurChanID,
-                                               const int  iOtherChanID,
-                                               const bool bIsMuted ) = 0;
+    void Init ( const int iNewFramePeriodNs );
+    void Reset();
 
-    virtual void CreateAndSendJitBufMessage ( const int iCurChanID,
-                                              const int iNNumFra ) = 0;
+    // updates the load with the processing time of a frame
+    void Update ( const qint64 iFrameTimeNs );
+
+    // total number of complexity reduction steps which are handed out to
+    // the given number of mix groups
+    int GetTotalNumShedSteps ( const int iNumGroups ) const;
+
+    // complexity of an encoder after the reduction steps
+    static int GetComplexity ( const int iDefaultComplexity,
+                               const int iNumShedSteps );
+
+    // number of reduction steps after the next step which lowers the
+    // complexity (larger than LOAD_GOV_NUM_STEPS if there is no such step)
+    static int GetNextNumShedSteps ( const int iDefaultComplexity,
+                                     const int iNumShedSteps );
+
+    bool IsShedding() const { return dShedLevel > 0.0; }
+
+    // statistic for the log (the number of encoders per reduction step is
+    // summed up over the frames)
+    void AddEncoderToStatistic ( const int iNumShedSteps ) { vecdSumNumEncoders[iNumShedSteps] += 1.0; }
+    bool IsReportReady() const;
+    void ResetStatistic();
+
+    double GetAvLoadPercent() const;
+    double GetMaxLoadPercent() const;
+    double GetShedLevel() const { return dShedLevel; }
+    int    GetNumFrames() const { return iStatNumFrames; }
+    int    GetNumShedSteps() const { return iStatNumShedSteps; }
+    int    GetNumRestoreSteps() const { return iStatNumRestoreSteps; }
+    const CVector<double>& GetSumNumEncoders() const { return vecdSumNumEncoders; }
+
+protected:
+    qint64          iFramePeriodNs;
+    double          dShedLevel;
+    int             iIntervalLenFrames;
+    int             iIntervalNumFrames;
+    qint64          iIntervalSumTimeNs;
+    int             iNumLowIntervals;
+
+    int             iStatNumFrames;
+    qint64          iStatSumTimeNs;
+    qint64          iStatMaxTimeNs;
+    int             iStatNumShedSteps;
+    int             iStatNumRestoreSteps;
+    CVector<double> vecdSumNumEncoders;
+    QElapsedTimer   ReportTimer;
+};
+
+
+// OPUS codec pool -------------------------------------------------------------
+// The OPUS modes are shared by all codecs (one mode per frame size, a mode is
+// read-only after its creation). The encoders and decoders are only created
+// for the codec variant (compression type and number of audio channels) a
+// channel has actually negotiated. Released codecs are kept in a free list
+// per variant and their state is reset when they are used again. Creating a
+// codec allocates memory, therefore the server timer thread never creates
+// one: if there is no released codec it takes a spare codec pair which the
+// main thread has created before (lock-free single producer/single consumer
+// ring per variant) and notifies the main thread to create a new spare pair.
+class COpusCodecPool
+{
+public:
+    COpusCodecPool();
+
+    void Init ( const int iNewMaxNumCodecsPerVariant );
+
+    // main thread: creates the spare codecs which were taken by the timer
+    // thread, the notifier is triggered if a spare codec is taken
+    void SetRefillNotifier ( CThreadNotifier* pNRefillNotifier ) { pRefillNotifier = pNRefillNotifier; }
+    void Refill();
+
+    static bool IsSupported ( const EAudComprType eAudComprType )
+        { return ( eAudComprType == CT_OPUS ) || ( eAudComprType == CT_OPUS64 ); }
+
+    // timer thread: returns false if the compression type is not supported or
+    // if no codec is available right now (the main thread is notified then
+    // and the call can be repeated in one of the next frames)
+    bool GetCodecs ( const EAudComprType eAudComprType,
+                     const int           iNumAudChan,
+                     OpusCustomEncoder*& pEncoder,
+                     OpusCustomDecoder*& pDecoder );
+
+    // releasing null pointers is allowed
+    void ReleaseCodecs ( OpusCustomEncoder*  pEncoder,
+                         OpusCustomDecoder*  pDecoder,
+                         const EAudComprType eAudComprType,
+                         const int           iNumAudChan );
+
+protected:
+    // variants: legacy mono/stereo, OPUS64 mono/stereo
+    static const int NUM_VARIANTS = 4;
+
+    static int GetVariant ( const EAudComprType eAudComprType,
+                            const int           iNumAudChan );
+
+    OpusCustomEncoder* CreateEncoder ( const int iVariant );
+    OpusCustomDecoder* CreateDecoder ( const int iVariant );
+    int                GetNumSpare ( const int iVariant );
+
+    OpusCustomMode*                      OpusMode;
+    OpusCustomMode*                      Opus64Mode;
+
+    // the free lists have the maximum size from the beginning so that a
+    // release never allocates memory (a codec is always released together
+    // with its counterpart, therefore one counter is sufficient)
+    CVector<OpusCustomEncoder*>          vecFreeEncoders[NUM_VARIANTS];
+    CVector<OpusCustomDecoder*>          vecFreeDecoders[NUM_VARIANTS];
+    int                                  iNumFree[NUM_VARIANTS];
+
+    // the spare codecs are written by the main thread and taken by the timer
+    // thread (the positions run from zero to two times the number of spare
+    // codecs so that a full and an empty ring can be distinguished)
+    OpusCustomEncoder*                   SpareEncoders[NUM_VARIANTS][OPUS_CODEC_POOL_NUM_SPARE];
+    OpusCustomDecoder*                   SpareDecoders[NUM_VARIANTS][OPUS_CODEC_POOL_NUM_SPARE];
+    QAtomicInt                           iSparePutPos[NUM_VARIANTS];
+    QAtomicInt                           iSpareGetPos[NUM_VARIANTS];
+    CThreadNotifier*                     pRefillNotifier;
+};
+
+
+// Statistics report hand-off --------------------------------------------------
+// The statistics are collected by the server timer thread but logged by the
+// main thread (formatting and writing the log allocates memory and locks).
+// The timer thread writes the preallocated report only if the main thread
+// has logged the previous one and then publishes it, the main thread polls
+// for a published report. No memory is allocated and no lock is taken in the
+// timer thread.
+template<class TReport>
+class CStatReportHandoff
+{
+public:
+    CStatReportHandoff() : iIsPublished ( 0 ) {}
+
+    // timer thread: returns a null pointer if the previous report was not
+    // logged yet (the statistic is then reported in a later frame)
+    TReport* GetWriteReport() { return ( iIsPublished.loadAcquire() == 0 ) ? &Report : nullptr; }
+    void     Publish()        { iIsPublished.storeRelease ( 1 ); }
+
+    // main thread: returns a null pointer if no report is published
+    TReport* GetReadReport()  { return ( iIsPublished.loadAcquire() != 0 ) ? &Report : nullptr; }
+    void     Release()        { iIsPublished.storeRelease ( 0 ); }
+
+protected:
+    TReport    Report;
+    QAtomicInt iIsPublished;
+};
+
+// statistics which are reported together with the decoding time
+class CDecodeStatReport
+{
+public:
+    CDecodeStatReport() :
+        iNumSkippedMixes  ( 0 ),
+        iNumChannelMixes  ( 0 ),
+        iNumOverruns      ( 0 ),
+        iNumLateWakeups   ( 0 ),
+        iNumSkippedFrames ( 0 ) {}
+
+    CProcessingTimeMeas DecodeTimeMeas;
+    qint64              iNumSkippedMixes;
+    qint64              iNumChannelMixes;
+    int                 iNumOverruns;
+    int                 iNumLateWakeups;
+    int                 iNumSkippedFrames;
+    CNetBufSeqStatistic SeqStatistic;
+};
+
+// statistics which are reported together with the sending time
+class CSendStatReport
+{
+public:
+    CSendStatReport() :
+        iNumSentPackets ( 0 ),
+        iNumSysCalls    ( 0 ) {}
+
+    CProcessingTimeMeas SendTimeMeas;
+    qint64              iNumSentPackets;
+    qint64              iNumSysCalls;
+};
+
+// statistics of the load governor (the vector has a fixed size)
+class CLoadGovStatReport
+{
+public:
+    CLoadGovStatReport() :
+        dAvLoadPercent     ( 0.0 ),
+        dMaxLoadPercent    ( 0.0 ),
+        dShedLevel         ( 0.0 ),
+        iNumShedSteps      ( 0 ),
+        iNumRestoreSteps   ( 0 ),
+        vecdSumNumEncoders ( LOAD_GOV_NUM_STEPS + 1, 0.0 ),
+        iNumFrames         ( 0 ) {}
+
+    double          dAvLoadPercent;
+    double          dMaxLoadPercent;
+    double          dShedLevel;
+    int             iNumShedSteps;
+    int             iNumRestoreSteps;
+    CVector<double> vecdSumNumEncoders;
+    int             iNumFrames;
+};
+
+
+// Recording queue -------------------------------------------------------------
+// The audio frames for the jam recorder are taken by the server timer thread
+// but emitted by the main thread (the queued signal to the recorder thread
+// allocates memory). The timer thread copies the frame in a preallocated
+// entry of a lock-free single producer/single consumer ring. A disconnected
+// client is put in the same ring so that the recorder gets it after the last
+// frame of the client, for this the last entries are reserved.
+class CRecordingQueue
+{
+public:
+    class CEntry
+    {
+    public:
+        CEntry() : iChID ( INVALID_CHANNEL_ID ), iNumAudChan ( 0 ), bIsDisconnected ( false ) {}
+
+        int              iChID;
+        int              iNumAudChan;
+        bool             bIsDisconnected;
+        CVector<int16_t> vecsData;
+    };
+
+    CRecordingQueue() : iNumReservedEntries ( 0 ), iPutPos ( 0 ), iGetPos ( 0 ) {}
+
+    void Init ( const int iNumEntries,
+                const int iNumReserved,
+                const int iFrameSize );
+
+    // timer thread: returns a null pointer if the queue is full (the frame is
+    // dropped in that case)
+    CEntry* GetWriteEntry ( const bool bIsDisconnected );
+    void    Publish();
+
+    // main thread: returns a null pointer if the queue is empty
+    CEntry* GetReadEntry();
+    void    Release();
+
+protected:
+    int GetNumUsed();
+
+    CVector<CEntry> vecEntries;
+    int             iNumReservedEntries;
+    QAtomicInt      iPutPos;
+    QAtomicInt      iGetPos;
 };
 
-template<>
-class CServerSlots<0> {};
 
-class CServer :
-        public QObject,
-        public CServerSlots<MAX_NUM_CHANNELS>
+class CServer : public QObject
 {
     Q_OBJECT
 
 public:
-    CServer ( const int          iNewMaxNumChan,
-              const int          iMaxDaysHistory,
-              const QString&     strLoggingFileName,
-              const quint16      iPortNumber,
-              const QString&     strHTMLStatusFileName,
-              const QString&     strHistoryFileName,
-              const QString&     strServerNameForHTMLStatusFile,
-              const QString&     strCentralServer,
-              const QString&     strServerInfo,
-              const QString&     strNewWelcomeMessage,
-              const QString&     strRecordingDirName,
-              const bool         bNCentServPingServerInList,
-              const bool         bNDisconnectAllClientsOnQuit,
-              const bool         bNUseDoubleSystemFrameSize,
-              const ELicenceType eNLicenceType );
+    CServer ( const int                 iNewMaxNumChan,
+              const int                 iMaxDaysHistory,
+              const QString&            strLoggingFileName,
+              const quint16             iPortNumber,
+              const QString&            strHTMLStatusFileName,
+              const QString&            strHistoryFileName,
+              const QString&            strServerNameForHTMLStatusFile,
+              const QString&            strCentralServer,
+              const QString&            strServerInfo,
+              const QString&            strNewWelcomeMessage,
+              const QString&            strRecordingDirName,
+              const bool                bNCentServPingServerInList,
+              const bool                bNDisconnectAllClientsOnQuit,
+              const bool                bNUseDoubleSystemFrameSize,
+              const ELicenceType        eNLicenceType,
+              const int                 iNumWorkerThreads,
+              const QString&            strWorkerCpuAffinity,
+              const bool                bNUseParallelDecode,
+              const bool                bNEnableProcTimeStats,
+              const bool                bNUseFloatAudio,
+              const int                 iTimerRtPriority,
+              const int                 iTimerCpuID,
+              const bool                bLockMemory,
+              const ETimerCatchUpPolicy eTimerCatchUpPolicy,
+              const int                 iNumRecvThreads,
+              const bool                bNUseDriftComp,
+              const bool                bNUseAdaptiveBitRate,
+              const bool                bNUseLoadGovernor );
 
     void Start();
     void Stop();
     bool IsRunning() { return HighPrecisionTimer.isActive(); }
 
+    // timing statistics of the timer thread
+    int GetNumTimerOverruns() const { return HighPrecisionTimer.GetNumOverruns(); }
+    int GetNumTimerLateWakeups() const { return HighPrecisionTimer.GetNumLateWakeups(); }
+    int GetNumTimerSkippedFrames() const { return HighPrecisionTimer.GetNumSkippedFrames(); }
+
+    // number of channel mixes of the last frame which were skipped because
+    // the channel was silent or had a zero gain
+    int GetNumSkippedMixes() const { return iLastNumSkippedMixes.loadAcquire(); }
+
     bool PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
                         const int               iNumBytesRead,
                         const CHostAddress&     HostAdr,
@@ -197,6 +787,8 @@ public:
                           CVector<int>&          veciJitBufNumFrames,
                           CVector<int>&          veciNetwFrameSizeFact );
 
+    int GetMaxNumChannels() const { return iMaxNumChannels; }
+
 
     // Server list management --------------------------------------------------
     void UpdateServerList() { ServerListManager.Update(); }
@@ -256,8 +848,12 @@ protected:
 
     int GetFreeChan();
     int FindChannel ( const CHostAddress& CheckAddr );
+
+    void PutAudioDataLocked ( const CHostAddress& HostAdr,
+                              int&                iCurChanID,
+                              bool&               bChanOK );
     int GetNumberOfConnectedClients();
-    CVector<CChannelInfo> CreateChannelList();
+    CVector<CChannelInfo> CreateChannelList ( const int iNumChanIDs );
 
     virtual void CreateAndSendChanListForAllConChannels();
     virtual void CreateAndSendChanListForThisChan ( const int iCurChanID );
@@ -272,21 +868,72 @@ protected:
     virtual void CreateAndSendJitBufMessage ( const int iCurChanID,
                                               const int iNNumFra );
 
+    virtual void UpdateGainPan ( const int    iCurChanID,
+                                 const int    iOtherChanID,
+                                 const double dNewGain,
+                                 const double dNewPan );
+
     virtual void SendProtMessage ( int              iChID,
                                    CVector<uint8_t> vecMessage );
 
-    template<unsigned int slotId>
-    inline void connectChannelSignalsToServerSlots();
+    void connectChannelSignalsToServerSlots();
 
     void WriteHTMLChannelList();
 
-    void ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
-                       const CVector<double>&            vecdGains,
-                       const CVector<double>&            vecdPannings,
-                       const CVector<int>&               vecNumAudioChannels,
-                       CVector<int16_t>&                 vecsOutData,
-                       const int                         iCurNumAudChan,
-                       const int                         iNumClients );
+    void UpdateChannelCodecs ( const int           iChanID,
+                               const EAudComprType eAudComprType,
+                               const int           iNumAudChan );
+
+    void DecodeReceiveData ( const int iClientIdx,
+                             const int iThreadID );
+
+    void GetAndDecodeClientFrame ( const int          iClientIdx,
+                                   const int          iThreadID,
+                                   OpusCustomDecoder* CurOpusDecoder,
+                                   const int          iClientFrameSizeSamples );
+
+    template<class TData>
+    static bool HasSignalAboveThreshold ( const TData* pData,
+                                          const int    iNumSamples,
+                                          const TData  Threshold )
+    {
+        // stop at the first sample above the threshold so that the check is
+        // cheap for active channels
+        for ( int i = 0; i < iNumSamples; i++ )
+        {
+            if ( ( pData[i] > Threshold ) || ( pData[i] < -Threshold ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    EMixType GetMixType ( const int iClientIdx,
+                          const int iNumClients ) const;
+
+    void PrepareSharedMixes ( const int iNumClients );
+
+    bool HaveEqualMixSettings ( const int iClientIdx1,
+                                const int iClientIdx2,
+                                const int iNumClients ) const;
+
+    int GroupClientsByMixSettings ( const int iNumClients );
+
+    void ShedEncoderComplexity ( const int iNumMixGroups );
+
+    void MixEncodeTransmitData ( const int iGroupIdx,
+                                 const int iThreadID );
+
+    template<class TData>
+    int ProcessData ( const CAlignedMatrix<TData>& vecvecData,
+                      const double*                pdGains,
+                      const double*                pdPannings,
+                      const CVector<int>&          vecNumAudioChannels,
+                      CVector<float>&              vecfMixAccum,
+                      const int                    iCurNumAudChan,
+                      const int                    iNumClients );
 
     virtual void customEvent ( QEvent* pEvent );
 
@@ -294,49 +941,180 @@ protected:
     bool                       bUseDoubleSystemFrameSize;
     int                        iServerFrameSizeSamples;
 
+    template<class TData>
     void CreateLevelsForAllConChannels  ( const int                        iNumClients,
                                           const CVector<int>&              vecNumAudioChannels,
-                                          const CVector<CVector<int16_t> > vecvecsData,
+                                          const CAlignedMatrix<TData>&     vecvecData,
+                                          const double                     dSampleScale,
                                           CVector<uint16_t>&               vecLevelsOut );
 
     void RequestNewRecording();
 
-    // do not use the vector class since CChannel does not have appropriate
-    // copy constructor/operator
-    CChannel                   vecChannels[MAX_NUM_CHANNELS];
-    int                        iMaxNumChannels;
-    CProtocol                  ConnLessProtocol;
-    QMutex                     Mutex;
-
-    // audio encoder/decoder
-    OpusCustomMode*            Opus64Mode[MAX_NUM_CHANNELS];
-    OpusCustomEncoder*         Opus64EncoderMono[MAX_NUM_CHANNELS];
-    OpusCustomDecoder*         Opus64DecoderMono[MAX_NUM_CHANNELS];
-    OpusCustomEncoder*         Opus64EncoderStereo[MAX_NUM_CHANNELS];
-    OpusCustomDecoder*         Opus64DecoderStereo[MAX_NUM_CHANNELS];
-    OpusCustomMode*            OpusMode[MAX_NUM_CHANNELS];
-    OpusCustomEncoder*         OpusEncoderMono[MAX_NUM_CHANNELS];
-    OpusCustomDecoder*         OpusDecoderMono[MAX_NUM_CHANNELS];
-    OpusCustomEncoder*         OpusEncoderStereo[MAX_NUM_CHANNELS];
-    OpusCustomDecoder*         OpusDecoderStereo[MAX_NUM_CHANNELS];
-    CConvBuf<int16_t>          DoubleFrameSizeConvBufIn[MAX_NUM_CHANNELS];
-    CConvBuf<int16_t>          DoubleFrameSizeConvBufOut[MAX_NUM_CHANNELS];
+    // the channels are allocated at runtime for the number of channels set
+    // at launch (do not use the vector class since CChannel does not have
+    // appropriate copy constructor/operator)
+    int                           iMaxNumChannels;
+    QScopedArrayPointer<CChannel> vecChannels;
+    CProtocol                     ConnLessProtocol;
+    QMutex                        Mutex;
+
+    // audio encoder/decoder (each channel holds the codecs of its negotiated
+    // variant, they are taken from the pool)
+    COpusCodecPool                OpusCodecPool;
+    CVector<OpusCustomEncoder*>   pChanOpusEncoder;
+    CVector<OpusCustomDecoder*>   pChanOpusDecoder;
+    CVector<EAudComprType>        eChanCodecComprType;
+    CVector<int>                  iChanCodecNumAudChan;
+    CVector<CConvBuf<int16_t> >   DoubleFrameSizeConvBufIn;
+    CVector<CConvBuf<int16_t> >   DoubleFrameSizeConvBufOut;
+    CVector<CConvBuf<float> >     DoubleFrameSizeConvBufInFloat;
+    CVector<CConvBuf<float> >     DoubleFrameSizeConvBufOutFloat;
+    CVector<CDriftCompensator>    DriftComp;
+    CVector<CBitRateController>   BitRateCtrl;
+
+    // the bit rate and the complexity of an encoder are only set if they
+    // have changed (the last used encoder of each channel and its settings
+    // are stored)
+    CVector<OpusCustomEncoder*>   pLastUsedEncoder;
+    CVector<int>                  iLastEncoderBitRate;
+    CVector<int>                  iLastEncoderComplexity;
 
     CVector<QString>           vstrChatColors;
     CVector<int>               vecChanIDsCurConChan;
 
-    CVector<CVector<double> >  vecvecdGains;
-    CVector<CVector<double> >  vecvecdPannings;
-    CVector<CVector<int16_t> > vecvecsData;
+    // the gains/pannings and the decoded audio data are stored in dense
+    // matrices indexed by the index of the connected client (the memory is
+    // allocated once and reused for every frame)
+    CAlignedMatrix<double>     vecvecdGains;
+    CAlignedMatrix<double>     vecvecdPannings;
+    CGainPanMatrix             GainPanMatrix;
+    CChannelAddressIndex       ChannelAddressIndex;
+    CVector<QAtomicInt>        vecChanPutActive; // number of receive threads using the channel
+
+    // the processing state of a newly connected channel is reset by the timer
+    // thread (the main thread only requests the reset)
+    CVector<QAtomicInt>        vecChanResetPending;
+    CVector<double>            vecdFadeInGains;
+    bool                       bFadeInWasActive;
+    CAlignedMatrix<int16_t>    vecvecsData;
+    CAlignedMatrix<float>      vecvecfData; // only used in float audio mode
     CVector<int>               vecNumAudioChannels;
     CVector<int>               vecNumFrameSizeConvBlocks;
     CVector<int>               vecUseDoubleSysFraSizeConvBuf;
     CVector<EAudComprType>     vecAudioComprType;
-    CVector<int16_t>           vecsSendData;
-    CVector<uint8_t>           vecbyCodedData;
+    CVector<int>               vecChannelIsNowDisconnected;
+    CVector<int>               vecChannelIsActive;
+    CVector<int>               vecFrameTransmitted;
+    int                        iCurNumClients;
+    int                        iPrevNumClients;
+    QAtomicInt                 iStopRequested;
+    bool                       bUseParallelDecode;
+    bool                       bUseFloatAudio;
+    bool                       bUseDriftComp;
+    bool                       bUseAdaptiveBitRate;
+    bool                       bUseLoadGovernor;
+
+    // the load governor reduces the encoder complexity of the mix groups in
+    // the order of their sensitivity if the server is near its limit
+    CLoadGovernor              LoadGovernor;
+    QElapsedTimer              FrameTimer;
+    CVector<int>               vecMixGroupBitRates;
+    CVector<int>               vecMixGroupOrder;
+    CVector<int>               vecMixGroupNumShedSteps;
+
+    // temporary buffers for each worker thread
+    CVector<CVector<int16_t> > vecvecsSendData;
+    CVector<CVector<float> >   vecvecfMixAccum;
+    CVector<CVector<uint8_t> > vecvecbyCodedData;
+
+    // statistics of the channel mixes which are skipped for silent channels
+    // (counted per worker thread and summed up after each frame, each worker
+    // thread has its own row so that the counters do not share a cache line)
+    CAlignedMatrix<int>        vecNumChannelMixes;
+    CAlignedMatrix<int>        vecNumSkippedMixes;
+    int                        iNumChannelMixes;
+    int                        iNumSkippedMixes;
+    qint64                     iSumChannelMixes;
+    qint64                     iSumSkippedMixes;
+    QAtomicInt                 iLastNumSkippedMixes; // read by other threads
+
+    // mixes shared by all clients with default gains/pannings (mono and stereo)
+    CVector<EMixType>          vecMixType;
+    CVector<CVector<float> >   vecvecfSharedMix;
+
+    // clients with identical mix and codec settings are grouped so that the
+    // mix is only encoded once per group (the group is a linked list of the
+    // client indices starting at the group leader), for each channel the ID
+    // of the channel whose encoder stream it received in the last frame is
+    // stored so that the groups are kept stable
+    CVector<int>               vecNetwFrameSizes;
+    CVector<uint>              vecMixSettingsHash;
+    CVector<int>               vecMixGroupLeaders;
+    CVector<int>               vecMixGroupNext;
+    CVector<int>               vecMixSourceChanIDs;
+
+    // multithreaded receive and decode of the client frames
+    class CDecodeReceiveJob : public CServerWorkerPool::CJob
+    {
+    public:
+        CDecodeReceiveJob ( CServer* pNServP ) : pServer ( pNServP ) {}
 
-    // Channel levels
+        virtual void ProcessItem ( const int iItem, const int iThreadID )
+            { pServer->DecodeReceiveData ( iItem, iThreadID ); }
+
+    protected:
+        CServer* pServer;
+    };
+
+    // multithreaded mix, encode and send of the client frames
+    class CMixEncodeTransmitJob : public CServerWorkerPool::CJob
+    {
+    public:
+        CMixEncodeTransmitJob ( CServer* pNServP ) : pServer ( pNServP ) {}
+
+        virtual void ProcessItem ( const int iItem, const int iThreadID )
+            { pServer->MixEncodeTransmitData ( iItem, iThreadID ); }
+
+    protected:
+        CServer* pServer;
+    };
+
+    CMixKernels                MixKernels;
+    CServerWorkerPool          WorkerPool;
+    CDecodeReceiveJob          DecodeReceiveJob;
+    CMixEncodeTransmitJob      MixEncodeTransmitJob;
+    CProcessingTimeMeas        DecodeTimeMeas;
+
+    // the packets of all clients are sent together at the end of the frame
+    // (each client has MAX_NUM_PACKETS_PER_FRAME fixed slots in the batch)
+    CSocketSendBatch           SendBatch;
+    CProcessingTimeMeas        SendTimeMeas;
+    qint64                     iSumSentPackets;
+    qint64                     iSumSendSysCalls;
+
+    // statistics reports of the timer thread which are logged by the main
+    // thread
+    CStatReportHandoff<CDecodeStatReport>  DecodeStatReport;
+    CStatReportHandoff<CSendStatReport>    SendStatReport;
+    CStatReportHandoff<CLoadGovStatReport> LoadGovStatReport;
+    QTimer                                 StatReportTimer;
+
+    // audio frames and disconnections for the jam recorder and requests of
+    // the channels which are handed over to the main thread
+    CRecordingQueue                        RecordingQueue;
+    CThreadNotifier                        RecordingNotifier;
+    CThreadNotifier                        ChanRequestNotifier;
+    CThreadNotifier                        CodecRefillNotifier;
+
+    // Channel levels (the message is generated in preallocated buffers)
     CVector<uint16_t>          vecChannelLevels;
+    CVector<uint8_t>           vecbyChanLevelMes;
+    CVector<uint8_t>           vecbyChanLevelMesData;
+
+    // the older clients only get the levels of the channels with an ID below
+    // MAX_NUM_CHANNELS_LEGACY
+    CVector<uint8_t>           vecbyChanLevelMesLegacy;
+    CVector<uint8_t>           vecbyChanLevelMesDataLegacy;
 
     // actual working objects
     CHighPrioSocket            Socket;
@@ -385,6 +1163,10 @@ signals:
 
 public slots:
     void OnTimer();
+    void OnStatReportTimer();
+    void OnRecordingNotification();
+    void OnChanRequestNotification();
+    void OnCodecRefillNotification() { OpusCodecPool.Refill(); }
 
     void OnNewConnection ( int          iChID,
                            CHostAddress RecHostAddr );
@@ -433,7 +1215,7 @@ public slots:
         { ConnLessProtocol.CreateCLVersionAndOSMes ( InetAddr ); }
 
     void OnCLReqConnClientsList ( CHostAddress InetAddr )
-        { ConnLessProtocol.CreateCLConnClientsListMes ( InetAddr, CreateChannelList() ); }
+        { ConnLessProtocol.CreateCLConnClientsListMes ( InetAddr, CreateChannelList ( iMaxNumChannels ) ); }
 
     void OnCLRegisterServerReceived ( CHostAddress    InetAddr,
                                       CHostAddress    LInetAddr,
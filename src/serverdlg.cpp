@@ -177,10 +177,11 @@ lvwClients->setMinimumHeight ( 140 );
 
 
     // insert items in reverse order because in Windows all of them are
-    // always visible -> put first item on the top
-    vecpListViewItems.Init ( MAX_NUM_CHANNELS );
+    // always visible -> put first item on the top (one item per channel of
+    // the server)
+    vecpListViewItems.Init ( pServer->GetMaxNumChannels() );
 
-    for ( int i = MAX_NUM_CHANNELS - 1; i >= 0; i-- )
+    for ( int i = pServer->GetMaxNumChannels() - 1; i >= 0; i-- )
     {
         vecpListViewItems[i] = new QTreeWidgetItem ( lvwClients );
         vecpListViewItems[i]->setHidden ( true );
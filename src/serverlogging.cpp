@@ -63,7 +63,6 @@ void CServerLogging::AddNewConnection ( const QHostAddress& ClientInetAddr )
     const QString strLogStr = CurTimeDatetoLogString() + ", " +
         ClientInetAddr.toString() + ", connected";
 
-    QTextStream& tsConsoleStream = *( ( new ConsoleWriterFactory() )->get() );
     tsConsoleStream << strLogStr << endl; // on console
     *this << strLogStr; // in log file
 
@@ -77,7 +76,6 @@ void CServerLogging::AddServerStopped()
     const QString strLogStr = CurTimeDatetoLogString() + ",, server stopped "
         "-------------------------------------";
 
-    QTextStream& tsConsoleStream = *( ( new ConsoleWriterFactory() )->get() );
     tsConsoleStream << strLogStr << endl; // on console
     *this << strLogStr; // in log file
 
@@ -89,6 +87,111 @@ void CServerLogging::AddServerStopped()
     SvgHistoryGraph.Update();
 }
 
+void CServerLogging::AddProcessingTime ( const QString&             strStageName,
+                                         const CProcessingTimeMeas& ProcTimeMeas )
+{
+    const QString strLogStr = CurTimeDatetoLogString() + ",, " + strStageName +
+        " time: " + QString::number ( ProcTimeMeas.GetNumClients() ) + " clients, " +
+        "av " + QString::number ( ProcTimeMeas.GetAvTimeUs(), 'f', 1 ) + " us, " +
+        "max " + QString::number ( ProcTimeMeas.GetMaxTimeUs(), 'f', 1 ) + " us, " +
+        QString::number ( ProcTimeMeas.GetNumFrames() ) + " frames";
+
+    tsConsoleStream << strLogStr << endl; // on console
+    *this << strLogStr; // in log file
+}
+
+void CServerLogging::AddSkippedMixes ( const qint64 iNumSkippedMixes,
+                                       const qint64 iNumChannelMixes )
+{
+    // percentage of the channel mixes which were skipped for silent channels
+    const double dSkippedPercent = ( iNumChannelMixes > 0 ) ?
+        100.0 * iNumSkippedMixes / iNumChannelMixes : 0.0;
+
+    const QString strLogStr = CurTimeDatetoLogString() + ",, skipped mixes: " +
+        QString::number ( iNumSkippedMixes ) + " of " +
+        QString::number ( iNumChannelMixes ) + " (" +
+        QString::number ( dSkippedPercent, 'f', 1 ) + " %)";
+
+    tsConsoleStream << strLogStr << endl; // on console
+    *this << strLogStr; // in log file
+}
+
+void CServerLogging::AddTimerStatistics ( const int iNumOverruns,
+                                          const int iNumLateWakeups,
+                                          const int iNumSkippedFrames )
+{
+    const QString strLogStr = CurTimeDatetoLogString() + ",, timer: " +
+        QString::number ( iNumOverruns ) + " overruns, " +
+        QString::number ( iNumLateWakeups ) + " late wake-ups, " +
+        QString::number ( iNumSkippedFrames ) + " skipped frames";
+
+    tsConsoleStream << strLogStr << endl; // on console
+    *this << strLogStr; // in log file
+}
+
+void CServerLogging::AddSendStatistics ( const qint64 iNumSentPackets,
+                                         const qint64 iNumSysCalls,
+                                         const int    iNumFrames )
+{
+    // average number of packets and send system calls per frame
+    const double dPacketsPerFrame  = ( iNumFrames > 0 ) ?
+        static_cast<double> ( iNumSentPackets ) / iNumFrames : 0.0;
+    const double dSysCallsPerFrame = ( iNumFrames > 0 ) ?
+        static_cast<double> ( iNumSysCalls ) / iNumFrames : 0.0;
+
+    const QString strLogStr = CurTimeDatetoLogString() + ",, send: " +
+        QString::number ( dPacketsPerFrame, 'f', 1 ) + " packets, " +
+        QString::number ( dSysCallsPerFrame, 'f', 1 ) + " system calls per frame";
+
+    tsConsoleStream << strLogStr << endl; // on console
+    *this << strLogStr; // in log file
+}
+
+void CServerLogging::AddSeqNumStatistics ( const CNetBufSeqStatistic& SeqStatistic )
+{
+    const QString strLogStr = CurTimeDatetoLogString() + ",, jitter buffers: " +
+        QString::number ( SeqStatistic.iNumReceived ) + " packets with sequence number, " +
+        QString::number ( SeqStatistic.iNumLost ) + " lost, " +
+        QString::number ( SeqStatistic.iNumReordered ) + " reordered, " +
+        QString::number ( SeqStatistic.iNumLate ) + " late, " +
+        QString::number ( SeqStatistic.iNumDuplicate ) + " duplicate, " +
+        QString::number ( SeqStatistic.iNumRecovered ) + " recovered, " +
+        "max jitter " + QString::number ( SeqStatistic.iJitterUs / 1000.0, 'f', 2 ) + " ms";
+
+    tsConsoleStream << strLogStr << endl; // on console
+    *this << strLogStr; // in log file
+}
+
+void CServerLogging::AddLoadGovernorStatistics ( const double           dAvLoadPercent,
+                                                 const double           dMaxLoadPercent,
+                                                 const double           dShedLevel,
+                                                 const int              iNumShedSteps,
+                                                 const int              iNumRestoreSteps,
+                                                 const CVector<double>& vecdSumNumEncoders,
+                                                 const int              iNumFrames )
+{
+    // average number of encoders per complexity reduction step
+    QString strEncoders;
+
+    for ( int i = 0; i < vecdSumNumEncoders.Size(); i++ )
+    {
+        const double dAvNumEncoders = ( iNumFrames > 0 ) ? vecdSumNumEncoders[i] / iNumFrames : 0.0;
+
+        strEncoders += ( i > 0 ? "/" : "" ) + QString::number ( dAvNumEncoders, 'f', 1 );
+    }
+
+    const QString strLogStr = CurTimeDatetoLogString() + ",, load governor: " +
+        "av load " + QString::number ( dAvLoadPercent, 'f', 1 ) + " %, " +
+        "max load " + QString::number ( dMaxLoadPercent, 'f', 1 ) + " %, " +
+        "shed level " + QString::number ( dShedLevel, 'f', 3 ) + ", " +
+        QString::number ( iNumShedSteps ) + " shed, " +
+        QString::number ( iNumRestoreSteps ) + " restore steps, " +
+        "encoders per step " + strEncoders;
+
+    tsConsoleStream << strLogStr << endl; // on console
+    *this << strLogStr; // in log file
+}
+
 void CServerLogging::operator<< ( const QString& sNewStr )
 {
     if ( bDoLogging )
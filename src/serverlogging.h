@@ -29,8 +29,10 @@
 #include <QFile>
 #include <QString>
 #include <QTimer>
+#include <QTextStream>
 #include "global.h"
 #include "util.h"
+#include "buffer.h"
 
 #include "historygraph.h"
 
@@ -42,7 +44,8 @@ public:
         JpegHistoryGraph ( iMaxDaysHistory ),
         SvgHistoryGraph ( iMaxDaysHistory ),
         bDoLogging ( false ),
-        File ( DEFAULT_LOG_FILE_NAME ) {}
+        File ( DEFAULT_LOG_FILE_NAME ),
+        tsConsoleStream ( *( ( new ConsoleWriterFactory() )->get() ) ) {}
 
     virtual ~CServerLogging();
 
@@ -50,6 +53,24 @@ public:
     void EnableHistory ( const QString& strHistoryFileName );
     void AddNewConnection ( const QHostAddress& ClientInetAddr );
     void AddServerStopped();
+    void AddProcessingTime ( const QString&             strStageName,
+                             const CProcessingTimeMeas& ProcTimeMeas );
+    void AddSkippedMixes ( const qint64 iNumSkippedMixes,
+                           const qint64 iNumChannelMixes );
+    void AddTimerStatistics ( const int iNumOverruns,
+                              const int iNumLateWakeups,
+                              const int iNumSkippedFrames );
+    void AddSendStatistics ( const qint64 iNumSentPackets,
+                             const qint64 iNumSysCalls,
+                             const int    iNumFrames );
+    void AddSeqNumStatistics ( const CNetBufSeqStatistic& SeqStatistic );
+    void AddLoadGovernorStatistics ( const double           dAvLoadPercent,
+                                     const double           dMaxLoadPercent,
+                                     const double           dShedLevel,
+                                     const int              iNumShedSteps,
+                                     const int              iNumRestoreSteps,
+                                     const CVector<double>& vecdSumNumEncoders,
+                                     const int              iNumFrames );
     void ParseLogFile ( const QString& strFileName );
 
 protected:
@@ -60,4 +81,5 @@ protected:
     CSvgHistoryGraph  SvgHistoryGraph;
     bool              bDoLogging;
     QFile             File;
+    QTextStream&      tsConsoleStream; // only created once
 };
@@ -24,9 +24,206 @@
 
 #include "socket.h"
 #include "server.h"
+#ifdef __linux__
+# include <cerrno>
+# include <sys/eventfd.h>
+# include <unistd.h>
+#endif
 
 
 /* Implementation *************************************************************/
+void CSocketSendBatch::Init ( const int iNewNumSlots )
+{
+    vecpData.Init     ( iNewNumSlots, nullptr );
+    veciNumBytes.Init ( iNewNumSlots, 0 );
+    vecAddr.Init      ( iNewNumSlots );
+    vecvecbyCopy.Init ( iNewNumSlots );
+#ifdef __linux__
+    vecIoVec.Init     ( iNewNumSlots );
+    vecMsgHdr.Init    ( iNewNumSlots );
+#endif
+}
+
+void CSocketSendBatch::Set ( const int           iSlot,
+                             const uint8_t*      pData,
+                             const int           iNumBytes,
+                             const CHostAddress& HostAddr )
+{
+    vecpData[iSlot]     = pData;
+    veciNumBytes[iSlot] = iNumBytes;
+
+    vecAddr[iSlot].sin_family      = AF_INET;
+    vecAddr[iSlot].sin_port        = htons ( HostAddr.iPort );
+    vecAddr[iSlot].sin_addr.s_addr = htonl ( HostAddr.InetAddr.toIPv4Address() );
+}
+
+void CSocketSendBatch::SetCopy ( const int           iSlot,
+                                 const uint8_t*      pData,
+                                 const int           iNumBytes,
+                                 const CHostAddress& HostAddr )
+{
+    // the memory is only allocated if the packet is larger than all previous
+    // packets of this slot
+    if ( vecvecbyCopy[iSlot].Size() < iNumBytes )
+    {
+        vecvecbyCopy[iSlot].Init ( iNumBytes );
+    }
+
+    std::copy ( pData, pData + iNumBytes, vecvecbyCopy[iSlot].begin() );
+
+    Set ( iSlot, vecvecbyCopy[iSlot].data(), iNumBytes, HostAddr );
+}
+
+CThreadNotifier::CThreadNotifier() :
+    iNotificationPending ( 0 )
+{
+#ifdef __linux__
+    // the eventfd is monitored by the event loop of the owner thread
+    iEventFd  = eventfd ( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    pNotifier = new QSocketNotifier ( iEventFd, QSocketNotifier::Read, this );
+
+    QObject::connect ( pNotifier, SIGNAL ( activated ( int ) ),
+        this, SLOT ( OnActivated() ) );
+#endif
+}
+
+CThreadNotifier::~CThreadNotifier()
+{
+#ifdef __linux__
+    delete pNotifier;
+    close ( iEventFd );
+#endif
+}
+
+void CThreadNotifier::Notify()
+{
+    // only notify if the previous notification was processed
+    if ( !iNotificationPending.testAndSetOrdered ( 0, 1 ) )
+    {
+        return;
+    }
+
+#ifdef __linux__
+    const uint64_t iEventCount = 1;
+    const ssize_t  iRet        = write ( iEventFd, &iEventCount, sizeof ( iEventCount ) );
+
+    Q_UNUSED ( iRet )
+#else
+    // on the other platforms a queued call is used which allocates an event
+    // (at most one per processing of the notification)
+    QMetaObject::invokeMethod ( this, "OnActivated", Qt::QueuedConnection );
+#endif
+}
+
+void CThreadNotifier::OnActivated()
+{
+#ifdef __linux__
+    // reset the eventfd
+    uint64_t      iEventCount;
+    const ssize_t iRet = read ( iEventFd, &iEventCount, sizeof ( iEventCount ) );
+
+    Q_UNUSED ( iRet )
+#endif
+
+    // the flag is reset before the signal is emitted so that data which are
+    // put after the processing has started lead to a new notification
+    iNotificationPending.storeRelease ( 0 );
+
+    emit Notified();
+}
+
+CProtMessageQueue::CProtMessageQueue() :
+    iPutPos       ( 0 ),
+    iGetPos       ( 0 ),
+    bIsProcessing ( false )
+{
+    vecSlots.Init ( NUM_PROT_MESSAGE_QUEUE_SLOTS );
+
+    QObject::connect ( &Notifier, SIGNAL ( Notified() ),
+        this, SLOT ( OnNotification() ) );
+}
+
+bool CProtMessageQueue::Put ( const int               iRecCounter,
+                              const int               iRecID,
+                              const CVector<uint8_t>& vecbyMesBodyData,
+                              const CHostAddress&     HostAdr )
+{
+    const int iNumSlots  = vecSlots.Size();
+    const int iCurPutPos = iPutPos.loadAcquire();
+    int       iNumUsed   = iCurPutPos - iGetPos.loadAcquire();
+
+    if ( iNumUsed < 0 )
+    {
+        iNumUsed += 2 * iNumSlots;
+    }
+
+    if ( iNumUsed >= iNumSlots )
+    {
+        // the queue is full, drop the message (the connection based protocol
+        // messages are resent by the sender)
+        return false;
+    }
+
+    // copy the message in the slot (the memory of the slot is only allocated
+    // if the message is larger than all previous messages of this slot)
+    CSlot& Slot = vecSlots[iCurPutPos < iNumSlots ? iCurPutPos : iCurPutPos - iNumSlots];
+
+    Slot.iRecCounter = iRecCounter;
+    Slot.iRecID      = iRecID;
+    Slot.iIPv4Addr   = HostAdr.InetAddr.toIPv4Address();
+    Slot.iPort       = HostAdr.iPort;
+
+    Slot.vecbyMesBodyData.Init ( vecbyMesBodyData.Size() );
+
+    std::copy ( vecbyMesBodyData.begin(),
+                vecbyMesBodyData.end(),
+                Slot.vecbyMesBodyData.begin() );
+
+    // publish the message and notify the main thread
+    iPutPos.storeRelease ( iCurPutPos + 1 < 2 * iNumSlots ? iCurPutPos + 1 : 0 );
+
+    Notifier.Notify();
+
+    return true;
+}
+
+void CProtMessageQueue::OnNotification()
+{
+    // a protocol message might be processed in a local event loop (e.g. a
+    // message box), the messages are then processed by the outer call since
+    // it checks the put position after each message
+    if ( bIsProcessing )
+    {
+        return;
+    }
+
+    bIsProcessing = true;
+
+    const int iNumSlots  = vecSlots.Size();
+    int       iCurGetPos = iGetPos.loadAcquire();
+
+    while ( iCurGetPos != iPutPos.loadAcquire() )
+    {
+        const CSlot&       Slot = vecSlots[iCurGetPos < iNumSlots ? iCurGetPos : iCurGetPos - iNumSlots];
+        const CHostAddress HostAdr ( QHostAddress ( Slot.iIPv4Addr ), Slot.iPort );
+
+        if ( CProtocol::IsConnectionLessMessageID ( Slot.iRecID ) )
+        {
+            emit ProtcolCLMessageReceived ( Slot.iRecID, Slot.vecbyMesBodyData, HostAdr );
+        }
+        else
+        {
+            emit ProtcolMessageReceived ( Slot.iRecCounter, Slot.iRecID, Slot.vecbyMesBodyData, HostAdr );
+        }
+
+        // release the slot
+        iCurGetPos = ( iCurGetPos + 1 < 2 * iNumSlots ? iCurGetPos + 1 : 0 );
+        iGetPos.storeRelease ( iCurGetPos );
+    }
+
+    bIsProcessing = false;
+}
+
 void CSocket::Init ( const quint16 iPortNumber )
 {
 #ifdef _WIN32
@@ -41,8 +238,34 @@ void CSocket::Init ( const quint16 iPortNumber )
     // create the UDP socket
     UdpSocket = socket ( AF_INET, SOCK_DGRAM, 0 );
 
+#ifdef __linux__
+    // allocate memory for the batched receive, each message header points to
+    // its own receive buffer and sender address
+    vecvecbyRecBuf.Init ( NUM_SOCKET_RECV_BATCH );
+    vecSenderAddr.Init  ( NUM_SOCKET_RECV_BATCH );
+    vecRecIoVec.Init    ( NUM_SOCKET_RECV_BATCH );
+    vecRecMsgHdr.Init   ( NUM_SOCKET_RECV_BATCH );
+
+    for ( int i = 0; i < NUM_SOCKET_RECV_BATCH; i++ )
+    {
+        vecvecbyRecBuf[i].Init ( MAX_SIZE_BYTES_NETW_BUF );
+
+        vecRecIoVec[i].iov_base = &vecvecbyRecBuf[i][0];
+        vecRecIoVec[i].iov_len  = MAX_SIZE_BYTES_NETW_BUF;
+
+        vecRecMsgHdr[i].msg_hdr.msg_name    = &vecSenderAddr[i];
+        vecRecMsgHdr[i].msg_hdr.msg_namelen = sizeof ( sockaddr_in );
+        vecRecMsgHdr[i].msg_hdr.msg_iov     = &vecRecIoVec[i];
+        vecRecMsgHdr[i].msg_hdr.msg_iovlen  = 1;
+    }
+#else
     // allocate memory for network receive and send buffer in samples
     vecbyRecBuf.Init ( MAX_SIZE_BYTES_NETW_BUF );
+#endif
+
+    // the memory for the body of received protocol messages is reserved once
+    // (the body is always smaller than the received packet)
+    vecbyMesBodyData.reserve ( MAX_SIZE_BYTES_NETW_BUF );
 
     // preinitialize socket in address (only the port number is missing)
     sockaddr_in UdpSocketInAddr;
@@ -89,9 +312,46 @@ void CSocket::Init ( const quint16 iPortNumber )
         // gets the desired port number
         UdpSocketInAddr.sin_port = htons ( iPortNumber );
 
-        bSuccess = ( ::bind ( UdpSocket ,
-                              (sockaddr*) &UdpSocketInAddr,
-                              sizeof ( sockaddr_in ) ) == 0 );
+        bSuccess = true;
+
+#ifdef __linux__
+        if ( ePortGroup == PG_CREATE )
+        {
+            // A port group of another process on this port (e.g. a second
+            // server instance) would get a share of our packets. Therefore we
+            // check that the port is free with a socket without SO_REUSEPORT
+            // before the group is created. Since the group members must have
+            // the same user ID, a later server instance fails at the same
+            // check and other users cannot join the group at all.
+            const int iProbeSocket = socket ( AF_INET, SOCK_DGRAM, 0 );
+
+            bSuccess = ( ::bind ( iProbeSocket,
+                                  (sockaddr*) &UdpSocketInAddr,
+                                  sizeof ( sockaddr_in ) ) == 0 );
+
+            close ( iProbeSocket );
+        }
+
+        if ( bSuccess && ( ePortGroup != PG_NONE ) )
+        {
+            // several receive sockets are bound to the same port (the option
+            // must be set on all sockets of the group, including the first)
+            const int iEnable = 1;
+
+            setsockopt ( UdpSocket,
+                         SOL_SOCKET,
+                         SO_REUSEPORT,
+                         &iEnable,
+                         sizeof ( iEnable ) );
+        }
+#endif
+
+        if ( bSuccess )
+        {
+            bSuccess = ( ::bind ( UdpSocket ,
+                                  (sockaddr*) &UdpSocketInAddr,
+                                  sizeof ( sockaddr_in ) ) == 0 );
+        }
     }
 
     if ( !bSuccess )
@@ -111,11 +371,11 @@ void CSocket::Init ( const quint16 iPortNumber )
     {
         // client connections:
 
-        QObject::connect ( this,
+        QObject::connect ( &ProtMessageQueue,
             SIGNAL ( ProtcolMessageReceived ( int, int, CVector<uint8_t>, CHostAddress ) ),
             pChannel, SLOT ( OnProtcolMessageReceived ( int, int, CVector<uint8_t>, CHostAddress ) ) );
 
-        QObject::connect ( this,
+        QObject::connect ( &ProtMessageQueue,
             SIGNAL ( ProtcolCLMessageReceived ( int, CVector<uint8_t>, CHostAddress ) ),
             pChannel, SLOT ( OnProtcolCLMessageReceived ( int, CVector<uint8_t>, CHostAddress ) ) );
 
@@ -127,11 +387,11 @@ void CSocket::Init ( const quint16 iPortNumber )
     {
         // server connections:
 
-        QObject::connect ( this,
+        QObject::connect ( &ProtMessageQueue,
             SIGNAL ( ProtcolMessageReceived ( int, int, CVector<uint8_t>, CHostAddress ) ),
             pServer, SLOT ( OnProtcolMessageReceived ( int, int, CVector<uint8_t>, CHostAddress ) ) );
 
-        QObject::connect ( this,
+        QObject::connect ( &ProtMessageQueue,
             SIGNAL ( ProtcolCLMessageReceived ( int, CVector<uint8_t>, CHostAddress ) ),
             pServer, SLOT ( OnProtcolCLMessageReceived ( int, CVector<uint8_t>, CHostAddress ) ) );
 
@@ -180,10 +440,7 @@ void CSocket::SendPacket ( const CVector<uint8_t>& vecbySendBuf,
 
     if ( iVecSizeOut > 0 )
     {
-        // send packet through network (we have to convert the constant unsigned
-        // char vector in "const char*", for this we first convert the const
-        // uint8_t vector in a read/write uint8_t vector and then do the cast to
-        // const char*)
+        // send packet through network
         sockaddr_in UdpSocketOutAddr;
 
         UdpSocketOutAddr.sin_family      = AF_INET;
@@ -191,7 +448,7 @@ void CSocket::SendPacket ( const CVector<uint8_t>& vecbySendBuf,
         UdpSocketOutAddr.sin_addr.s_addr = htonl ( HostAddr.InetAddr.toIPv4Address() );
 
         sendto ( UdpSocket,
-                 (const char*) &( (CVector<uint8_t>) vecbySendBuf )[0],
+                 (const char*) vecbySendBuf.data(),
                  iVecSizeOut,
                  0,
                  (sockaddr*) &UdpSocketOutAddr,
@@ -199,6 +456,104 @@ void CSocket::SendPacket ( const CVector<uint8_t>& vecbySendBuf,
     }
 }
 
+void CSocket::SendBatch ( CSocketSendBatch& SendBatch )
+{
+    // note that no mutex is needed here since the send system calls are
+    // thread safe and the batch is only used by the calling thread
+    SendBatch.iNumSentPackets = 0;
+    SendBatch.iNumSysCalls    = 0;
+
+#ifdef __linux__
+    // collect the used slots in the message headers
+    int iNumPackets = 0;
+
+    for ( int i = 0; i < SendBatch.veciNumBytes.Size(); i++ )
+    {
+        if ( SendBatch.veciNumBytes[i] > 0 )
+        {
+            iovec&  IoVec  = SendBatch.vecIoVec[iNumPackets];
+            msghdr& MsgHdr = SendBatch.vecMsgHdr[iNumPackets].msg_hdr;
+
+            IoVec.iov_base = const_cast<uint8_t*> ( SendBatch.vecpData[i] );
+            IoVec.iov_len  = static_cast<size_t> ( SendBatch.veciNumBytes[i] );
+
+            MsgHdr.msg_name    = &SendBatch.vecAddr[i];
+            MsgHdr.msg_namelen = sizeof ( sockaddr_in );
+            MsgHdr.msg_iov     = &IoVec;
+            MsgHdr.msg_iovlen  = 1;
+
+            // the slot is empty for the next frame
+            SendBatch.veciNumBytes[i] = 0;
+            iNumPackets++;
+        }
+    }
+
+    // send all packets (a call might send less packets than requested)
+    int iNumSent    = 0;
+    int iNumRetries = 0;
+
+    while ( iNumSent < iNumPackets )
+    {
+        const int iRet = sendmmsg ( UdpSocket,
+                                    &SendBatch.vecMsgHdr[iNumSent],
+                                    static_cast<unsigned int> ( iNumPackets - iNumSent ),
+                                    0 );
+
+        SendBatch.iNumSysCalls++;
+
+        if ( iRet > 0 )
+        {
+            iNumSent += iRet;
+        }
+        else if ( ( ( errno == EINTR ) || ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) &&
+                  ( iNumRetries < MAX_NUM_SEND_BATCH_RETRIES ) )
+        {
+            // temporary error, nothing was sent, try again
+            iNumRetries++;
+        }
+        else
+        {
+            // the first packet cannot be sent, send the remaining packets one
+            // by one so that only the packets which fail themselves are lost
+            for ( ; iNumSent < iNumPackets; iNumSent++ )
+            {
+                const msghdr& MsgHdr = SendBatch.vecMsgHdr[iNumSent].msg_hdr;
+
+                sendto ( UdpSocket,
+                         (const char*) MsgHdr.msg_iov->iov_base,
+                         MsgHdr.msg_iov->iov_len,
+                         0,
+                         (sockaddr*) MsgHdr.msg_name,
+                         MsgHdr.msg_namelen );
+
+                SendBatch.iNumSysCalls++;
+            }
+        }
+    }
+
+    SendBatch.iNumSentPackets = iNumPackets;
+#else
+    // send the packets one by one
+    for ( int i = 0; i < SendBatch.veciNumBytes.Size(); i++ )
+    {
+        if ( SendBatch.veciNumBytes[i] > 0 )
+        {
+            sendto ( UdpSocket,
+                     (const char*) SendBatch.vecpData[i],
+                     SendBatch.veciNumBytes[i],
+                     0,
+                     (sockaddr*) &SendBatch.vecAddr[i],
+                     sizeof ( sockaddr_in ) );
+
+            // the slot is empty for the next frame
+            SendBatch.veciNumBytes[i] = 0;
+            SendBatch.iNumSentPackets++;
+            SendBatch.iNumSysCalls++;
+        }
+    }
+#endif
+}
+
 bool CSocket::GetAndResetbJitterBufferOKFlag()
 {
     // check jitter buffer status
@@ -224,13 +579,39 @@ void CSocket::OnDataReceived()
     use the signal/slot mechanism (i.e. we use messages for that).
 */
 
+#ifdef __linux__
+    // read all available blocks from network interface with one system call
+    // (blocks until at least one block is received)
+    for ( int i = 0; i < NUM_SOCKET_RECV_BATCH; i++ )
+    {
+        // the address length is overwritten on each receive
+        vecRecMsgHdr[i].msg_hdr.msg_namelen = sizeof ( sockaddr_in );
+    }
+
+    const int iNumPackets = recvmmsg ( UdpSocket,
+                                       &vecRecMsgHdr[0],
+                                       NUM_SOCKET_RECV_BATCH,
+                                       MSG_WAITFORONE,
+                                       nullptr );
+
+    // the processing of the received packets must not allocate memory
+    CRtAllocGuardScope RtAllocGuardScope ( RG_SOCKET_THREAD );
+
+    // in case of an error, the number of packets is negative
+    for ( int i = 0; i < iNumPackets; i++ )
+    {
+        ProcessReceivedPacket ( vecvecbyRecBuf[i],
+                                static_cast<int> ( vecRecMsgHdr[i].msg_len ),
+                                vecSenderAddr[i] );
+    }
+#else
     // read block from network interface and query address of sender
     sockaddr_in SenderAddr;
-#ifdef _WIN32
+# ifdef _WIN32
     int SenderAddrSize = sizeof ( sockaddr_in );
-#else
+# else
     socklen_t SenderAddrSize = sizeof ( sockaddr_in );
-#endif
+# endif
 
     const long iNumBytesRead = recvfrom ( UdpSocket,
                                           (char*) &vecbyRecBuf[0],
@@ -239,6 +620,19 @@ void CSocket::OnDataReceived()
                                           (sockaddr*) &SenderAddr,
                                           &SenderAddrSize );
 
+    // the processing of the received packet must not allocate memory
+    CRtAllocGuardScope RtAllocGuardScope ( RG_SOCKET_THREAD );
+
+    ProcessReceivedPacket ( vecbyRecBuf,
+                            static_cast<int> ( iNumBytesRead ),
+                            SenderAddr );
+#endif
+}
+
+void CSocket::ProcessReceivedPacket ( const CVector<uint8_t>& vecbyRecBuf,
+                                      const int               iNumBytesRead,
+                                      const sockaddr_in&      SenderAddr )
+{
     // check if an error occurred or no data could be read
     if ( iNumBytesRead <= 0 )
     {
@@ -250,10 +644,10 @@ void CSocket::OnDataReceived()
     RecHostAddr.iPort = ntohs ( SenderAddr.sin_port );
 
 
-    // check if this is a protocol message
-    int              iRecCounter;
-    int              iRecID;
-    CVector<uint8_t> vecbyMesBodyData;
+    // check if this is a protocol message (the body is parsed in the
+    // preallocated member vector)
+    int iRecCounter;
+    int iRecID;
 
     if ( !CProtocol::ParseMessageFrame ( vecbyRecBuf,
                                          iNumBytesRead,
@@ -261,21 +655,8 @@ void CSocket::OnDataReceived()
                                          iRecCounter,
                                          iRecID ) )
     {
-        // this is a protocol message, check the type of the message
-        if ( CProtocol::IsConnectionLessMessageID ( iRecID ) )
-        {
-
-// TODO a copy of the vector is used -> avoid malloc in real-time routine
-
-            emit ProtcolCLMessageReceived ( iRecID, vecbyMesBodyData, RecHostAddr );
-        }
-        else
-        {
-
-// TODO a copy of the vector is used -> avoid malloc in real-time routine
-
-            emit ProtcolMessageReceived ( iRecCounter, iRecID, vecbyMesBodyData, RecHostAddr );
-        }
+        // this is a protocol message, it is processed in the main thread
+        ProtMessageQueue.Put ( iRecCounter, iRecID, vecbyMesBodyData, RecHostAddr );
     }
     else
     {
@@ -292,14 +673,23 @@ void CSocket::OnDataReceived()
                 break;
 
             case PS_NEW_CONNECTION:
+            {
                 // inform other objects that new connection was established
+                // (this is no steady state, the signal may allocate memory)
+                CRtAllocGuardPause RtAllocGuardPause;
                 emit NewConnection();
+                DetachRecHostAddr();
                 break;
+            }
 
             case PS_AUDIO_INVALID:
+            {
                 // inform about received invalid packet by fireing an event
+                CRtAllocGuardPause RtAllocGuardPause;
                 emit InvalidPacketReceived ( RecHostAddr );
+                DetachRecHostAddr();
                 break;
+            }
 
             default:
                 // do nothing
@@ -314,8 +704,12 @@ void CSocket::OnDataReceived()
 
             if ( pServer->PutAudioData ( vecbyRecBuf, iNumBytesRead, RecHostAddr, iCurChanID ) )
             {
-                // we have a new connection, emit a signal
+                // we have a new connection, emit a signal (this is no steady
+                // state, the signal may allocate memory)
+                CRtAllocGuardPause RtAllocGuardPause;
+
                 emit NewConnection ( iCurChanID, RecHostAddr );
+                DetachRecHostAddr();
 
                 // this was an audio packet, start server if it is in sleep mode
                 if ( !pServer->IsRunning() )
@@ -330,7 +724,10 @@ void CSocket::OnDataReceived()
             if ( iCurChanID == INVALID_CHANNEL_ID )
             {
                 // fire message for the state that no free channel is available
+                CRtAllocGuardPause RtAllocGuardPause;
+
                 emit ServerFull ( RecHostAddr );
+                DetachRecHostAddr();
             }
         }
     }
@@ -28,14 +28,20 @@
 #include <QMessageBox>
 #include <QThread>
 #include <QMutex>
+#include <QAtomicInt>
 #include <vector>
 #include "global.h"
 #include "protocol.h"
 #include "util.h"
+#include "rtallocguard.h"
 #ifndef _WIN32
 # include <netinet/in.h>
 # include <sys/socket.h>
 #endif
+#ifdef __linux__
+# include <sys/uio.h>
+# include <QSocketNotifier>
+#endif
 
 
 // The header files channel.h and server.h require to include this header file
@@ -49,8 +55,171 @@ class CChannel; // forward declaration of CChannel
 // number of ports we try to bind until we give up
 #define NUM_SOCKET_PORTS_TO_TRY         50
 
+// maximum number of datagrams received with one system call (Linux only)
+#define NUM_SOCKET_RECV_BATCH           32
+
+// maximum number of receive threads of the server (Linux only)
+#define MAX_NUM_SOCKET_RECV_THREADS     16
+
+// number of retries of a batch send after a temporary error before the
+// remaining packets are sent one by one (Linux only)
+#define MAX_NUM_SEND_BATCH_RETRIES      3
+
+// number of slots of the queue for the received protocol messages
+#define NUM_PROT_MESSAGE_QUEUE_SLOTS    128
+
+// preallocated size of the message body of each slot in bytes (the memory of a
+// slot is enlarged if a larger message is received)
+#define PROT_MESSAGE_QUEUE_SLOT_SIZE    2048
+
+
+// the server can bind several receive sockets to the same port (Linux only):
+// the first socket creates the port group, the additional sockets join it
+enum ESocketPortGroup
+{
+    PG_NONE   = 0, // the port is used by this socket only
+    PG_CREATE = 1, // first socket of the port group
+    PG_JOIN   = 2  // additional socket of the port group
+};
+
 
 /* Classes ********************************************************************/
+/* Batch of outgoing packets ------------------------------------------------ */
+// The packets of one frame are stored in fixed slots so that several threads
+// can fill different slots without synchronization. The whole batch is then
+// sent with one system call (sendmmsg on Linux). Note that Set() does not
+// copy the packet data, it must stay valid until the batch is sent.
+class CSocketSendBatch
+{
+public:
+    CSocketSendBatch() : iNumSentPackets ( 0 ), iNumSysCalls ( 0 ) { Init ( 0 ); }
+
+    void Init ( const int iNewNumSlots );
+
+    void Set ( const int           iSlot,
+               const uint8_t*      pData,
+               const int           iNumBytes,
+               const CHostAddress& HostAddr );
+
+    // same as Set() but the data is copied in the memory of the slot
+    void SetCopy ( const int           iSlot,
+                   const uint8_t*      pData,
+                   const int           iNumBytes,
+                   const CHostAddress& HostAddr );
+
+    // statistics of the last send of the batch
+    int GetNumSentPackets() const { return iNumSentPackets; }
+    int GetNumSysCalls() const { return iNumSysCalls; }
+
+protected:
+    friend class CSocket;
+
+    CVector<const uint8_t*>    vecpData;
+    CVector<int>               veciNumBytes; // zero for an empty slot
+    CVector<sockaddr_in>       vecAddr;
+    CVector<CVector<uint8_t> > vecvecbyCopy;
+#ifdef __linux__
+    CVector<iovec>             vecIoVec;
+    CVector<mmsghdr>           vecMsgHdr;
+#endif
+    int                        iNumSentPackets;
+    int                        iNumSysCalls;
+};
+
+
+/* Notification of the main thread ------------------------------------------ */
+// A high priority thread wakes up the event loop of the thread which owns this
+// object (usually the main thread) which then emits the Notified() signal. On
+// Linux an eventfd is used, i.e. Notify() does not allocate memory, on the
+// other platforms a queued call is used which allocates an event. Several
+// notifications before the event loop gets to the object lead to one signal,
+// the flag is reset before the signal is emitted so that a notification
+// during the signal processing is not lost.
+class CThreadNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    CThreadNotifier();
+    virtual ~CThreadNotifier();
+
+    // may be called by any thread
+    void Notify();
+
+protected:
+    QAtomicInt       iNotificationPending;
+
+#ifdef __linux__
+    int              iEventFd;
+    QSocketNotifier* pNotifier;
+#endif
+
+protected slots:
+    void OnActivated();
+
+signals:
+    void Notified();
+};
+
+
+/* Queue of received protocol messages -------------------------------------- */
+// The protocol messages are received by the high priority socket thread but
+// processed by the low priority main thread. The socket thread only copies a
+// message in a preallocated slot of a lock-free single producer/single
+// consumer ring and notifies the main thread (see CThreadNotifier). This
+// object must live in the main thread which emits the protocol message
+// signals.
+class CProtMessageQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    CProtMessageQueue();
+
+    // must only be called by the socket thread, returns false if the queue is
+    // full (the message is dropped in that case)
+    bool Put ( const int               iRecCounter,
+               const int               iRecID,
+               const CVector<uint8_t>& vecbyMesBodyData,
+               const CHostAddress&     HostAdr );
+
+protected:
+    class CSlot
+    {
+    public:
+        CSlot() : iRecCounter ( 0 ), iRecID ( 0 ), iIPv4Addr ( 0 ), iPort ( 0 )
+            { vecbyMesBodyData.reserve ( PROT_MESSAGE_QUEUE_SLOT_SIZE ); }
+
+        int              iRecCounter;
+        int              iRecID;
+        CVector<uint8_t> vecbyMesBodyData;
+        quint32          iIPv4Addr;
+        quint16          iPort;
+    };
+
+    // the positions are in the range [0, 2 * number of slots) so that a full
+    // and an empty queue can be distinguished
+    CVector<CSlot>   vecSlots;
+    QAtomicInt       iPutPos;
+    QAtomicInt       iGetPos;
+    bool             bIsProcessing;
+    CThreadNotifier  Notifier;
+
+protected slots:
+    void OnNotification();
+
+signals:
+    void ProtcolMessageReceived ( int              iRecCounter,
+                                  int              iRecID,
+                                  CVector<uint8_t> vecbyMesBodyData,
+                                  CHostAddress     HostAdr );
+
+    void ProtcolCLMessageReceived ( int              iRecID,
+                                    CVector<uint8_t> vecbyMesBodyData,
+                                    CHostAddress     HostAdr );
+};
+
+
 /* Base socket class -------------------------------------------------------- */
 class CSocket : public QObject
 {
@@ -61,12 +230,15 @@ public:
               const quint16 iPortNumber )
         : pChannel ( pNewChannel ),
           bIsClient ( true ),
+          ePortGroup ( PG_NONE ),
           bJitterBufferOK ( true ) { Init ( iPortNumber ); }
 
-    CSocket ( CServer*      pNServP,
-              const quint16 iPortNumber )
+    CSocket ( CServer*               pNServP,
+              const quint16          iPortNumber,
+              const ESocketPortGroup eNPortGroup = PG_NONE )
         : pServer ( pNServP ),
           bIsClient ( false ),
+          ePortGroup ( eNPortGroup ),
           bJitterBufferOK ( true ) { Init ( iPortNumber ); }
 
     virtual ~CSocket();
@@ -74,12 +246,24 @@ public:
     void SendPacket ( const CVector<uint8_t>& vecbySendBuf,
                       const CHostAddress&     HostAddr );
 
+    void SendBatch ( CSocketSendBatch& SendBatch );
+
     bool GetAndResetbJitterBufferOKFlag();
     void Close();
 
 protected:
     void Init ( const quint16 iPortNumber );
 
+    void ProcessReceivedPacket ( const CVector<uint8_t>& vecbyRecBuf,
+                                 const int               iNumBytesRead,
+                                 const sockaddr_in&      SenderAddr );
+
+    // the address of the received packet is shared with a signal which was
+    // just emitted, it is detached right away so that the next received packet
+    // does not allocate memory
+    void DetachRecHostAddr()
+        { RecHostAddr.InetAddr.setAddress ( RecHostAddr.InetAddr.toIPv4Address() ); }
+
 #ifdef _WIN32
     SOCKET           UdpSocket;
 #else
@@ -88,8 +272,21 @@ protected:
 
     QMutex           Mutex;
 
+#ifdef __linux__
+    // preallocated buffers for the batched receive with recvmmsg
+    CVector<CVector<uint8_t> > vecvecbyRecBuf;
+    CVector<sockaddr_in>       vecSenderAddr;
+    CVector<iovec>             vecRecIoVec;
+    CVector<mmsghdr>           vecRecMsgHdr;
+#else
     CVector<uint8_t> vecbyRecBuf;
+#endif
+    CVector<uint8_t> vecbyMesBodyData;
     CHostAddress     RecHostAddr;
+
+    // note that the queue has no parent, i.e., it stays in the main thread if
+    // the socket is moved to the socket thread
+    CProtMessageQueue ProtMessageQueue;
     QHostAddress     SenderAddress;
     quint16          SenderPort;
 
@@ -97,6 +294,7 @@ protected:
     CServer*         pServer;  // for server
 
     bool             bIsClient;
+    ESocketPortGroup ePortGroup;
 
     bool             bJitterBufferOK;
 
@@ -112,15 +310,6 @@ signals:
     void ServerFull ( CHostAddress RecHostAddr );
 
     void InvalidPacketReceived ( CHostAddress RecHostAddr );
-
-    void ProtcolMessageReceived ( int              iRecCounter,
-                                  int              iRecID,
-                                  CVector<uint8_t> vecbyMesBodyData,
-                                  CHostAddress     HostAdr );
-
-    void ProtcolCLMessageReceived ( int              iRecID,
-                                    CVector<uint8_t> vecbyMesBodyData,
-                                    CHostAddress     HostAdr );
 };
 
 
@@ -136,15 +325,46 @@ class CHighPrioSocket : public QObject
 public:
     CHighPrioSocket ( CChannel*     pNewChannel,
                       const quint16 iPortNumber )
-        : Socket ( pNewChannel, iPortNumber ) { Init(); }
+        : iNumRecvThreads ( 1 ),
+          Socket ( pNewChannel, iPortNumber ) { Init(); }
 
     CHighPrioSocket ( CServer*      pNewServer,
-                      const quint16 iPortNumber )
-        : Socket ( pNewServer, iPortNumber ) { Init(); }
+                      const quint16 iPortNumber,
+                      const int     iNewNumRecvThreads = 1 )
+        : iNumRecvThreads ( GetNumRecvThreads ( iNewNumRecvThreads ) ),
+          Socket ( pNewServer, iPortNumber, ( iNumRecvThreads > 1 ) ? PG_CREATE : PG_NONE )
+    {
+        Init();
+
+        // the additional receive sockets are bound to the same port, the
+        // kernel distributes the received packets on the sockets by the
+        // sender address (i.e. the packets of a client are always received
+        // by the same thread)
+        for ( int i = 1; i < iNumRecvThreads; i++ )
+        {
+            CSocket* pNewSocket = new CSocket ( pNewServer, iPortNumber, PG_JOIN );
+
+            vecpAddSockets.Add ( pNewSocket );
+            vecpAddThreads.Add ( new CSocketThread ( pNewSocket ) );
+
+            pNewSocket->moveToThread ( vecpAddThreads[i - 1] );
+
+            QObject::connect ( pNewSocket,
+                SIGNAL ( InvalidPacketReceived ( CHostAddress ) ),
+                SIGNAL ( InvalidPacketReceived ( CHostAddress ) ) );
+        }
+    }
 
     virtual ~CHighPrioSocket()
     {
         NetworkWorkerThread.Stop();
+
+        for ( int i = 0; i < vecpAddThreads.Size(); i++ )
+        {
+            vecpAddThreads[i]->Stop();
+            delete vecpAddThreads[i];
+            delete vecpAddSockets[i];
+        }
     }
 
     void Start()
@@ -152,14 +372,26 @@ public:
         // starts the high priority socket receive thread (with using blocking
         // socket request call)
         NetworkWorkerThread.start ( QThread::TimeCriticalPriority );
+
+        for ( int i = 0; i < vecpAddThreads.Size(); i++ )
+        {
+            vecpAddThreads[i]->start ( QThread::TimeCriticalPriority );
+        }
     }
 
+    int GetNumRecvThreads() const { return iNumRecvThreads; }
+
     void SendPacket ( const CVector<uint8_t>& vecbySendBuf,
                       const CHostAddress&     HostAddr )
     {
         Socket.SendPacket ( vecbySendBuf, HostAddr );
     }
 
+    void SendBatch ( CSocketSendBatch& SendBatch )
+    {
+        Socket.SendBatch ( SendBatch );
+    }
+
     bool GetAndResetbJitterBufferOKFlag()
     {
         return Socket.GetAndResetbJitterBufferOKFlag();
@@ -222,8 +454,24 @@ protected:
             SIGNAL ( InvalidPacketReceived ( CHostAddress ) ) );
     }
 
-    CSocketThread NetworkWorkerThread;
-    CSocket       Socket;
+    static int GetNumRecvThreads ( const int iNewNumRecvThreads )
+    {
+#ifdef __linux__
+        return std::max ( 1, std::min ( iNewNumRecvThreads, MAX_NUM_SOCKET_RECV_THREADS ) );
+#else
+        // several sockets on the same port are only supported on Linux
+        Q_UNUSED ( iNewNumRecvThreads )
+        return 1;
+#endif
+    }
+
+    int                     iNumRecvThreads;
+    CSocketThread           NetworkWorkerThread;
+    CSocket                 Socket;
+
+    // additional receive sockets/threads of the server
+    CVector<CSocket*>       vecpAddSockets;
+    CVector<CSocketThread*> vecpAddThreads;
 
 signals:
     void InvalidPacketReceived ( CHostAddress RecHostAddr );
@@ -29,13 +29,145 @@
 #include <QDateTime>
 #include <QUdpSocket>
 #include <QHostAddress>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QMutex>
+#include <ctime>
+#ifdef __linux__
+# include <unistd.h>
+#endif
 #include "global.h"
 #include "socket.h"
 #include "protocol.h"
+#include "buffer.h"
+#include "driftcomp.h"
 #include "util.h"
 
 
 /* Classes ********************************************************************/
+// Reference network buffer with statistic -------------------------------------
+// Uses the previous implementation of the statistic with one simulation
+// network buffer per simulated buffer size as a reference for the fill level
+// counters of CNetBufWithStats.
+class CRefNetBufWithStats : public CNetBufWithStats
+{
+public:
+    CRefNetBufWithStats()
+    {
+        for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+        {
+            SimulationBuffer[i].SetIsSimulation ( true );
+        }
+    }
+
+    void Init ( const int  iNewBlockSize,
+                const int  iNewNumBlocks,
+                const bool bPreserve = false )
+    {
+        CNetBufWithStats::Init ( iNewBlockSize, iNewNumBlocks, bPreserve );
+
+        if ( !bPreserve )
+        {
+            for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+            {
+                SimulationBuffer[i].Init ( iNewBlockSize, viBufSizesForSim[i] );
+            }
+        }
+    }
+
+    virtual bool Put ( const CVector<uint8_t>& vecbyData, const int iInSize )
+    {
+        const bool bPutOK = CNetBuf::Put ( vecbyData, iInSize );
+
+        for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+        {
+            ErrorRateStatistic[i].Update (
+                !SimulationBuffer[i].Put ( vecbyData, iInSize ) );
+        }
+
+        return bPutOK;
+    }
+
+    virtual bool Get ( CVector<uint8_t>& vecbyData, const int iOutSize )
+    {
+        const bool bGetOK = CNetBuf::Get ( vecbyData, iOutSize );
+
+        for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+        {
+            ErrorRateStatistic[i].Update (
+                !SimulationBuffer[i].Get ( vecbyData, iOutSize ) );
+        }
+
+        UpdateAutoSetting();
+
+        return bGetOK;
+    }
+
+protected:
+    CNetBuf SimulationBuffer[NUM_STAT_SIMULATION_BUFFERS];
+};
+
+
+// Producer thread of the lock-free network buffer stress test -----------------
+// Puts numbered blocks in the buffer (a put contains one or two blocks), a
+// failed put is repeated until the consumer has made room for the packet.
+class CNetBufStressProducer : public QThread
+{
+public:
+    CNetBufStressProducer ( CLockFreeNetBufWithStats& NNetBuf,
+                            const int                 iNBlockSize,
+                            const int                 iNNumBlocks ) :
+        NetBuf      ( NNetBuf ),
+        iBlockSize  ( iNBlockSize ),
+        iNumBlocks  ( iNNumBlocks ),
+        iNumRetries ( 0 ) {}
+
+    // the content of a block is defined by its number
+    static void FillBlock ( uint8_t* pbyData, const int iBlockNum, const int iBlockSize )
+    {
+        for ( int k = 0; k < iBlockSize; k++ )
+        {
+            pbyData[k] = static_cast<uint8_t> ( iBlockNum * 31 + k );
+        }
+    }
+
+    int GetNumRetries() const { return iNumRetries; }
+
+protected:
+    virtual void run()
+    {
+        CVector<uint8_t> vecbyData ( 2 * iBlockSize, 0 );
+        int              iBlockNum = 0;
+
+        while ( iBlockNum < iNumBlocks )
+        {
+            const int iNumBlocksInPut = ( ( iBlockNum % 7 ) == 3 ) ? std::min ( 2, iNumBlocks - iBlockNum ) : 1;
+
+            for ( int i = 0; i < iNumBlocksInPut; i++ )
+            {
+                FillBlock ( &vecbyData[i * iBlockSize], iBlockNum + i, iBlockSize );
+            }
+
+            if ( NetBuf.Put ( vecbyData, iNumBlocksInPut * iBlockSize ) )
+            {
+                iBlockNum += iNumBlocksInPut;
+            }
+            else
+            {
+                iNumRetries++;
+                QThread::yieldCurrentThread();
+            }
+        }
+    }
+
+    CLockFreeNetBufWithStats& NetBuf;
+    int                       iBlockSize;
+    int                       iNumBlocks;
+    int                       iNumRetries;
+};
+
+
+// Test bench ------------------------------------------------------------------
 class CTestbench : public QObject
 {
     Q_OBJECT
@@ -71,7 +203,870 @@ public:
         Timer.start ( 1 ); // 1 ms
     }
 
+    // Micro benchmark of the protocol frame CRC: the table driven CRC is
+    // compared with the previous bit serial implementation (the results must
+    // be identical) and the throughput of the frame parsing is measured.
+    static void RunCRCBenchmark()
+    {
+        const int iNumFrames   = 1000;
+        const int iNumRuns     = 200;
+        const int iMaxBodySize = 200; // typical size of protocol messages
+
+        // generate random protocol message frames
+        CVector<CVector<uint8_t> > vecvecbyFrames ( iNumFrames );
+        CVector<uint8_t>           vecbyBody;
+        qint64                     iNumBytes = 0;
+
+        for ( int i = 0; i < iNumFrames; i++ )
+        {
+            const int iBodySize = rand() % iMaxBodySize;
+
+            vecvecbyFrames[i].Init ( MESS_LEN_WITHOUT_DATA_BYTE + iBodySize, 0 );
+
+            uint8_t* pbyFrame = vecvecbyFrames[i].data();
+
+            pbyFrame[2] = static_cast<uint8_t> ( rand() ); // ID
+            pbyFrame[4] = static_cast<uint8_t> ( rand() ); // cnt
+            pbyFrame[5] = static_cast<uint8_t> ( iBodySize & 0xFF );
+            pbyFrame[6] = static_cast<uint8_t> ( iBodySize >> 8 );
+
+            for ( int j = 0; j < iBodySize; j++ )
+            {
+                pbyFrame[MESS_HEADER_LENGTH_BYTE + j] = static_cast<uint8_t> ( rand() );
+            }
+
+            CCRC CRCObj;
+            CRCObj.AddBytes ( pbyFrame, MESS_HEADER_LENGTH_BYTE + iBodySize );
+
+            const uint32_t iCRC = CRCObj.GetCRC();
+
+            pbyFrame[MESS_HEADER_LENGTH_BYTE + iBodySize]     = static_cast<uint8_t> ( iCRC & 0xFF );
+            pbyFrame[MESS_HEADER_LENGTH_BYTE + iBodySize + 1] = static_cast<uint8_t> ( iCRC >> 8 );
+
+            // the results of all implementations must be identical
+            CCRC CRCObjByteWise;
+
+            for ( int j = 0; j < MESS_HEADER_LENGTH_BYTE + iBodySize; j++ )
+            {
+                CRCObjByteWise.AddByte ( pbyFrame[j] );
+            }
+
+            if ( ( CRCObjByteWise.GetCRC() != iCRC ) ||
+                 ( GetBitSerialCRC ( pbyFrame, MESS_HEADER_LENGTH_BYTE + iBodySize ) != iCRC ) )
+            {
+                qWarning() << "CRC benchmark: the CRC implementations differ";
+                return;
+            }
+
+            iNumBytes += vecvecbyFrames[i].Size();
+        }
+
+        QElapsedTimer Timer;
+        uint32_t      iDummy = 0; // avoids that the compiler removes the loops
+
+        // previous bit serial implementation
+        Timer.start();
+
+        for ( int iRun = 0; iRun < iNumRuns; iRun++ )
+        {
+            for ( int i = 0; i < iNumFrames; i++ )
+            {
+                iDummy += GetBitSerialCRC ( vecvecbyFrames[i].data(), vecvecbyFrames[i].Size() - 2 );
+            }
+        }
+
+        const qint64 iBitSerialNs = Timer.nsecsElapsed();
+
+        // table driven implementation
+        Timer.start();
+
+        for ( int iRun = 0; iRun < iNumRuns; iRun++ )
+        {
+            for ( int i = 0; i < iNumFrames; i++ )
+            {
+                CCRC CRCObj;
+                CRCObj.AddBytes ( vecvecbyFrames[i].data(), vecvecbyFrames[i].Size() - 2 );
+                iDummy += CRCObj.GetCRC();
+            }
+        }
+
+        const qint64 iTableNs = Timer.nsecsElapsed();
+
+        // complete frame parsing (header, CRC check and body extraction)
+        int iCnt;
+        int iID;
+
+        vecbyBody.reserve ( iMaxBodySize );
+        Timer.start();
+
+        for ( int iRun = 0; iRun < iNumRuns; iRun++ )
+        {
+            for ( int i = 0; i < iNumFrames; i++ )
+            {
+                if ( CProtocol::ParseMessageFrame ( vecvecbyFrames[i],
+                                                    vecvecbyFrames[i].Size(),
+                                                    vecbyBody,
+                                                    iCnt,
+                                                    iID ) )
+                {
+                    qWarning() << "CRC benchmark: frame parsing failed";
+                    return;
+                }
+
+                iDummy += static_cast<uint32_t> ( iID );
+            }
+        }
+
+        const qint64 iParseNs = Timer.nsecsElapsed();
+
+        // throughput in MB/s (bytes per microsecond)
+        const double dTotalBytes = static_cast<double> ( iNumBytes ) * iNumRuns;
+
+        qDebug() << "CRC benchmark (" << iDummy << "):" <<
+            "bit serial CRC" << dTotalBytes * 1000 / std::max ( iBitSerialNs, qint64 ( 1 ) ) << "MB/s," <<
+            "table driven CRC" << dTotalBytes * 1000 / std::max ( iTableNs, qint64 ( 1 ) ) << "MB/s," <<
+            "frame parsing" << dTotalBytes * 1000 / std::max ( iParseNs, qint64 ( 1 ) ) << "MB/s";
+    }
+
+    // Micro benchmark of the server send path: the previous per client send
+    // (lock the channel mutex, copy the packet in a new vector, lock the
+    // socket mutex, sendto) is compared with the batched send (fill the
+    // message headers, sendmmsg until all packets are sent). Packets of
+    // 200 bytes are sent to N bound loopback sockets which are never read,
+    // the process CPU time per frame is reported (Linux only).
+    static void RunSendBatchBenchmark()
+    {
+#ifdef __linux__
+        const int iNumFrames       = 20000;
+        const int iPacketSize      = 200;
+        const int veciNumClients[] = { 50, 250 };
+
+        for ( const int iNumClients : veciNumClients )
+        {
+            // receiving sockets (bound to a free port on the loopback device)
+            CVector<int>         veciRecSock ( iNumClients );
+            CVector<sockaddr_in> vecAddr ( iNumClients );
+
+            for ( int i = 0; i < iNumClients; i++ )
+            {
+                socklen_t iAddrLen = sizeof ( sockaddr_in );
+
+                veciRecSock[i] = socket ( AF_INET, SOCK_DGRAM, 0 );
+
+                vecAddr[i]                 = sockaddr_in();
+                vecAddr[i].sin_family      = AF_INET;
+                vecAddr[i].sin_port        = 0;
+                vecAddr[i].sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+
+                if ( ( veciRecSock[i] < 0 ) ||
+                     ( bind ( veciRecSock[i], (sockaddr*) &vecAddr[i], sizeof ( sockaddr_in ) ) != 0 ) ||
+                     ( getsockname ( veciRecSock[i], (sockaddr*) &vecAddr[i], &iAddrLen ) != 0 ) )
+                {
+                    qWarning() << "send batch benchmark: cannot bind the receiving sockets";
+                    return;
+                }
+            }
+
+            const int        iSendSock = socket ( AF_INET, SOCK_DGRAM, 0 );
+            CVector<uint8_t> vecbyPacket ( iPacketSize, 0x55 );
+            QMutex           ChanMutex;
+            QMutex           SocketMutex;
+
+            // previous implementation: one system call per client
+            const clock_t iSendToStart = clock();
+
+            for ( int iFrame = 0; iFrame < iNumFrames; iFrame++ )
+            {
+                for ( int i = 0; i < iNumClients; i++ )
+                {
+                    ChanMutex.lock();
+                    CVector<uint8_t> vecbySendBuf ( vecbyPacket );
+                    ChanMutex.unlock();
+
+                    SocketMutex.lock();
+                    sendto ( iSendSock,
+                             (const char*) vecbySendBuf.data(),
+                             vecbySendBuf.Size(),
+                             0,
+                             (sockaddr*) &vecAddr[i],
+                             sizeof ( sockaddr_in ) );
+                    SocketMutex.unlock();
+                }
+            }
+
+            const clock_t iSendToTicks = clock() - iSendToStart;
+
+            // batched implementation: one system call per frame
+            CVector<iovec>   vecIoVec ( iNumClients );
+            CVector<mmsghdr> vecMsgHdr ( iNumClients );
+            int              iNumSysCalls = 0;
+
+            const clock_t iBatchStart = clock();
+
+            for ( int iFrame = 0; iFrame < iNumFrames; iFrame++ )
+            {
+                for ( int i = 0; i < iNumClients; i++ )
+                {
+                    msghdr& MsgHdr = vecMsgHdr[i].msg_hdr;
+
+                    vecIoVec[i].iov_base = vecbyPacket.data();
+                    vecIoVec[i].iov_len  = static_cast<size_t> ( iPacketSize );
+
+                    MsgHdr             = msghdr();
+                    MsgHdr.msg_name    = &vecAddr[i];
+                    MsgHdr.msg_namelen = sizeof ( sockaddr_in );
+                    MsgHdr.msg_iov     = &vecIoVec[i];
+                    MsgHdr.msg_iovlen  = 1;
+                }
+
+                int iNumSent = 0;
+
+                while ( iNumSent < iNumClients )
+                {
+                    const int iRet = sendmmsg ( iSendSock,
+                                                &vecMsgHdr[iNumSent],
+                                                static_cast<unsigned int> ( iNumClients - iNumSent ),
+                                                0 );
+
+                    iNumSysCalls++;
+                    iNumSent += std::max ( iRet, 1 );
+                }
+            }
+
+            const clock_t iBatchTicks = clock() - iBatchStart;
+
+            close ( iSendSock );
+
+            for ( int i = 0; i < iNumClients; i++ )
+            {
+                close ( veciRecSock[i] );
+            }
+
+            // CPU time per frame in microseconds
+            const double dTicksToUs = 1e6 / CLOCKS_PER_SEC / iNumFrames;
+
+            qDebug() << "send batch benchmark," << iNumClients << "clients:" <<
+                "sendto" << iSendToTicks * dTicksToUs << "us/frame" << iNumClients << "syscalls/frame," <<
+                "sendmmsg" << iBatchTicks * dTicksToUs << "us/frame" <<
+                static_cast<double> ( iNumSysCalls ) / iNumFrames << "syscalls/frame";
+        }
+#endif
+    }
+
+    // Regression test of the jitter buffer statistic: a packet arrival trace
+    // with network jitter, packet bursts, losses and buffer size changes is
+    // replayed into the network buffers with statistic and into the reference
+    // implementation. The error rates and the auto jitter buffer decisions
+    // must be identical after each get.
+    static bool RunNetBufStatsRegressionTest()
+    {
+        const int iNumGets      = 200000;
+        const int iBlockSize    = 43; // arbitrary packet size in bytes
+        bool      bResultsEqual = true;
+
+        for ( int iDoubleFrameSize = 0; ( iDoubleFrameSize < 2 ) && bResultsEqual; iDoubleFrameSize++ )
+        {
+            CNetBufWithStats         NetBuf;
+            CLockFreeNetBufWithStats LockFreeNetBuf;
+            CRefNetBufWithStats      RefNetBuf;
+            CVector<uint8_t>         vecbyData ( 2 * iBlockSize, 0 );
+            CVector<double>          vecErrRates, vecLockFreeErrRates, vecRefErrRates;
+            double                   dLimit, dMaxUpLimit;
+            int                      iCurNumBlocks = 6;
+
+            srand ( 1234 + iDoubleFrameSize );
+
+            NetBuf.SetUseDoubleSystemFrameSize ( iDoubleFrameSize != 0 );
+            LockFreeNetBuf.SetUseDoubleSystemFrameSize ( iDoubleFrameSize != 0 );
+            RefNetBuf.SetUseDoubleSystemFrameSize ( iDoubleFrameSize != 0 );
+
+            NetBuf.Init ( iBlockSize, iCurNumBlocks );
+            LockFreeNetBuf.Init ( iBlockSize, iCurNumBlocks );
+            RefNetBuf.Init ( iBlockSize, iCurNumBlocks );
+
+            for ( int iGet = 0; ( iGet < iNumGets ) && bResultsEqual; iGet++ )
+            {
+                // the jitter level changes every few seconds so that all
+                // simulated buffer sizes see errors
+                const int iJitter = ( iGet / 5000 ) % 6;
+
+                // number of packets which arrived since the last get (on
+                // average one packet per get)
+                int iNumPuts = 1;
+
+                if ( ( rand() % 10 ) < iJitter )
+                {
+                    iNumPuts = ( ( rand() % 2 ) == 0 ) ? 0 : std::min ( iJitter, 4 );
+                }
+
+                if ( ( rand() % 1000 ) == 0 )
+                {
+                    iNumPuts += 10; // burst after a network stall
+                }
+
+                for ( int i = 0; i < iNumPuts; i++ )
+                {
+                    // occasionally a packet with a wrong size or with two
+                    // blocks is put (also within a burst so that the lock-free
+                    // buffer must keep the size of each pending put)
+                    const int iSizeSel = rand() % 1000;
+                    const int iPutSize = ( iSizeSel == 0 ) ? iBlockSize / 2 :
+                                         ( iSizeSel == 1 ) ? 2 * iBlockSize : iBlockSize;
+
+                    const bool bPutOK = NetBuf.Put ( vecbyData, iPutSize );
+
+                    if ( ( LockFreeNetBuf.Put ( vecbyData, iPutSize ) != bPutOK ) ||
+                         ( RefNetBuf.Put ( vecbyData, iPutSize ) != bPutOK ) )
+                    {
+                        bResultsEqual = false;
+                    }
+                }
+
+                const bool bGetOK = NetBuf.Get ( vecbyData, iBlockSize );
+
+                if ( ( LockFreeNetBuf.Get ( vecbyData, iBlockSize ) != bGetOK ) ||
+                     ( RefNetBuf.Get ( vecbyData, iBlockSize ) != bGetOK ) )
+                {
+                    bResultsEqual = false;
+                }
+
+                // compare the statistic and the auto setting decisions
+                NetBuf.GetErrorRates ( vecErrRates, dLimit, dMaxUpLimit );
+                LockFreeNetBuf.GetErrorRates ( vecLockFreeErrRates, dLimit, dMaxUpLimit );
+                RefNetBuf.GetErrorRates ( vecRefErrRates, dLimit, dMaxUpLimit );
+
+                if ( ( vecErrRates != vecRefErrRates ) ||
+                     ( vecLockFreeErrRates != vecRefErrRates ) ||
+                     ( NetBuf.GetAutoSetting() != RefNetBuf.GetAutoSetting() ) ||
+                     ( LockFreeNetBuf.GetAutoSetting() != RefNetBuf.GetAutoSetting() ) )
+                {
+                    bResultsEqual = false;
+                }
+
+                // apply the auto setting from time to time like the channel
+                // does (the statistic is preserved in this case)
+                if ( ( iGet % 1000 == 999 ) && ( RefNetBuf.GetAutoSetting() != iCurNumBlocks ) )
+                {
+                    iCurNumBlocks = RefNetBuf.GetAutoSetting();
+
+                    NetBuf.Init ( iBlockSize, iCurNumBlocks, true );
+                    LockFreeNetBuf.Init ( iBlockSize, iCurNumBlocks, true );
+                    RefNetBuf.Init ( iBlockSize, iCurNumBlocks, true );
+                }
+            }
+        }
+
+        if ( bResultsEqual )
+        {
+            qDebug() << "network buffer statistic regression test: passed";
+        }
+        else
+        {
+            qWarning() << "network buffer statistic regression test: FAILED";
+        }
+
+        return bResultsEqual;
+    }
+
+    // Test of the sequence number support of the jitter buffer: the packets
+    // of a stream are delayed by a random network delay, some are lost and
+    // some are duplicated. The jitter buffer is large enough for the delay,
+    // therefore the played packets must be in order and only the packets
+    // which were not sent must be skipped and reported as lost.
+    static bool RunNetBufSeqNumTest()
+    {
+        const int                iNumPackets = 100000;
+        const int                iBlockSize  = 43; // arbitrary packet size in bytes
+        const int                iMaxDelay   = 4;  // in packet intervals
+        CLockFreeNetBufWithStats NetBuf;
+        CVector<uint8_t>         vecbyData ( iBlockSize, 0 );
+        CVector<int>             vecDelayLine[iMaxDelay + 1];
+        CVector<int>             veciIsSent ( iNumPackets, 0 );
+        CNetBufSeqStatistic      SeqStatistic;
+        int                      iLastPlayed = -1;
+        int                      iNumSkipped = 0;
+        int                      iNumLost    = 0;
+        int                      iNumNotSent = 0;
+        bool                     bTestOK     = true;
+
+        srand ( 4321 );
+
+        NetBuf.Init ( iBlockSize, 10 );
+
+        for ( int iTime = 0; iTime < iNumPackets + iMaxDelay; iTime++ )
+        {
+            // send a packet (the packets in the delay line are sorted by the
+            // arrival time, the sequence number is stored in the data)
+            if ( iTime < iNumPackets )
+            {
+                const int iNumCopies = ( ( rand() % 100 ) == 0 ) ? 0 : ( ( rand() % 200 ) == 0 ) ? 2 : 1;
+
+                for ( int i = 0; i < iNumCopies; i++ )
+                {
+                    vecDelayLine[rand() % ( iMaxDelay + 1 )].Add ( iTime );
+                }
+
+                veciIsSent[iTime] = ( iNumCopies > 0 );
+            }
+
+            // receive the packets which arrive now
+            for ( int i = 0; i < vecDelayLine[0].Size(); i++ )
+            {
+                vecbyData[0] = static_cast<uint8_t> ( vecDelayLine[0][i] & 0xFF );
+                vecbyData[1] = static_cast<uint8_t> ( ( vecDelayLine[0][i] >> 8 ) & 0xFF );
+                vecbyData[2] = static_cast<uint8_t> ( vecDelayLine[0][i] >> 16 );
+
+                NetBuf.PutWithSeqNum ( vecbyData,
+                                       iBlockSize,
+                                       static_cast<uint16_t> ( vecDelayLine[0][i] ),
+                                       static_cast<uint16_t> ( vecDelayLine[0][i] * SYSTEM_FRAME_SIZE_SAMPLES ) );
+            }
+
+            for ( int i = 0; i < iMaxDelay; i++ )
+            {
+                vecDelayLine[i] = vecDelayLine[i + 1];
+            }
+
+            vecDelayLine[iMaxDelay].Init ( 0 );
+
+            // play one packet after the jitter buffer is filled
+            if ( iTime >= iMaxDelay )
+            {
+                if ( NetBuf.Get ( vecbyData, iBlockSize ) )
+                {
+                    const int iPlayed = vecbyData[0] | ( vecbyData[1] << 8 ) | ( vecbyData[2] << 16 );
+
+                    if ( iPlayed <= iLastPlayed )
+                    {
+                        bTestOK = false;
+                    }
+
+                    if ( iLastPlayed >= 0 )
+                    {
+                        iNumSkipped += iPlayed - iLastPlayed - 1;
+                    }
+
+                    iLastPlayed = iPlayed;
+                }
+            }
+
+            // the statistic is read from time to time
+            if ( iTime % 1000 == 0 )
+            {
+                SeqStatistic = NetBuf.GetAndResetSeqStatistic();
+                iNumLost    += SeqStatistic.iNumLost;
+            }
+        }
+
+        SeqStatistic = NetBuf.GetAndResetSeqStatistic();
+        iNumLost    += SeqStatistic.iNumLost;
+
+        // exactly the packets which were not sent must be skipped, the lost
+        // packets after the last played packet may be reported, too
+        for ( int i = 0; i < iLastPlayed; i++ )
+        {
+            if ( !veciIsSent[i] )
+            {
+                iNumNotSent++;
+            }
+        }
+
+        if ( ( iNumSkipped != iNumNotSent ) || ( iNumLost < iNumSkipped ) || ( iNumLost > iNumSkipped + iMaxDelay ) )
+        {
+            bTestOK = false;
+        }
+
+        if ( bTestOK )
+        {
+            qDebug() << "network buffer sequence number test: passed," << iNumLost << "lost packets";
+        }
+        else
+        {
+            qWarning() << "network buffer sequence number test: FAILED";
+        }
+
+        return bTestOK;
+    }
+
+    // Stress test of the lock-free jitter buffer with one producer and one
+    // consumer thread: the producer puts numbered blocks (with one or two
+    // blocks per put) while the consumer gets the blocks, reads the statistic
+    // and re-initializes the buffer from time to time with the data being
+    // preserved. All blocks must be received in order and uncorrupted.
+    static bool RunNetBufStressTest()
+    {
+        const int                iNumBlocks  = 2000000;
+        const int                iBlockSize  = 43; // arbitrary packet size in bytes
+        const int                iBufNumBl   = 8;
+        CLockFreeNetBufWithStats NetBuf;
+        CNetBufStressProducer    Producer ( NetBuf, iBlockSize, iNumBlocks );
+        CVector<uint8_t>         vecbyData ( iBlockSize, 0 );
+        CVector<uint8_t>         vecbyExpected ( iBlockSize, 0 );
+        CVector<double>          vecErrRates;
+        double                   dLimit, dMaxUpLimit;
+        QElapsedTimer            Timer;
+        int                      iNextBlockNum = 0;
+        int                      iNumGets      = 0;
+        bool                     bTestOK       = true;
+
+        NetBuf.Init ( iBlockSize, iBufNumBl );
+
+        Timer.start();
+        Producer.start();
+
+        while ( bTestOK && ( iNextBlockNum < iNumBlocks ) )
+        {
+            if ( NetBuf.Get ( vecbyData, iBlockSize ) )
+            {
+                CNetBufStressProducer::FillBlock ( &vecbyExpected[0], iNextBlockNum, iBlockSize );
+
+                if ( vecbyData != vecbyExpected )
+                {
+                    qWarning() << "network buffer stress test: wrong block" << iNextBlockNum;
+                    bTestOK = false;
+                }
+
+                iNextBlockNum++;
+            }
+            else
+            {
+                QThread::yieldCurrentThread();
+            }
+
+            // the consumer side accesses of the channel
+            NetBuf.GetErrorRates ( vecErrRates, dLimit, dMaxUpLimit );
+            NetBuf.GetFillLevel ( 1000 );
+
+            if ( ( ++iNumGets % 5000 ) == 0 )
+            {
+                NetBuf.Init ( iBlockSize, iBufNumBl, true );
+            }
+
+            if ( Timer.elapsed() > 60000 )
+            {
+                qWarning() << "network buffer stress test: timeout at block" << iNextBlockNum;
+                bTestOK = false;
+            }
+        }
+
+        if ( !bTestOK )
+        {
+            // stop the producer by emptying the buffer until it is done
+            while ( !Producer.isFinished() )
+            {
+                NetBuf.Get ( vecbyData, iBlockSize );
+            }
+        }
+
+        Producer.wait();
+
+        if ( bTestOK )
+        {
+            qDebug() << "network buffer stress test: passed," << iNumGets << "gets," <<
+                Producer.GetNumRetries() << "repeated puts," << Timer.elapsed() << "ms";
+        }
+        else
+        {
+            qWarning() << "network buffer stress test: FAILED";
+        }
+
+        return bTestOK;
+    }
+
+    // Test of the redundant audio data: each packet carries a copy of the
+    // previous packet, a single lost packet must be recovered and the auto
+    // setting of the jitter buffer must be smaller than without the redundant
+    // copies.
+    static bool RunNetBufRedundancyTest()
+    {
+        const int                iNumPackets = 100000;
+        const int                iBlockSize  = 43; // arbitrary packet size in bytes
+        CLockFreeNetBufWithStats NetBuf;
+        CLockFreeNetBufWithStats RedNetBuf;
+        CVector<uint8_t>         vecbyPacket ( 2 * iBlockSize, 0 );
+        CVector<uint8_t>         vecbyData ( iBlockSize, 0 );
+        CNetBufSeqStatistic      SeqStatistic;
+        int                      iNumLost    = 0;
+        int                      iNumRedLost = 0;
+        int                      iLastPlayed = -1;
+        bool                     bTestOK     = true;
+
+        srand ( 5678 );
+
+        NetBuf.Init ( iBlockSize, 10 );
+        RedNetBuf.Init ( iBlockSize, 10 );
+
+        for ( int iSeqNum = 0; iSeqNum < iNumPackets; iSeqNum++ )
+        {
+            // the packet contains the sequence number of the current and the
+            // previous audio data, 2 % of the packets are lost (the sequence
+            // numbers are stored with 16 bits)
+            vecbyPacket[0]              = static_cast<uint8_t> ( iSeqNum & 0xFF );
+            vecbyPacket[1]              = static_cast<uint8_t> ( ( iSeqNum >> 8 ) & 0xFF );
+            vecbyPacket[iBlockSize]     = static_cast<uint8_t> ( ( iSeqNum - 1 ) & 0xFF );
+            vecbyPacket[iBlockSize + 1] = static_cast<uint8_t> ( ( ( iSeqNum - 1 ) >> 8 ) & 0xFF );
+
+            if ( ( rand() % 50 ) != 0 )
+            {
+                NetBuf.PutWithSeqNum ( vecbyPacket,
+                                       iBlockSize,
+                                       static_cast<uint16_t> ( iSeqNum ),
+                                       static_cast<uint16_t> ( iSeqNum * SYSTEM_FRAME_SIZE_SAMPLES ) );
+
+                if ( iSeqNum > 0 )
+                {
+                    RedNetBuf.PutRedundantCopy ( vecbyPacket,
+                                                 iBlockSize,
+                                                 iBlockSize,
+                                                 static_cast<uint16_t> ( iSeqNum - 1 ) );
+                }
+
+                RedNetBuf.PutWithSeqNum ( vecbyPacket,
+                                          iBlockSize,
+                                          static_cast<uint16_t> ( iSeqNum ),
+                                          static_cast<uint16_t> ( iSeqNum * SYSTEM_FRAME_SIZE_SAMPLES ) );
+            }
+
+            // play one packet after two packets were sent
+            if ( iSeqNum >= 2 )
+            {
+                NetBuf.Get ( vecbyData, iBlockSize );
+
+                if ( RedNetBuf.Get ( vecbyData, iBlockSize ) )
+                {
+                    const int iPlayed = vecbyData[0] | ( vecbyData[1] << 8 );
+
+                    if ( ( iLastPlayed >= 0 ) &&
+                         ( static_cast<int16_t> ( iPlayed - iLastPlayed ) <= 0 ) )
+                    {
+                        bTestOK = false;
+                    }
+
+                    iLastPlayed = iPlayed;
+                }
+            }
+
+            if ( iSeqNum % 1000 == 0 )
+            {
+                iNumLost    += NetBuf.GetAndResetSeqStatistic().iNumLost;
+                iNumRedLost += RedNetBuf.GetAndResetSeqStatistic().iNumLost;
+            }
+        }
+
+        // only two consecutive lost packets cannot be recovered (about 2 % of
+        // the lost packets) and the recovered packets allow a smaller buffer
+        if ( ( iNumRedLost > iNumLost / 10 ) ||
+             ( RedNetBuf.GetAutoSetting() >= NetBuf.GetAutoSetting() ) )
+        {
+            bTestOK = false;
+        }
+
+        if ( bTestOK )
+        {
+            qDebug() << "network buffer redundancy test: passed," << iNumLost << "lost packets without and" <<
+                iNumRedLost << "with redundancy, auto setting" << NetBuf.GetAutoSetting() << "without and" <<
+                RedNetBuf.GetAutoSetting() << "with redundancy";
+        }
+        else
+        {
+            qWarning() << "network buffer redundancy test: FAILED";
+        }
+
+        return bTestOK;
+    }
+
+    // Test of the clock drift compensator: a sine is sent by a client whose
+    // clock is faster or slower than the server clock, the jitter buffer is
+    // modelled by the number of stored frames. The fill level must settle at
+    // the centre of the jitter buffer without overruns and underruns. The
+    // delay of the compensator is estimated from the phase of the output
+    // frames, it must stay within one frame plus the filter look-ahead (the
+    // fractional read position can reduce it by up to two samples) and it must
+    // be the look-ahead only if there is no drift.
+    static bool RunDriftCompTest()
+    {
+        const int    iFrameSize   = SYSTEM_FRAME_SIZE_SAMPLES;
+        const int    iBufNumBl    = 6;
+        const int    iNumFrames   = 120 * SYSTEM_SAMPLE_RATE_HZ / iFrameSize; // 120 s
+        const int    iPeriod      = 256; // longer than the maximum delay
+        const double dW           = 2 * 3.14159265358979323846 / iPeriod;
+        const int    iLookAhead   = DRIFT_COMP_NUM_TAPS / 2 + 1;
+        const double vdDriftPpm[] = { 0.0, 100.0, -100.0 };
+        bool         bTestOK      = true;
+
+        for ( const double dDriftPpm : vdDriftPpm )
+        {
+            CDriftCompensator DriftComp;
+            CVector<float>    vecfIn ( iFrameSize, 0.0f );
+            CVector<float>    vecfOut ( iFrameSize, 0.0f );
+            int               iNumStored    = iBufNumBl / 2;
+            int               iNumOverruns  = 0;
+            int               iNumUnderruns = 0;
+            qint64            iNumInSamples = 0;
+            double            dClientTime   = 0.0;
+            double            dSumFillLevel = 0.0;
+            int               iNumFillLevel = 0;
+            double            dMinDelay     = iPeriod;
+            double            dMaxDelay     = 0.0;
+
+            DriftComp.Init ( 1, iFrameSize );
+
+            for ( int iFrame = 0; iFrame < iNumFrames; iFrame++ )
+            {
+                // the client puts its frames in the jitter buffer
+                for ( dClientTime += 1.0 + dDriftPpm * 1e-6; dClientTime >= 1.0; dClientTime -= 1.0 )
+                {
+                    if ( iNumStored < iBufNumBl )
+                    {
+                        iNumStored++;
+                    }
+                    else
+                    {
+                        iNumOverruns++;
+                    }
+                }
+
+                // the server reads the frames which are required for one output
+                // frame (same processing as in the server)
+                for ( int iDec = 0; ( iDec < DRIFT_COMP_MAX_NUM_DECODES ) &&
+                                    DriftComp.IsInputRequired ( iFrameSize ); iDec++ )
+                {
+                    if ( iNumStored > 0 )
+                    {
+                        iNumStored--;
+
+                        for ( int i = 0; i < iFrameSize; i++ )
+                        {
+                            vecfIn[i] = static_cast<float> ( sin ( dW * ( iNumInSamples + i ) ) );
+                        }
+                    }
+                    else
+                    {
+                        iNumUnderruns++;
+                        vecfIn.Reset ( 0.0f );
+                    }
+
+                    DriftComp.Put ( &vecfIn[0], iFrameSize );
+                    DriftComp.UpdateFillLevel ( iNumStored, iBufNumBl, iFrameSize );
+
+                    iNumInSamples += iFrameSize;
+
+                    if ( iFrame >= iNumFrames / 2 )
+                    {
+                        dSumFillLevel += iNumStored;
+                        iNumFillLevel++;
+                    }
+                }
+
+                DriftComp.Get ( &vecfOut[0], iFrameSize );
+
+                // the delay is only evaluated after the controller has settled
+                // (without a drift, the delay must be constant from the start)
+                if ( ( iFrame < iNumFrames / 2 ) && ( ( dDriftPpm != 0.0 ) || ( iFrame == 0 ) ) )
+                {
+                    continue;
+                }
+
+                // least squares fit of a sine and a cosine to the output frame
+                double dSS = 0, dCC = 0, dSC = 0, dYS = 0, dYC = 0;
+
+                for ( int i = 0; i < iFrameSize; i++ )
+                {
+                    const double dS = sin ( dW * i );
+                    const double dC = cos ( dW * i );
+
+                    dSS += dS * dS;
+                    dCC += dC * dC;
+                    dSC += dS * dC;
+                    dYS += vecfOut[i] * dS;
+                    dYC += vecfOut[i] * dC;
+                }
+
+                const double dDet = dSS * dCC - dSC * dSC;
+                const double dA   = ( dYS * dCC - dYC * dSC ) / dDet;
+                const double dB   = ( dYC * dSS - dYS * dSC ) / dDet;
+
+                // the phase of the last output sample compared to the phase of
+                // the last input sample gives the delay
+                const double dPhaseDiff = dW * ( iNumInSamples - 1 ) - ( dW * ( iFrameSize - 1 ) + atan2 ( dB, dA ) );
+                double       dDelay     = fmod ( dPhaseDiff / dW, iPeriod );
+
+                if ( dDelay < 0 )
+                {
+                    dDelay += iPeriod;
+                }
+
+                dMinDelay = std::min ( dMinDelay, dDelay );
+                dMaxDelay = std::max ( dMaxDelay, dDelay );
+
+                if ( fabs ( sqrt ( dA * dA + dB * dB ) - 1.0 ) > 0.05 )
+                {
+                    bTestOK = false;
+                }
+            }
+
+            const double dMeanFillLevel = dSumFillLevel / std::max ( iNumFillLevel, 1 );
+
+            if ( ( iNumOverruns > 0 ) || ( iNumUnderruns > 0 ) ||
+                 ( fabs ( dMeanFillLevel - iBufNumBl / 2.0 ) > 0.5 ) ||
+                 ( dMinDelay < DRIFT_COMP_NUM_TAPS / 2 - 1.5 ) ||
+                 ( dMaxDelay > ( ( dDriftPpm == 0.0 ) ? iLookAhead + 0.5 : iLookAhead + iFrameSize + 1 ) ) )
+            {
+                bTestOK = false;
+            }
+
+            qDebug() << "drift compensator test:" << dDriftPpm << "ppm drift, ratio" << DriftComp.GetRatio() <<
+                "mean fill level" << dMeanFillLevel << "of" << iBufNumBl << "blocks, delay" << dMinDelay << "to" <<
+                dMaxDelay << "samples," << iNumOverruns << "overruns," << iNumUnderruns << "underruns";
+        }
+
+        if ( bTestOK )
+        {
+            qDebug() << "drift compensator test: passed";
+        }
+        else
+        {
+            qWarning() << "drift compensator test: FAILED";
+        }
+
+        return bTestOK;
+    }
+
 protected:
+    // the previous bit serial CRC implementation as a reference
+    static uint32_t GetBitSerialCRC ( const uint8_t* pbyData,
+                                      const int      iNumBytes )
+    {
+        const uint32_t iPoly          = ( 1 << 5 ) | ( 1 << 12 );
+        const uint32_t iBitOutMask    = 1 << 16;
+        uint32_t       iStateShiftReg = ~uint32_t ( 0 );
+
+        for ( int j = 0; j < iNumBytes; j++ )
+        {
+            for ( int i = 0; i < 8; i++ )
+            {
+                iStateShiftReg <<= 1;
+
+                if ( ( iStateShiftReg & iBitOutMask ) > 0 )
+                {
+                    iStateShiftReg |= 1;
+                }
+
+                if ( ( pbyData[j] & ( 1 << ( 8 - i - 1 ) ) ) > 0 )
+                {
+                    iStateShiftReg ^= 1;
+                }
+
+                if ( iStateShiftReg & 1 )
+                {
+                    iStateShiftReg ^= iPoly;
+                }
+            }
+        }
+
+        return ~iStateShiftReg & ( iBitOutMask - 1 );
+    }
+
     int GenRandomIntInRange ( const int iStart, const int iEnd ) const
     {
         return static_cast<int> ( iStart +
@@ -186,7 +1181,7 @@ public slots:
             NetTrProps.iBlockSizeFact         = GenRandomIntInRange ( -2, 100 );
             NetTrProps.iNumAudioChannels      = GenRandomIntInRange ( -2, 10 );
             NetTrProps.iSampleRate            = GenRandomIntInRange ( -2, 10000 );
-            NetTrProps.iVersion               = GenRandomIntInRange ( -2, 10000 );
+            NetTrProps.iFlags                 = GenRandomIntInRange ( -2, 10000 );
 
             Protocol.CreateNetwTranspPropsMes ( NetTrProps );
             break;
@@ -104,39 +104,84 @@ double CStereoSignalLevelMeter::CalcLogResult ( const double& dLinearLevel )
 
 
 // CRC -------------------------------------------------------------------------
+// The tables are calculated once at program start. Table 0 is the CRC of one
+// byte, table k is the CRC of one byte followed by k zero bytes so that four
+// bytes can be processed at once.
+class CCRCTables
+{
+public:
+    CCRCTables()
+    {
+        for ( int i = 0; i < 256; i++ )
+        {
+            uint32_t iCRC = static_cast<uint32_t> ( i ) << 8;
+
+            for ( int j = 0; j < 8; j++ )
+            {
+                iCRC <<= 1;
+
+                if ( iCRC & 0x10000 )
+                {
+                    iCRC ^= CRC_POLYNOMIAL;
+                }
+            }
+
+            Table[0][i] = static_cast<uint16_t> ( iCRC );
+        }
+
+        for ( int k = 1; k < 4; k++ )
+        {
+            for ( int i = 0; i < 256; i++ )
+            {
+                const uint16_t iPrev = Table[k - 1][i];
+
+                Table[k][i] = static_cast<uint16_t> ( ( iPrev << 8 ) ^ Table[0][iPrev >> 8] );
+            }
+        }
+    }
+
+    // x^16 + x^12 + x^5 + 1 (the x^16 term is the bit which is shifted out)
+    static const uint32_t CRC_POLYNOMIAL = 0x11021;
+
+    uint16_t Table[4][256];
+};
+
+static const CCRCTables CRCTables;
+
 void CCRC::Reset()
 {
-    // init state shift-register with ones. Set all registers to "1" with
-    // bit-wise not operation
-    iStateShiftReg = ~uint32_t ( 0 );
+    // init state shift-register with ones
+    iStateShiftReg = 0xFFFF;
 }
 
 void CCRC::AddByte ( const uint8_t byNewInput )
 {
-    for ( int i = 0; i < 8; i++ )
-    {
-        // shift bits in shift-register for transistion
-        iStateShiftReg <<= 1;
+    iStateShiftReg = ( ( iStateShiftReg << 8 ) & 0xFFFF ) ^
+        CRCTables.Table[0][( ( iStateShiftReg >> 8 ) ^ byNewInput ) & 0xFF];
+}
 
-        // take bit, which was shifted out of the register-size and place it
-        // at the beginning (LSB)
-        // (If condition is not satisfied, implicitely a "0" is added)
-        if ( ( iStateShiftReg & iBitOutMask) > 0 )
-        {
-            iStateShiftReg |= 1;
-        }
+void CCRC::AddBytes ( const uint8_t* pbyNewInput,
+                      const int      iNumBytes )
+{
+    uint32_t iCRC = iStateShiftReg;
+    int      i    = 0;
 
-        // add new data bit to the LSB
-        if ( ( byNewInput & ( 1 << ( 8 - i - 1 ) ) ) > 0 )
-        {
-            iStateShiftReg ^= 1;
-        }
+    // four bytes per step: the two bytes of the shift register are combined
+    // with the first two input bytes
+    for ( ; i + 4 <= iNumBytes; i += 4 )
+    {
+        iCRC = CRCTables.Table[3][( ( iCRC >> 8 ) ^ pbyNewInput[i] ) & 0xFF] ^
+               CRCTables.Table[2][( iCRC ^ pbyNewInput[i + 1] ) & 0xFF] ^
+               CRCTables.Table[1][pbyNewInput[i + 2]] ^
+               CRCTables.Table[0][pbyNewInput[i + 3]];
+    }
 
-        // add mask to shift-register if first bit is true
-        if ( iStateShiftReg & 1 )
-        {
-            iStateShiftReg ^= iPoly;
-        }
+    iStateShiftReg = iCRC;
+
+    // remaining bytes
+    for ( ; i < iNumBytes; i++ )
+    {
+        AddByte ( pbyNewInput[i] );
     }
 }
 
@@ -145,8 +190,8 @@ uint32_t CCRC::GetCRC()
     // return inverted shift-register (1's complement)
     iStateShiftReg = ~iStateShiftReg;
 
-    // remove bit which where shifted out of the shift-register frame
-    return iStateShiftReg & ( iBitOutMask - 1 );
+    // remove bits which are outside of the 16 bit shift-register
+    return iStateShiftReg & 0xFFFF;
 }
 
 
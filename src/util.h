@@ -254,6 +254,98 @@ template<class TData> int CVector<TData>::StringFiFoWithCompare ( const QString
 
 
 
+/******************************************************************************\
+* CAlignedMatrix Class                                                         *
+\******************************************************************************/
+// Dense two dimensional array which is stored in one contiguous memory block.
+// Each row starts at an AUDIO_BUFFER_ALIGNMENT_BYTES boundary (the rows are
+// padded accordingly) so that rows can be processed with SIMD instructions and
+// rows which are written by different threads do not share a cache line.
+// The element type must be a plain data type.
+template<class TData> class CAlignedMatrix
+{
+public:
+    CAlignedMatrix() : pData ( nullptr ), iNumRows ( 0 ), iRowLength ( 0 ), iRowStride ( 0 ) {}
+    ~CAlignedMatrix() { qFreeAligned ( pData ); }
+
+    void Init ( const int iNewNumRows,
+                const int iNewRowLength );
+
+    // set all values to the given reset value
+    void Reset ( const TData tResetVal )
+    {
+        std::fill ( pData, pData + iNumRows * iRowStride, tResetVal );
+    }
+
+    int NumRows() const { return iNumRows; }
+    int RowLength() const { return iRowLength; }
+
+    // returns a pointer to the first element of the given row so that
+    // Matrix[x][y] is possible
+    inline TData* operator[] ( const int iRow )
+    {
+#ifdef _DEBUG_
+        if ( ( iRow < 0 ) || ( iRow > iNumRows - 1 ) )
+        {
+            DebugError ( "Accessing matrix out of bounds", "Number of rows",
+                iNumRows, "Row index", iRow );
+        }
+#endif
+        return pData + iRow * iRowStride;
+    }
+
+    inline const TData* operator[] ( const int iRow ) const
+    {
+#ifdef _DEBUG_
+        if ( ( iRow < 0 ) || ( iRow > iNumRows - 1 ) )
+        {
+            DebugError ( "Accessing matrix out of bounds", "Number of rows",
+                iNumRows, "Row index", iRow );
+        }
+#endif
+        return pData + iRow * iRowStride;
+    }
+
+protected:
+    Q_DISABLE_COPY ( CAlignedMatrix )
+
+    TData* pData;
+    int    iNumRows;
+    int    iRowLength;
+    int    iRowStride;
+};
+
+template<class TData> void CAlignedMatrix<TData>::Init ( const int iNewNumRows,
+                                                         const int iNewRowLength )
+{
+    // pad the rows to a multiple of the alignment
+    const int iElemPerAlign = std::max ( 1, static_cast<int> ( AUDIO_BUFFER_ALIGNMENT_BYTES / sizeof ( TData ) ) );
+
+    iNumRows   = iNewNumRows;
+    iRowLength = iNewRowLength;
+    iRowStride = ( ( iNewRowLength + iElemPerAlign - 1 ) / iElemPerAlign ) * iElemPerAlign;
+
+    // free old memory and allocate the new block (at least one alignment
+    // block so that the pointer is always valid)
+    qFreeAligned ( pData );
+
+    pData = static_cast<TData*> ( qMallocAligned ( std::max ( 1, iNumRows * iRowStride ) * sizeof ( TData ),
+                                                   AUDIO_BUFFER_ALIGNMENT_BYTES ) );
+
+    if ( pData == nullptr )
+    {
+        // leave an empty matrix behind so that the destructor is still safe
+        iNumRows   = 0;
+        iRowLength = 0;
+        iRowStride = 0;
+
+        throw CGenErr ( "Cannot allocate the memory for the audio buffers." );
+    }
+
+    Reset ( TData() );
+}
+
+
 /******************************************************************************\
 * CFIFO Class (First In, First Out)                                            *
 \******************************************************************************/
@@ -524,6 +616,18 @@ enum EAudComprType
 };
 
 
+// Network transport flags enum ------------------------------------------------
+enum ENetwTranspFlags
+{
+    // used for protocol -> enum values must be fixed!
+    NF_NONE                 = 0,
+    NF_WITH_SEQUENCE_NUMBER = 1, // audio packets with sequence number trailer
+    NF_WITH_REDUNDANCY      = 2, // audio packets with a copy of the previous packet
+    NF_WITH_ADAPTIVE_SIZE   = 4, // server audio packets with an adapted size
+    NF_WITH_MANY_CHANNELS   = 8  // more than MAX_NUM_CHANNELS_LEGACY channels
+};
+
+
 // Audio quality enum ----------------------------------------------------------
 enum EAudioQuality
 {
@@ -1022,6 +1126,7 @@ public:
         iNumAudioChannels      ( 0 ),
         iSampleRate            ( 0 ),
         eAudioCodingType       ( CT_NONE ),
+        iFlags                 ( NF_NONE ),
         iAudioCodingArg        ( 0 ) {}
 
     CNetworkTransportProps ( const uint32_t      iNBNPS,
@@ -1029,14 +1134,14 @@ public:
                              const uint32_t      iNNACH,
                              const uint32_t      iNSR,
                              const EAudComprType eNACT,
-                             const uint32_t      iNVers,
+                             const uint32_t      iNFlags,
                              const int32_t       iNACA ) :
         iBaseNetworkPacketSize ( iNBNPS ),
         iBlockSizeFact         ( iNBSF ),
         iNumAudioChannels      ( iNNACH ),
         iSampleRate            ( iNSR ),
         eAudioCodingType       ( eNACT ),
-        iVersion               ( iNVers ),
+        iFlags                 ( iNFlags ),
         iAudioCodingArg        ( iNACA ) {}
 
     uint32_t      iBaseNetworkPacketSize;
@@ -1044,7 +1149,7 @@ public:
     uint32_t      iNumAudioChannels;
     uint32_t      iSampleRate;
     EAudComprType eAudioCodingType;
-    uint32_t      iVersion;
+    uint32_t      iFlags;
     int32_t       iAudioCodingArg;
 };
 
@@ -1147,20 +1252,22 @@ protected:
 
 
 // CRC -------------------------------------------------------------------------
+// 16 bit CRC with the polynomial x^16 + x^12 + x^5 + 1 (MSB first, the shift
+// register is initialized with ones and the result is inverted). The CRC is
+// table driven, AddBytes() processes four bytes per step (slicing-by-4).
 class CCRC
 {
 public:
-    CCRC() : iPoly ( ( 1 << 5 ) | ( 1 << 12 ) ), iBitOutMask ( 1 << 16 )
-        { Reset(); }
+    CCRC() { Reset(); }
 
     void Reset();
     void AddByte ( const uint8_t byNewInput );
+    void AddBytes ( const uint8_t* pbyNewInput,
+                    const int      iNumBytes );
     bool CheckCRC ( const uint32_t iCRC ) { return iCRC == GetCRC(); }
     uint32_t GetCRC();
 
 protected:
-    uint32_t iPoly;
-    uint32_t iBitOutMask;
     uint32_t iStateShiftReg;
 };
 
@@ -1292,6 +1399,71 @@ protected:
 };
 
 
+// Processing time measurement -------------------------------------------------
+// measures the processing time of a part of the server audio processing per
+// frame, the statistic is reset if the number of clients changes so that a
+// report always refers to one fixed number of connected clients
+class CProcessingTimeMeas
+{
+public:
+    CProcessingTimeMeas() : bIsEnabled ( false ), iNumClients ( 0 ) { Reset(); }
+
+    void SetEnable ( const bool bNEn ) { bIsEnabled = bNEn; }
+    bool IsEnabled() const { return bIsEnabled; }
+
+    void Reset()
+    {
+        iNumFrames  = 0;
+        iSumTimeNs  = 0;
+        iMaxTimeNs  = 0;
+        ReportTimer.start();
+    }
+
+    void Start()
+    {
+        if ( bIsEnabled )
+        {
+            ElapsedTimer.start();
+        }
+    }
+
+    void Stop ( const int iNewNumClients )
+    {
+        const qint64 iCurTimeNs = ElapsedTimer.nsecsElapsed();
+
+        if ( iNewNumClients != iNumClients )
+        {
+            iNumClients = iNewNumClients;
+            Reset();
+        }
+
+        iSumTimeNs += iCurTimeNs;
+        iMaxTimeNs  = std::max ( iMaxTimeNs, iCurTimeNs );
+        iNumFrames++;
+    }
+
+    bool IsReportReady() const
+    {
+        return ( iNumFrames > 0 ) &&
+               ( ReportTimer.elapsed() >= PROCESSING_TIME_REPORT_INTERVAL_MS );
+    }
+
+    int    GetNumClients() const { return iNumClients; }
+    int    GetNumFrames() const { return iNumFrames; }
+    double GetAvTimeUs() const { return static_cast<double> ( iSumTimeNs ) / iNumFrames / 1000; }
+    double GetMaxTimeUs() const { return static_cast<double> ( iMaxTimeNs ) / 1000; }
+
+protected:
+    bool          bIsEnabled;
+    int           iNumClients;
+    int           iNumFrames;
+    qint64        iSumTimeNs;
+    qint64        iMaxTimeNs;
+    QElapsedTimer ElapsedTimer;
+    QElapsedTimer ReportTimer;
+};
+
+
 /******************************************************************************\
 * Statistics                                                                   *
 \******************************************************************************/